@@ -0,0 +1,521 @@
+#include "pch.hpp"
+#include "AssetArchive.hpp"
+#include <climits>
+#ifdef DX_ARCHIVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef DX_ARCHIVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace dx
+{
+    namespace
+    {
+        constexpr std::array<char, 4> kMagic = {'D', 'X', 'A', 'R'};
+        constexpr std::uint32_t kVersion = 1;
+
+        // 文件头：magic、version、条目数、哈希表大小，然后是哈希表、条目表
+        // 和名字的偏移，以及名字的总长度。
+        constexpr std::size_t kHeaderSize = 48;
+        // 哈希表中每一项是条目下标加一，0 表示空。
+        constexpr std::size_t kBucketSize = 4;
+        // hash、offset、storedSize、size、nameOffset、nameSize、compression
+        // 以及一个保留字节。
+        constexpr std::size_t kEntrySize = 40;
+
+        template<typename T>
+        void AppendLe(std::vector<std::byte>& out, T value)
+        {
+            static_assert(std::is_integral_v<T>);
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+            {
+                out.push_back(static_cast<std::byte>(
+                    static_cast<std::make_unsigned_t<T>>(value) >> (i * 8)));
+            }
+        }
+
+        template<typename T>
+        T LoadLe(const std::byte* bytes) noexcept
+        {
+            static_assert(std::is_integral_v<T>);
+            std::make_unsigned_t<T> value = 0;
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+            {
+                value |= static_cast<std::make_unsigned_t<T>>(
+                    static_cast<std::make_unsigned_t<T>>(bytes[i]) << (i * 8));
+            }
+            return static_cast<T>(value);
+        }
+
+        std::uint64_t AlignUp(std::uint64_t value,
+                              std::uint64_t alignment) noexcept
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // [offset, offset + size) 在 [0, total) 之内，不会溢出。
+        bool Fits(std::uint64_t offset, std::uint64_t size,
+                  std::uint64_t total) noexcept
+        {
+            return offset <= total && size <= total - offset;
+        }
+
+        std::uint32_t BucketCountFor(std::size_t entryCount) noexcept
+        {
+            // 至少留一半空位，探测序列一定会遇到空位而停下。
+            std::uint32_t count = 1;
+            while (count < entryCount * 2 + 1)
+                count *= 2;
+            return count;
+        }
+
+        const char* CompressionName(ArchiveCompression compression) noexcept
+        {
+            switch (compression)
+            {
+                case ArchiveCompression::kLz4:
+                    return "LZ4";
+                case ArchiveCompression::kZstd:
+                    return "Zstd";
+                default:
+                    return "None";
+            }
+        }
+
+        void RequireSupported(ArchiveCompression compression)
+        {
+            if (!IsCompressionSupported(compression))
+                throw AssetArchiveError{
+                    fmt::format("EasyDx was built without {} support",
+                                CompressionName(compression))};
+        }
+
+        std::vector<std::byte> Compress(gsl::span<const std::byte> bytes,
+                                        ArchiveCompression compression)
+        {
+            RequireSupported(compression);
+            std::vector<std::byte> compressed;
+            const auto size = static_cast<std::size_t>(bytes.size());
+#ifdef DX_ARCHIVE_LZ4
+            if (compression == ArchiveCompression::kLz4)
+            {
+                if (size > LZ4_MAX_INPUT_SIZE)
+                    return {};
+                compressed.resize(static_cast<std::size_t>(
+                    LZ4_compressBound(static_cast<int>(size))));
+                const int written = LZ4_compress_default(
+                    reinterpret_cast<const char*>(bytes.data()),
+                    reinterpret_cast<char*>(compressed.data()),
+                    static_cast<int>(size),
+                    static_cast<int>(compressed.size()));
+                compressed.resize(
+                    static_cast<std::size_t>(std::max(written, 0)));
+            }
+#endif
+#ifdef DX_ARCHIVE_ZSTD
+            if (compression == ArchiveCompression::kZstd)
+            {
+                compressed.resize(ZSTD_compressBound(size));
+                const std::size_t written =
+                    ZSTD_compress(compressed.data(), compressed.size(),
+                                  bytes.data(), size, ZSTD_CLEVEL_DEFAULT);
+                compressed.resize(ZSTD_isError(written) ? 0 : written);
+            }
+#endif
+            (void)size;
+            return compressed;
+        }
+
+        std::vector<std::byte> Decompress(gsl::span<const std::byte> stored,
+                                          std::uint64_t size,
+                                          ArchiveCompression compression)
+        {
+            RequireSupported(compression);
+            std::vector<std::byte> bytes(gsl::narrow<std::size_t>(size));
+            bool ok = false;
+#ifdef DX_ARCHIVE_LZ4
+            if (compression == ArchiveCompression::kLz4 && size <= INT_MAX &&
+                stored.size() <= INT_MAX)
+            {
+                const int read = LZ4_decompress_safe(
+                    reinterpret_cast<const char*>(stored.data()),
+                    reinterpret_cast<char*>(bytes.data()),
+                    static_cast<int>(stored.size()),
+                    static_cast<int>(bytes.size()));
+                ok = read >= 0 && static_cast<std::uint64_t>(read) == size;
+            }
+#endif
+#ifdef DX_ARCHIVE_ZSTD
+            if (compression == ArchiveCompression::kZstd)
+            {
+                const std::size_t read =
+                    ZSTD_decompress(bytes.data(), bytes.size(), stored.data(),
+                                    static_cast<std::size_t>(stored.size()));
+                ok = !ZSTD_isError(read) && read == size;
+            }
+#endif
+            (void)stored;
+            if (!ok)
+                throw AssetArchiveError{"Corrupted compressed archive entry"};
+            return bytes;
+        }
+    } // namespace
+
+    bool IsCompressionSupported(ArchiveCompression compression) noexcept
+    {
+        switch (compression)
+        {
+            case ArchiveCompression::kNone:
+                return true;
+#ifdef DX_ARCHIVE_LZ4
+            case ArchiveCompression::kLz4:
+                return true;
+#endif
+#ifdef DX_ARCHIVE_ZSTD
+            case ArchiveCompression::kZstd:
+                return true;
+#endif
+            default:
+                return false;
+        }
+    }
+
+    std::string ArchiveName(const fs::path& relativePath)
+    {
+        return relativePath.lexically_normal().generic_u8string();
+    }
+
+    AssetArchiveWriter::AssetArchiveWriter(const fs::path& path)
+        : m_path{path}, m_file{path, std::ios::binary | std::ios::trunc}
+    {
+        if (!m_file)
+            throw AssetArchiveError{"Failed to create " + path.u8string()};
+        // 文件头在 Finish 时才写入。
+        WriteZeros(kHeaderSize);
+    }
+
+    AssetArchiveWriter::~AssetArchiveWriter() = default;
+
+    void AssetArchiveWriter::Add(std::string_view name,
+                                 gsl::span<const std::byte> bytes,
+                                 ArchiveCompression compression)
+    {
+        Expects(!m_finished);
+        if (name.size() > std::numeric_limits<std::uint16_t>::max())
+            throw AssetArchiveError{"Archive entry name is too long"};
+        if (!m_names.insert(std::string{name}).second)
+            throw AssetArchiveError{"Duplicate archive entry " +
+                                    std::string{name}};
+
+        std::vector<std::byte> compressed;
+        if (compression != ArchiveCompression::kNone)
+        {
+            compressed = Compress(bytes, compression);
+            if (compressed.empty() ||
+                compressed.size() >= static_cast<std::size_t>(bytes.size()))
+                compression = ArchiveCompression::kNone;
+        }
+        const gsl::span<const std::byte> stored =
+            compression == ArchiveCompression::kNone
+                ? bytes
+                : gsl::span<const std::byte>{compressed};
+
+        WriteZeros(AlignUp(m_offset, kArchiveAlignment) - m_offset);
+        m_entries.push_back(PendingEntry{
+            std::string{name}, m_offset,
+            static_cast<std::uint64_t>(stored.size()),
+            static_cast<std::uint64_t>(bytes.size()), compression});
+        m_file.write(reinterpret_cast<const char*>(stored.data()),
+                     static_cast<std::streamsize>(stored.size()));
+        m_offset += static_cast<std::uint64_t>(stored.size());
+    }
+
+    void AssetArchiveWriter::AddFile(std::string_view name,
+                                     const fs::path& file,
+                                     ArchiveCompression compression)
+    {
+        const MappedFile mapped{file, MappedFileHints::kSequential};
+        Add(name, mapped.Bytes(), compression);
+    }
+
+    void AssetArchiveWriter::AddDirectory(const fs::path& root,
+                                          ArchiveCompression compression)
+    {
+        std::vector<std::pair<std::string, fs::path>> files;
+        for (const auto& entry : fs::recursive_directory_iterator{root})
+        {
+            if (entry.is_regular_file())
+                files.emplace_back(
+                    ArchiveName(entry.path().lexically_relative(root)),
+                    entry.path());
+        }
+        std::sort(files.begin(), files.end());
+        for (const auto& [name, path] : files)
+        {
+            AddFile(name, path, compression);
+        }
+    }
+
+    void AssetArchiveWriter::Finish()
+    {
+        Expects(!m_finished);
+        m_finished = true;
+        WriteZeros(AlignUp(m_offset, 8) - m_offset);
+
+        const auto entryCount = gsl::narrow<std::uint32_t>(m_entries.size());
+        const std::uint32_t bucketCount = BucketCountFor(m_entries.size());
+        std::vector<std::uint32_t> buckets(bucketCount, 0);
+        std::vector<std::byte> toc;
+        std::vector<std::byte> names;
+        for (std::uint32_t i = 0; i < entryCount; ++i)
+        {
+            const PendingEntry& entry = m_entries[i];
+            const std::uint64_t hash = Fnv1a64(entry.Name);
+            std::uint32_t bucket = static_cast<std::uint32_t>(hash) &
+                                   (bucketCount - 1);
+            while (buckets[bucket] != 0)
+                bucket = (bucket + 1) & (bucketCount - 1);
+            buckets[bucket] = i + 1;
+        }
+
+        const std::uint64_t bucketsOffset = m_offset;
+        for (const std::uint32_t bucket : buckets)
+        {
+            AppendLe(toc, bucket);
+        }
+        toc.resize(static_cast<std::size_t>(AlignUp(toc.size(), 8)));
+        const std::uint64_t entriesOffset = bucketsOffset + toc.size();
+        for (const PendingEntry& entry : m_entries)
+        {
+            AppendLe(toc, Fnv1a64(entry.Name));
+            AppendLe(toc, entry.Offset);
+            AppendLe(toc, entry.StoredSize);
+            AppendLe(toc, entry.Size);
+            AppendLe(toc, gsl::narrow<std::uint32_t>(names.size()));
+            AppendLe(toc, static_cast<std::uint16_t>(entry.Name.size()));
+            AppendLe(toc, static_cast<std::uint8_t>(entry.Compression));
+            AppendLe(toc, std::uint8_t{0});
+            for (const char c : entry.Name)
+            {
+                names.push_back(static_cast<std::byte>(c));
+            }
+        }
+        const std::uint64_t namesOffset = bucketsOffset + toc.size();
+        toc.insert(toc.end(), names.begin(), names.end());
+        m_file.write(reinterpret_cast<const char*>(toc.data()),
+                     static_cast<std::streamsize>(toc.size()));
+
+        std::vector<std::byte> header;
+        for (const char c : kMagic)
+        {
+            AppendLe(header, c);
+        }
+        AppendLe(header, kVersion);
+        AppendLe(header, entryCount);
+        AppendLe(header, bucketCount);
+        AppendLe(header, bucketsOffset);
+        AppendLe(header, entriesOffset);
+        AppendLe(header, namesOffset);
+        AppendLe(header, static_cast<std::uint64_t>(names.size()));
+        Ensures(header.size() == kHeaderSize);
+        m_file.seekp(0);
+        m_file.write(reinterpret_cast<const char*>(header.data()),
+                     static_cast<std::streamsize>(header.size()));
+        m_file.close();
+        if (!m_file)
+            throw AssetArchiveError{"Failed to write " + m_path.u8string()};
+    }
+
+    void AssetArchiveWriter::WriteZeros(std::uint64_t count)
+    {
+        static const std::array<char, 4096> zeros{};
+        for (std::uint64_t left = count; left > 0;)
+        {
+            const auto chunk = std::min<std::uint64_t>(left, zeros.size());
+            m_file.write(zeros.data(), static_cast<std::streamsize>(chunk));
+            left -= chunk;
+        }
+        m_offset += count;
+    }
+
+    gsl::span<const std::byte> ArchiveBytes::Bytes() const& noexcept
+    {
+        using Mapped = gsl::span<const std::byte>;
+        if (const auto mapped = std::get_if<Mapped>(&m_bytes))
+            return *mapped;
+        return std::get<std::vector<std::byte>>(m_bytes);
+    }
+
+    AssetArchive::AssetArchive(const fs::path& path) : m_file{path}
+    {
+        const gsl::span<const std::byte> file = m_file.Bytes();
+        const auto fileSize = static_cast<std::uint64_t>(file.size());
+        const auto invalid = [&](const char* what) {
+            return AssetArchiveError{
+                fmt::format("{} is not a valid archive: {}", path.u8string(),
+                            what)};
+        };
+        if (fileSize < kHeaderSize)
+            throw invalid("truncated header");
+        const std::byte* const header = file.data();
+        for (std::size_t i = 0; i < kMagic.size(); ++i)
+        {
+            if (static_cast<char>(header[i]) != kMagic[i])
+                throw invalid("bad magic");
+        }
+        if (LoadLe<std::uint32_t>(header + 4) != kVersion)
+            throw invalid("unsupported version");
+        m_entryCount = LoadLe<std::uint32_t>(header + 8);
+        m_bucketCount = LoadLe<std::uint32_t>(header + 12);
+        const auto bucketsOffset = LoadLe<std::uint64_t>(header + 16);
+        const auto entriesOffset = LoadLe<std::uint64_t>(header + 24);
+        const auto namesOffset = LoadLe<std::uint64_t>(header + 32);
+        const auto namesSize = LoadLe<std::uint64_t>(header + 40);
+
+        if (m_bucketCount == 0 || (m_bucketCount & (m_bucketCount - 1)) != 0 ||
+            m_bucketCount <= m_entryCount)
+            throw invalid("bad hash table size");
+        if (!Fits(bucketsOffset,
+                  std::uint64_t{m_bucketCount} * kBucketSize, fileSize) ||
+            !Fits(entriesOffset, std::uint64_t{m_entryCount} * kEntrySize,
+                  fileSize) ||
+            !Fits(namesOffset, namesSize, fileSize))
+            throw invalid("table of contents out of range");
+        m_buckets = file.data() + bucketsOffset;
+        m_entries = file.data() + entriesOffset;
+        m_names = file.data() + namesOffset;
+        m_file.Prefetch(static_cast<std::size_t>(bucketsOffset),
+                        static_cast<std::size_t>(namesOffset + namesSize -
+                                                 bucketsOffset));
+
+        // 之后的查找和读取都相信目录，不再检查。每个条目恰好占一个桶，
+        // 桶又比条目多，所以 FindIndex 的线性探测一定会遇到空桶。
+        std::vector<bool> inBucket(m_entryCount);
+        std::uint32_t usedBuckets = 0;
+        for (std::uint32_t i = 0; i < m_bucketCount; ++i)
+        {
+            const auto slot =
+                LoadLe<std::uint32_t>(m_buckets + i * kBucketSize);
+            if (slot == 0)
+                continue;
+            if (slot > m_entryCount || inBucket[slot - 1])
+                throw invalid("bad hash table entry");
+            inBucket[slot - 1] = true;
+            ++usedBuckets;
+        }
+        if (usedBuckets != m_entryCount)
+            throw invalid("entries missing from the hash table");
+        for (std::uint32_t i = 0; i < m_entryCount; ++i)
+        {
+            const std::byte* const record = EntryRecord(i);
+            const auto offset = LoadLe<std::uint64_t>(record + 8);
+            const auto storedSize = LoadLe<std::uint64_t>(record + 16);
+            const auto size = LoadLe<std::uint64_t>(record + 24);
+            const auto nameOffset = LoadLe<std::uint32_t>(record + 32);
+            const auto nameSize = LoadLe<std::uint16_t>(record + 36);
+            const auto compression = LoadLe<std::uint8_t>(record + 38);
+            if (offset % kArchiveAlignment != 0 ||
+                !Fits(offset, storedSize, fileSize))
+                throw invalid("entry data out of range");
+            if (!Fits(nameOffset, nameSize, namesSize))
+                throw invalid("entry name out of range");
+            if (compression > static_cast<std::uint8_t>(
+                                  ArchiveCompression::kZstd) ||
+                (compression == 0 && storedSize != size))
+                throw invalid("bad entry compression");
+            const std::string_view name{
+                reinterpret_cast<const char*>(m_names + nameOffset),
+                nameSize};
+            if (LoadLe<std::uint64_t>(record) != Fnv1a64(name))
+                throw invalid("entry hash mismatch");
+        }
+    }
+
+    ArchiveEntryInfo AssetArchive::EntryAt(std::size_t index) const
+    {
+        Expects(index < m_entryCount);
+        const std::byte* const record = EntryRecord(index);
+        const auto nameOffset = LoadLe<std::uint32_t>(record + 32);
+        const auto nameSize = LoadLe<std::uint16_t>(record + 36);
+        return ArchiveEntryInfo{
+            std::string_view{
+                reinterpret_cast<const char*>(m_names + nameOffset), nameSize},
+            LoadLe<std::uint64_t>(record + 24),
+            LoadLe<std::uint64_t>(record + 16),
+            static_cast<ArchiveCompression>(LoadLe<std::uint8_t>(record + 38))};
+    }
+
+    std::optional<ArchiveEntryInfo>
+    AssetArchive::Find(std::string_view name) const
+    {
+        if (const auto index = FindIndex(name))
+            return EntryAt(*index);
+        return std::nullopt;
+    }
+
+    ArchiveBytes AssetArchive::Read(std::string_view name) const
+    {
+        const std::uint32_t index = RequireIndex(name);
+        const ArchiveEntryInfo info = EntryAt(index);
+        if (info.Compression == ArchiveCompression::kNone)
+            return ArchiveBytes{StoredBytes(index)};
+        return ArchiveBytes{
+            Decompress(StoredBytes(index), info.Size, info.Compression)};
+    }
+
+    gsl::span<const std::byte> AssetArchive::View(std::string_view name) const
+    {
+        const std::uint32_t index = RequireIndex(name);
+        if (EntryAt(index).Compression != ArchiveCompression::kNone)
+            throw AssetArchiveError{"Archive entry " + std::string{name} +
+                                    " is compressed"};
+        return StoredBytes(index);
+    }
+
+    std::optional<std::uint32_t>
+    AssetArchive::FindIndex(std::string_view name) const
+    {
+        if (m_bucketCount == 0)
+            return std::nullopt;
+        const std::uint64_t hash = Fnv1a64(name);
+        const std::uint32_t mask = m_bucketCount - 1;
+        for (std::uint32_t bucket = static_cast<std::uint32_t>(hash) & mask;;
+             bucket = (bucket + 1) & mask)
+        {
+            const auto slot =
+                LoadLe<std::uint32_t>(m_buckets + bucket * kBucketSize);
+            if (slot == 0)
+                return std::nullopt;
+            const std::uint32_t index = slot - 1;
+            if (LoadLe<std::uint64_t>(EntryRecord(index)) == hash &&
+                EntryAt(index).Name == name)
+                return index;
+        }
+    }
+
+    const std::byte* AssetArchive::EntryRecord(std::size_t index) const
+        noexcept
+    {
+        return m_entries + index * kEntrySize;
+    }
+
+    gsl::span<const std::byte>
+    AssetArchive::StoredBytes(std::size_t index) const
+    {
+        const std::byte* const record = EntryRecord(index);
+        const auto offset = LoadLe<std::uint64_t>(record + 8);
+        const auto storedSize = LoadLe<std::uint64_t>(record + 16);
+        return m_file.Bytes().subspan(
+            static_cast<std::ptrdiff_t>(offset),
+            static_cast<std::ptrdiff_t>(storedSize));
+    }
+
+    std::uint32_t AssetArchive::RequireIndex(std::string_view name) const
+    {
+        if (const auto index = FindIndex(name))
+            return *index;
+        throw AssetArchiveError{"No archive entry named " +
+                                std::string{name}};
+    }
+} // namespace dx
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <fstream>
+#include <unordered_set>
+
+namespace dx
+{
+    // 条目的压缩方式。kLz4 和 kZstd 分别需要定义 DX_ARCHIVE_LZ4、
+    // DX_ARCHIVE_ZSTD 并链接对应的库，否则写入和读取这样的条目都会抛出
+    // AssetArchiveError。
+    enum class ArchiveCompression : std::uint8_t
+    {
+        kNone,
+        kLz4,
+        kZstd
+    };
+
+    bool IsCompressionSupported(ArchiveCompression compression) noexcept;
+
+    // 每个条目的起始位置都按 64 KiB 对齐，与 Windows 的映射粒度一致，
+    // 以后可以单独映射一个条目。
+    inline constexpr std::uint64_t kArchiveAlignment = 64 * 1024;
+
+    struct ArchiveEntryInfo
+    {
+        // 指向映射的目录，与 AssetArchive 的生命周期相同。
+        std::string_view Name;
+        // 解压之后的大小。
+        std::uint64_t Size;
+        // 在文件中占用的大小，未压缩时与 Size 相同。
+        std::uint64_t StoredSize;
+        ArchiveCompression Compression;
+    };
+
+    // 格式错误、条目不存在或者不支持的压缩方式。
+    class AssetArchiveError : public std::runtime_error
+    {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // 条目在包中的名字：相对路径，统一使用 '/'。
+    std::string ArchiveName(const fs::path& relativePath);
+
+    // 把多个资源写成一个文件：
+    //
+    //   文件头 | 按 64 KiB 对齐的条目数据 ... | 哈希表 | 条目表 | 名字
+    //
+    // 所有整数都是小端。哈希表按名字的 Fnv1a64 开放寻址，查找时不需要解析
+    // 整个目录。Finish 之前文件头是空的，中途失败的文件不会被当成有效的包。
+    class AssetArchiveWriter : Noncopyable
+    {
+      public:
+        explicit AssetArchiveWriter(const fs::path& path);
+        ~AssetArchiveWriter();
+
+        // 压缩之后没有变小的条目按不压缩存储。名字不能重复。
+        void Add(std::string_view name, gsl::span<const std::byte> bytes,
+                 ArchiveCompression compression = ArchiveCompression::kNone);
+        void AddFile(std::string_view name, const fs::path& file,
+                     ArchiveCompression compression =
+                         ArchiveCompression::kNone);
+        // root 下的所有文件，名字是相对 root 的路径，按名字排序写入。
+        void AddDirectory(const fs::path& root,
+                          ArchiveCompression compression =
+                              ArchiveCompression::kNone);
+
+        void Finish();
+
+      private:
+        struct PendingEntry
+        {
+            std::string Name;
+            std::uint64_t Offset;
+            std::uint64_t StoredSize;
+            std::uint64_t Size;
+            ArchiveCompression Compression;
+        };
+
+        void WriteZeros(std::uint64_t count);
+
+        fs::path m_path;
+        std::ofstream m_file;
+        std::vector<PendingEntry> m_entries;
+        std::unordered_set<std::string> m_names;
+        std::uint64_t m_offset = 0;
+        bool m_finished = false;
+    };
+
+    // 一个条目的内容：未压缩的条目直接指向映射的文件，压缩的条目解压到
+    // 自己持有的内存中。
+    class ArchiveBytes
+    {
+      public:
+        explicit ArchiveBytes(gsl::span<const std::byte> mapped) noexcept
+            : m_bytes{mapped}
+        {}
+        explicit ArchiveBytes(std::vector<std::byte> owned)
+            : m_bytes{std::move(owned)}
+        {}
+
+        gsl::span<const std::byte> Bytes() const& noexcept;
+        bool IsZeroCopy() const noexcept
+        {
+            return std::holds_alternative<gsl::span<const std::byte>>(m_bytes);
+        }
+
+      private:
+        std::variant<gsl::span<const std::byte>, std::vector<std::byte>>
+            m_bytes;
+    };
+
+    // 只读地映射整个包，打开时检查一遍目录，之后的查找只是几次内存访问，
+    // 不需要任何系统调用。可以在多个线程中同时读取。
+    class AssetArchive : Noncopyable
+    {
+      public:
+        explicit AssetArchive(const fs::path& path);
+        DEFAULT_MOVE(AssetArchive)
+
+        std::size_t EntryCount() const noexcept { return m_entryCount; }
+        ArchiveEntryInfo EntryAt(std::size_t index) const;
+        std::optional<ArchiveEntryInfo> Find(std::string_view name) const;
+        bool Contains(std::string_view name) const
+        {
+            return FindIndex(name).has_value();
+        }
+
+        // 条目不存在时抛出 AssetArchiveError。
+        ArchiveBytes Read(std::string_view name) const;
+        // 只用于未压缩的条目，返回的 span 与 AssetArchive 的生命周期相同。
+        gsl::span<const std::byte> View(std::string_view name) const;
+
+      private:
+        std::optional<std::uint32_t> FindIndex(std::string_view name) const;
+        const std::byte* EntryRecord(std::size_t index) const noexcept;
+        gsl::span<const std::byte> StoredBytes(std::size_t index) const;
+        std::uint32_t RequireIndex(std::string_view name) const;
+
+        MappedFile m_file;
+        std::uint32_t m_entryCount = 0;
+        std::uint32_t m_bucketCount = 0;
+        const std::byte* m_buckets = nullptr;
+        const std::byte* m_entries = nullptr;
+        const std::byte* m_names = nullptr;
+    };
+} // namespace dx
@@ -0,0 +1,341 @@
+#include "AssetWatcher.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <optional>
+#include <gsl/gsl>
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include "EasyDx.Common/Common.hpp"
+#endif
+
+namespace dx
+{
+    namespace
+    {
+        // 文件不存在时返回 min，重新出现时也算作变化。
+        fs::file_time_type LastWriteTime(const fs::path& path)
+        {
+            std::error_code ec;
+            const auto time = fs::last_write_time(path, ec);
+            return ec ? fs::file_time_type::min() : time;
+        }
+    } // namespace
+
+#ifdef _WIN32
+    // 等待目录的变更通知，超时之后照常检查一遍，通知只是让变化更早被发现。
+    class AssetWatcher::ChangeSignal
+    {
+      public:
+        ChangeSignal()
+            : m_wakeEvent{::CreateEventW(nullptr, FALSE, FALSE, nullptr)}
+        {
+            if (m_wakeEvent == nullptr)
+                ThrowWin32();
+        }
+
+        ~ChangeSignal()
+        {
+            CloseNotifications();
+            ::CloseHandle(m_wakeEvent);
+        }
+
+        void Watch(const std::vector<fs::path>& directories)
+        {
+            CloseNotifications();
+            for (const fs::path& directory : directories)
+            {
+                // 第一个位置留给 m_wakeEvent，超出的目录只靠轮询。
+                if (m_notifications.size() + 1 >= MAXIMUM_WAIT_OBJECTS)
+                    break;
+                const ::HANDLE notification = ::FindFirstChangeNotificationW(
+                    directory.c_str(), FALSE,
+                    FILE_NOTIFY_CHANGE_LAST_WRITE |
+                        FILE_NOTIFY_CHANGE_FILE_NAME);
+                if (notification != INVALID_HANDLE_VALUE)
+                    m_notifications.push_back(notification);
+            }
+        }
+
+        void Wait(std::chrono::milliseconds timeout)
+        {
+            std::vector<::HANDLE> handles{m_wakeEvent};
+            handles.insert(handles.end(), m_notifications.begin(),
+                           m_notifications.end());
+            const ::DWORD result = ::WaitForMultipleObjects(
+                static_cast<::DWORD>(handles.size()), handles.data(), FALSE,
+                static_cast<::DWORD>(timeout.count()));
+            const ::DWORD index = result - WAIT_OBJECT_0;
+            if (index > 0 && index < handles.size())
+                ::FindNextChangeNotification(handles[index]);
+        }
+
+        void Wake() { ::SetEvent(m_wakeEvent); }
+
+      private:
+        void CloseNotifications()
+        {
+            for (const ::HANDLE notification : m_notifications)
+            {
+                ::FindCloseChangeNotification(notification);
+            }
+            m_notifications.clear();
+        }
+
+        ::HANDLE m_wakeEvent;
+        std::vector<::HANDLE> m_notifications;
+    };
+#else
+    // 没有变更通知，只按 pollInterval 轮询。
+    class AssetWatcher::ChangeSignal
+    {
+      public:
+        void Watch(const std::vector<fs::path>&) {}
+
+        void Wait(std::chrono::milliseconds timeout)
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_condition.wait_for(lock, timeout, [&] { return m_woken; });
+            m_woken = false;
+        }
+
+        void Wake()
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_woken = true;
+            }
+            m_condition.notify_one();
+        }
+
+      private:
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_woken = false;
+    };
+#endif
+
+    AssetWatcher::AssetWatcher(std::chrono::milliseconds pollInterval)
+        : m_pollInterval{pollInterval},
+          m_signal{std::make_unique<ChangeSignal>()}
+    {}
+
+    AssetWatcher::~AssetWatcher() { Stop(); }
+
+    AssetWatcher::WatchId AssetWatcher::Watch(std::vector<fs::path> files,
+                                              AssetLoader loader)
+    {
+        Expects(loader != nullptr);
+        Entry entry;
+        entry.Loader = std::move(loader);
+        for (fs::path& file : files)
+        {
+            const auto lastWrite = LastWriteTime(file);
+            entry.Files.push_back(WatchedFile{std::move(file), lastWrite});
+        }
+        std::lock_guard<std::mutex> lock{m_mutex};
+        const WatchId id = m_nextId++;
+        m_entries.emplace(id, std::move(entry));
+        m_directoriesChanged = true;
+        return id;
+    }
+
+    void AssetWatcher::Unwatch(WatchId id)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_entries.erase(id);
+        m_pending.erase(id);
+        m_directoriesChanged = true;
+    }
+
+    std::size_t AssetWatcher::Poll()
+    {
+        std::lock_guard<std::mutex> pollLock{m_pollMutex};
+
+        // 只在复制和写回时持有 m_mutex，检查文件和加载时主线程不会被挡住。
+        std::vector<std::pair<WatchId, std::vector<WatchedFile>>> snapshot;
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            snapshot.reserve(m_entries.size());
+            for (const auto& [id, entry] : m_entries)
+            {
+                snapshot.emplace_back(id, entry.Files);
+            }
+        }
+
+        struct Changed
+        {
+            WatchId Id;
+            fs::path Path;
+            AssetLoader Loader;
+        };
+        std::vector<Changed> changed;
+        for (auto& [id, files] : snapshot)
+        {
+            std::optional<fs::path> changedPath;
+            for (WatchedFile& file : files)
+            {
+                const auto lastWrite = LastWriteTime(file.Path);
+                if (lastWrite == file.LastWrite)
+                    continue;
+                file.LastWrite = lastWrite;
+                if (!changedPath)
+                    changedPath = file.Path;
+            }
+            if (changedPath)
+                changed.push_back(Changed{id, std::move(*changedPath), {}});
+        }
+        if (changed.empty())
+            return 0;
+
+        // 先记下新的修改时间再加载：加载失败之后要等文件再次变化才重试，
+        // 加载期间文件又变了则下次还会被发现。
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            for (auto& [id, files] : snapshot)
+            {
+                const auto it = m_entries.find(id);
+                if (it == m_entries.end())
+                    continue;
+                it->second.Files = std::move(files);
+            }
+            for (Changed& change : changed)
+            {
+                const auto it = m_entries.find(change.Id);
+                if (it != m_entries.end())
+                    change.Loader = it->second.Loader;
+            }
+        }
+
+        std::size_t loaded = 0;
+        for (const Changed& change : changed)
+        {
+            if (!change.Loader)
+                continue;
+            try
+            {
+                ReloadedAsset asset = change.Loader();
+                std::vector<WatchedFile> files;
+                for (fs::path& file : asset.Dependencies)
+                {
+                    const auto lastWrite = LastWriteTime(file);
+                    files.push_back(WatchedFile{std::move(file), lastWrite});
+                }
+                std::lock_guard<std::mutex> lock{m_mutex};
+                // 加载期间被 Unwatch 的结果直接丢弃。
+                const auto it = m_entries.find(change.Id);
+                if (it == m_entries.end())
+                    continue;
+                if (!files.empty())
+                {
+                    // 原来就在监视的文件沿用加载前的时间，加载期间的修改不会
+                    // 被漏掉。
+                    for (WatchedFile& file : files)
+                    {
+                        for (const WatchedFile& old : it->second.Files)
+                        {
+                            if (old.Path == file.Path)
+                                file.LastWrite = old.LastWrite;
+                        }
+                    }
+                    it->second.Files = std::move(files);
+                    m_directoriesChanged = true;
+                }
+                m_pending[change.Id] = std::move(asset.Apply);
+                ++loaded;
+            }
+            catch (const std::exception& e)
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_errors.push_back(AssetReloadError{change.Path, e.what()});
+            }
+        }
+        return loaded;
+    }
+
+    void AssetWatcher::Start()
+    {
+        if (m_running.exchange(true))
+            return;
+        m_thread = std::thread{[this] { PollThread(); }};
+    }
+
+    void AssetWatcher::Stop()
+    {
+        if (!m_running.exchange(false))
+            return;
+        m_signal->Wake();
+        m_thread.join();
+    }
+
+    std::size_t AssetWatcher::ApplyPendingReloads()
+    {
+        std::unordered_map<WatchId, std::function<void()>> pending;
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            pending.swap(m_pending);
+        }
+        for (auto& [id, apply] : pending)
+        {
+            if (apply)
+                apply();
+        }
+        return pending.size();
+    }
+
+    std::vector<AssetReloadError> AssetWatcher::TakeErrors()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return std::exchange(m_errors, {});
+    }
+
+    std::size_t AssetWatcher::WatchCount() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_entries.size();
+    }
+
+    void AssetWatcher::PollThread()
+    {
+#ifdef _WIN32
+        // loader 可能用到 WIC。失败时不退出，用到 COM 的 loader 会报错。
+        const bool comInitialized =
+            SUCCEEDED(::CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+#endif
+        while (m_running)
+        {
+            std::optional<std::vector<fs::path>> directories;
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                if (m_directoriesChanged)
+                {
+                    m_directoriesChanged = false;
+                    directories.emplace();
+                    for (const auto& idAndEntry : m_entries)
+                    {
+                        for (const WatchedFile& file : idAndEntry.second.Files)
+                        {
+                            fs::path directory = file.Path.parent_path();
+                            if (directory.empty())
+                                directory = ".";
+                            if (std::find(directories->begin(),
+                                          directories->end(),
+                                          directory) == directories->end())
+                                directories->push_back(std::move(directory));
+                        }
+                    }
+                }
+            }
+            if (directories)
+                m_signal->Watch(*directories);
+            m_signal->Wait(m_pollInterval);
+            if (!m_running)
+                break;
+            Poll();
+        }
+#ifdef _WIN32
+        if (comInitialized)
+            ::CoUninitialize();
+#endif
+    }
+} // namespace dx
@@ -0,0 +1,113 @@
+#pragma once
+
+// 不依赖 pch，轮询的部分可以在其它平台上单独编译和测试。
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dx
+{
+    // 一次成功的重新加载。
+    struct ReloadedAsset
+    {
+        // 在帧之间由主线程调用，把新的资源换进去。
+        std::function<void()> Apply;
+        // 新的依赖文件列表，例如 shader 改动之后 #include 的文件变了；为空
+        // 表示不变。
+        std::vector<fs::path> Dependencies;
+    };
+
+    // 在后台线程中调用，只能创建资源，不能碰 immediate context。失败时抛出
+    // 异常，旧的资源保持不变。
+    using AssetLoader = std::function<ReloadedAsset()>;
+
+    struct AssetReloadError
+    {
+        fs::path Path;
+        std::string Message;
+    };
+
+    // 监视资源依赖的文件，文件变化时在后台重新加载受影响的资源，加载完成
+    // 的结果由 ApplyPendingReloads 在帧之间一次性换入。
+    //
+    // 通过比较文件的修改时间发现变化。Start 之后由后台线程定期检查，在
+    // Windows 上目录的变更通知会提前唤醒它；不调用 Start 时可以手动 Poll。
+    class AssetWatcher
+    {
+      public:
+        using WatchId = std::uint32_t;
+
+        explicit AssetWatcher(
+            std::chrono::milliseconds pollInterval = std::chrono::milliseconds{
+                250});
+        ~AssetWatcher();
+
+        // 资源已经加载好，files 中任一文件变化时调用 loader。
+        WatchId Watch(std::vector<fs::path> files, AssetLoader loader);
+        // 还没有换入的结果一起丢弃。
+        void Unwatch(WatchId id);
+
+        // 检查一次文件，为变化了的资源调用 loader，返回成功加载的数量。
+        // 可以与后台线程同时调用，但同一时刻只有一个在检查。
+        std::size_t Poll();
+
+        void Start();
+        void Stop();
+
+        // 主线程在帧之间调用。同一个资源在两次调用之间加载了多次时只换入
+        // 最后一次的结果。返回换入的数量。
+        std::size_t ApplyPendingReloads();
+
+        // 上次调用之后失败的加载。
+        std::vector<AssetReloadError> TakeErrors();
+
+        std::size_t WatchCount() const;
+        std::chrono::milliseconds PollInterval() const noexcept
+        {
+            return m_pollInterval;
+        }
+
+      private:
+        struct WatchedFile
+        {
+            fs::path Path;
+            fs::file_time_type LastWrite;
+        };
+
+        struct Entry
+        {
+            std::vector<WatchedFile> Files;
+            AssetLoader Loader;
+        };
+
+        class ChangeSignal;
+
+        void PollThread();
+
+        std::chrono::milliseconds m_pollInterval;
+        std::mutex m_pollMutex;
+        // 以下由 m_mutex 保护。
+        mutable std::mutex m_mutex;
+        std::unordered_map<WatchId, Entry> m_entries;
+        std::unordered_map<WatchId, std::function<void()>> m_pending;
+        std::vector<AssetReloadError> m_errors;
+        WatchId m_nextId = 0;
+        // 目录集合变化之后后台线程需要重新登记变更通知。
+        bool m_directoriesChanged = false;
+
+        std::unique_ptr<ChangeSignal> m_signal;
+        std::atomic<bool> m_running{false};
+        std::thread m_thread;
+    };
+} // namespace dx
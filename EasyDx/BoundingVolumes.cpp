@@ -0,0 +1,298 @@
+#include "pch.hpp"
+#include "BoundingVolumes.hpp"
+#include <cfloat>
+
+namespace dx
+{
+    // OBB 的体积小于 AABB 的这个比例时才保存 OBB。
+    constexpr float kOrientedBoxVolumeRatio = 0.8f;
+
+    // EPOS-26 的 13 个方向。
+    constexpr float kExtremalDirections[][3] = {
+        {1.0f, 0.0f, 0.0f},  {0.0f, 1.0f, 0.0f},  {0.0f, 0.0f, 1.0f},
+        {1.0f, 1.0f, 1.0f},  {1.0f, 1.0f, -1.0f}, {1.0f, -1.0f, 1.0f},
+        {1.0f, -1.0f, -1.0f}, {1.0f, 1.0f, 0.0f}, {1.0f, -1.0f, 0.0f},
+        {1.0f, 0.0f, 1.0f},  {1.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 1.0f},
+        {0.0f, 1.0f, -1.0f}};
+
+    template<typename Func>
+    void ForEachPosition(const std::byte* positions, std::uint32_t stride,
+                         std::size_t vertexCount,
+                         gsl::span<const ShortIndex> indices, Func&& func)
+    {
+        const auto load = [&](std::size_t i) {
+            return DirectX::XMLoadFloat3(
+                reinterpret_cast<const DirectX::XMFLOAT3*>(positions +
+                                                           i * stride));
+        };
+        if (indices.empty())
+        {
+            for (std::size_t i = 0; i < vertexCount; ++i)
+                func(load(i));
+        }
+        else
+        {
+            for (const ShortIndex index : indices)
+                func(load(index));
+        }
+    }
+
+    DirectX::BoundingSphere
+    ComputeBoundingSphere(const std::byte* positions, std::uint32_t stride,
+                          std::size_t vertexCount,
+                          gsl::span<const ShortIndex> indices)
+    {
+        using namespace DirectX;
+        constexpr std::size_t kDirectionCount = std::size(kExtremalDirections);
+        Expects(vertexCount != 0);
+
+        // 1. 沿固定方向找极值点，取距离最远的一对作为初始直径。
+        std::array<XMVECTOR, kDirectionCount> directions;
+        std::array<XMVECTOR, kDirectionCount> minPoints, maxPoints;
+        std::array<float, kDirectionCount> minProjections, maxProjections;
+        for (std::size_t i = 0; i < kDirectionCount; ++i)
+        {
+            directions[i] = XMLoadFloat3(
+                reinterpret_cast<const XMFLOAT3*>(kExtremalDirections[i]));
+            minProjections[i] = FLT_MAX;
+            maxProjections[i] = -FLT_MAX;
+        }
+        ForEachPosition(
+            positions, stride, vertexCount, indices, [&](FXMVECTOR p) {
+                for (std::size_t i = 0; i < kDirectionCount; ++i)
+                {
+                    const float projection =
+                        XMVectorGetX(XMVector3Dot(p, directions[i]));
+                    if (projection < minProjections[i])
+                    {
+                        minProjections[i] = projection;
+                        minPoints[i] = p;
+                    }
+                    if (projection > maxProjections[i])
+                    {
+                        maxProjections[i] = projection;
+                        maxPoints[i] = p;
+                    }
+                }
+            });
+        std::size_t widest = 0;
+        float widestLengthSq = -1.0f;
+        for (std::size_t i = 0; i < kDirectionCount; ++i)
+        {
+            const float lengthSq = XMVectorGetX(XMVector3LengthSq(
+                XMVectorSubtract(maxPoints[i], minPoints[i])));
+            if (lengthSq > widestLengthSq)
+            {
+                widestLengthSq = lengthSq;
+                widest = i;
+            }
+        }
+        XMVECTOR center = XMVectorScale(
+            XMVectorAdd(minPoints[widest], maxPoints[widest]), 0.5f);
+        float radius = std::sqrt(widestLengthSq) * 0.5f;
+
+        // 2. Ritter：遇到球外的点就把球扩大到刚好包住它。
+        ForEachPosition(
+            positions, stride, vertexCount, indices, [&](FXMVECTOR p) {
+                const XMVECTOR offset = XMVectorSubtract(p, center);
+                const float distanceSq =
+                    XMVectorGetX(XMVector3LengthSq(offset));
+                if (distanceSq <= radius * radius)
+                    return;
+                const float distance = std::sqrt(distanceSq);
+                const float newRadius = (radius + distance) * 0.5f;
+                center = XMVectorAdd(
+                    center,
+                    XMVectorScale(offset, (newRadius - radius) / distance));
+                radius = newRadius;
+            });
+
+        BoundingSphere sphere;
+        XMStoreFloat3(&sphere.Center, center);
+        sphere.Radius = radius;
+        return sphere;
+    }
+
+    MeshBounds ComputeMeshBounds(const std::byte* positions,
+                                 std::uint32_t stride, std::size_t vertexCount,
+                                 gsl::span<const ShortIndex> indices)
+    {
+        using namespace DirectX;
+        MeshBounds bounds;
+        bounds.Sphere =
+            ComputeBoundingSphere(positions, stride, vertexCount, indices);
+        const XMFLOAT3* points = reinterpret_cast<const XMFLOAT3*>(positions);
+        std::size_t pointCount = vertexCount;
+        std::size_t pointStride = stride;
+        std::vector<XMFLOAT3> referenced;
+        if (!indices.empty())
+        {
+            referenced.reserve(indices.size());
+            ForEachPosition(positions, stride, vertexCount, indices,
+                            [&](FXMVECTOR p) {
+                                XMStoreFloat3(&referenced.emplace_back(), p);
+                            });
+            points = referenced.data();
+            pointCount = referenced.size();
+            pointStride = sizeof(XMFLOAT3);
+        }
+        BoundingBox::CreateFromPoints(bounds.Box, pointCount, points,
+                                      pointStride);
+        BoundingOrientedBox orientedBox;
+        BoundingOrientedBox::CreateFromPoints(orientedBox, pointCount, points,
+                                              pointStride);
+        bounds.OrientedBox = orientedBox;
+        const auto volume = [](const XMFLOAT3& extents) {
+            return extents.x * extents.y * extents.z;
+        };
+        if (volume(bounds.OrientedBox->Extents) >
+            volume(bounds.Box.Extents) * kOrientedBoxVolumeRatio)
+        {
+            bounds.OrientedBox.reset();
+        }
+        return bounds;
+    }
+
+    bool IsVisible(const MeshBounds& bounds, DirectX::FXMMATRIX world,
+                   const DirectX::BoundingFrustum& frustum)
+    {
+        using namespace DirectX;
+        BoundingSphere sphere;
+        bounds.Sphere.Transform(sphere, world);
+        switch (frustum.Contains(sphere))
+        {
+            case DISJOINT:
+                return false;
+            case CONTAINS:
+                return true;
+            default:
+                break;
+        }
+        BoundingOrientedBox localBox;
+        if (bounds.OrientedBox)
+        {
+            localBox = *bounds.OrientedBox;
+        }
+        else
+        {
+            BoundingOrientedBox::CreateFromBoundingBox(localBox, bounds.Box);
+        }
+        BoundingOrientedBox worldBox;
+        localBox.Transform(worldBox, world);
+        return frustum.Intersects(worldBox);
+    }
+
+    FrustumPlanes ExtractFrustumPlanes(DirectX::FXMMATRIX viewProjection)
+    {
+        using namespace DirectX;
+        // 行向量约定下 clip = p * M，各平面由 M 的列组合得到。
+        const XMMATRIX columns = XMMatrixTranspose(viewProjection);
+        const XMVECTOR planes[6] = {
+            XMVectorAdd(columns.r[3], columns.r[0]),      // left
+            XMVectorSubtract(columns.r[3], columns.r[0]), // right
+            XMVectorAdd(columns.r[3], columns.r[1]),      // bottom
+            XMVectorSubtract(columns.r[3], columns.r[1]), // top
+            columns.r[2],                                 // near
+            XMVectorSubtract(columns.r[3], columns.r[2]), // far
+        };
+        // 填充平面 (0, 0, 0, 1) 对任何点的距离都是 1。
+        const XMMATRIX group0 = XMMatrixTranspose(
+            XMMATRIX{XMPlaneNormalize(planes[0]), XMPlaneNormalize(planes[1]),
+                     XMPlaneNormalize(planes[2]), XMPlaneNormalize(planes[3])});
+        const XMMATRIX group1 = XMMatrixTranspose(
+            XMMATRIX{XMPlaneNormalize(planes[4]), XMPlaneNormalize(planes[5]),
+                     g_XMIdentityR3, g_XMIdentityR3});
+        return FrustumPlanes{{group0.r[0], group1.r[0]},
+                             {group0.r[1], group1.r[1]},
+                             {group0.r[2], group1.r[2]},
+                             {group0.r[3], group1.r[3]}};
+    }
+
+    namespace
+    {
+        // 点到各平面的有符号距离。
+        DirectX::XMVECTOR PlaneDistances(const FrustumPlanes& planes,
+                                         std::size_t group,
+                                         DirectX::FXMVECTOR point)
+        {
+            using namespace DirectX;
+            XMVECTOR result = XMVectorMultiplyAdd(
+                planes.X[group], XMVectorSplatX(point), planes.W[group]);
+            result = XMVectorMultiplyAdd(planes.Y[group],
+                                         XMVectorSplatY(point), result);
+            return XMVectorMultiplyAdd(planes.Z[group], XMVectorSplatZ(point),
+                                       result);
+        }
+
+        // 向量 axis 在各平面法线上投影长度的绝对值。
+        DirectX::XMVECTOR ProjectedLengths(const FrustumPlanes& planes,
+                                           std::size_t group,
+                                           DirectX::FXMVECTOR axis)
+        {
+            using namespace DirectX;
+            XMVECTOR result =
+                XMVectorMultiply(planes.X[group], XMVectorSplatX(axis));
+            result = XMVectorMultiplyAdd(planes.Y[group], XMVectorSplatY(axis),
+                                         result);
+            result = XMVectorMultiplyAdd(planes.Z[group], XMVectorSplatZ(axis),
+                                         result);
+            return XMVectorAbs(result);
+        }
+    } // namespace
+
+    bool Intersects(const FrustumPlanes& planes, DirectX::FXMVECTOR center,
+                    float radius)
+    {
+        using namespace DirectX;
+        const XMVECTOR negativeRadius = XMVectorReplicate(-radius);
+        for (std::size_t group = 0; group < 2; ++group)
+        {
+            if (!XMVector4GreaterOrEqual(
+                    PlaneDistances(planes, group, center), negativeRadius))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool IsVisible(const MeshBounds& bounds, DirectX::FXMMATRIX world,
+                   const FrustumPlanes& planes)
+    {
+        using namespace DirectX;
+        BoundingSphere sphere;
+        bounds.Sphere.Transform(sphere, world);
+        if (!Intersects(planes, XMLoadFloat3(&sphere.Center), sphere.Radius))
+            return false;
+
+        // box 的三个半轴连同 world 变换到世界空间。
+        XMMATRIX boxToWorld;
+        if (bounds.OrientedBox)
+        {
+            const BoundingOrientedBox& box = *bounds.OrientedBox;
+            boxToWorld = XMMatrixAffineTransformation(
+                XMLoadFloat3(&box.Extents), XMVectorZero(),
+                XMLoadFloat4(&box.Orientation), XMLoadFloat3(&box.Center));
+        }
+        else
+        {
+            const BoundingBox& box = bounds.Box;
+            boxToWorld = XMMatrixMultiply(
+                XMMatrixScalingFromVector(XMLoadFloat3(&box.Extents)),
+                XMMatrixTranslationFromVector(XMLoadFloat3(&box.Center)));
+        }
+        boxToWorld = XMMatrixMultiply(boxToWorld, world);
+        for (std::size_t group = 0; group < 2; ++group)
+        {
+            const XMVECTOR radii = XMVectorAdd(
+                XMVectorAdd(ProjectedLengths(planes, group, boxToWorld.r[0]),
+                            ProjectedLengths(planes, group, boxToWorld.r[1])),
+                ProjectedLengths(planes, group, boxToWorld.r[2]));
+            const XMVECTOR distances =
+                PlaneDistances(planes, group, boxToWorld.r[3]);
+            if (!XMVector4GreaterOrEqual(distances, XMVectorNegate(radii)))
+                return false;
+        }
+        return true;
+    }
+} // namespace dx
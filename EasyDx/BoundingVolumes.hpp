@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Resources/Buffers.hpp"
+#include <DirectXCollision.h>
+
+namespace dx
+{
+    struct MeshBounds
+    {
+        DirectX::BoundingBox Box;
+        DirectX::BoundingSphere Sphere;
+        // 只有在明显比 Box 紧时才保存。
+        std::optional<DirectX::BoundingOrientedBox> OrientedBox;
+    };
+
+    // positions 是 stride 间隔的 XMFLOAT3。indices 非空时只统计被引用的顶点，
+    // 可以用来计算一段 index range（submesh）的包围体。
+    DirectX::BoundingSphere
+    ComputeBoundingSphere(const std::byte* positions, std::uint32_t stride,
+                          std::size_t vertexCount,
+                          gsl::span<const ShortIndex> indices = {});
+
+    MeshBounds ComputeMeshBounds(const std::byte* positions,
+                                 std::uint32_t stride, std::size_t vertexCount,
+                                 gsl::span<const ShortIndex> indices = {});
+
+    // 六个指向 frustum 内部的归一化平面，按 SoA 存放：第 i 个平面为
+    // (X[i / 4][i % 4], Y..., Z..., W...)。第 7、8 个平面是恒通过的填充，
+    // 这样两组 XMVECTOR 就能测完所有平面。
+    struct FrustumPlanes
+    {
+        std::array<DirectX::XMVECTOR, 2> X, Y, Z, W;
+    };
+
+    // 从 view * projection（D3D 的 [0, 1] 深度）中提取 world space 的平面。
+    FrustumPlanes ExtractFrustumPlanes(DirectX::FXMMATRIX viewProjection);
+
+    bool Intersects(const FrustumPlanes& planes, DirectX::FXMVECTOR center,
+                    float radius);
+
+    // 先测代价最低的 sphere，只有相交时才用 OBB（没有则用变换后的 Box）
+    // 细化。frustum 与 world 变换后的包围体处于同一空间。
+    bool IsVisible(const MeshBounds& bounds, DirectX::FXMMATRIX world,
+                   const DirectX::BoundingFrustum& frustum);
+    // 同上，OBB 按其在各平面法线上的投影半径测试，结果是保守的。
+    bool IsVisible(const MeshBounds& bounds, DirectX::FXMMATRIX world,
+                   const FrustumPlanes& planes);
+} // namespace dx
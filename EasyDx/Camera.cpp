@@ -14,21 +14,22 @@ namespace dx
         {
             DirectX::XMMATRIX View;
             DirectX::XMMATRIX Projection;
+            DirectX::XMMATRIX ViewProjection;
+            DirectX::XMMATRIX InverseView;
+            DirectX::XMMATRIX InverseProjection;
+            DirectX::XMMATRIX InverseViewProjection;
             DirectX::BoundingFrustum Frustum;
+            FrustumPlanes Planes;
         };
     } // namespace Internal
 
     Camera::Camera()
-        : m_isProjectionDirty{true}, m_isViewDirty{true},
+        : m_isProjectionDirty{true}, m_isViewDirty{true}, aspectRatio_{1.0f},
+          m_fov{DirectX::XM_PIDIV4}, m_nearZ{0.1f}, m_farZ{1000.0f},
           rotation_{0.f, 0.f, 0.f, 1.f}, position_{0.f, 0.f, 0.f, 1.f},
           data_{aligned_unique<Internal::CameraData>()},
           m_viewport{std::make_unique<Rect>()}, m_defaultMove{}
-    {
-        auto& frustum = data_->Frustum;
-        frustum.Origin = {};
-        DirectX::XMStoreFloat4(&frustum.Orientation,
-                               DirectX::XMQuaternionIdentity());
-    }
+    {}
 
     void Camera::Translate(float x, float y, float z, Space space) noexcept
     {
@@ -147,22 +148,36 @@ namespace dx
         SetProjection(Fov(), newSize.GetAspectRatio(), NearZ(), FarZ());
     }
 
-    void Camera::FlushProjectionDirty() const
+    void Camera::FlushDirty() const
     {
-        if (!m_isProjectionDirty)
+        using namespace DirectX;
+        if (!m_isViewDirty && !m_isProjectionDirty)
             return;
-        data_->Projection = DirectX::XMMatrixPerspectiveFovLH(
-            Fov(), aspectRatio_, NearZ(), FarZ());
-        auto& frustum = data_->Frustum;
-        const auto tanYFov = std::tan(Fov());
-        const auto tanXFov = tanYFov * aspectRatio_;
-        frustum.RightSlope = tanXFov;
-        frustum.LeftSlope = -tanXFov;
-        frustum.TopSlope = tanYFov;
-        frustum.BottomSlope = -tanYFov;
-        frustum.Near = NearZ();
-        frustum.Far = FarZ();
-        m_isProjectionDirty = false;
+        auto& data = *data_;
+        if (m_isViewDirty)
+        {
+            // view 是刚体变换，逆矩阵直接由 rotation 和 position 得到。
+            const XMMATRIX rotation =
+                XMMatrixRotationQuaternion(LoadRotation());
+            data.View = XMMatrixTranslation(-position_.x, -position_.y,
+                                            -position_.z) *
+                        XMMatrixTranspose(rotation);
+            data.InverseView =
+                rotation * XMMatrixTranslationFromVector(LoadTranslation());
+            m_isViewDirty = false;
+        }
+        if (m_isProjectionDirty)
+        {
+            data.Projection = XMMatrixPerspectiveFovLH(Fov(), aspectRatio_,
+                                                       NearZ(), FarZ());
+            data.InverseProjection = XMMatrixInverse(nullptr, data.Projection);
+            BoundingFrustum::CreateFromMatrix(data.Frustum, data.Projection);
+            m_isProjectionDirty = false;
+        }
+        data.ViewProjection = data.View * data.Projection;
+        data.InverseViewProjection =
+            data.InverseProjection * data.InverseView;
+        data.Planes = ExtractFrustumPlanes(data.ViewProjection);
     }
 
     DirectX::XMVECTOR Camera::LoadTranslation() const noexcept
@@ -209,27 +224,40 @@ namespace dx
         return m_isViewDirty || m_isProjectionDirty;
     }
 
-    DirectX::XMMATRIX Camera::GetView() const noexcept
+    const DirectX::XMMATRIX& Camera::GetView() const noexcept
     {
-        auto& view = data_->View;
-        if (m_isViewDirty)
-        {
-            auto rotation =
-                XMMatrixTranspose(DirectX::XMMatrixRotationQuaternion(
-                    DirectX::XMLoadFloat4(&rotation_)));
-            auto translation = DirectX::XMMatrixTranslation(
-                -position_.x, -position_.y, -position_.z);
-            view = translation * rotation;
-            m_isViewDirty = false;
-        }
-        return view;
+        FlushDirty();
+        return data_->View;
+    }
+
+    const DirectX::XMMATRIX& Camera::GetProjection() const noexcept
+    {
+        FlushDirty();
+        return data_->Projection;
+    }
+
+    const DirectX::XMMATRIX& Camera::GetViewProjection() const noexcept
+    {
+        FlushDirty();
+        return data_->ViewProjection;
+    }
+
+    const DirectX::XMMATRIX& Camera::GetInverseView() const noexcept
+    {
+        FlushDirty();
+        return data_->InverseView;
+    }
+
+    const DirectX::XMMATRIX& Camera::GetInverseProjection() const noexcept
+    {
+        FlushDirty();
+        return data_->InverseProjection;
     }
 
-    DirectX::XMMATRIX Camera::GetProjection() const noexcept
+    const DirectX::XMMATRIX& Camera::GetInverseViewProjection() const noexcept
     {
-        auto& projection = data_->Projection;
-        FlushProjectionDirty();
-        return projection;
+        FlushDirty();
+        return data_->InverseViewProjection;
     }
 
     DirectX::XMFLOAT3 Camera::GetEyePos() const noexcept
@@ -251,8 +279,13 @@ namespace dx
 
     const DirectX::BoundingFrustum& Camera::Frustum() const
     {
-        auto& frustum = data_->Frustum;
-        FlushProjectionDirty();
-        return frustum;
+        FlushDirty();
+        return data_->Frustum;
+    }
+
+    const FrustumPlanes& Camera::WorldFrustumPlanes() const
+    {
+        FlushDirty();
+        return data_->Planes;
     }
 } // namespace dx
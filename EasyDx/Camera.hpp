@@ -4,6 +4,7 @@
 #include <DirectXCollision.h>
 #include "AlignedAllocator.hpp"
 #include "Misc.hpp"
+#include "BoundingVolumes.hpp"
 
 namespace dx
 {
@@ -40,11 +41,19 @@ namespace dx
                        const DirectX::XMFLOAT3& up) noexcept;
         void UpdateAspectRatio(float aspectRatio) noexcept;
         bool HasChanged() const noexcept;
-        // TODO: 这里应该返回引用
-        DirectX::XMMATRIX GetView() const noexcept;
-        DirectX::XMMATRIX GetProjection() const noexcept;
+        // 以下矩阵和平面都缓存在 Camera 中，只在 view 或 projection 改变后
+        // 第一次访问时重新计算。
+        const DirectX::XMMATRIX& GetView() const noexcept;
+        const DirectX::XMMATRIX& GetProjection() const noexcept;
+        const DirectX::XMMATRIX& GetViewProjection() const noexcept;
+        const DirectX::XMMATRIX& GetInverseView() const noexcept;
+        const DirectX::XMMATRIX& GetInverseProjection() const noexcept;
+        const DirectX::XMMATRIX& GetInverseViewProjection() const noexcept;
         DirectX::XMFLOAT3 GetEyePos() const noexcept;
+        // view space 的 frustum。
         const DirectX::BoundingFrustum& Frustum() const;
+        // world space 的 frustum 平面，可以直接用于剔除。
+        const FrustumPlanes& WorldFrustumPlanes() const;
         void UseDefaultMoveEvents(bool use);
         void Walk(float d) noexcept;
         void Strafe(float d) noexcept;
@@ -82,7 +91,7 @@ namespace dx
                                  const Game& game);
         void Update(const UpdateArgs& args, const Game& game);
         void OnResize(Size newSize);
-        void FlushProjectionDirty() const;
+        void FlushDirty() const;
 
         DirectX::XMVECTOR LoadTranslation() const noexcept;
         DirectX::XMVECTOR LoadRotation() const noexcept;
@@ -0,0 +1,83 @@
+#include "pch.hpp"
+#include "CascadeFitting.hpp"
+
+namespace dx
+{
+    // 半径按这个粒度向上取整，避免浮点误差让投影逐帧抖动。
+    constexpr float kRadiusGranularity = 1.0f / 16.0f;
+
+    void ComputePracticalSplits(float nearZ, float farZ, float lambda,
+                                gsl::span<float> splits)
+    {
+        Expects(splits.size() >= 2);
+        Expects(nearZ > 0.0f && farZ > nearZ);
+        Expects(lambda >= 0.0f && lambda <= 1.0f);
+        const auto cascadeCount = static_cast<float>(splits.size() - 1);
+        const float ratio = farZ / nearZ;
+        for (std::ptrdiff_t i = 0; i < splits.size(); ++i)
+        {
+            const float t = static_cast<float>(i) / cascadeCount;
+            const float logSplit = nearZ * std::pow(ratio, t);
+            const float uniformSplit = nearZ + (farZ - nearZ) * t;
+            splits[i] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+        }
+        // 消除 pow 的误差。
+        splits[0] = nearZ;
+        splits[splits.size() - 1] = farZ;
+    }
+
+    DirectX::BoundingSphere SliceBoundingSphere(
+        const DirectX::BoundingFrustum& frustum, float sliceNear,
+        float sliceFar)
+    {
+        Expects(sliceFar > sliceNear);
+        const float slopeX =
+            std::max(std::abs(frustum.LeftSlope), std::abs(frustum.RightSlope));
+        const float slopeY =
+            std::max(std::abs(frustum.TopSlope), std::abs(frustum.BottomSlope));
+        // 到 z 轴距离最远的角点满足 r(z) = k * z。
+        const float k2 = slopeX * slopeX + slopeY * slopeY;
+        // 中心在 z 轴上，到近、远平面角点的距离相等：
+        // (c - n)^2 + k^2 n^2 = (f - c)^2 + k^2 f^2。
+        float centerZ = 0.5f * (sliceNear + sliceFar) * (1.0f + k2);
+        // 若超过远平面，外接球由远平面的角点决定。
+        centerZ = std::min(centerZ, sliceFar);
+        const float farDelta = sliceFar - centerZ;
+        const float radius = std::sqrt(farDelta * farDelta +
+                                       k2 * sliceFar * sliceFar);
+        return DirectX::BoundingSphere{DirectX::XMFLOAT3{0.0f, 0.0f, centerZ},
+                                       radius};
+    }
+
+    DirectX::XMMATRIX
+    FitStableCascade(const DirectX::BoundingSphere& worldSphere,
+                     DirectX::FXMMATRIX lightView,
+                     std::uint32_t shadowMapSize,
+                     const std::optional<DirectX::BoundingBox>& casterBounds)
+    {
+        using namespace DirectX;
+        Expects(shadowMapSize > 0);
+        const float radius =
+            std::ceil(worldSphere.Radius / kRadiusGranularity) *
+            kRadiusGranularity;
+        XMFLOAT3 center;
+        XMStoreFloat3(&center, XMVector3Transform(
+                                   XMLoadFloat3(&worldSphere.Center),
+                                   lightView));
+        const float texelSize =
+            2.0f * radius / static_cast<float>(shadowMapSize);
+        center.x = std::floor(center.x / texelSize) * texelSize;
+        center.y = std::floor(center.y / texelSize) * texelSize;
+
+        float nearZ = center.z - radius;
+        const float farZ = center.z + radius;
+        if (casterBounds)
+        {
+            const BoundingBox& box = *casterBounds;
+            nearZ = std::min(nearZ, box.Center.z - box.Extents.z);
+        }
+        return XMMatrixOrthographicOffCenterLH(
+            center.x - radius, center.x + radius, center.y - radius,
+            center.y + radius, nearZ, farZ);
+    }
+} // namespace dx
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+namespace dx
+{
+    // 按 practical split scheme 划分 [nearZ, farZ]：lambda 为 0 时均匀划分，
+    // 为 1 时按对数划分。splits.size() 为 cascade 数 + 1，首尾分别是 nearZ
+    // 和 farZ。
+    void ComputePracticalSplits(float nearZ, float farZ, float lambda,
+                                gsl::span<float> splits);
+
+    // frustum 是 view space 的（Camera::Frustum()）。返回 [sliceNear,
+    // sliceFar] 这一段的最小外接球，同样在 view space。半径只取决于投影
+    // 参数，相机旋转时不会变化。
+    DirectX::BoundingSphere SliceBoundingSphere(
+        const DirectX::BoundingFrustum& frustum, float sliceNear,
+        float sliceFar);
+
+    // 为 world space 的 sphere 构造 light view space 下的正交投影。
+    // sphere 的中心按 shadow map 的 texel 对齐，相机平移时已有的阴影边缘
+    // 不会闪烁。casterBounds 是 light space 中所有 caster 的包围盒，只用来
+    // 把 near 延伸到最靠近光源的 caster；far 始终是球的远端，球内 caster
+    // 之后的 receiver 同样有阴影。
+    DirectX::XMMATRIX
+    FitStableCascade(const DirectX::BoundingSphere& worldSphere,
+                     DirectX::FXMMATRIX lightView,
+                     std::uint32_t shadowMapSize,
+                     const std::optional<DirectX::BoundingBox>& casterBounds);
+} // namespace dx
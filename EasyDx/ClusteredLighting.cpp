@@ -0,0 +1,399 @@
+#include "pch.hpp"
+#include "ClusteredLighting.hpp"
+#include "Camera.hpp"
+#include "Resources/Buffers.hpp"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace dx
+{
+    constexpr std::uint32_t kGroupSize = 4;
+    constexpr std::uint32_t kBitsPerWord = 64;
+    constexpr std::size_t kParallelSliceThreshold = 4;
+
+    namespace
+    {
+        std::uint32_t PopCount(std::uint64_t bits)
+        {
+            std::uint32_t count = 0;
+            for (; bits != 0; bits &= bits - 1)
+                ++count;
+            return count;
+        }
+
+        DirectX::XMVECTOR MakeVector(const float (&lanes)[kGroupSize])
+        {
+            return DirectX::XMVectorSet(lanes[0], lanes[1], lanes[2],
+                                        lanes[3]);
+        }
+    } // namespace
+
+    ClusteredLightBinner::ClusteredLightBinner(ClusterGridSize size)
+        : m_size{size}, m_inverseProjection{}, m_nearZ{}, m_farZ{},
+          m_boundsValid{false}, m_wordsPerCluster{0}
+    {
+        Expects(size.TilesX > 0 && size.TilesY > 0 && size.SlicesZ > 0);
+        m_groupsPerSlice =
+            (size.TilesX * size.TilesY + kGroupSize - 1) / kGroupSize;
+    }
+
+    std::uint32_t ClusteredLightBinner::ClusterCount() const
+    {
+        return m_size.TilesX * m_size.TilesY * m_size.SlicesZ;
+    }
+
+    std::uint32_t ClusteredLightBinner::ClusterIndex(std::uint32_t x,
+                                                     std::uint32_t y,
+                                                     std::uint32_t z) const
+    {
+        return x + (y + z * m_size.TilesY) * m_size.TilesX;
+    }
+
+    cb::ClusterGrid
+    ClusteredLightBinner::GridConstants(Size renderTargetSize) const
+    {
+        Expects(m_boundsValid);
+        const float logRange = std::log(m_farZ / m_nearZ);
+        const auto slices = static_cast<float>(m_size.SlicesZ);
+        cb::ClusterGrid grid{};
+        grid.TilesX = m_size.TilesX;
+        grid.TilesY = m_size.TilesY;
+        grid.SlicesZ = m_size.SlicesZ;
+        grid.SliceScale = slices / logRange;
+        grid.SliceBias = -slices * std::log(m_nearZ) / logRange;
+        grid.TileScale = {
+            static_cast<float>(m_size.TilesX) / renderTargetSize.Width,
+            static_cast<float>(m_size.TilesY) / renderTargetSize.Height};
+        return grid;
+    }
+
+    gsl::span<const cb::Light> ClusteredLightBinner::Lights() const
+    {
+        return m_lights;
+    }
+
+    gsl::span<const std::uint32_t> ClusteredLightBinner::LightIndices() const
+    {
+        return m_lightIndices;
+    }
+
+    gsl::span<const ClusterRange> ClusteredLightBinner::Clusters() const
+    {
+        return m_clusters;
+    }
+
+    float ClusteredLightBinner::SliceDepth(std::uint32_t slice) const
+    {
+        return m_nearZ *
+               std::pow(m_farZ / m_nearZ,
+                        static_cast<float>(slice) / m_size.SlicesZ);
+    }
+
+    void ClusteredLightBinner::RebuildClusterBounds(
+        DirectX::FXMMATRIX inverseProjection, float nearZ, float farZ)
+    {
+        using namespace DirectX;
+        DirectX::XMFLOAT4X4 inverse;
+        XMStoreFloat4x4(&inverse, inverseProjection);
+        if (m_boundsValid && nearZ == m_nearZ && farZ == m_farZ &&
+            std::memcmp(&inverse, &m_inverseProjection, sizeof(inverse)) == 0)
+            return;
+        m_inverseProjection = inverse;
+        m_nearZ = nearZ;
+        m_farZ = farZ;
+        m_boundsValid = true;
+
+        // tile 角点在 view space 中 z = 1 处的 x/y，row 0 在屏幕顶部。
+        const std::uint32_t cornersX = m_size.TilesX + 1;
+        const std::uint32_t cornersY = m_size.TilesY + 1;
+        std::vector<XMFLOAT2> corners(cornersX * cornersY);
+        for (std::uint32_t y = 0; y < cornersY; ++y)
+        {
+            for (std::uint32_t x = 0; x < cornersX; ++x)
+            {
+                const float ndcX = -1.f + 2.f * x / m_size.TilesX;
+                const float ndcY = 1.f - 2.f * y / m_size.TilesY;
+                const XMVECTOR onNearPlane = XMVector3TransformCoord(
+                    XMVectorSet(ndcX, ndcY, 0.f, 1.f), inverseProjection);
+                const float z = XMVectorGetZ(onNearPlane);
+                corners[x + y * cornersX] = {XMVectorGetX(onNearPlane) / z,
+                                             XMVectorGetY(onNearPlane) / z};
+            }
+        }
+
+        const std::size_t groupCount =
+            std::size_t{m_groupsPerSlice} * m_size.SlicesZ;
+        for (auto* lane : {&m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY,
+                           &m_maxZ})
+            lane->resize(groupCount);
+
+        const std::uint32_t tileCount = m_size.TilesX * m_size.TilesY;
+        for (std::uint32_t z = 0; z < m_size.SlicesZ; ++z)
+        {
+            const float sliceNear = SliceDepth(z);
+            const float sliceFar = SliceDepth(z + 1);
+            for (std::uint32_t group = 0; group < m_groupsPerSlice; ++group)
+            {
+                // 超出 slice 的 lane 使用空包围盒，任何光源都不会与之相交。
+                float minX[kGroupSize], minY[kGroupSize], minZ[kGroupSize];
+                float maxX[kGroupSize], maxY[kGroupSize], maxZ[kGroupSize];
+                for (std::uint32_t lane = 0; lane < kGroupSize; ++lane)
+                {
+                    minX[lane] = minY[lane] = minZ[lane] = FLT_MAX;
+                    maxX[lane] = maxY[lane] = maxZ[lane] = -FLT_MAX;
+                    const std::uint32_t tile = group * kGroupSize + lane;
+                    if (tile >= tileCount)
+                        continue;
+                    const std::uint32_t tileX = tile % m_size.TilesX;
+                    const std::uint32_t tileY = tile / m_size.TilesX;
+                    for (std::uint32_t corner = 0; corner < 4; ++corner)
+                    {
+                        const auto& ray =
+                            corners[(tileX + corner % 2) +
+                                    (tileY + corner / 2) * cornersX];
+                        for (const float depth : {sliceNear, sliceFar})
+                        {
+                            minX[lane] = std::min(minX[lane], ray.x * depth);
+                            maxX[lane] = std::max(maxX[lane], ray.x * depth);
+                            minY[lane] = std::min(minY[lane], ray.y * depth);
+                            maxY[lane] = std::max(maxY[lane], ray.y * depth);
+                        }
+                    }
+                    minZ[lane] = sliceNear;
+                    maxZ[lane] = sliceFar;
+                }
+                const std::size_t index = z * m_groupsPerSlice + group;
+                m_minX[index] = MakeVector(minX);
+                m_minY[index] = MakeVector(minY);
+                m_minZ[index] = MakeVector(minZ);
+                m_maxX[index] = MakeVector(maxX);
+                m_maxY[index] = MakeVector(maxY);
+                m_maxZ[index] = MakeVector(maxZ);
+            }
+        }
+    }
+
+    void ClusteredLightBinner::Build(gsl::span<const Light> lights,
+                                     const Camera& camera)
+    {
+        std::vector<cb::Light> cbLights(lights.begin(), lights.end());
+        Build(cbLights, camera);
+    }
+
+    void ClusteredLightBinner::Build(gsl::span<const cb::Light> lights,
+                                     const Camera& camera)
+    {
+        using namespace DirectX;
+        RebuildClusterBounds(camera.GetInverseProjection(), camera.NearZ(),
+                             camera.FarZ());
+
+        const XMMATRIX& view = camera.GetView();
+        m_lights.clear();
+        m_binnedLights.clear();
+        for (const cb::Light& cbLight : lights)
+        {
+            if (cbLight.Type == LightType::DirectionalLight ||
+                !cbLight.Enabled)
+                continue;
+            BinnedLight binned{};
+            XMStoreFloat3(&binned.Center,
+                          XMVector3TransformCoord(
+                              XMLoadFloat4(&cbLight.Position), view));
+            binned.Radius = cbLight.Range;
+            // SpotAngle 是圆锥的半角，不小于 90° 时退化为球。
+            binned.IsCone = cbLight.Type == LightType::SpotLight &&
+                            cbLight.SpotAngle < XM_PIDIV2;
+            if (binned.IsCone)
+            {
+                XMStoreFloat3(&binned.Direction,
+                              XMVector3Normalize(XMVector3TransformNormal(
+                                  XMLoadFloat4(&cbLight.Direction), view)));
+                binned.CosAngle = std::cos(cbLight.SpotAngle);
+                binned.SinAngle = std::sin(cbLight.SpotAngle);
+            }
+            m_lights.push_back(cbLight);
+            m_binnedLights.push_back(binned);
+        }
+
+        const std::uint32_t clusterCount = ClusterCount();
+        m_wordsPerCluster = gsl::narrow<std::uint32_t>(
+            (m_lights.size() + kBitsPerWord - 1) / kBitsPerWord);
+        m_lightBits.assign(std::size_t{clusterCount} * m_wordsPerCluster, 0);
+        ParallelFor(m_size.SlicesZ, kParallelSliceThreshold,
+                    [&](std::size_t begin, std::size_t end) {
+                        for (std::size_t z = begin; z < end; ++z)
+                            BinSlice(static_cast<std::uint32_t>(z));
+                    });
+
+        // 前缀和得到每个 cluster 在 m_lightIndices 中的位置。
+        m_clusters.resize(clusterCount);
+        std::uint32_t offset = 0;
+        for (std::uint32_t cluster = 0; cluster < clusterCount; ++cluster)
+        {
+            std::uint32_t count = 0;
+            const std::uint64_t* words =
+                &m_lightBits[std::size_t{cluster} * m_wordsPerCluster];
+            for (std::uint32_t word = 0; word < m_wordsPerCluster; ++word)
+                count += PopCount(words[word]);
+            m_clusters[cluster] = ClusterRange{offset, count};
+            offset += count;
+        }
+        m_lightIndices.resize(offset);
+        ParallelFor(m_size.SlicesZ, kParallelSliceThreshold,
+                    [&](std::size_t begin, std::size_t end) {
+                        for (std::size_t z = begin; z < end; ++z)
+                            EmitSlice(static_cast<std::uint32_t>(z));
+                    });
+    }
+
+    void ClusteredLightBinner::BinSlice(std::uint32_t slice)
+    {
+        using namespace DirectX;
+        const float sliceNear = SliceDepth(slice);
+        const float sliceFar = SliceDepth(slice + 1);
+        const std::uint32_t tileCount = m_size.TilesX * m_size.TilesY;
+        const std::size_t firstGroup = std::size_t{slice} * m_groupsPerSlice;
+        const XMVECTOR zero = XMVectorZero();
+
+        for (std::size_t i = 0; i < m_binnedLights.size(); ++i)
+        {
+            const BinnedLight& light = m_binnedLights[i];
+            if (light.Center.z + light.Radius < sliceNear ||
+                light.Center.z - light.Radius > sliceFar)
+                continue;
+            const XMVECTOR centerX = XMVectorReplicate(light.Center.x);
+            const XMVECTOR centerY = XMVectorReplicate(light.Center.y);
+            const XMVECTOR centerZ = XMVectorReplicate(light.Center.z);
+            const XMVECTOR radiusSq =
+                XMVectorReplicate(light.Radius * light.Radius);
+            const std::uint64_t bit = std::uint64_t{1} << (i % kBitsPerWord);
+            const std::size_t word = i / kBitsPerWord;
+
+            for (std::uint32_t group = 0; group < m_groupsPerSlice; ++group)
+            {
+                const std::size_t g = firstGroup + group;
+                // 球心到 AABB 的最近距离。
+                const XMVECTOR distX = XMVectorAdd(
+                    XMVectorMax(XMVectorSubtract(m_minX[g], centerX), zero),
+                    XMVectorMax(XMVectorSubtract(centerX, m_maxX[g]), zero));
+                const XMVECTOR distY = XMVectorAdd(
+                    XMVectorMax(XMVectorSubtract(m_minY[g], centerY), zero),
+                    XMVectorMax(XMVectorSubtract(centerY, m_maxY[g]), zero));
+                const XMVECTOR distZ = XMVectorAdd(
+                    XMVectorMax(XMVectorSubtract(m_minZ[g], centerZ), zero),
+                    XMVectorMax(XMVectorSubtract(centerZ, m_maxZ[g]), zero));
+                const XMVECTOR distanceSq = XMVectorAdd(
+                    XMVectorMultiply(distX, distX),
+                    XMVectorAdd(XMVectorMultiply(distY, distY),
+                                XMVectorMultiply(distZ, distZ)));
+                std::uint32_t hits[kGroupSize];
+                XMStoreInt4(hits, XMVectorLessOrEqual(distanceSq, radiusSq));
+
+                for (std::uint32_t lane = 0; lane < kGroupSize; ++lane)
+                {
+                    const std::uint32_t tile = group * kGroupSize + lane;
+                    if (hits[lane] == 0 || tile >= tileCount)
+                        continue;
+                    if (light.IsCone)
+                    {
+                        // 用 cluster 的包围球与圆锥求交，见 Wronski,
+                        // "Cull that cone!"。
+                        const XMFLOAT3 boxMin{
+                            XMVectorGetByIndex(m_minX[g], lane),
+                            XMVectorGetByIndex(m_minY[g], lane),
+                            XMVectorGetByIndex(m_minZ[g], lane)};
+                        const XMFLOAT3 boxMax{
+                            XMVectorGetByIndex(m_maxX[g], lane),
+                            XMVectorGetByIndex(m_maxY[g], lane),
+                            XMVectorGetByIndex(m_maxZ[g], lane)};
+                        const float vx =
+                            (boxMin.x + boxMax.x) * 0.5f - light.Center.x;
+                        const float vy =
+                            (boxMin.y + boxMax.y) * 0.5f - light.Center.y;
+                        const float vz =
+                            (boxMin.z + boxMax.z) * 0.5f - light.Center.z;
+                        const float ex = (boxMax.x - boxMin.x) * 0.5f;
+                        const float ey = (boxMax.y - boxMin.y) * 0.5f;
+                        const float ez = (boxMax.z - boxMin.z) * 0.5f;
+                        const float sphereRadius =
+                            std::sqrt(ex * ex + ey * ey + ez * ez);
+                        const float lengthSq = vx * vx + vy * vy + vz * vz;
+                        const float alongAxis = vx * light.Direction.x +
+                                                vy * light.Direction.y +
+                                                vz * light.Direction.z;
+                        const float closest =
+                            light.CosAngle *
+                                std::sqrt(std::max(
+                                    lengthSq - alongAxis * alongAxis, 0.f)) -
+                            alongAxis * light.SinAngle;
+                        if (closest > sphereRadius ||
+                            alongAxis > sphereRadius + light.Radius ||
+                            alongAxis < -sphereRadius)
+                            continue;
+                    }
+                    const std::size_t cluster =
+                        std::size_t{slice} * tileCount + tile;
+                    m_lightBits[cluster * m_wordsPerCluster + word] |= bit;
+                }
+            }
+        }
+    }
+
+    void ClusteredLightBinner::EmitSlice(std::uint32_t slice)
+    {
+        const std::uint32_t tileCount = m_size.TilesX * m_size.TilesY;
+        for (std::uint32_t tile = 0; tile < tileCount; ++tile)
+        {
+            const std::size_t cluster = std::size_t{slice} * tileCount + tile;
+            std::uint32_t* out = m_lightIndices.data() +
+                                 m_clusters[cluster].Offset;
+            const std::uint64_t* words =
+                &m_lightBits[cluster * m_wordsPerCluster];
+            for (std::uint32_t word = 0; word < m_wordsPerCluster; ++word)
+            {
+                for (std::uint64_t bits = words[word]; bits != 0;
+                     bits &= bits - 1)
+                {
+                    std::uint32_t bit = 0;
+                    while (((bits >> bit) & 1) == 0)
+                        ++bit;
+                    *out++ = word * kBitsPerWord + bit;
+                }
+            }
+        }
+    }
+
+    void ClusteredLightBuffers::StructuredBuffer::Upload(
+        ID3D11Device& device, ID3D11DeviceContext& context3D,
+        gsl::span<const std::byte> bytes, std::uint32_t stride)
+    {
+        // 空 buffer 不能创建，至少保留一个元素。
+        const auto count = std::max<std::uint32_t>(
+            gsl::narrow<std::uint32_t>(bytes.size() / stride), 1);
+        if (count > Capacity)
+        {
+            Capacity = std::max(count, Capacity * 2);
+            Buffer = MakeDynamicStructuredBuffer(device, stride, Capacity);
+            View = MakeStructuredBufferView(device, *Buffer.Get());
+        }
+        if (!bytes.empty())
+        {
+            auto mapped = Map(context3D, *Buffer.Get());
+            gsl::copy(bytes, mapped.Bytes());
+        }
+    }
+
+    void ClusteredLightBuffers::Upload(ID3D11Device& device,
+                                       ID3D11DeviceContext& context3D,
+                                       const ClusteredLightBinner& binner)
+    {
+        m_lights.Upload(device, context3D, gsl::as_bytes(binner.Lights()),
+                        sizeof(cb::Light));
+        m_indices.Upload(device, context3D,
+                         gsl::as_bytes(binner.LightIndices()),
+                         sizeof(std::uint32_t));
+        m_clusters.Upload(device, context3D, gsl::as_bytes(binner.Clusters()),
+                          sizeof(ClusterRange));
+    }
+} // namespace dx
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "CBStructs.hpp"
+#include "AlignedAllocator.hpp"
+#include "Misc.hpp"
+#include <DirectXMath.h>
+
+namespace dx
+{
+    class Camera;
+
+    // view space 被划分为 TilesX * TilesY * SlicesZ 个 cluster（froxel）：
+    // x/y 在屏幕上均匀划分，z 在 [near, far] 间按指数划分。
+    struct ClusterGridSize
+    {
+        std::uint32_t TilesX = 16;
+        std::uint32_t TilesY = 9;
+        std::uint32_t SlicesZ = 24;
+    };
+
+    // 一个 cluster 的光源在 LightIndices 中的范围。
+    struct ClusterRange
+    {
+        std::uint32_t Offset;
+        std::uint32_t Count;
+    };
+
+    namespace cb
+    {
+        // 与 ClusteredLighting.hlsli 中的 dx_PerViewClusterGrid 对应。
+        struct alignas(16) ClusterGrid
+        {
+            std::uint32_t TilesX;
+            std::uint32_t TilesY;
+            std::uint32_t SlicesZ;
+            std::uint32_t Padding;
+            // slice = log(viewZ) * SliceScale + SliceBias
+            float SliceScale;
+            float SliceBias;
+            // tile = SV_Position.xy * TileScale
+            DirectX::XMFLOAT2 TileScale;
+        };
+    } // namespace cb
+
+    // 在 CPU 上把 point/spot light 分配到 cluster 中。方向光影响所有
+    // cluster，不参与分配。
+    class ClusteredLightBinner
+    {
+      public:
+        explicit ClusteredLightBinner(ClusterGridSize size = {});
+
+        void Build(gsl::span<const Light> lights, const Camera& camera);
+        // lights 通常来自 LightRegistry::GpuLights。
+        void Build(gsl::span<const cb::Light> lights, const Camera& camera);
+
+        const ClusterGridSize& GridSize() const { return m_size; }
+        std::uint32_t ClusterCount() const;
+        std::uint32_t ClusterIndex(std::uint32_t x, std::uint32_t y,
+                                   std::uint32_t z) const;
+        cb::ClusterGrid GridConstants(Size renderTargetSize) const;
+
+        // 以下结果在下一次 Build 前有效，GridConstants 需要在 Build 之后
+        // 调用。
+        gsl::span<const cb::Light> Lights() const;
+        gsl::span<const std::uint32_t> LightIndices() const;
+        gsl::span<const ClusterRange> Clusters() const;
+
+      private:
+        struct BinnedLight
+        {
+            // view space
+            DirectX::XMFLOAT3 Center;
+            float Radius;
+            DirectX::XMFLOAT3 Direction;
+            float CosAngle;
+            float SinAngle;
+            bool IsCone;
+        };
+
+        void RebuildClusterBounds(DirectX::FXMMATRIX inverseProjection,
+                                  float nearZ, float farZ);
+        float SliceDepth(std::uint32_t slice) const;
+        void BinSlice(std::uint32_t slice);
+        void EmitSlice(std::uint32_t slice);
+
+        ClusterGridSize m_size;
+        std::uint32_t m_groupsPerSlice;
+
+        // 投影参数没变时不重新计算 cluster 包围盒。
+        DirectX::XMFLOAT4X4 m_inverseProjection;
+        float m_nearZ, m_farZ;
+        bool m_boundsValid;
+        // cluster 的 view space AABB，SoA，每个 XMVECTOR 存同一 slice 中
+        // 相邻的 4 个 cluster。
+        AlignedVec<DirectX::XMVECTOR> m_minX, m_minY, m_minZ;
+        AlignedVec<DirectX::XMVECTOR> m_maxX, m_maxY, m_maxZ;
+
+        std::vector<cb::Light> m_lights;
+        std::vector<BinnedLight> m_binnedLights;
+        // 每个 cluster 一个 bitset，第 i 位表示 m_lights[i]。
+        std::vector<std::uint64_t> m_lightBits;
+        std::uint32_t m_wordsPerCluster;
+        std::vector<std::uint32_t> m_lightIndices;
+        std::vector<ClusterRange> m_clusters;
+    };
+
+    // 把 ClusteredLightBinner 的结果上传到 structured buffer，容量不够时
+    // 重新创建。
+    class ClusteredLightBuffers
+    {
+      public:
+        void Upload(ID3D11Device& device, ID3D11DeviceContext& context3D,
+                    const ClusteredLightBinner& binner);
+
+        // 对应 hlsli 中的 dx_ClusterLights、dx_ClusterLightIndices 与
+        // dx_Clusters。
+        ID3D11ShaderResourceView* LightsView() const
+        {
+            return m_lights.View.Get();
+        }
+        ID3D11ShaderResourceView* IndicesView() const
+        {
+            return m_indices.View.Get();
+        }
+        ID3D11ShaderResourceView* ClustersView() const
+        {
+            return m_clusters.View.Get();
+        }
+
+      private:
+        struct StructuredBuffer
+        {
+            wrl::ComPtr<ID3D11Buffer> Buffer;
+            wrl::ComPtr<ID3D11ShaderResourceView> View;
+            std::uint32_t Capacity = 0;
+
+            void Upload(ID3D11Device& device, ID3D11DeviceContext& context3D,
+                        gsl::span<const std::byte> bytes,
+                        std::uint32_t stride);
+        };
+
+        StructuredBuffer m_lights, m_indices, m_clusters;
+    };
+} // namespace dx
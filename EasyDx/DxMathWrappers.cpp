@@ -15,4 +15,12 @@ namespace dx
     {
         return DirectX::XMLoadFloat3A(&f3a);
     }
+    DirectX::XMVECTOR Load(const DirectX::XMFLOAT2A& f2a)
+    {
+        return DirectX::XMLoadFloat2A(&f2a);
+    }
+    DirectX::XMVECTOR Load(const DirectX::XMFLOAT4A& f4a)
+    {
+        return DirectX::XMLoadFloat4A(&f4a);
+    }
 } // namespace dx
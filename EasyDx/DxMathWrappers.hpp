@@ -7,6 +7,8 @@ namespace dx
     DirectX::XMVECTOR Load(const DirectX::XMFLOAT3& f3);
     DirectX::XMVECTOR Load(const DirectX::XMFLOAT4& f4);
     DirectX::XMVECTOR Load(const DirectX::XMFLOAT3A& f3a);
+    DirectX::XMVECTOR Load(const DirectX::XMFLOAT2A& f2a);
+    DirectX::XMVECTOR Load(const DirectX::XMFLOAT4A& f4a);
 
     template<typename T>
     T Store(DirectX::XMVECTOR vec)
@@ -24,6 +26,14 @@ namespace dx
         {
             DirectX::XMStoreFloat3A(&result, vec);
         }
+        else if constexpr (std::is_same_v<T, DirectX::XMFLOAT2A>)
+        {
+            DirectX::XMStoreFloat2A(&result, vec);
+        }
+        else if constexpr (std::is_same_v<T, DirectX::XMFLOAT4A>)
+        {
+            DirectX::XMStoreFloat4A(&result, vec);
+        }
         return result;
     }
 } // namespace dx
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <gsl/span>
+
+namespace dx
+{
+    // 64 位 FNV-1a。结果与运行次数和平台无关，可以用作写入磁盘的 key。
+    class Fnv1aHasher
+    {
+      public:
+        static constexpr std::uint64_t kOffsetBasis = 14695981039346656037ull;
+        static constexpr std::uint64_t kPrime = 1099511628211ull;
+
+        constexpr Fnv1aHasher& Append(std::string_view str) noexcept
+        {
+            for (const char c : str)
+            {
+                AppendByte(static_cast<std::uint8_t>(c));
+            }
+            return *this;
+        }
+
+        Fnv1aHasher& Append(gsl::span<const std::byte> bytes) noexcept
+        {
+            for (const std::byte b : bytes)
+            {
+                AppendByte(static_cast<std::uint8_t>(b));
+            }
+            return *this;
+        }
+
+        // 总是按小端顺序追加，不同机器上整数的 hash 一致。
+        template<typename T,
+                 typename = std::enable_if_t<std::is_integral_v<T>>>
+        constexpr Fnv1aHasher& Append(T value) noexcept
+        {
+            using U = std::make_unsigned_t<T>;
+            const U bits = static_cast<U>(value);
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+            {
+                AppendByte(static_cast<std::uint8_t>(bits >> (i * 8)));
+            }
+            return *this;
+        }
+
+        // 先追加长度，("ab", "c") 和 ("a", "bc") 的 hash 才会不同。
+        constexpr Fnv1aHasher& AppendField(std::string_view str) noexcept
+        {
+            return Append(static_cast<std::uint64_t>(str.size())).Append(str);
+        }
+
+        constexpr std::uint64_t Value() const noexcept { return m_hash; }
+
+      private:
+        constexpr void AppendByte(std::uint8_t b) noexcept
+        {
+            m_hash = (m_hash ^ b) * kPrime;
+        }
+
+        std::uint64_t m_hash = kOffsetBasis;
+    };
+
+    constexpr std::uint64_t Fnv1a64(std::string_view str) noexcept
+    {
+        return Fnv1aHasher{}.Append(str).Value();
+    }
+
+    inline std::uint64_t Fnv1a64(gsl::span<const std::byte> bytes) noexcept
+    {
+        return Fnv1aHasher{}.Append(bytes).Value();
+    }
+} // namespace dx
@@ -0,0 +1,169 @@
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#ifdef _WIN32
+#include "Common.hpp"
+#include "Win32Handles.hpp"
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dx
+{
+    namespace
+    {
+        bool HasHint(MappedFileHints hints, MappedFileHints hint) noexcept
+        {
+            return (hints & hint) != MappedFileHints::kNone;
+        }
+
+#ifndef _WIN32
+        [[noreturn]] void ThrowErrno(const std::filesystem::path& path)
+        {
+            throw std::system_error{errno, std::generic_category(),
+                                    path.string()};
+        }
+
+        // 映射建立后就可以关掉文件描述符。
+        struct FileDescriptor
+        {
+            int Fd;
+            ~FileDescriptor() { ::close(Fd); }
+        };
+#endif
+    } // namespace
+
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::filesystem::path& path,
+                           MappedFileHints hints)
+    {
+        DWORD flags = FILE_ATTRIBUTE_NORMAL;
+        if (HasHint(hints, MappedFileHints::kSequential))
+            flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+        if (HasHint(hints, MappedFileHints::kRandom))
+            flags |= FILE_FLAG_RANDOM_ACCESS;
+        // FILE_SHARE_DELETE：映射期间文件仍然可以被替换，例如重新编译
+        // shader。
+        const auto file = FileHandle{::CreateFileW(
+            path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, flags, nullptr)};
+        if (!file)
+            ThrowWin32();
+
+        LARGE_INTEGER fileSize{};
+        TryWin32(::GetFileSizeEx(file.Get(), &fileSize));
+        if (fileSize.QuadPart == 0)
+            return;
+        const auto size = static_cast<std::uint64_t>(fileSize.QuadPart);
+        if (size > static_cast<std::uint64_t>(SIZE_MAX))
+            throw std::runtime_error{"File is too large to be mapped"};
+
+        // 两个 handle 都可以马上关掉，view 会保持映射。
+        const auto mapping = OpenWin32WithCheck<MemoryMappedFileHandle>(
+            ::CreateFileMappingW(file.Get(), nullptr, PAGE_READONLY, 0, 0,
+                                 nullptr));
+        const void* view =
+            ::MapViewOfFile(mapping.Get(), FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr)
+            ThrowWin32();
+        m_data = static_cast<const std::byte*>(view);
+        m_size = static_cast<std::size_t>(size);
+
+        if (HasHint(hints, MappedFileHints::kPrefetch))
+            Prefetch(0, m_size);
+    }
+
+    void MappedFile::Prefetch(std::size_t offset, std::size_t size) const
+        noexcept
+    {
+        if (offset >= m_size)
+            return;
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = const_cast<std::byte*>(m_data + offset);
+        range.NumberOfBytes = std::min(size, m_size - offset);
+        ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+    }
+
+    void MappedFile::Unmap() noexcept
+    {
+        if (m_data != nullptr)
+            ::UnmapViewOfFile(m_data);
+    }
+#else
+    MappedFile::MappedFile(const std::filesystem::path& path,
+                           MappedFileHints hints)
+    {
+        const FileDescriptor file{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (file.Fd < 0)
+            ThrowErrno(path);
+        struct stat status;
+        if (::fstat(file.Fd, &status) != 0)
+            ThrowErrno(path);
+        if (status.st_size == 0)
+            return;
+        const auto size = static_cast<std::size_t>(status.st_size);
+
+        void* const view =
+            ::mmap(nullptr, size, PROT_READ, MAP_SHARED, file.Fd, 0);
+        if (view == MAP_FAILED)
+            ThrowErrno(path);
+        m_data = static_cast<const std::byte*>(view);
+        m_size = size;
+
+        if (HasHint(hints, MappedFileHints::kSequential))
+            ::madvise(view, size, MADV_SEQUENTIAL);
+        if (HasHint(hints, MappedFileHints::kRandom))
+            ::madvise(view, size, MADV_RANDOM);
+#ifdef MADV_HUGEPAGE
+        if (HasHint(hints, MappedFileHints::kLargePages))
+            ::madvise(view, size, MADV_HUGEPAGE);
+#endif
+        if (HasHint(hints, MappedFileHints::kPrefetch))
+            Prefetch(0, m_size);
+    }
+
+    void MappedFile::Prefetch(std::size_t offset, std::size_t size) const
+        noexcept
+    {
+        if (offset >= m_size)
+            return;
+        // madvise 要求起始地址按页对齐。
+        const auto pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t begin = offset / pageSize * pageSize;
+        const std::size_t end = offset + std::min(size, m_size - offset);
+        ::madvise(const_cast<std::byte*>(m_data + begin), end - begin,
+                  MADV_WILLNEED);
+    }
+
+    void MappedFile::Unmap() noexcept
+    {
+        if (m_data != nullptr)
+            ::munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+#endif
+
+    MappedFile::~MappedFile() { Unmap(); }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+        : m_data{std::exchange(other.m_data, nullptr)},
+          m_size{std::exchange(other.m_size, 0)}
+    {}
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Unmap();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+        }
+        return *this;
+    }
+} // namespace dx
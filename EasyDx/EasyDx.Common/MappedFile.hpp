@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <gsl/span>
+#include "FlagEnums.hpp"
+
+namespace dx
+{
+    enum class MappedFileHints : std::uint32_t
+    {
+        kNone = 0,
+        // 映射后立即在后台预读整个文件。
+        kPrefetch = 1,
+        // 从头到尾读一遍，系统可以多预读一些。
+        kSequential = 1 << 1,
+        // 随机读取，关掉预读。
+        kRandom = 1 << 2,
+        // 尽量用大页。Windows 的文件映射不支持大页，会忽略这一项。
+        kLargePages = 1 << 3,
+    };
+
+    ENABLE_FLAGS(MappedFileHints);
+
+    // 只读地映射整个文件，映射期间其它进程仍然可以读它。空文件映射为空的
+    // span。打不开或者映射失败时抛出 std::system_error。
+    class MappedFile
+    {
+      public:
+        MappedFile() noexcept = default;
+        explicit MappedFile(const std::filesystem::path& path,
+                            MappedFileHints hints = MappedFileHints::kNone);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        gsl::span<const std::byte> Bytes() const& noexcept
+        {
+            return {m_data, static_cast<std::ptrdiff_t>(m_size)};
+        }
+        std::size_t Size() const noexcept { return m_size; }
+        bool Empty() const noexcept { return m_size == 0; }
+
+        // 提示 [offset, offset + size) 马上会被读到，超出范围的部分截掉，
+        // 失败时忽略。
+        void Prefetch(std::size_t offset, std::size_t size) const noexcept;
+
+      private:
+        void Unmap() noexcept;
+
+        const std::byte* m_data = nullptr;
+        std::size_t m_size = 0;
+    };
+} // namespace dx
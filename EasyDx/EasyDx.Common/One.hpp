@@ -5,4 +5,7 @@
 #include "FlagEnums.hpp"
 #include "UniqueHandle.hpp"
 #include "Win32Handles.hpp"
-#include "File.hpp"
\ No newline at end of file
+#include "File.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+#include "Hash.hpp"
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <execution>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace dx
+{
+    // Splits [0, count) into chunks and runs func(begin, end) on them in
+    // parallel. Falls back to a single call on the current thread when count
+    // is below serialThreshold.
+    template<typename Func>
+    void ParallelFor(std::size_t count, std::size_t serialThreshold,
+                     Func&& func)
+    {
+        if (count < serialThreshold)
+        {
+            if (count != 0)
+                func(std::size_t{0}, count);
+            return;
+        }
+        const std::size_t workerCount =
+            std::max(1u, std::thread::hardware_concurrency());
+        const std::size_t chunkCount =
+            std::min<std::size_t>(count, workerCount * 4);
+        const std::size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        std::vector<std::size_t> chunks(chunkCount);
+        std::iota(chunks.begin(), chunks.end(), std::size_t{0});
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+                      [&](std::size_t chunk) {
+                          const std::size_t begin = chunk * chunkSize;
+                          const std::size_t end =
+                              std::min(count, begin + chunkSize);
+                          if (begin < end)
+                              func(begin, end);
+                      });
+    }
+} // namespace dx
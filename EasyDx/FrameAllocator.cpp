@@ -0,0 +1,183 @@
+#include "pch.hpp"
+#include "FrameAllocator.hpp"
+#include <cstdlib>
+#include <new>
+
+#ifdef DX_COUNT_HEAP_ALLOCATIONS
+namespace
+{
+    std::atomic<std::uint64_t> g_heapAllocations{0};
+} // namespace
+
+// 只替换最基本的两个版本，数组、nothrow 以及 sized delete 的默认实现都会
+// 转到这里。
+void* operator new(std::size_t size)
+{
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+#endif
+
+namespace dx
+{
+    namespace
+    {
+        std::atomic<std::uint64_t> g_nextAllocatorId{1};
+
+        // 当前线程上一次取到的 arena，FrameAllocator 和帧都没变时直接使用。
+        struct ArenaCache
+        {
+            std::uint64_t Owner = 0;
+            std::uint64_t Frame = 0;
+            LinearArena* Arena = nullptr;
+        };
+
+        thread_local ArenaCache t_arenaCache;
+    } // namespace
+
+    std::uint64_t HeapAllocationCount() noexcept
+    {
+#ifdef DX_COUNT_HEAP_ALLOCATIONS
+        return g_heapAllocations.load(std::memory_order_relaxed);
+#else
+        return 0;
+#endif
+    }
+
+    bool CountsHeapAllocations() noexcept
+    {
+#ifdef DX_COUNT_HEAP_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    LinearArena::LinearArena(std::size_t blockSize) : m_blockSize{blockSize}
+    {
+        Expects(blockSize != 0);
+    }
+
+    LinearArena::~LinearArena() = default;
+
+    void* LinearArena::Allocate(std::size_t size, std::size_t align)
+    {
+        Expects(align != 0 && (align & (align - 1)) == 0);
+        while (m_current < m_blocks.size())
+        {
+            const Block& block = m_blocks[m_current];
+            const auto base =
+                reinterpret_cast<std::uintptr_t>(block.Data.get());
+            const std::uintptr_t aligned =
+                (base + m_offset + align - 1) & ~std::uintptr_t{align - 1};
+            const std::size_t end = aligned - base + size;
+            if (end <= block.Size)
+            {
+                m_offset = end;
+                return reinterpret_cast<void*>(aligned);
+            }
+            // 剩下的空间不够，丢弃并换到下一个块。
+            m_usedBefore += block.Size;
+            ++m_current;
+            m_offset = 0;
+        }
+        const std::size_t blockSize = std::max(m_blockSize, size + align);
+        m_blocks.push_back(
+            Block{std::unique_ptr<std::byte[]>{new std::byte[blockSize]},
+                  blockSize});
+        return Allocate(size, align);
+    }
+
+    void LinearArena::Reset()
+    {
+        if (m_blocks.size() > 1)
+        {
+            const std::size_t capacity = Capacity();
+            m_blocks.clear();
+            m_blocks.push_back(
+                Block{std::unique_ptr<std::byte[]>{new std::byte[capacity]},
+                      capacity});
+        }
+        m_current = 0;
+        m_offset = 0;
+        m_usedBefore = 0;
+    }
+
+    std::size_t LinearArena::BytesUsed() const noexcept
+    {
+        return m_usedBefore + m_offset;
+    }
+
+    std::size_t LinearArena::Capacity() const noexcept
+    {
+        std::size_t capacity = 0;
+        for (const Block& block : m_blocks)
+        {
+            capacity += block.Size;
+        }
+        return capacity;
+    }
+
+    void* LinearArena::do_allocate(std::size_t bytes, std::size_t alignment)
+    {
+        return Allocate(bytes, alignment);
+    }
+
+    FrameAllocator::FrameAllocator(std::size_t blockSize)
+        : m_blockSize{blockSize}, m_id{g_nextAllocatorId.fetch_add(1)},
+          m_heapCountAtFrameStart{HeapAllocationCount()}
+    {}
+
+    FrameAllocator::~FrameAllocator() = default;
+
+    void FrameAllocator::BeginFrame()
+    {
+        const Frame& finished = m_frames[m_frameIndex % kFramesInFlight];
+        std::size_t arenaBytes = 0;
+        for (const auto& [thread, arena] : finished.Arenas)
+        {
+            arenaBytes += arena->BytesUsed();
+        }
+        const std::uint64_t heapCount = HeapAllocationCount();
+        m_lastFrameStats = FrameMemoryStats{
+            heapCount - m_heapCountAtFrameStart, arenaBytes};
+        m_heapCountAtFrameStart = heapCount;
+
+        ++m_frameIndex;
+        for (auto& [thread, arena] :
+             m_frames[m_frameIndex % kFramesInFlight].Arenas)
+        {
+            arena->Reset();
+        }
+    }
+
+    LinearArena& FrameAllocator::Arena()
+    {
+        ArenaCache& cache = t_arenaCache;
+        if (cache.Owner != m_id || cache.Frame != m_frameIndex)
+        {
+            cache = ArenaCache{
+                m_id, m_frameIndex,
+                &FindOrCreateArena(m_frames[m_frameIndex % kFramesInFlight])};
+        }
+        return *cache.Arena;
+    }
+
+    LinearArena& FrameAllocator::FindOrCreateArena(Frame& frame)
+    {
+        const std::thread::id current = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lock{frame.Mutex};
+        for (auto& [thread, arena] : frame.Arenas)
+        {
+            if (thread == current)
+                return *arena;
+        }
+        frame.Arenas.push_back(
+            ThreadArena{current, std::make_unique<LinearArena>(m_blockSize)});
+        return *frame.Arenas.back().Arena;
+    }
+} // namespace dx
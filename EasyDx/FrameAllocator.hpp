@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <memory_resource>
+
+namespace dx
+{
+    // 线性分配器：从大块内存中依次切出，不能单独释放，Reset 时一次性回收。
+    // Reset 会把用过的多个块合并成一个，因此每帧用量稳定之后不再访问堆。
+    //
+    // 本身就是一个 std::pmr::memory_resource，可以直接交给 std::pmr 容器；
+    // 容器的 deallocate 什么都不做，内存要等到 Reset。不是线程安全的。
+    class LinearArena : public std::pmr::memory_resource
+    {
+      public:
+        static constexpr std::size_t kDefaultBlockSize = 256 * 1024;
+
+        explicit LinearArena(std::size_t blockSize = kDefaultBlockSize);
+        ~LinearArena() override;
+        DELETE_COPY(LinearArena)
+
+        void* Allocate(std::size_t size, std::size_t align);
+
+        // 只分配内存，不构造对象。
+        template<typename T>
+        T* AllocateArray(std::size_t count)
+        {
+            static_assert(std::is_trivially_destructible_v<T>);
+            return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void Reset();
+
+        // 上次 Reset 之后分配出去的字节数，包括对齐浪费的部分。
+        std::size_t BytesUsed() const noexcept;
+        std::size_t Capacity() const noexcept;
+        std::uint32_t BlockCount() const noexcept
+        {
+            return static_cast<std::uint32_t>(m_blocks.size());
+        }
+
+      private:
+        struct Block
+        {
+            std::unique_ptr<std::byte[]> Data;
+            std::size_t Size;
+        };
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const
+            noexcept override
+        {
+            return this == &other;
+        }
+
+        std::vector<Block> m_blocks;
+        std::size_t m_blockSize;
+        // 正在使用的块以及块内的偏移。
+        std::size_t m_current = 0;
+        std::size_t m_offset = 0;
+        // m_current 之前的块中已经用掉的字节数。
+        std::size_t m_usedBefore = 0;
+    };
+
+    struct FrameMemoryStats
+    {
+        // 这一帧里全局 operator new 被调用的次数。只有编译 EasyDx 时定义了
+        // DX_COUNT_HEAP_ALLOCATIONS（Debug 配置）才会统计，否则总是 0。
+        std::uint64_t HeapAllocations = 0;
+        // 这一帧所有线程从 arena 中分配的字节数。
+        std::size_t ArenaBytes = 0;
+    };
+
+    // 程序启动以来全局 operator new 被调用的次数，见 FrameMemoryStats。
+    std::uint64_t HeapAllocationCount() noexcept;
+    // 是否定义了 DX_COUNT_HEAP_ALLOCATIONS。
+    bool CountsHeapAllocations() noexcept;
+
+    // 每帧的临时内存。kFramesInFlight 帧的 arena 轮流使用：第 N 帧分配的
+    // 内存在 BeginFrame 再被调用 kFramesInFlight 次之前一直有效，因此也可以
+    // 存放 GPU 在之后几帧才读取的数据（例如 map 到 dynamic buffer 之前的
+    // staging 数据）。
+    //
+    // 每个线程在每帧有自己的 arena，分配时不需要加锁，可以在 ParallelFor
+    // 中使用。BeginFrame 只能在没有其它线程分配时调用。
+    class FrameAllocator : Noncopyable
+    {
+      public:
+        static constexpr std::uint32_t kFramesInFlight = 3;
+
+        explicit FrameAllocator(
+            std::size_t blockSize = LinearArena::kDefaultBlockSize);
+        ~FrameAllocator();
+
+        // 结束上一帧的统计，并回收 kFramesInFlight 帧之前的内存。
+        void BeginFrame();
+
+        // 当前线程在这一帧使用的 arena。
+        LinearArena& Arena();
+        std::pmr::memory_resource* Resource() { return &Arena(); }
+
+        template<typename T>
+        std::pmr::vector<T> MakeVector()
+        {
+            return std::pmr::vector<T>{Resource()};
+        }
+
+        std::uint64_t FrameIndex() const noexcept { return m_frameIndex; }
+        const FrameMemoryStats& LastFrameStats() const noexcept
+        {
+            return m_lastFrameStats;
+        }
+
+      private:
+        struct ThreadArena
+        {
+            std::thread::id Thread;
+            std::unique_ptr<LinearArena> Arena;
+        };
+
+        struct Frame
+        {
+            std::mutex Mutex;
+            std::vector<ThreadArena> Arenas;
+        };
+
+        LinearArena& FindOrCreateArena(Frame& frame);
+
+        std::array<Frame, kFramesInFlight> m_frames;
+        std::size_t m_blockSize;
+        // 用来区分 thread_local 缓存属于哪个 FrameAllocator。
+        std::uint64_t m_id;
+        std::uint64_t m_frameIndex = 0;
+        std::uint64_t m_heapCountAtFrameStart = 0;
+        FrameMemoryStats m_lastFrameStats;
+    };
+} // namespace dx
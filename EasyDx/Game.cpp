@@ -6,6 +6,8 @@
 #include "InputSystem.hpp"
 #include "GraphicsDevices.hpp"
 #include "DependentGraphics.hpp"
+#include "FrameAllocator.hpp"
+#include "AssetWatcher.hpp"
 #include <stdexcept>
 #include <gsl/gsl_assert>
 #include <d3d11.h>
@@ -50,12 +52,21 @@ namespace dx
                 {
                     UpdateArgs args{delta};
                     prev = now;
+                    if (m_assetWatcher)
+                        ApplyAssetReloads();
+                    m_frameAllocator->BeginFrame();
+                    if (CountsHeapAllocations())
+                        ReportFrameMemory();
+                    m_lastFrameCbUploads = GetCbUploadStats();
+                    ResetCbUploadStats();
                     m_inputSystem->OnFrameStart();
                     auto& scene = switcher.MainScene();
                     auto& camera = scene.MainCamera();
                     camera.PrepareForRendering(context3D, *this);
                     camera.Update(args, *this);
                     scene.Update(args, *this);
+                    scene.Transforms().UpdateWorldMatrices();
+                    scene.Lights().Flush();
                     scene.Render(context3D, gfxContext, *this);
                     m_inputSystem->OnFrameDone();
                 }
@@ -72,6 +83,42 @@ namespace dx
         });
     }
 
+    AssetWatcher& Game::EnableAssetWatching(
+        std::chrono::milliseconds pollInterval)
+    {
+        if (!m_assetWatcher)
+        {
+            m_assetWatcher = MakeUnique<AssetWatcher>(pollInterval);
+            m_assetWatcher->Start();
+        }
+        return *m_assetWatcher;
+    }
+
+    void Game::ApplyAssetReloads()
+    {
+        m_assetWatcher->ApplyPendingReloads();
+        for (const AssetReloadError& error : m_assetWatcher->TakeErrors())
+        {
+            ::OutputDebugStringA(fmt::format("Failed to reload {}: {}\n",
+                                             error.Path.string(),
+                                             error.Message)
+                                     .c_str());
+        }
+    }
+
+    void Game::ReportFrameMemory() const
+    {
+        const std::uint64_t frame = m_frameAllocator->FrameIndex();
+        if (frame % fps_ != 0)
+            return;
+        const FrameMemoryStats& stats = m_frameAllocator->LastFrameStats();
+        ::OutputDebugStringA(
+            fmt::format("Frame {}: {} heap allocations, {} bytes from the "
+                        "frame arena\n",
+                        frame - 1, stats.HeapAllocations, stats.ArenaBytes)
+                .c_str());
+    }
+
     void Game::SetUp(std::unique_ptr<GameWindow> mainWindow)
     {
         mainWindow_ = std::move(mainWindow);
@@ -186,7 +233,8 @@ namespace dx
     Game::Game(std::unique_ptr<GlobalGraphicsContext> globalGraphics,
                std::uint32_t fps)
         : fps_{fps}, m_globalGraphics{std::move(globalGraphics)},
-          sceneSwitcher_{*this}, m_inputSystem{MakeUnique<InputSystem>()}
+          sceneSwitcher_{*this}, m_inputSystem{MakeUnique<InputSystem>()},
+          m_frameAllocator{MakeUnique<FrameAllocator>()}
     {
         TryHR(::CoInitialize(nullptr));
     }
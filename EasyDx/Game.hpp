@@ -10,6 +10,8 @@ namespace dx
     class SceneBase;
     class Game;
     class InputSystem;
+    class FrameAllocator;
+    class AssetWatcher;
 
     using SceneCreator = std::function<std::unique_ptr<SceneBase>(Game&)>;
 
@@ -78,6 +80,23 @@ namespace dx
         {
             return *m_inputSystem;
         }
+        // 当前帧的临时内存，每帧开始时轮换。
+        FrameAllocator& FrameMemory() const noexcept
+        {
+            return *m_frameAllocator;
+        }
+        // 上一帧上传到 constant buffer 的数据量。
+        const CbUploadStats& LastFrameCbUploads() const noexcept
+        {
+            return m_lastFrameCbUploads;
+        }
+        // 开启热重载：启动 AssetWatcher 的后台线程，之后每帧开始前换入已经
+        // 重新加载好的资源。重复调用返回同一个 AssetWatcher。
+        AssetWatcher& EnableAssetWatching(
+            std::chrono::milliseconds pollInterval = std::chrono::milliseconds{
+                250});
+        // 没有开启热重载时为 nullptr。
+        AssetWatcher* Assets() const noexcept { return m_assetWatcher.get(); }
 
       private:
         friend struct MessageDispatcher;
@@ -87,13 +106,21 @@ namespace dx
         void UnpackMessage(WindowEventArgsPack event);
         void PrepareGraphicsForResizing(GameWindow* window, Size newSize);
         InputSystem& GetInputSystem() noexcept { return *m_inputSystem; }
+        void ApplyAssetReloads();
+        // 统计了堆分配时（Debug 配置），每秒把上一帧的 FrameMemoryStats
+        // 输出到调试器。
+        void ReportFrameMemory() const;
 
         std::unique_ptr<GlobalGraphicsContext> m_globalGraphics;
         SceneSwitcher sceneSwitcher_;
         // TODO: only one window?
         std::unique_ptr<GameWindow> mainWindow_;
         std::unique_ptr<InputSystem> m_inputSystem;
+        std::unique_ptr<FrameAllocator> m_frameAllocator;
+        CbUploadStats m_lastFrameCbUploads;
         std::uint32_t fps_;
+        // 后台线程中的 loader 会用到上面的设备，最先析构。
+        std::unique_ptr<AssetWatcher> m_assetWatcher;
     };
 
     void RunGame(Game& game, std::unique_ptr<GameWindow> mainWindow,
@@ -3,28 +3,59 @@
 #include "ShaderCbKeyDef.hpp"
 #include "GlobalShaderContext.hpp"
 #include "Resources/Shaders.hpp"
+#include <atomic>
 
 namespace dx
 {
-    void GlobalShaderContext::Apply(
-        const std::unordered_map<std::string, gsl::span<std::byte>>& bytesMap)
-        const
+    namespace
     {
-        //不想再用 boost::unordered_map 找来找去，代码太长了，先用 string
-        //了……
-        const auto SetIfExists = [&](std::string name, const auto& value) {
-            if (const auto it = bytesMap.find(name); it != bytesMap.end())
-            {
-                gsl::copy(gsl::as_bytes(SingleAsSpan(value)), it->second);
-            }
+        std::atomic<std::uint64_t> g_nextEpoch{1};
+
+        const std::array<std::string_view, 2> kFrameFieldNames = {
+            LIGHTS, LIGHT_COUNT};
+        const std::array<std::string_view, 4> kViewFieldNames = {
+            PROJ_MATRIX, VIEW_MATRIX, VIEW_PROJ_MATRIX, EYE_POS};
+    } // namespace
+
+    void GlobalShaderContext::BeginFrame()
+    {
+        FrameEpoch = g_nextEpoch.fetch_add(1);
+        BeginView();
+    }
+
+    void GlobalShaderContext::BeginView()
+    {
+        ViewEpoch = g_nextEpoch.fetch_add(1);
+    }
+
+    std::optional<CbFrequency>
+    GlobalShaderContext::FieldFrequency(std::string_view name)
+    {
+        const auto contains = [name](const auto& names) {
+            return std::find(names.begin(), names.end(), name) != names.end();
         };
-        // SetIfExists(WORLD_MATRIX, WorldMatrix);
-        SetIfExists(PROJ_MATRIX, ProjMatrix);
-        SetIfExists(VIEW_MATRIX, ViewMatrix);
-        SetIfExists(VIEW_PROJ_MATRIX, ViewProjMatrix);
-        SetIfExists(EYE_POS, EyePos);
-        SetIfExists(LIGHTS, lights);
-        SetIfExists(LIGHT_COUNT, lightCount);
+        if (contains(kFrameFieldNames))
+            return CbFrequency::kPerFrame;
+        if (contains(kViewFieldNames))
+            return CbFrequency::kPerView;
+        return std::nullopt;
+    }
+
+    void GlobalShaderContext::ForEachFrameField(
+        const FieldVisitor& visitor) const
+    {
+        visitor(LIGHTS, AsBytes(lights));
+        visitor(LIGHT_COUNT, AsBytes(lightCount));
+    }
+
+    void GlobalShaderContext::ForEachViewField(
+        const FieldVisitor& visitor) const
+    {
+        // visitor(WORLD_MATRIX, AsBytes(WorldMatrix));
+        visitor(PROJ_MATRIX, AsBytes(ProjMatrix));
+        visitor(VIEW_MATRIX, AsBytes(ViewMatrix));
+        visitor(VIEW_PROJ_MATRIX, AsBytes(ViewProjMatrix));
+        visitor(EYE_POS, AsBytes(EyePos));
     }
 
 } // namespace dx
@@ -2,6 +2,7 @@
 
 #include <DirectXMath.h>
 #include "CBStructs.hpp"
+#include "Resources/Shaders.hpp"
 
 namespace dx
 {
@@ -18,11 +19,30 @@ namespace dx
         cb::Light lights[10];
         int lightCount;
 
+        // shader 记录最近写入的 epoch，相同时不再写入（也就不再上传）。
+        // 为 0 时每次都写入。填好光源后调用 BeginFrame，之后只修改了
+        // 矩阵或 EyePos 时调用 BeginView。
+        std::uint64_t FrameEpoch = 0;
+        std::uint64_t ViewEpoch = 0;
+
+        void BeginFrame();
+        void BeginView();
+
         void Flush();
 
+        // GlobalShaderContext 中的字段返回 kPerFrame（光源）或 kPerView，
+        // 其它字段返回 std::nullopt。
+        static std::optional<CbFrequency>
+        FieldFrequency(std::string_view name);
+
       private:
         friend class Shader;
-        void Apply(const std::unordered_map<std::string, gsl::span<std::byte>>&
-                       bytesMap) const;
+
+        using FieldVisitor = std::function<void(
+            std::string_view name, gsl::span<const std::byte> bytes)>;
+
+        // 光源（每帧）与矩阵、EyePos（每个 view）。
+        void ForEachFrameField(const FieldVisitor& visitor) const;
+        void ForEachViewField(const FieldVisitor& visitor) const;
     };
-} // namespace dx
\ No newline at end of file
+} // namespace dx
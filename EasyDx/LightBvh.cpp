@@ -0,0 +1,235 @@
+#include "pch.hpp"
+#include "LightBvh.hpp"
+#include "Mesh.hpp"
+#include <cfloat>
+#include <numeric>
+
+namespace dx
+{
+    constexpr std::uint32_t kLightsPerLeaf = 4;
+    constexpr std::uint32_t kMaxTraversalDepth = 64;
+    constexpr std::size_t kParallelNodeThreshold = 64;
+
+    namespace
+    {
+        float Luminance(const DirectX::XMFLOAT4& color)
+        {
+            return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+        }
+
+        bool Intersects(const DirectX::XMFLOAT3& min,
+                        const DirectX::XMFLOAT3& max,
+                        const DirectX::BoundingSphere& sphere)
+        {
+            const auto axisDistance = [](float value, float low, float high) {
+                return value < low ? low - value
+                                   : (value > high ? value - high : 0.f);
+            };
+            const float x = axisDistance(sphere.Center.x, min.x, max.x);
+            const float y = axisDistance(sphere.Center.y, min.y, max.y);
+            const float z = axisDistance(sphere.Center.z, min.z, max.z);
+            return x * x + y * y + z * z <= sphere.Radius * sphere.Radius;
+        }
+    } // namespace
+
+    void LightBvh::Build(gsl::span<const Light> lights)
+    {
+        std::vector<cb::Light> cbLights(lights.begin(), lights.end());
+        Build(cbLights);
+    }
+
+    void LightBvh::Build(gsl::span<const cb::Light> lights)
+    {
+        m_globalLights.clear();
+        m_localLights.clear();
+        m_bounds.clear();
+        m_nodes.clear();
+        for (const cb::Light& cbLight : lights)
+        {
+            if (!cbLight.Enabled)
+                continue;
+            if (cbLight.Type == LightType::DirectionalLight)
+            {
+                m_globalLights.push_back(cbLight);
+                continue;
+            }
+            m_bounds.push_back(LocalLight{
+                {cbLight.Position.x, cbLight.Position.y, cbLight.Position.z},
+                cbLight.Range,
+                Luminance(cbLight.Color),
+                {cbLight.ConstantAttenuation, cbLight.LinearAttenuation,
+                 cbLight.QuadraticAttenuation}});
+            m_localLights.push_back(cbLight);
+        }
+
+        const auto count = static_cast<std::uint32_t>(m_bounds.size());
+        m_order.resize(count);
+        std::iota(m_order.begin(), m_order.end(), 0u);
+        if (count != 0)
+        {
+            m_nodes.reserve(std::size_t{count} * 2);
+            m_nodes.emplace_back();
+            BuildNode(0, 0, count);
+        }
+    }
+
+    void LightBvh::BuildNode(std::uint32_t index, std::uint32_t begin,
+                             std::uint32_t end)
+    {
+        DirectX::XMFLOAT3 min{FLT_MAX, FLT_MAX, FLT_MAX};
+        DirectX::XMFLOAT3 max{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        DirectX::XMFLOAT3 centerMin = min, centerMax = max;
+        for (std::uint32_t i = begin; i < end; ++i)
+        {
+            const LocalLight& light = m_bounds[m_order[i]];
+            const auto& c = light.Center;
+            min = {std::min(min.x, c.x - light.Range),
+                   std::min(min.y, c.y - light.Range),
+                   std::min(min.z, c.z - light.Range)};
+            max = {std::max(max.x, c.x + light.Range),
+                   std::max(max.y, c.y + light.Range),
+                   std::max(max.z, c.z + light.Range)};
+            centerMin = {std::min(centerMin.x, c.x),
+                         std::min(centerMin.y, c.y),
+                         std::min(centerMin.z, c.z)};
+            centerMax = {std::max(centerMax.x, c.x),
+                         std::max(centerMax.y, c.y),
+                         std::max(centerMax.z, c.z)};
+        }
+        m_nodes[index].Min = min;
+        m_nodes[index].Max = max;
+        if (end - begin <= kLightsPerLeaf)
+        {
+            m_nodes[index].First = begin;
+            m_nodes[index].Count = end - begin;
+            return;
+        }
+
+        // 沿光源中心分布最广的轴在中位数处切分。
+        const float extents[] = {centerMax.x - centerMin.x,
+                                 centerMax.y - centerMin.y,
+                                 centerMax.z - centerMin.z};
+        const auto axis = static_cast<std::size_t>(
+            std::max_element(std::begin(extents), std::end(extents)) -
+            std::begin(extents));
+        const auto coordinate = [&](std::uint32_t light) {
+            const auto& c = m_bounds[light].Center;
+            return axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+        };
+        const std::uint32_t middle = begin + (end - begin) / 2;
+        std::nth_element(m_order.begin() + begin, m_order.begin() + middle,
+                         m_order.begin() + end,
+                         [&](std::uint32_t lhs, std::uint32_t rhs) {
+                             return coordinate(lhs) < coordinate(rhs);
+                         });
+
+        const auto left = static_cast<std::uint32_t>(m_nodes.size());
+        m_nodes[index].First = left;
+        m_nodes[index].Count = 0;
+        m_nodes.resize(m_nodes.size() + 2);
+        BuildNode(left, begin, middle);
+        BuildNode(left + 1, middle, end);
+    }
+
+    void LightBvh::SelectLights(const DirectX::BoundingSphere& bounds,
+                                ObjectLights& result,
+                                std::uint32_t maxLights) const
+    {
+        Expects(maxLights <= kMaxLightsPerObject);
+        result.Count = 0;
+        for (const cb::Light& light : m_globalLights)
+        {
+            if (result.Count == maxLights)
+                return;
+            result.Lights[result.Count++] = light;
+        }
+        const std::uint32_t localBudget = maxLights - result.Count;
+        if (localBudget == 0 || m_nodes.empty())
+            return;
+
+        // 按影响从大到小保存当前最好的 localBudget 个光源。
+        struct Candidate
+        {
+            float Score;
+            std::uint32_t Light;
+        };
+        std::array<Candidate, kMaxLightsPerObject> best;
+        std::uint32_t bestCount = 0;
+
+        std::array<std::uint32_t, kMaxTraversalDepth> stack;
+        std::uint32_t stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize != 0)
+        {
+            const Node& node = m_nodes[stack[--stackSize]];
+            if (!Intersects(node.Min, node.Max, bounds))
+                continue;
+            if (node.Count == 0)
+            {
+                Expects(stackSize + 2 <= kMaxTraversalDepth);
+                stack[stackSize++] = node.First;
+                stack[stackSize++] = node.First + 1;
+                continue;
+            }
+            for (std::uint32_t i = node.First; i < node.First + node.Count;
+                 ++i)
+            {
+                const std::uint32_t lightIndex = m_order[i];
+                const LocalLight& light = m_bounds[lightIndex];
+                const float ox = light.Center.x - bounds.Center.x;
+                const float oy = light.Center.y - bounds.Center.y;
+                const float oz = light.Center.z - bounds.Center.z;
+                const float centerDistance =
+                    std::sqrt(ox * ox + oy * oy + oz * oz);
+                if (centerDistance > light.Range + bounds.Radius)
+                    continue;
+                // 用物体表面上离光源最近的点估计衰减。
+                const float d = std::max(centerDistance - bounds.Radius, 0.f);
+                const auto& att = light.Attenuation;
+                const float score =
+                    light.Intensity /
+                    std::max(att.x + att.y * d + att.z * d * d, 1e-4f);
+                const auto isBetter = [&](const Candidate& other) {
+                    return score > other.Score ||
+                           (score == other.Score && lightIndex < other.Light);
+                };
+                if (bestCount == localBudget && !isBetter(best[bestCount - 1]))
+                    continue;
+                std::uint32_t slot =
+                    bestCount == localBudget ? bestCount - 1 : bestCount++;
+                while (slot > 0 && isBetter(best[slot - 1]))
+                {
+                    best[slot] = best[slot - 1];
+                    --slot;
+                }
+                best[slot] = Candidate{score, lightIndex};
+            }
+        }
+
+        for (std::uint32_t i = 0; i < bestCount; ++i)
+        {
+            result.Lights[result.Count++] = m_localLights[best[i].Light];
+        }
+    }
+
+    void SelectLightsForNodes(const LightBvh& bvh,
+                              gsl::span<const RenderNode> nodes,
+                              std::vector<ObjectLights>& results,
+                              std::uint32_t maxLights)
+    {
+        results.resize(static_cast<std::size_t>(nodes.size()));
+        ParallelFor(results.size(), kParallelNodeThreshold,
+                    [&](std::size_t begin, std::size_t end) {
+                        for (std::size_t i = begin; i < end; ++i)
+                        {
+                            const RenderNode& node =
+                                nodes[static_cast<std::ptrdiff_t>(i)];
+                            DirectX::BoundingSphere worldSphere;
+                            node.mesh.GetBounds().Sphere.Transform(
+                                worldSphere, node.World);
+                            bvh.SelectLights(worldSphere, results[i],
+                                             maxLights);
+                        }
+                    });
+    }
+} // namespace dx
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CBStructs.hpp"
+#include "RenderNode.hpp"
+#include <DirectXCollision.h>
+
+namespace dx
+{
+    // 与 GlobalShaderContext::lights 以及 shader 中 dx_Lights 的长度一致。
+    constexpr std::uint32_t kMaxLightsPerObject = 10;
+
+    // 一个物体实际使用的光源，方向光在前，其余按影响从大到小排列。
+    struct ObjectLights
+    {
+        std::array<cb::Light, kMaxLightsPerObject> Lights;
+        std::uint32_t Count = 0;
+
+        gsl::span<const cb::Light> AsSpan() const
+        {
+            return gsl::make_span(Lights.data(),
+                                  static_cast<std::ptrdiff_t>(Count));
+        }
+    };
+
+    // point/spot light 作用范围（以 Range 为半径的球）上的 BVH，用于为每个
+    // 物体挑选影响最大的若干个光源。方向光影响所有物体，不进入 BVH。
+    class LightBvh
+    {
+      public:
+        void Build(gsl::span<const Light> lights);
+        // lights 通常来自 LightRegistry::GpuLights。
+        void Build(gsl::span<const cb::Light> lights);
+
+        // 与 bounds 相交的 point/spot light 按影响排序，连同所有方向光一起
+        // 最多选出 maxLights 个。
+        void SelectLights(const DirectX::BoundingSphere& bounds,
+                          ObjectLights& result,
+                          std::uint32_t maxLights = kMaxLightsPerObject) const;
+
+        std::uint32_t LocalLightCount() const
+        {
+            return static_cast<std::uint32_t>(m_localLights.size());
+        }
+        std::uint32_t NodeCount() const
+        {
+            return static_cast<std::uint32_t>(m_nodes.size());
+        }
+
+      private:
+        struct Node
+        {
+            DirectX::XMFLOAT3 Min;
+            // 叶子：m_order 中的第一个光源；内部节点：左子节点，右子节点
+            // 紧随其后。
+            std::uint32_t First;
+            DirectX::XMFLOAT3 Max;
+            // 0 表示内部节点。
+            std::uint32_t Count;
+        };
+
+        struct LocalLight
+        {
+            DirectX::XMFLOAT3 Center;
+            float Range;
+            float Intensity;
+            DirectX::XMFLOAT3 Attenuation;
+        };
+
+        // 计算 m_order[begin, end) 的包围盒并在需要时继续切分。
+        void BuildNode(std::uint32_t index, std::uint32_t begin,
+                       std::uint32_t end);
+
+        std::vector<cb::Light> m_globalLights;
+        std::vector<cb::Light> m_localLights;
+        std::vector<LocalLight> m_bounds;
+        std::vector<std::uint32_t> m_order;
+        std::vector<Node> m_nodes;
+    };
+
+    // 并行地为每个 node 选择光源，results 与 nodes 一一对应。
+    void SelectLightsForNodes(const LightBvh& bvh,
+                              gsl::span<const RenderNode> nodes,
+                              std::vector<ObjectLights>& results,
+                              std::uint32_t maxLights = kMaxLightsPerObject);
+} // namespace dx
@@ -0,0 +1,360 @@
+#include "pch.hpp"
+#include "LightRegistry.hpp"
+
+namespace dx
+{
+    constexpr std::uint32_t kGroupSize = 4;
+    constexpr std::uint32_t kBitsPerWord = 64;
+    constexpr std::uint32_t kGroupsPerWord = kBitsPerWord / kGroupSize;
+
+    namespace
+    {
+        bool TestBit(const std::vector<std::uint64_t>& words,
+                     std::uint32_t slot)
+        {
+            return (words[slot / kBitsPerWord] >> (slot % kBitsPerWord)) & 1;
+        }
+
+        void AssignBit(std::vector<std::uint64_t>& words, std::uint32_t slot,
+                       bool value)
+        {
+            const std::uint64_t mask = std::uint64_t{1}
+                                       << (slot % kBitsPerWord);
+            if (value)
+                words[slot / kBitsPerWord] |= mask;
+            else
+                words[slot / kBitsPerWord] &= ~mask;
+        }
+    } // namespace
+
+    LightRegistry::Pool& LightRegistry::PoolOf(LightType type)
+    {
+        return m_pools[static_cast<std::size_t>(type)];
+    }
+
+    const LightRegistry::Pool& LightRegistry::PoolOf(LightType type) const
+    {
+        return m_pools[static_cast<std::size_t>(type)];
+    }
+
+    LightHandle LightRegistry::Allocate(LightType type)
+    {
+        Pool& pool = PoolOf(type);
+        std::uint32_t slot;
+        if (!pool.FreeSlots.empty())
+        {
+            slot = pool.FreeSlots.back();
+            pool.FreeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<std::uint32_t>(pool.Generations.size());
+            pool.Generations.push_back(0);
+            pool.PackedIndex.push_back(0);
+            if (slot % kGroupSize == 0)
+            {
+                for (auto& lane : pool.Lanes)
+                    lane.push_back(DirectX::XMVectorZero());
+                pool.Converted.insert(pool.Converted.end(), kGroupSize,
+                                      cb::Light{});
+            }
+            if (slot % kBitsPerWord == 0)
+            {
+                pool.EnabledWords.push_back(0);
+                pool.DirtyWords.push_back(0);
+            }
+        }
+        return LightHandle{type, slot, pool.Generations[slot]};
+    }
+
+    LightHandle LightRegistry::Add(const PointLight& light)
+    {
+        const LightHandle handle = Allocate(LightType::PointLight);
+        SetPosition(handle, light.Position);
+        SetColor(handle, light.Color);
+        SetAttenuation(handle, light.Attr);
+        SetRange(handle, light.Range);
+        SetEnabled(handle, light.Enabled);
+        return handle;
+    }
+
+    LightHandle LightRegistry::Add(const DirectionalLight& light)
+    {
+        const LightHandle handle = Allocate(LightType::DirectionalLight);
+        SetDirection(handle, light.Direction);
+        SetColor(handle, light.Color);
+        SetEnabled(handle, light.Enabled);
+        return handle;
+    }
+
+    LightHandle LightRegistry::Add(const SpotLight& light)
+    {
+        const LightHandle handle = Allocate(LightType::SpotLight);
+        SetPosition(handle, light.Position);
+        SetDirection(handle, light.Direction);
+        SetColor(handle, light.Color);
+        SetAttenuation(handle, light.Attr);
+        SetRange(handle, light.Range);
+        SetSpotAngle(handle, light.SpotAngle);
+        SetEnabled(handle, light.Enabled);
+        return handle;
+    }
+
+    LightHandle LightRegistry::Add(const Light& light)
+    {
+        return std::visit([this](const auto& typed) { return Add(typed); },
+                          light);
+    }
+
+    void LightRegistry::Remove(LightHandle handle)
+    {
+        const std::uint32_t slot = Slot(handle);
+        Pool& pool = PoolOf(handle.Type);
+        if (TestBit(pool.EnabledWords, slot))
+        {
+            AssignBit(pool.EnabledWords, slot, false);
+            m_membershipChanged = true;
+        }
+        ++pool.Generations[slot];
+        pool.FreeSlots.push_back(slot);
+    }
+
+    bool LightRegistry::IsAlive(LightHandle handle) const
+    {
+        const Pool& pool = PoolOf(handle.Type);
+        return handle.Index < pool.Generations.size() &&
+               pool.Generations[handle.Index] == handle.Generation;
+    }
+
+    std::uint32_t LightRegistry::Count(LightType type) const
+    {
+        const Pool& pool = PoolOf(type);
+        return static_cast<std::uint32_t>(pool.Generations.size() -
+                                          pool.FreeSlots.size());
+    }
+
+    std::uint32_t LightRegistry::Slot(LightHandle handle) const
+    {
+        Expects(IsAlive(handle));
+        return handle.Index;
+    }
+
+    void LightRegistry::MarkDirty(LightType type, std::uint32_t slot)
+    {
+        AssignBit(PoolOf(type).DirtyWords, slot, true);
+    }
+
+    void LightRegistry::SetLane(LightHandle handle, Lane lane, float value)
+    {
+        const std::uint32_t slot = Slot(handle);
+        DirectX::XMVECTOR& lanes =
+            PoolOf(handle.Type).Lanes[lane][slot / kGroupSize];
+        lanes = DirectX::XMVectorSetByIndex(lanes, value, slot % kGroupSize);
+        MarkDirty(handle.Type, slot);
+    }
+
+    float LightRegistry::GetLane(LightHandle handle, Lane lane) const
+    {
+        const std::uint32_t slot = Slot(handle);
+        return DirectX::XMVectorGetByIndex(
+            PoolOf(handle.Type).Lanes[lane][slot / kGroupSize],
+            slot % kGroupSize);
+    }
+
+    void LightRegistry::SetEnabled(LightHandle handle, bool enabled)
+    {
+        const std::uint32_t slot = Slot(handle);
+        Pool& pool = PoolOf(handle.Type);
+        if (TestBit(pool.EnabledWords, slot) == enabled)
+            return;
+        AssignBit(pool.EnabledWords, slot, enabled);
+        MarkDirty(handle.Type, slot);
+        m_membershipChanged = true;
+    }
+
+    bool LightRegistry::IsEnabled(LightHandle handle) const
+    {
+        return TestBit(PoolOf(handle.Type).EnabledWords, Slot(handle));
+    }
+
+    void LightRegistry::SetPosition(LightHandle handle,
+                                    const DirectX::XMFLOAT3& position)
+    {
+        Expects(handle.Type != LightType::DirectionalLight);
+        SetLane(handle, kPositionX, position.x);
+        SetLane(handle, kPositionY, position.y);
+        SetLane(handle, kPositionZ, position.z);
+    }
+
+    void LightRegistry::SetDirection(LightHandle handle,
+                                     const DirectX::XMFLOAT3& direction)
+    {
+        Expects(handle.Type != LightType::PointLight);
+        SetLane(handle, kDirectionX, direction.x);
+        SetLane(handle, kDirectionY, direction.y);
+        SetLane(handle, kDirectionZ, direction.z);
+    }
+
+    void LightRegistry::SetColor(LightHandle handle,
+                                 const DirectX::XMFLOAT4& color)
+    {
+        SetLane(handle, kColorR, color.x);
+        SetLane(handle, kColorG, color.y);
+        SetLane(handle, kColorB, color.z);
+        SetLane(handle, kColorA, color.w);
+    }
+
+    void LightRegistry::SetRange(LightHandle handle, float range)
+    {
+        Expects(handle.Type != LightType::DirectionalLight);
+        SetLane(handle, kRange, range);
+    }
+
+    void LightRegistry::SetAttenuation(LightHandle handle,
+                                       const DirectX::XMFLOAT3& attenuation)
+    {
+        Expects(handle.Type != LightType::DirectionalLight);
+        SetLane(handle, kConstantAttenuation, attenuation.x);
+        SetLane(handle, kLinearAttenuation, attenuation.y);
+        SetLane(handle, kQuadraticAttenuation, attenuation.z);
+    }
+
+    void LightRegistry::SetSpotAngle(LightHandle handle, float spotAngle)
+    {
+        Expects(handle.Type == LightType::SpotLight);
+        SetLane(handle, kSpotAngle, spotAngle);
+    }
+
+    Light LightRegistry::Get(LightHandle handle) const
+    {
+        const auto float3 = [&](Lane first) {
+            return DirectX::XMFLOAT3{
+                GetLane(handle, first),
+                GetLane(handle, static_cast<Lane>(first + 1)),
+                GetLane(handle, static_cast<Lane>(first + 2))};
+        };
+        const DirectX::XMFLOAT4 color{
+            GetLane(handle, kColorR), GetLane(handle, kColorG),
+            GetLane(handle, kColorB), GetLane(handle, kColorA)};
+        const bool enabled = IsEnabled(handle);
+        switch (handle.Type)
+        {
+            case LightType::PointLight:
+                return PointLight{float3(kPositionX), color,
+                                  float3(kConstantAttenuation),
+                                  GetLane(handle, kRange), enabled};
+            case LightType::DirectionalLight:
+                return DirectionalLight{color, float3(kDirectionX), enabled};
+            default:
+                return SpotLight{float3(kPositionX),
+                                 GetLane(handle, kSpotAngle),
+                                 float3(kDirectionX),
+                                 GetLane(handle, kRange),
+                                 color,
+                                 float3(kConstantAttenuation),
+                                 enabled};
+        }
+    }
+
+    std::uint32_t LightRegistry::ConvertDirty(LightType type,
+                                              bool updatePacked)
+    {
+        using namespace DirectX;
+        Pool& pool = PoolOf(type);
+        const auto& lanes = pool.Lanes;
+        std::uint32_t converted = 0;
+        for (std::size_t word = 0; word < pool.DirtyWords.size(); ++word)
+        {
+            const std::uint64_t dirty = pool.DirtyWords[word];
+            if (dirty == 0)
+                continue;
+            pool.DirtyWords[word] = 0;
+            for (std::uint32_t i = 0; i < kGroupsPerWord; ++i)
+            {
+                const auto groupMask = static_cast<std::uint32_t>(
+                    (dirty >> (i * kGroupSize)) & 0xF);
+                if (groupMask == 0)
+                    continue;
+                const std::size_t g = word * kGroupsPerWord + i;
+                // 转置后第 i 行就是第 i 个光源的 float4。
+                const XMMATRIX position = XMMatrixTranspose(
+                    XMMATRIX{lanes[kPositionX][g], lanes[kPositionY][g],
+                             lanes[kPositionZ][g], XMVectorSplatOne()});
+                const XMMATRIX direction = XMMatrixTranspose(
+                    XMMATRIX{lanes[kDirectionX][g], lanes[kDirectionY][g],
+                             lanes[kDirectionZ][g], XMVectorZero()});
+                const XMMATRIX color = XMMatrixTranspose(
+                    XMMATRIX{lanes[kColorR][g], lanes[kColorG][g],
+                             lanes[kColorB][g], lanes[kColorA][g]});
+                // cb::Light 中 SpotAngle 与三个衰减系数是连续的。
+                const XMMATRIX spot = XMMatrixTranspose(
+                    XMMATRIX{lanes[kSpotAngle][g],
+                             lanes[kConstantAttenuation][g],
+                             lanes[kLinearAttenuation][g],
+                             lanes[kQuadraticAttenuation][g]});
+                for (std::uint32_t lane = 0; lane < kGroupSize; ++lane)
+                {
+                    if (((groupMask >> lane) & 1) == 0)
+                        continue;
+                    const auto slot =
+                        static_cast<std::uint32_t>(g * kGroupSize + lane);
+                    cb::Light& light = pool.Converted[slot];
+                    XMStoreFloat4(&light.Position, position.r[lane]);
+                    XMStoreFloat4(&light.Direction, direction.r[lane]);
+                    XMStoreFloat4(&light.Color, color.r[lane]);
+                    XMFLOAT4 spotParams;
+                    XMStoreFloat4(&spotParams, spot.r[lane]);
+                    light.SpotAngle = spotParams.x;
+                    light.ConstantAttenuation = spotParams.y;
+                    light.LinearAttenuation = spotParams.z;
+                    light.QuadraticAttenuation = spotParams.w;
+                    light.Type = type;
+                    light.Enabled = TestBit(pool.EnabledWords, slot);
+                    light.Range = XMVectorGetByIndex(lanes[kRange][g], lane);
+                    light.Padding = 0;
+                    if (updatePacked && light.Enabled)
+                        m_packed[pool.PackedIndex[slot]] = light;
+                    ++converted;
+                }
+            }
+        }
+        return converted;
+    }
+
+    void LightRegistry::Repack()
+    {
+        m_packed.clear();
+        for (Pool& pool : m_pools)
+        {
+            const auto slotCount =
+                static_cast<std::uint32_t>(pool.Generations.size());
+            for (std::uint32_t slot = 0; slot < slotCount; ++slot)
+            {
+                if (!TestBit(pool.EnabledWords, slot))
+                    continue;
+                pool.PackedIndex[slot] =
+                    static_cast<std::uint32_t>(m_packed.size());
+                m_packed.push_back(pool.Converted[slot]);
+            }
+        }
+    }
+
+    std::uint32_t LightRegistry::Flush()
+    {
+        // 启用的集合没变时 m_packed 中的位置不变，只需更新转换过的项。
+        const bool repack = m_membershipChanged;
+        std::uint32_t converted = 0;
+        for (const auto type :
+             {LightType::DirectionalLight, LightType::PointLight,
+              LightType::SpotLight})
+        {
+            converted += ConvertDirty(type, !repack);
+        }
+        if (repack)
+        {
+            Repack();
+            m_membershipChanged = false;
+        }
+        return converted;
+    }
+} // namespace dx
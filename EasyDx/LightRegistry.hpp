@@ -0,0 +1,118 @@
+#pragma once
+
+#include "CBStructs.hpp"
+#include "AlignedAllocator.hpp"
+#include <DirectXMath.h>
+
+namespace dx
+{
+    // LightRegistry 中一个光源的句柄，与 TransformHandle 一样带有
+    // generation，光源被 Remove 后旧句柄失效。
+    struct LightHandle
+    {
+        LightType Type = LightType::PointLight;
+        std::uint32_t Index = UINT32_MAX;
+        std::uint32_t Generation = 0;
+    };
+
+    inline bool operator==(LightHandle lhs, LightHandle rhs)
+    {
+        return lhs.Type == rhs.Type && lhs.Index == rhs.Index &&
+               lhs.Generation == rhs.Generation;
+    }
+
+    inline bool operator!=(LightHandle lhs, LightHandle rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    // 每种光源一个 pool，pool 中每个属性分量一个数组，每个 XMVECTOR 存 4 个
+    // 光源的同一分量（与 TransformStore 相同）。启用与 dirty 状态用 bitset
+    // 保存。
+    //
+    // Flush 只把 dirty 的 4 元组转置成 cb::Light，结果缓存下来；启用的
+    // 光源按类型紧密排列在 GpuLights 中，可以直接拷贝到 constant buffer。
+    class LightRegistry : Noncopyable
+    {
+      public:
+        LightRegistry() = default;
+        DEFAULT_MOVE(LightRegistry)
+
+        LightHandle Add(const PointLight& light);
+        LightHandle Add(const DirectionalLight& light);
+        LightHandle Add(const SpotLight& light);
+        LightHandle Add(const Light& light);
+        void Remove(LightHandle handle);
+        bool IsAlive(LightHandle handle) const;
+        // 存活的光源数量，包括未启用的。
+        std::uint32_t Count(LightType type) const;
+
+        void SetEnabled(LightHandle handle, bool enabled);
+        bool IsEnabled(LightHandle handle) const;
+        // 方向光没有 position/range/attenuation，point light 没有 direction，
+        // 只有 spot light 有 spot angle；设置不存在的属性是错误。
+        void SetPosition(LightHandle handle,
+                         const DirectX::XMFLOAT3& position);
+        void SetDirection(LightHandle handle,
+                          const DirectX::XMFLOAT3& direction);
+        void SetColor(LightHandle handle, const DirectX::XMFLOAT4& color);
+        void SetRange(LightHandle handle, float range);
+        void SetAttenuation(LightHandle handle,
+                            const DirectX::XMFLOAT3& attenuation);
+        void SetSpotAngle(LightHandle handle, float spotAngle);
+        Light Get(LightHandle handle) const;
+
+        // 转换上次 Flush 之后改变过的光源，返回被转换的光源数。
+        std::uint32_t Flush();
+        // 上一次 Flush 时启用的光源，依次为方向光、point light、spot light。
+        gsl::span<const cb::Light> GpuLights() const { return m_packed; }
+
+      private:
+        enum Lane
+        {
+            kPositionX,
+            kPositionY,
+            kPositionZ,
+            kDirectionX,
+            kDirectionY,
+            kDirectionZ,
+            kColorR,
+            kColorG,
+            kColorB,
+            kColorA,
+            kSpotAngle,
+            kConstantAttenuation,
+            kLinearAttenuation,
+            kQuadraticAttenuation,
+            kRange,
+            kLaneCount
+        };
+
+        struct Pool
+        {
+            std::array<AlignedVec<DirectX::XMVECTOR>, kLaneCount> Lanes;
+            std::vector<std::uint64_t> EnabledWords;
+            std::vector<std::uint64_t> DirtyWords;
+            std::vector<std::uint32_t> Generations;
+            std::vector<std::uint32_t> FreeSlots;
+            // 按槽位排列的转换结果，长度是 4 的倍数。
+            std::vector<cb::Light> Converted;
+            // 启用的光源在 m_packed 中的位置。
+            std::vector<std::uint32_t> PackedIndex;
+        };
+
+        Pool& PoolOf(LightType type);
+        const Pool& PoolOf(LightType type) const;
+        std::uint32_t Slot(LightHandle handle) const;
+        LightHandle Allocate(LightType type);
+        void SetLane(LightHandle handle, Lane lane, float value);
+        float GetLane(LightHandle handle, Lane lane) const;
+        void MarkDirty(LightType type, std::uint32_t slot);
+        std::uint32_t ConvertDirty(LightType type, bool updatePacked);
+        void Repack();
+
+        std::array<Pool, 3> m_pools;
+        std::vector<cb::Light> m_packed;
+        bool m_membershipChanged = false;
+    };
+} // namespace dx
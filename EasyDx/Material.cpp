@@ -1,5 +1,6 @@
 #include "pch.hpp"
 #include "Material.hpp"
+#include "Predefined.hpp"
 
 namespace dx
 {
@@ -55,9 +56,13 @@ namespace dx
         g_predefinedPasses = std::make_unique<PredefinedPasses>();
 
         g_predefinedPasses->m_defaultShadowCaster =
-            std::make_shared<Pass>(Pass{MakeShaderCollection(
-                Shaders::Get(Shaders::kDefaultShadowCasterVS).value(),
-                Shaders::Get(Shaders::kDefaultShadowCasterPS).value())});
+            std::make_shared<Pass>(Pass{
+                MakeShaderCollection(
+                    Shaders::Get(Shaders::kDefaultShadowCasterVS).value(),
+                    Shaders::Get(Shaders::kDefaultShadowCasterPS).value()),
+                {},
+                {},
+                PredefinedResources::GetShadowCaster()});
     }
 
     std::shared_ptr<Pass> PredefinedPasses::GetPlainShadowCaster()
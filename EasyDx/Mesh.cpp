@@ -2,6 +2,7 @@
 #include "Mesh.hpp"
 #include "Bind.hpp"
 #include "Model.hpp"
+#include <cstring>
 
 namespace dx
 {
@@ -62,64 +63,175 @@ namespace dx
                std::vector<std::uint32_t> stridesAndOffsets,
                GpuBuffer indexBuffer, std::uint32_t indexCount,
                bool isImmutable, D3D_PRIMITIVE_TOPOLOGY topology,
-               const DirectX::BoundingBox& boundingBox)
+               const MeshBounds& bounds)
         : m_gpuVertexBuffers{std::move(gpuBuffer)}, m_indexBuffer{std::move(
                                                         indexBuffer)},
           m_fullInputElementDesces{std::move(fullInputElementDesces)},
           m_vsSemantics{std::move(vsSemantics)}, m_streams{std::move(streams)},
           m_stridesAndOffsets{std::move(stridesAndOffsets)},
           m_indexCount{indexCount}, m_isImmutable{isImmutable},
-          m_primitiveTopology{topology}, m_boundingBox{boundingBox}
+          m_primitiveTopology{topology}, m_bounds{bounds}
     {}
 
+    struct PackedStreamInfo
+    {
+        VSSemantics Semantics = VSSemantics::kNone;
+        std::uint32_t Stride = 0;
+        MaxStreamVector<std::uint32_t> Channels;
+    };
+
+    MaxStreamVector<PackedStreamInfo>
+    PackChannels(std::uint32_t channelCount,
+                 const gsl::span<const std::byte>* bytes,
+                 const std::uint32_t* strides, const VSSemantics* semantics,
+                 StreamLayout layout, VSSemantics usedSemantics)
+    {
+        MaxStreamVector<PackedStreamInfo> packed;
+        const bool separatePosition =
+            layout == StreamLayout::kInterleavedWithPositionStream;
+        if (layout != StreamLayout::kPerChannel)
+        {
+            packed.resize(separatePosition ? 2 : 1);
+        }
+        for (std::uint32_t i = 0; i < channelCount; ++i)
+        {
+            if (bytes[i].empty())
+                continue;
+            if (usedSemantics != VSSemantics::kNone &&
+                (semantics[i] & usedSemantics) == VSSemantics::kNone)
+                continue;
+            if (layout == StreamLayout::kPerChannel)
+            {
+                packed.emplace_back();
+            }
+            const bool isPosition = (semantics[i] & VSSemantics::kPosition) ==
+                                    VSSemantics::kPosition;
+            PackedStreamInfo& stream =
+                separatePosition && isPosition ? packed[0] : packed.back();
+            stream.Semantics |= semantics[i];
+            stream.Stride += strides[i];
+            stream.Channels.push_back(i);
+        }
+        packed.erase(std::remove_if(packed.begin(), packed.end(),
+                                    [](const PackedStreamInfo& stream) {
+                                        return stream.Channels.empty();
+                                    }),
+                     packed.end());
+        return packed;
+    }
+
+    MeshBounds BoundsFromChannels(std::uint32_t channelCount,
+                                  const gsl::span<const std::byte>* bytes,
+                                  const std::uint32_t* strides,
+                                  const VSSemantics* semantics)
+    {
+        const auto positionChannel = std::find_if(
+            semantics, semantics + channelCount, [](VSSemantics semantics) {
+                return (semantics & VSSemantics::kPosition) ==
+                       VSSemantics::kPosition;
+            });
+        Expects(positionChannel != semantics + channelCount);
+        const auto channel = positionChannel - semantics;
+        const std::uint32_t positionStride = strides[channel];
+        return ComputeMeshBounds(bytes[channel].data(), positionStride,
+                                 bytes[channel].size() / positionStride);
+    }
+
     Mesh Mesh::CreateImmutable(
         ID3D11Device& device, std::uint32_t channelCount,
         const gsl::span<const std::byte>* bytes, const std::uint32_t* strides,
         const VSSemantics* semantics,
         std::vector<D3D11_INPUT_ELEMENT_DESC> inputElementDesces,
-        gsl::span<const ShortIndex> indices, D3D_PRIMITIVE_TOPOLOGY topology)
+        gsl::span<const ShortIndex> indices, D3D_PRIMITIVE_TOPOLOGY topology,
+        StreamLayout layout, VSSemantics usedSemantics)
     {
-        std::uint32_t offset = {};
+        // 每个 channel 在 inputElementDesces 中的起始位置
+        std::vector<std::uint32_t> descStarts(channelCount + 1);
+        for (std::uint32_t i = 0; i < channelCount; ++i)
+        {
+            const std::uint32_t semanticsCount =
+                __popcnt(static_cast<unsigned int>(semantics[i]));
+            descStarts[i + 1] = descStarts[i] + semanticsCount;
+        }
+        Expects(descStarts.back() == inputElementDesces.size());
+
+        const MaxStreamVector<PackedStreamInfo> packed = PackChannels(
+            channelCount, bytes, strides, semantics, layout, usedSemantics);
+        const auto streamCount = static_cast<std::uint32_t>(packed.size());
         std::vector<StreamInfo> streams;
         std::vector<GpuBuffer> vertexBuffers;
-        std::vector<std::uint32_t> stridesAndOffsets;
-        streams.reserve(channelCount);
-        vertexBuffers.reserve(channelCount);
-        stridesAndOffsets.resize(channelCount * 2);
-        std::uint32_t current = {};
-        for (std::uint32_t i = 0; i < channelCount; ++i)
+        std::vector<VSSemantics> vsSemantics;
+        std::vector<D3D11_INPUT_ELEMENT_DESC> packedDesces;
+        std::vector<std::uint32_t> stridesAndOffsets(streamCount * 2);
+        std::vector<std::byte> interleaved;
+        streams.reserve(streamCount);
+        vertexBuffers.reserve(streamCount);
+        vsSemantics.reserve(streamCount);
+        packedDesces.reserve(inputElementDesces.size());
+        for (std::uint32_t slot = 0; slot < streamCount; ++slot)
         {
-            const gsl::span<const std::byte>& cpuVb = bytes[i];
-            if (cpuVb.empty())
-                continue;
-            auto& stream = streams.emplace_back(StreamInfo{strides[i]});
+            const PackedStreamInfo& info = packed[slot];
+            const std::uint32_t firstChannel = info.Channels[0];
+            const std::size_t vertexCount =
+                bytes[firstChannel].size() / strides[firstChannel];
+            gsl::span<const std::byte> cpuVb = bytes[firstChannel];
+            if (info.Channels.size() > 1)
+            {
+                interleaved.resize(vertexCount * info.Stride);
+            }
+            std::uint32_t offset = 0;
+            for (const std::uint32_t channel : info.Channels)
+            {
+                const std::uint32_t stride = strides[channel];
+                Expects(bytes[channel].size() == vertexCount * stride);
+                for (std::uint32_t i = descStarts[channel];
+                     i < descStarts[channel + 1]; ++i)
+                {
+                    D3D11_INPUT_ELEMENT_DESC& desc =
+                        packedDesces.emplace_back(inputElementDesces[i]);
+                    desc.InputSlot = slot;
+                    // channel 的 stride 可能大于 format 的大小（比如
+                    // XMFLOAT3A），所以不能依赖 D3D11_APPEND_ALIGNED_ELEMENT。
+                    if (i == descStarts[channel] && offset != 0)
+                        desc.AlignedByteOffset = offset;
+                }
+                if (info.Channels.size() > 1)
+                {
+                    const std::byte* src = bytes[channel].data();
+                    std::byte* dest = interleaved.data() + offset;
+                    for (std::size_t v = 0; v < vertexCount; ++v)
+                    {
+                        std::memcpy(dest, src, stride);
+                        src += stride;
+                        dest += info.Stride;
+                    }
+                }
+                offset += stride;
+            }
+            if (info.Channels.size() > 1)
+            {
+                cpuVb = gsl::make_span(interleaved);
+            }
+            auto& stream = streams.emplace_back(StreamInfo{info.Stride});
             stream.ResetBytes(cpuVb);
-            offset += gsl::narrow<std::uint32_t>(cpuVb.size());
-            stridesAndOffsets[current] = strides[i];
-            // TODO
-            stridesAndOffsets[current + channelCount] = 0;
-            ++current;
+            stridesAndOffsets[slot] = info.Stride;
+            stridesAndOffsets[slot + streamCount] = 0;
+            vsSemantics.push_back(info.Semantics);
             vertexBuffers.push_back(MakeImmutableVertexBuffer(device, cpuVb));
         }
-        DirectX::BoundingBox boundingBox;
-        const std::uint32_t positionStride = strides[0];
-        DirectX::BoundingBox::CreateFromPoints(
-            boundingBox, bytes[0].size() / positionStride,
-            reinterpret_cast<const DirectX::XMFLOAT3*>(bytes[0].data()),
-            positionStride);
+        const MeshBounds bounds =
+            BoundsFromChannels(channelCount, bytes, strides, semantics);
         GpuBuffer indexBuffer = MakeImmutableIndexBuffer(device, indices);
-        std::vector<VSSemantics> vsSemantics{semantics,
-                                             semantics + channelCount};
         return Mesh{std::move(vertexBuffers),
                     std::move(streams),
-                    std::move(inputElementDesces),
+                    std::move(packedDesces),
                     std::move(vsSemantics),
                     std::move(stridesAndOffsets),
                     std::move(indexBuffer),
                     gsl::narrow<std::uint32_t>(indices.size()),
                     true,
                     topology,
-                    boundingBox};
+                    bounds};
     }
 
     void Mesh::SetAllStreamsInternal(
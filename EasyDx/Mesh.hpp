@@ -3,6 +3,7 @@
 #include "Resources/Buffers.hpp"
 #include "ComponentBase.hpp"
 #include "Vertex.hpp"
+#include "BoundingVolumes.hpp"
 #include <DirectXCollision.h>
 #include <d3d11.h> //for D3D11_PRIMITIVE_TOPOLOGY
 
@@ -86,8 +87,9 @@ namespace dx
         }
         const DirectX::BoundingBox& GetBoundingBox() const
         {
-            return m_boundingBox;
+            return m_bounds.Box;
         }
+        const MeshBounds& GetBounds() const { return m_bounds; }
 
         // TODO: optimize flush
         void FlushAll(ID3D11DeviceContext& context3D) const;
@@ -124,13 +126,18 @@ namespace dx
         //	CreateImmutable()
         //}
 
+        // inputElementDesces 按 channel 顺序排列。layout 决定 channel 如何
+        // 打包成 GPU vertex buffer；usedSemantics 非 kNone 时，不被任何 pass
+        // 使用的 channel 会被丢弃。
         static Mesh CreateImmutable(
             ID3D11Device& device, std::uint32_t channelCount,
             const gsl::span<const std::byte>* bytes,
             const std::uint32_t* strides, const VSSemantics* semantics,
             std::vector<D3D11_INPUT_ELEMENT_DESC> inputElementDesces,
             gsl::span<const ShortIndex> indices,
-            D3D_PRIMITIVE_TOPOLOGY topology);
+            D3D_PRIMITIVE_TOPOLOGY topology,
+            StreamLayout layout = StreamLayout::kPerChannel,
+            VSSemantics usedSemantics = VSSemantics::kNone);
 
       private:
         Mesh() = default;
@@ -139,8 +146,7 @@ namespace dx
              std::vector<VSSemantics> vsSemantics,
              std::vector<std::uint32_t> stridesAndOffsets,
              GpuBuffer indexBuffer, std::uint32_t indexCount, bool isImmutable,
-             D3D_PRIMITIVE_TOPOLOGY topology,
-             const DirectX::BoundingBox& boundingBox);
+             D3D_PRIMITIVE_TOPOLOGY topology, const MeshBounds& bounds);
 
         void SetAllStreamsInternal(
             gsl::span<const gsl::span<const std::byte>> streamsInBytes);
@@ -158,8 +164,7 @@ namespace dx
         std::uint32_t m_indexCount;
         bool m_isImmutable;
         D3D11_PRIMITIVE_TOPOLOGY m_primitiveTopology;
-        //这里假设第一个 stream 是 position
-        DirectX::BoundingBox m_boundingBox;
+        MeshBounds m_bounds;
     };
 
     // TODO: a submesh
@@ -0,0 +1,456 @@
+#include "pch.hpp"
+#include "MeshGenerators.hpp"
+#include <DirectXMath.h>
+#include <unordered_map>
+
+namespace dx
+{
+    constexpr std::uint32_t kMaxIcoSphereSubdivisions = 6;
+    constexpr std::size_t kParallelRowThreshold = 64;
+    constexpr std::size_t kParallelVertexThreshold = 4096;
+
+    struct SinCosTable
+    {
+        std::vector<float> Sin;
+        std::vector<float> Cos;
+    };
+
+    // 角度为 step * i（i 属于 [0, count)），每次用 XMVectorSinCos 算 4 个。
+    SinCosTable MakeSinCosTable(float step, std::size_t count)
+    {
+        using namespace DirectX;
+        SinCosTable table;
+        // 多留 3 个位置，循环里可以直接写满 4 个。
+        table.Sin.resize(count + 3);
+        table.Cos.resize(count + 3);
+        const XMVECTOR lanes = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+        const XMVECTOR steps = XMVectorReplicate(step);
+        for (std::size_t i = 0; i < count; i += 4)
+        {
+            const XMVECTOR indices =
+                XMVectorAdd(XMVectorReplicate(static_cast<float>(i)), lanes);
+            XMVECTOR sines, cosines;
+            XMVectorSinCos(&sines, &cosines, XMVectorMultiply(indices, steps));
+            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&table.Sin[i]), sines);
+            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&table.Cos[i]),
+                          cosines);
+        }
+        table.Sin.resize(count);
+        table.Cos.resize(count);
+        return table;
+    }
+
+    // 顶点 (row, column) 的下标为 row * (columns + 1) + column，每个格子写
+    // 两个三角形，绕序与 MakeUVSphere 相同。
+    void WriteQuadGridIndices(std::size_t row, std::uint16_t columns,
+                              ShortIndex* indices)
+    {
+        const std::size_t stride = columns + 1;
+        ShortIndex* out = indices + row * columns * 6;
+        for (std::uint16_t column = 0; column < columns; ++column)
+        {
+            const auto a = static_cast<ShortIndex>(row * stride + column);
+            const auto b = static_cast<ShortIndex>(a + 1);
+            const auto c = static_cast<ShortIndex>(a + stride + 1);
+            const auto d = static_cast<ShortIndex>(a + stride);
+            *out++ = a;
+            *out++ = b;
+            *out++ = c;
+            *out++ = a;
+            *out++ = c;
+            *out++ = d;
+        }
+    }
+
+    void ResizeForQuadGrid(std::size_t rows, std::uint16_t columns,
+                           LoadedMesh& meshData)
+    {
+        const std::size_t vertexCount = (rows + 1) * (columns + 1);
+        Expects(vertexCount <= UINT16_MAX);
+        meshData.Resize(vertexCount, rows * columns * 6);
+    }
+
+    struct IcoSphereLevel
+    {
+        std::vector<DirectX::XMFLOAT3A> Positions;
+        std::vector<ShortIndex> Indices;
+    };
+
+    std::unique_ptr<IcoSphereLevel> MakeIcosahedron()
+    {
+        using namespace DirectX;
+        const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+        auto level = std::make_unique<IcoSphereLevel>();
+        level->Positions = {
+            {-1.0f, t, 0.0f},  {1.0f, t, 0.0f},  {-1.0f, -t, 0.0f},
+            {1.0f, -t, 0.0f},  {0.0f, -1.0f, t}, {0.0f, 1.0f, t},
+            {0.0f, -1.0f, -t}, {0.0f, 1.0f, -t}, {t, 0.0f, -1.0f},
+            {t, 0.0f, 1.0f},   {-t, 0.0f, -1.0f}, {-t, 0.0f, 1.0f}};
+        for (XMFLOAT3A& position : level->Positions)
+        {
+            XMStoreFloat3A(&position,
+                           XMVector3Normalize(XMLoadFloat3A(&position)));
+        }
+        level->Indices = {0, 11, 5, 0, 5,  1,  0,  1,  7,  0, 7,  10, 0, 10, 11,
+                          1, 5,  9, 5, 11, 4,  11, 10, 2,  10, 7, 6,  7, 1,  8,
+                          3, 9,  4, 3, 4,  2,  3,  2,  6,  3, 6,  8,  3, 8,  9,
+                          4, 9,  5, 2, 4,  11, 6,  2,  10, 8, 6,  7,  9, 8,  1};
+        return level;
+    }
+
+    std::unique_ptr<IcoSphereLevel> Subdivide(const IcoSphereLevel& previous)
+    {
+        using namespace DirectX;
+        auto level = std::make_unique<IcoSphereLevel>();
+        auto& positions = level->Positions;
+        const std::size_t triangleCount = previous.Indices.size() / 3;
+        // 每条边被两个三角形共享：V' = V + E = V + 3F / 2。
+        positions.reserve(previous.Positions.size() + triangleCount * 3 / 2);
+        positions = previous.Positions;
+        level->Indices.resize(previous.Indices.size() * 4);
+        std::unordered_map<std::uint32_t, ShortIndex> midpoints;
+        midpoints.reserve(triangleCount * 3 / 2);
+        const auto midpoint = [&](ShortIndex a, ShortIndex b) {
+            const std::uint32_t key = a < b ? (std::uint32_t{a} << 16) | b
+                                            : (std::uint32_t{b} << 16) | a;
+            const auto [iter, inserted] = midpoints.try_emplace(
+                key, static_cast<ShortIndex>(positions.size()));
+            if (inserted)
+            {
+                const XMVECTOR middle = XMVector3Normalize(
+                    XMVectorAdd(XMLoadFloat3A(&positions[a]),
+                                XMLoadFloat3A(&positions[b])));
+                XMStoreFloat3A(&positions.emplace_back(), middle);
+            }
+            return iter->second;
+        };
+        ShortIndex* out = level->Indices.data();
+        for (std::size_t i = 0; i < triangleCount; ++i)
+        {
+            const ShortIndex a = previous.Indices[i * 3];
+            const ShortIndex b = previous.Indices[i * 3 + 1];
+            const ShortIndex c = previous.Indices[i * 3 + 2];
+            const ShortIndex ab = midpoint(a, b);
+            const ShortIndex bc = midpoint(b, c);
+            const ShortIndex ca = midpoint(c, a);
+            for (const ShortIndex index : {a, ab, ca, b, bc, ab, c, ca, bc, ab,
+                                           bc, ca})
+            {
+                *out++ = index;
+            }
+        }
+        return level;
+    }
+
+    const IcoSphereLevel& GetIcoSphereLevel(std::uint32_t subdivisions)
+    {
+        static std::mutex mutex;
+        static std::vector<std::unique_ptr<IcoSphereLevel>> levels;
+        std::lock_guard<std::mutex> lock{mutex};
+        if (levels.empty())
+        {
+            levels.push_back(MakeIcosahedron());
+        }
+        while (levels.size() <= subdivisions)
+        {
+            levels.push_back(Subdivide(*levels.back()));
+        }
+        // unique_ptr 指向的对象不会因为 levels 扩容而移动。
+        return *levels[subdivisions];
+    }
+
+    template<typename T>
+    void DuplicateVertex(std::vector<T>& stream, std::size_t vertex)
+    {
+        const T copy = stream[vertex];
+        stream.push_back(copy);
+    }
+
+    // 经线接缝处 u 从 1 跳回 0，跨过接缝的三角形把 u 较小的顶点换成 u + 1
+    // 的副本（每个顶点最多一个）。两极的 u 没有定义，每个三角形用一份 u
+    // 取另外两个顶点平均值的副本，切线也按这个 u 算。
+    void SplitIcoSphereSeam(LoadedMesh& meshData)
+    {
+        using namespace DirectX;
+        auto& [positions, normals, tangents, colors, texCoords, indices] =
+            meshData;
+        constexpr auto kNone = std::numeric_limits<ShortIndex>::max();
+        const std::size_t vertexCount = positions.size();
+        std::vector<ShortIndex> seamCopies(vertexCount, kNone);
+        std::vector<bool> poleUsed(vertexCount);
+        const auto isPole = [&](ShortIndex vertex) {
+            return normals[vertex].x == 0.0f && normals[vertex].z == 0.0f;
+        };
+        const auto duplicate = [&](ShortIndex vertex) {
+            Expects(positions.size() < kNone);
+            DuplicateVertex(positions, vertex);
+            DuplicateVertex(normals, vertex);
+            DuplicateVertex(tangents, vertex);
+            DuplicateVertex(texCoords, vertex);
+            return static_cast<ShortIndex>(positions.size() - 1);
+        };
+        for (std::size_t triangle = 0; triangle < indices.size();
+             triangle += 3)
+        {
+            ShortIndex* corners = &indices[triangle];
+            float minU = 1.0f;
+            float maxU = 0.0f;
+            for (std::size_t i = 0; i < 3; ++i)
+            {
+                if (isPole(corners[i]))
+                    continue;
+                minU = std::min(minU, texCoords[corners[i]].x);
+                maxU = std::max(maxU, texCoords[corners[i]].x);
+            }
+            for (std::size_t i = 0; i < 3 && maxU - minU > 0.5f; ++i)
+            {
+                ShortIndex& corner = corners[i];
+                if (isPole(corner) || texCoords[corner].x >= 0.5f)
+                    continue;
+                if (seamCopies[corner] == kNone)
+                {
+                    const ShortIndex copy = duplicate(corner);
+                    texCoords[copy].x += 1.0f;
+                    seamCopies[corner] = copy;
+                }
+                corner = seamCopies[corner];
+            }
+            for (std::size_t i = 0; i < 3; ++i)
+            {
+                ShortIndex& corner = corners[i];
+                if (!isPole(corner))
+                    continue;
+                if (poleUsed[corner])
+                    corner = duplicate(corner);
+                else
+                    poleUsed[corner] = true;
+                const float u = (texCoords[corners[(i + 1) % 3]].x +
+                                 texCoords[corners[(i + 2) % 3]].x) *
+                                0.5f;
+                texCoords[corner].x = u;
+                const float angle = (u - 0.5f) * XM_2PI;
+                tangents[corner] =
+                    MakeTangent(-std::sin(angle), 0.0f, std::cos(angle));
+            }
+        }
+    }
+
+    void MakeIcoSphere(float radius, std::uint32_t subdivisions,
+                       LoadedMesh& meshData)
+    {
+        using namespace DirectX;
+        Expects(subdivisions <= kMaxIcoSphereSubdivisions);
+        const IcoSphereLevel& level = GetIcoSphereLevel(subdivisions);
+        const std::size_t vertexCount = level.Positions.size();
+        meshData.Resize(vertexCount, level.Indices.size());
+        std::copy(level.Indices.begin(), level.Indices.end(),
+                  meshData.Indices.begin());
+        auto& [positions, normals, tangents, colors, texCoords, indices] =
+            meshData;
+        const auto writeVertex = [&](std::size_t i) {
+            const XMFLOAT3A& unit = level.Positions[i];
+            normals[i] = unit;
+            positions[i] =
+                StoreVec(XMVectorScale(XMLoadFloat3A(&unit), radius));
+            texCoords[i] =
+                MakeTexCoord(std::atan2(unit.z, unit.x) / XM_2PI + 0.5f,
+                             std::acos(unit.y) / XM_PI);
+            // 两极处 u 方向没有定义，先取 +X，之后按三角形重设。v 向南增大，
+            // 正好是 cross(normal, tangent) 的方向，手性为 1。
+            const XMVECTOR tangent = XMVector3Normalize(
+                XMVectorSet(-unit.z, 0.0f, unit.x, 0.0f));
+            tangents[i] = XMVector3Equal(tangent, XMVectorZero())
+                              ? MakeTangent(1.0f, 0.0f, 0.0f)
+                              : StoreTangent(tangent, 1.0f);
+        };
+        ParallelFor(vertexCount, kParallelVertexThreshold,
+                    [&](std::size_t begin, std::size_t end) {
+                        for (std::size_t i = begin; i < end; ++i)
+                            writeVertex(i);
+                    });
+        SplitIcoSphereSeam(meshData);
+    }
+
+    void MakeBox(float width, float height, float depth, LoadedMesh& meshData)
+    {
+        using namespace DirectX;
+        struct Face
+        {
+            XMFLOAT3 Normal;
+            XMFLOAT3 Tangent;
+        };
+        constexpr Face kFaces[] = {
+            {{1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+            {{-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}},
+            {{0.0f, 1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+            {{0.0f, -1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+            {{0.0f, 0.0f, 1.0f}, {-1.0f, 0.0f, 0.0f}},
+            {{0.0f, 0.0f, -1.0f}, {1.0f, 0.0f, 0.0f}}};
+        constexpr float kCornerUVs[][2] = {
+            {0.0f, 1.0f}, {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}};
+        meshData.Resize(std::size(kFaces) * 4, std::size(kFaces) * 6);
+        auto& [positions, normals, tangents, colors, texCoords, indices] =
+            meshData;
+        const XMVECTOR halfExtents =
+            XMVectorSet(width * 0.5f, height * 0.5f, depth * 0.5f, 0.0f);
+        for (std::size_t face = 0; face < std::size(kFaces); ++face)
+        {
+            const XMVECTOR normal = XMLoadFloat3(&kFaces[face].Normal);
+            const XMVECTOR tangent = XMLoadFloat3(&kFaces[face].Tangent);
+            // 面内的“上”方向，保证 cross(up, tangent) == normal。v 沿 -up
+            // 增大，手性为 1。
+            const XMVECTOR up = XMVector3Cross(tangent, normal);
+            for (std::size_t corner = 0; corner < 4; ++corner)
+            {
+                const float u = kCornerUVs[corner][0];
+                const float v = kCornerUVs[corner][1];
+                const XMVECTOR offset = XMVectorAdd(
+                    XMVectorScale(tangent, 2.0f * u - 1.0f),
+                    XMVectorScale(up, 1.0f - 2.0f * v));
+                const std::size_t i = face * 4 + corner;
+                positions[i] = StoreVec(
+                    XMVectorMultiply(XMVectorAdd(normal, offset), halfExtents));
+                normals[i] = StoreVec(normal);
+                tangents[i] = StoreTangent(tangent, 1.0f);
+                texCoords[i] = MakeTexCoord(u, v);
+            }
+            const auto base = static_cast<ShortIndex>(face * 4);
+            const ShortIndex faceIndices[] = {0, 1, 2, 0, 2, 3};
+            for (std::size_t i = 0; i < 6; ++i)
+            {
+                indices[face * 6 + i] =
+                    static_cast<ShortIndex>(base + faceIndices[i]);
+            }
+        }
+    }
+
+    void MakePlaneGrid(float width, float depth, std::uint16_t xSegments,
+                       std::uint16_t zSegments, LoadedMesh& meshData)
+    {
+        Expects(xSegments > 0 && zSegments > 0);
+        ResizeForQuadGrid(zSegments, xSegments, meshData);
+        auto& [positions, normals, tangents, colors, texCoords, indices] =
+            meshData;
+        const float stepX = width / xSegments;
+        const float stepZ = depth / zSegments;
+        const std::size_t columns = xSegments + 1;
+        // 行沿 -Z 排列，列沿 +X 排列。
+        ParallelFor(
+            zSegments + 1, kParallelRowThreshold,
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t row = begin; row < end; ++row)
+                {
+                    const float z =
+                        depth * 0.5f - static_cast<float>(row) * stepZ;
+                    const float v = static_cast<float>(row) / zSegments;
+                    for (std::size_t column = 0; column < columns; ++column)
+                    {
+                        const std::size_t i = row * columns + column;
+                        positions[i] = MakePosition(
+                            -width * 0.5f + static_cast<float>(column) * stepX,
+                            0.0f, z);
+                        normals[i] = MakeDir(0.0f, 1.0f, 0.0f);
+                        tangents[i] = MakeTangent(1.0f, 0.0f, 0.0f);
+                        texCoords[i] = MakeTexCoord(
+                            static_cast<float>(column) / xSegments, v);
+                    }
+                    if (row < zSegments)
+                    {
+                        WriteQuadGridIndices(row, xSegments, indices.data());
+                    }
+                }
+            });
+    }
+
+    void MakeTorus(float majorRadius, float minorRadius,
+                   std::uint16_t ringSegments, std::uint16_t tubeSegments,
+                   LoadedMesh& meshData)
+    {
+        Expects(ringSegments > 2 && tubeSegments > 2);
+        ResizeForQuadGrid(ringSegments, tubeSegments, meshData);
+        auto& [positions, normals, tangents, colors, texCoords, indices] =
+            meshData;
+        const SinCosTable rings =
+            MakeSinCosTable(DirectX::XM_2PI / ringSegments, ringSegments + 1);
+        const SinCosTable tubes =
+            MakeSinCosTable(DirectX::XM_2PI / tubeSegments, tubeSegments + 1);
+        const std::size_t columns = tubeSegments + 1;
+        for (std::size_t ring = 0; ring <= ringSegments; ++ring)
+        {
+            const float cosU = rings.Cos[ring];
+            const float sinU = rings.Sin[ring];
+            for (std::size_t tube = 0; tube < columns; ++tube)
+            {
+                const float cosV = tubes.Cos[tube];
+                const float sinV = tubes.Sin[tube];
+                const float distance = majorRadius + minorRadius * cosV;
+                const std::size_t i = ring * columns + tube;
+                positions[i] = MakePosition(distance * cosU, minorRadius * sinV,
+                                            distance * sinU);
+                normals[i] = MakeDir(cosV * cosU, sinV, cosV * sinU);
+                // v 绕管子向上转，与 cross(normal, tangent) 相反。
+                tangents[i] = MakeTangent(-sinU, 0.0f, cosU, -1.0f);
+                texCoords[i] =
+                    MakeTexCoord(static_cast<float>(ring) / ringSegments,
+                                 static_cast<float>(tube) / tubeSegments);
+            }
+            if (ring < ringSegments)
+            {
+                WriteQuadGridIndices(ring, tubeSegments, indices.data());
+            }
+        }
+    }
+
+    void MakeCapsule(float radius, float height, std::uint16_t sliceCount,
+                     std::uint16_t hemisphereStackCount, LoadedMesh& meshData)
+    {
+        using namespace DirectX;
+        Expects(sliceCount > 2 && hemisphereStackCount > 0);
+        // 上半球 hemisphereStackCount + 1 圈，下半球同样多，赤道处的两圈
+        // 之间就是圆柱部分。
+        const std::size_t ringCount = (hemisphereStackCount + 1) * 2;
+        ResizeForQuadGrid(ringCount - 1, sliceCount, meshData);
+        auto& [positions, normals, tangents, colors, texCoords, indices] =
+            meshData;
+        const SinCosTable slices =
+            MakeSinCosTable(XM_2PI / sliceCount, sliceCount + 1);
+        const SinCosTable stacks = MakeSinCosTable(
+            XM_PIDIV2 / hemisphereStackCount, hemisphereStackCount + 1);
+        const float totalLength = XM_PI * radius + height;
+        const std::size_t columns = sliceCount + 1;
+        for (std::size_t ring = 0; ring < ringCount; ++ring)
+        {
+            const bool upper = ring <= hemisphereStackCount;
+            const std::size_t stack =
+                upper ? ring : ring - hemisphereStackCount - 1;
+            // 上半球 phi 从 0 到 pi/2，下半球从 pi/2 到 pi。
+            const float sinPhi = upper ? stacks.Sin[stack] : stacks.Cos[stack];
+            const float cosPhi = upper ? stacks.Cos[stack] : -stacks.Sin[stack];
+            const float y = upper ? height * 0.5f : -height * 0.5f;
+            const float arc =
+                static_cast<float>(stack) * XM_PIDIV2 / hemisphereStackCount *
+                    radius +
+                (upper ? 0.0f : XM_PIDIV2 * radius + height);
+            for (std::size_t slice = 0; slice < columns; ++slice)
+            {
+                const float cosTheta = slices.Cos[slice];
+                const float sinTheta = slices.Sin[slice];
+                const std::size_t i = ring * columns + slice;
+                const auto normal =
+                    MakeDir(sinPhi * cosTheta, cosPhi, sinPhi * sinTheta);
+                normals[i] = normal;
+                positions[i] = MakePosition(radius * normal.x,
+                                            radius * normal.y + y,
+                                            radius * normal.z);
+                tangents[i] = MakeTangent(-sinTheta, 0.0f, cosTheta);
+                texCoords[i] =
+                    MakeTexCoord(static_cast<float>(slice) / sliceCount,
+                                 arc / totalLength);
+            }
+            if (ring + 1 < ringCount)
+            {
+                WriteQuadGridIndices(ring, sliceCount, indices.data());
+            }
+        }
+    }
+} // namespace dx
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Model.hpp"
+
+namespace dx
+{
+    // 这些函数都先 LoadedMesh::Resize 再按下标写入，生成 Positions、
+    // Normals、Tangents、TexCoords 和三角形列表的 Indices（Colors 为空）。
+
+    // 单位二十面体细分 subdivisions 次，细分结果按级别缓存（线程安全）。
+    // 细分后有 10 * 4^n + 2 个不同的位置，经线接缝和两极的顶点会按 UV
+    // 拆开，subdivisions 不能超过 6。
+    void MakeIcoSphere(float radius, std::uint32_t subdivisions,
+                       LoadedMesh& meshData);
+
+    void MakeBox(float width, float height, float depth, LoadedMesh& meshData);
+
+    // XZ 平面上以原点为中心、法线朝 +Y 的网格。行数多时并行生成。
+    void MakePlaneGrid(float width, float depth, std::uint16_t xSegments,
+                       std::uint16_t zSegments, LoadedMesh& meshData);
+
+    // 绕 Y 轴的圆环。
+    void MakeTorus(float majorRadius, float minorRadius,
+                   std::uint16_t ringSegments, std::uint16_t tubeSegments,
+                   LoadedMesh& meshData);
+
+    // 沿 Y 轴的胶囊体，height 是中间圆柱部分的高度。
+    void MakeCapsule(float radius, float height, std::uint16_t sliceCount,
+                     std::uint16_t hemisphereStackCount, LoadedMesh& meshData);
+} // namespace dx
@@ -0,0 +1,471 @@
+#include "pch.hpp"
+#include "MeshProcessing.hpp"
+#include "DxMathWrappers.hpp"
+#include <DirectXMath.h>
+#include <cfloat>
+#include <numeric>
+
+namespace dx
+{
+    // 每个 stream 在 key 中占 4 个 uint32（一个 XMVECTOR）。
+    constexpr std::size_t kKeyWordsPerStream = 4;
+    constexpr std::uint32_t kEmptySlot = UINT32_MAX;
+    constexpr std::size_t kParallelTriangleThreshold = 4096;
+
+    template<typename T>
+    void StoreVertexKeys(const std::vector<T>& stream, std::size_t keyWidth,
+                         std::size_t column, std::vector<std::uint32_t>& keys)
+    {
+        using namespace DirectX;
+        std::uint32_t* key = keys.data() + column;
+        for (const T& element : stream)
+        {
+            // -0.0f + 0.0f == +0.0f，保证两者的位模式相同。
+            XMStoreInt4(key, XMVectorAdd(Load(element), XMVectorZero()));
+            key += keyWidth;
+        }
+    }
+
+    template<typename T>
+    void StoreVertexAttributes(const std::vector<T>& stream,
+                               std::size_t width, std::size_t column,
+                               std::vector<DirectX::XMFLOAT4A>& attributes)
+    {
+        DirectX::XMFLOAT4A* attribute = attributes.data() + column;
+        for (const T& element : stream)
+        {
+            DirectX::XMStoreFloat4A(attribute, Load(element));
+            attribute += width;
+        }
+    }
+
+    std::uint64_t HashVertexKey(const std::uint32_t* key, std::size_t keyWidth)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (std::size_t i = 0; i < keyWidth; ++i)
+        {
+            hash = (hash ^ key[i]) * 1099511628211ull;
+        }
+        return hash ^ (hash >> 29);
+    }
+
+    // 位置所在的格子，格子的边长是 epsilon。转换时饱和，出界的坐标挤在边上
+    // 的格子里，不影响正确性，合并前总会逐个分量比较。
+    using WeldCell = std::array<std::uint32_t, 4>;
+
+    WeldCell CellOf(const PositionType& position,
+                    DirectX::FXMVECTOR invEpsilon)
+    {
+        using namespace DirectX;
+        WeldCell cell;
+        XMStoreInt4(cell.data(),
+                    XMConvertVectorFloatToInt(
+                        XMVectorFloor(XMVectorMultiply(Load(position),
+                                                       invEpsilon)),
+                        0));
+        cell[3] = 0;
+        return cell;
+    }
+
+    // 所有 stream 相同的顶点合并，返回合并后的顶点数。
+    std::uint32_t WeldEqualVertices(const std::vector<std::uint32_t>& keys,
+                                    std::size_t keyWidth,
+                                    std::vector<std::uint32_t>& remap)
+    {
+        const std::size_t vertexCount = remap.size();
+        // 开放寻址，装载因子不超过 0.5。
+        std::size_t tableSize = 16;
+        while (tableSize < vertexCount * 2)
+            tableSize <<= 1;
+        const std::size_t tableMask = tableSize - 1;
+        std::vector<std::uint32_t> table(tableSize, kEmptySlot);
+        std::uint32_t weldedCount = 0;
+        for (std::size_t i = 0; i < vertexCount; ++i)
+        {
+            const std::uint32_t* key = keys.data() + i * keyWidth;
+            std::size_t slot = HashVertexKey(key, keyWidth) & tableMask;
+            for (;;)
+            {
+                const std::uint32_t existing = table[slot];
+                if (existing == kEmptySlot)
+                {
+                    table[slot] = static_cast<std::uint32_t>(i);
+                    remap[i] = weldedCount++;
+                    break;
+                }
+                if (std::equal(key, key + keyWidth,
+                               keys.data() + existing * keyWidth))
+                {
+                    remap[i] = remap[existing];
+                    break;
+                }
+                slot = (slot + 1) & tableMask;
+            }
+        }
+        return weldedCount;
+    }
+
+    // 与之前某个保留下来的顶点在所有 stream 的每个分量上都相差不超过
+    // epsilon 时合并。按位置分格子建表，相距不超过 epsilon 的两个位置所在的
+    // 格子在每个轴上最多差一，所以只需要检查周围 3×3×3 个格子。
+    std::uint32_t
+    WeldNearVertices(const PositionStream& positions,
+                     const std::vector<DirectX::XMFLOAT4A>& attributes,
+                     std::size_t width, float epsilon,
+                     std::vector<std::uint32_t>& remap)
+    {
+        using namespace DirectX;
+        const std::size_t vertexCount = remap.size();
+        const XMVECTOR epsilonVector = XMVectorReplicate(epsilon);
+        const XMVECTOR invEpsilon = XMVectorReplicate(1.0f / epsilon);
+        std::vector<WeldCell> cells(vertexCount);
+        for (std::size_t i = 0; i < vertexCount; ++i)
+        {
+            cells[i] = CellOf(positions[i], invEpsilon);
+        }
+
+        // 每个非空格子占一个槽，存放格子中最后保留的顶点；同一格子中保留的
+        // 顶点通过 next 串起来。
+        std::size_t tableSize = 16;
+        while (tableSize < vertexCount * 2)
+            tableSize <<= 1;
+        const std::size_t tableMask = tableSize - 1;
+        std::vector<std::uint32_t> table(tableSize, kEmptySlot);
+        std::vector<std::uint32_t> next(vertexCount, kEmptySlot);
+        const auto findSlot = [&](const WeldCell& cell) {
+            std::size_t slot = HashVertexKey(cell.data(), 3) & tableMask;
+            while (table[slot] != kEmptySlot && cells[table[slot]] != cell)
+                slot = (slot + 1) & tableMask;
+            return slot;
+        };
+        const auto isNear = [&](std::size_t lhs, std::size_t rhs) {
+            for (std::size_t column = 0; column < width; ++column)
+            {
+                if (!XMVector4NearEqual(
+                        XMLoadFloat4A(&attributes[lhs * width + column]),
+                        XMLoadFloat4A(&attributes[rhs * width + column]),
+                        epsilonVector))
+                    return false;
+            }
+            return true;
+        };
+
+        std::uint32_t weldedCount = 0;
+        for (std::size_t i = 0; i < vertexCount; ++i)
+        {
+            std::uint32_t match = kEmptySlot;
+            for (std::uint32_t neighbor = 0;
+                 neighbor < 27 && match == kEmptySlot; ++neighbor)
+            {
+                // 无符号回绕：最边上的格子找到的是另一头的格子，同样会被
+                // 逐个比较排除。
+                const WeldCell cell = {cells[i][0] + neighbor % 3 - 1,
+                                       cells[i][1] + neighbor / 3 % 3 - 1,
+                                       cells[i][2] + neighbor / 9 - 1, 0};
+                for (std::uint32_t candidate = table[findSlot(cell)];
+                     candidate != kEmptySlot; candidate = next[candidate])
+                {
+                    if (isNear(i, candidate))
+                    {
+                        match = candidate;
+                        break;
+                    }
+                }
+            }
+            if (match != kEmptySlot)
+            {
+                remap[i] = remap[match];
+                continue;
+            }
+            const std::size_t slot = findSlot(cells[i]);
+            next[i] = table[slot];
+            table[slot] = static_cast<std::uint32_t>(i);
+            remap[i] = weldedCount++;
+        }
+        return weldedCount;
+    }
+
+    template<typename T>
+    void CompactStream(std::vector<T>& stream,
+                       const std::vector<std::uint32_t>& remap,
+                       std::size_t newCount)
+    {
+        if (stream.empty())
+            return;
+        // 首次出现的顶点按出现顺序编号，因此 remap[i] <= i，可以原地前移。
+        std::uint32_t next = 0;
+        for (std::size_t i = 0; i < stream.size(); ++i)
+        {
+            if (remap[i] == next)
+            {
+                stream[next] = stream[i];
+                ++next;
+            }
+        }
+        stream.resize(newCount);
+    }
+
+    std::size_t WeldVertices(LoadedMesh& mesh, float epsilon)
+    {
+        auto& [positions, normals, tangents, colors, texCoords, indices] = mesh;
+        const std::size_t vertexCount = positions.size();
+        const auto usable = [&](std::size_t size) {
+            Expects(size == 0 || size == vertexCount);
+            return size != 0;
+        };
+        const bool hasNormals = usable(normals.size());
+        const bool hasTangents = usable(tangents.size());
+        const bool hasColors = usable(colors.size());
+        const bool hasTexCoords = usable(texCoords.size());
+        const std::size_t streamCount =
+            1 + hasNormals + hasTangents + hasColors + hasTexCoords;
+
+        std::vector<std::uint32_t> remap(vertexCount);
+        std::uint32_t weldedCount = 0;
+        std::size_t column = 0;
+        if (epsilon > 0.0f)
+        {
+            std::vector<DirectX::XMFLOAT4A> attributes(vertexCount *
+                                                       streamCount);
+            const auto storeAttributes = [&](const auto& stream,
+                                             bool enabled) {
+                if (!enabled)
+                    return;
+                StoreVertexAttributes(stream, streamCount, column++,
+                                      attributes);
+            };
+            storeAttributes(positions, true);
+            storeAttributes(normals, hasNormals);
+            storeAttributes(tangents, hasTangents);
+            storeAttributes(colors, hasColors);
+            storeAttributes(texCoords, hasTexCoords);
+            weldedCount = WeldNearVertices(positions, attributes, streamCount,
+                                           epsilon, remap);
+        }
+        else
+        {
+            const std::size_t keyWidth = kKeyWordsPerStream * streamCount;
+            std::vector<std::uint32_t> keys(vertexCount * keyWidth);
+            const auto storeKeys = [&](const auto& stream, bool enabled) {
+                if (!enabled)
+                    return;
+                StoreVertexKeys(stream, keyWidth, column, keys);
+                column += kKeyWordsPerStream;
+            };
+            storeKeys(positions, true);
+            storeKeys(normals, hasNormals);
+            storeKeys(tangents, hasTangents);
+            storeKeys(colors, hasColors);
+            storeKeys(texCoords, hasTexCoords);
+            weldedCount = WeldEqualVertices(keys, keyWidth, remap);
+        }
+
+        CompactStream(positions, remap, weldedCount);
+        CompactStream(normals, remap, weldedCount);
+        CompactStream(tangents, remap, weldedCount);
+        CompactStream(colors, remap, weldedCount);
+        CompactStream(texCoords, remap, weldedCount);
+        for (ShortIndex& index : indices)
+        {
+            index = static_cast<ShortIndex>(remap[index]);
+        }
+        return weldedCount;
+    }
+
+    DirectX::XMVECTOR TangentOnNormalPlane(DirectX::FXMVECTOR tangent,
+                                           DirectX::FXMVECTOR normal)
+    {
+        using namespace DirectX;
+        return XMVectorSubtract(
+            tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent)));
+    }
+
+    // 按顶点分组 corner（counting sort），gather 时不需要原子操作。顶点 v 的
+    // corner 是 vertexCorners[cornerOffsets[v], cornerOffsets[v + 1])。
+    void GroupCornersByVertex(const std::vector<ShortIndex>& indices,
+                              std::size_t vertexCount,
+                              std::vector<std::uint32_t>& cornerOffsets,
+                              std::vector<std::uint32_t>& vertexCorners)
+    {
+        cornerOffsets.assign(vertexCount + 1, 0);
+        for (const ShortIndex index : indices)
+        {
+            ++cornerOffsets[index + 1];
+        }
+        std::partial_sum(cornerOffsets.begin(), cornerOffsets.end(),
+                         cornerOffsets.begin());
+        vertexCorners.resize(indices.size());
+        std::vector<std::uint32_t> cursors{cornerOffsets.begin(),
+                                           cornerOffsets.end() - 1};
+        for (std::size_t corner = 0; corner < indices.size(); ++corner)
+        {
+            vertexCorners[cursors[indices[corner]]++] =
+                static_cast<std::uint32_t>(corner);
+        }
+    }
+
+    template<typename T>
+    void DuplicateVertex(std::vector<T>& stream, std::size_t vertex)
+    {
+        if (stream.empty())
+            return;
+        const T copy = stream[vertex];
+        stream.push_back(copy);
+    }
+
+    // 镜像 UV 的接缝上，同一个顶点的 corner 手性不同，一个 w 无法同时满足，
+    // 把负手性的 corner 拆到新顶点上（Tangents 之外的 stream 都复制一份）。
+    // 返回是否拆分过。
+    bool SplitMirroredVertices(LoadedMesh& mesh,
+                               const std::vector<std::int8_t>& cornerSigns,
+                               const std::vector<std::uint32_t>& cornerOffsets,
+                               const std::vector<std::uint32_t>& vertexCorners)
+    {
+        auto& [positions, normals, tangents, colors, texCoords, indices] = mesh;
+        const std::size_t vertexCount = positions.size();
+        bool split = false;
+        for (std::size_t vertex = 0; vertex < vertexCount; ++vertex)
+        {
+            const auto begin = vertexCorners.begin() + cornerOffsets[vertex];
+            const auto end = vertexCorners.begin() + cornerOffsets[vertex + 1];
+            const auto isNegative = [&](std::uint32_t corner) {
+                return cornerSigns[corner] < 0;
+            };
+            const auto isPositive = [&](std::uint32_t corner) {
+                return cornerSigns[corner] > 0;
+            };
+            if (std::none_of(begin, end, isNegative) ||
+                std::none_of(begin, end, isPositive))
+                continue;
+            Expects(positions.size() <= UINT16_MAX);
+            const auto mirrored = static_cast<ShortIndex>(positions.size());
+            DuplicateVertex(positions, vertex);
+            DuplicateVertex(normals, vertex);
+            DuplicateVertex(colors, vertex);
+            DuplicateVertex(texCoords, vertex);
+            for (auto corner = begin; corner != end; ++corner)
+            {
+                if (isNegative(*corner))
+                    indices[*corner] = mirrored;
+            }
+            split = true;
+        }
+        return split;
+    }
+
+    void GenerateTangents(LoadedMesh& mesh)
+    {
+        using namespace DirectX;
+        auto& [positions, normals, tangents, colors, texCoords, indices] = mesh;
+        const std::size_t vertexCount = positions.size();
+        Expects(normals.size() == vertexCount &&
+                texCoords.size() == vertexCount);
+        Expects(indices.size() % 3 == 0);
+        const std::size_t triangleCount = indices.size() / 3;
+
+        // 每个 corner（三角形上的一个顶点）加权后的切线和手性，UV 退化的
+        // 三角形手性为 0，不参与判断。
+        std::vector<VectorType> cornerTangents(indices.size());
+        std::vector<std::int8_t> cornerSigns(indices.size());
+        ParallelFor(
+            triangleCount, kParallelTriangleThreshold,
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t triangle = begin; triangle < end; ++triangle)
+                {
+                    const ShortIndex* corners = &indices[triangle * 3];
+                    const XMVECTOR p0 = Load(positions[corners[0]]);
+                    const XMVECTOR p1 = Load(positions[corners[1]]);
+                    const XMVECTOR p2 = Load(positions[corners[2]]);
+                    const XMVECTOR uv0 = Load(texCoords[corners[0]]);
+                    const XMVECTOR d1 =
+                        XMVectorSubtract(Load(texCoords[corners[1]]), uv0);
+                    const XMVECTOR d2 =
+                        XMVectorSubtract(Load(texCoords[corners[2]]), uv0);
+                    const XMVECTOR e1 = XMVectorSubtract(p1, p0);
+                    const XMVECTOR e2 = XMVectorSubtract(p2, p0);
+                    const float det = XMVectorGetX(d1) * XMVectorGetY(d2) -
+                                      XMVectorGetX(d2) * XMVectorGetY(d1);
+                    const bool degenerate = !(std::abs(det) > FLT_MIN);
+                    XMVECTOR faceTangent = XMVectorZero();
+                    XMVECTOR faceBitangent = XMVectorZero();
+                    if (!degenerate)
+                    {
+                        const float sign = det < 0.0f ? -1.0f : 1.0f;
+                        faceTangent = XMVectorSubtract(
+                            XMVectorScale(e1, XMVectorGetY(d2)),
+                            XMVectorScale(e2, XMVectorGetY(d1)));
+                        faceTangent = XMVector3Normalize(
+                            XMVectorScale(faceTangent, sign));
+                        faceBitangent = XMVectorScale(
+                            XMVectorSubtract(
+                                XMVectorScale(e2, XMVectorGetX(d1)),
+                                XMVectorScale(e1, XMVectorGetX(d2))),
+                            sign);
+                    }
+                    const XMVECTOR cornerPositions[] = {p0, p1, p2};
+                    for (std::size_t i = 0; i < 3; ++i)
+                    {
+                        const XMVECTOR p = cornerPositions[i];
+                        const XMVECTOR a = XMVector3Normalize(
+                            XMVectorSubtract(cornerPositions[(i + 1) % 3], p));
+                        const XMVECTOR b = XMVector3Normalize(
+                            XMVectorSubtract(cornerPositions[(i + 2) % 3], p));
+                        const XMVECTOR angle =
+                            XMVector3AngleBetweenNormals(a, b);
+                        const XMVECTOR normal = Load(normals[corners[i]]);
+                        const XMVECTOR projected = XMVector3Normalize(
+                            TangentOnNormalPlane(faceTangent, normal));
+                        const std::size_t corner = triangle * 3 + i;
+                        cornerTangents[corner] =
+                            StoreVec(XMVectorMultiply(projected, angle));
+                        cornerSigns[corner] =
+                            degenerate ? 0
+                                       : static_cast<std::int8_t>(
+                                             TangentHandedness(
+                                                 normal, faceTangent,
+                                                 faceBitangent));
+                    }
+                }
+            });
+
+        std::vector<std::uint32_t> cornerOffsets;
+        std::vector<std::uint32_t> vertexCorners;
+        GroupCornersByVertex(indices, vertexCount, cornerOffsets,
+                             vertexCorners);
+        if (SplitMirroredVertices(mesh, cornerSigns, cornerOffsets,
+                                  vertexCorners))
+        {
+            GroupCornersByVertex(indices, positions.size(), cornerOffsets,
+                                 vertexCorners);
+        }
+
+        tangents.resize(positions.size());
+        ParallelFor(
+            positions.size(), kParallelTriangleThreshold,
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t vertex = begin; vertex < end; ++vertex)
+                {
+                    XMVECTOR sum = XMVectorZero();
+                    // 拆分之后同一顶点上非 0 的手性都相同。
+                    float handedness = 1.0f;
+                    for (std::uint32_t i = cornerOffsets[vertex];
+                         i < cornerOffsets[vertex + 1]; ++i)
+                    {
+                        const std::uint32_t corner = vertexCorners[i];
+                        sum = XMVectorAdd(sum, Load(cornerTangents[corner]));
+                        if (cornerSigns[corner] != 0)
+                            handedness = cornerSigns[corner];
+                    }
+                    const XMVECTOR normal = Load(normals[vertex]);
+                    XMVECTOR tangent = TangentOnNormalPlane(sum, normal);
+                    if (XMVector3LessOrEqual(XMVector3LengthSq(tangent),
+                                             XMVectorReplicate(FLT_MIN)))
+                    {
+                        tangent = XMVector3Orthogonal(normal);
+                    }
+                    tangents[vertex] =
+                        StoreTangent(XMVector3Normalize(tangent), handedness);
+                }
+            });
+    }
+} // namespace dx
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Model.hpp"
+
+namespace dx
+{
+    // 合并所有 stream 上都相同的顶点并重映射 Indices，返回合并后的顶点数。
+    // epsilon > 0 时，所有 stream 的每个分量都与之前保留的某个顶点相差不
+    // 超过 epsilon 的顶点会合并到它上面。
+    std::size_t WeldVertices(LoadedMesh& mesh, float epsilon = 0.0f);
+
+    // 按 MikkTSpace 的做法生成 Tangents：三角形切线投影到顶点法线平面后按
+    // 该顶点处的夹角加权累加，再与法线做 Gram-Schmidt 正交化。需要
+    // Positions、Normals、TexCoords 和三角形列表的 Indices；为了让 UV 接缝
+    // 两侧共享切线，建议先 WeldVertices。w 是手性（见 TangentType）；镜像 UV
+    // 的接缝上手性不同的 corner 会被拆到新顶点，所以顶点数可能增加。
+    void GenerateTangents(LoadedMesh& mesh);
+} // namespace dx
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ComponentBase.hpp"
+#include "Resources/Shaders.hpp"
 
 namespace dx
 {
@@ -16,9 +17,12 @@ namespace dx
         Mesh& GetMesh() const;
         std::shared_ptr<Mesh> SharedMesh() const { return m_mesh; }
         Material& GetMaterial() const;
+        // 见 RenderNode::CbKey。
+        std::uint64_t CbKey() const noexcept { return m_cbKey.Value(); }
 
       private:
         std::shared_ptr<Mesh> m_mesh;
         std::shared_ptr<Material> m_material;
+        UniqueCbKey m_cbKey;
     };
 } // namespace dx
\ No newline at end of file
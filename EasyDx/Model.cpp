@@ -1,6 +1,7 @@
 ﻿#include "pch.hpp"
 #include "Model.hpp"
 #include "Mesh.hpp"
+#include "MeshProcessing.hpp"
 #include "Texture.hpp"
 #include "Material.hpp"
 #include "Resources/Shaders.hpp"
@@ -106,6 +107,11 @@ namespace dx
 
     TexCoordType MakeTexCoord(float x, float y) { return TexCoordType{x, y}; }
 
+    TangentType MakeTangent(float x, float y, float z, float w)
+    {
+        return TangentType{x, y, z, w};
+    }
+
     ColorType MakeColor(float r, float g, float b, float a)
     {
         return ColorType{r, g, b, a};
@@ -152,62 +158,204 @@ namespace dx
         return smoothness;
     }
 
+    template<typename T, typename U, typename Converter>
+    void CopyAiChannel(const T* source, std::uint32_t vertexCount,
+                       Converter converter, std::vector<U>& channel)
+    {
+        channel.resize(vertexCount);
+        std::transform(source, source + vertexCount, channel.begin(),
+                       converter);
+    }
+
+    // 手性由 aiMesh 的副切线决定；没有法线时取 1。
+    void CopyAiTangents(const aiMesh& aiMesh_, TangentStream& tangents)
+    {
+        const std::uint32_t vertexCount = aiMesh_.mNumVertices;
+        tangents.resize(vertexCount);
+        for (std::uint32_t i = 0; i < vertexCount; ++i)
+        {
+            const auto tangent = Load(MakeAiDirection(aiMesh_.mTangents[i]));
+            const float handedness =
+                aiMesh_.HasNormals()
+                    ? TangentHandedness(
+                          Load(MakeAiDirection(aiMesh_.mNormals[i])), tangent,
+                          Load(MakeAiDirection(aiMesh_.mBitangents[i])))
+                    : 1.0f;
+            tangents[i] = StoreTangent(tangent, handedness);
+        }
+    }
+
+    void LoadedMeshFromAiMesh(const aiMesh& aiMesh_, LoadFlags flags,
+                              LoadedMesh& loadedMesh)
+    {
+        const auto requested = [flags](LoadFlags flag) {
+            return (flags & flag) == flag;
+        };
+        auto& [positions, normals, tangents, colors, texCoords, indices] =
+            loadedMesh;
+        loadedMesh.Clear();
+        const std::uint32_t vertexCount = aiMesh_.mNumVertices;
+        if (requested(LoadFlags::kPositions))
+        {
+            CopyAiChannel(aiMesh_.mVertices, vertexCount, MakeAiPosition,
+                          positions);
+        }
+        if (requested(LoadFlags::kNormals) && aiMesh_.HasNormals())
+        {
+            CopyAiChannel(aiMesh_.mNormals, vertexCount, MakeAiDirection,
+                          normals);
+        }
+        if (requested(LoadFlags::kColors) && aiMesh_.HasVertexColors(0))
+        {
+            CopyAiChannel(aiMesh_.mColors[0], vertexCount,
+                          [](const aiColor4D& color) {
+                              return AiColorToFloat4(color);
+                          },
+                          colors);
+        }
+        // 生成切线也需要 texcoords。
+        const bool hasTexCoords = aiMesh_.HasTextureCoords(0);
+        const bool needTexCoords = requested(LoadFlags::kTexCoords) ||
+                                   requested(LoadFlags::kTangents);
+        if (needTexCoords && hasTexCoords)
+        {
+            CopyAiChannel(aiMesh_.mTextureCoords[0], vertexCount,
+                          [](const aiVector3D& uv) {
+                              return MakeTexCoord(uv.x, uv.y);
+                          },
+                          texCoords);
+        }
+        IndicesFromMesh(aiMesh_, indices);
+        if (requested(LoadFlags::kTangents))
+        {
+            if (aiMesh_.HasTangentsAndBitangents())
+            {
+                CopyAiTangents(aiMesh_, tangents);
+            }
+            else if (!normals.empty() && hasTexCoords)
+            {
+                GenerateTangents(loadedMesh);
+            }
+        }
+        if (!requested(LoadFlags::kTexCoords))
+        {
+            texCoords.clear();
+        }
+    }
+
+    // 每个 channel 一个 stream，数量有上限，不需要在堆上分配。
+    struct MeshChannels
+    {
+        MaxStreamVector<gsl::span<const std::byte>> Bytes;
+        MaxStreamVector<VSSemantics> Semantices;
+        MaxStreamVector<std::uint32_t> Strides;
+        MaxStreamVector<DxgiFormat> Formats;
+        MaxStreamVector<std::uint32_t> SemanticsIndices;
+
+        template<typename T>
+        void Push(VSSemantics semantics, const T* p, std::size_t vertexCount,
+                  DxgiFormat format)
+        {
+            Semantices.push_back(semantics);
+            Bytes.push_back(gsl::as_bytes(gsl::make_span(p, vertexCount)));
+            Strides.push_back(sizeof(T));
+            Formats.push_back(format);
+            SemanticsIndices.push_back(0);
+        }
+
+        std::shared_ptr<Mesh>
+        CreateImmutable(ID3D11Device& device3D,
+                        gsl::span<const ShortIndex> indices,
+                        D3D11_PRIMITIVE_TOPOLOGY topology, StreamLayout layout,
+                        VSSemantics usedSemantics) const
+        {
+            std::vector<D3D11_INPUT_ELEMENT_DESC> inputElementsDesces;
+            FillInputElementsDesc(inputElementsDesces, Semantices, Formats,
+                                  SemanticsIndices);
+            return std::make_shared<Mesh>(Mesh::CreateImmutable(
+                device3D, gsl::narrow<std::uint32_t>(Bytes.size()),
+                Bytes.data(), Strides.data(), Semantices.data(),
+                std::move(inputElementsDesces), indices, topology, layout,
+                usedSemantics));
+        }
+    };
+
     std::shared_ptr<Mesh> ConvertToImmutableMesh(ID3D11Device& device3D,
-                                                 const aiMesh& aiMesh_)
+                                                 const aiMesh& aiMesh_,
+                                                 StreamLayout layout,
+                                                 VSSemantics usedSemantics)
     {
         std::vector<ShortIndex> indices;
         IndicesFromMesh(aiMesh_, indices);
-        // const VSSemantics semanticsMask = VSSemanticsFromMesh(aiMesh_);
         const std::uint32_t vertexCount = aiMesh_.mNumVertices;
-        std::vector<gsl::span<const std::byte>> channels;
-        std::vector<VSSemantics> semantices;
-        VSSemantics allSemantics;
-        std::vector<std::uint32_t> strides;
-        std::vector<DxgiFormat> formats;
-        std::vector<std::uint32_t> semanticsIndices;
-        const auto pushChannel = [&](VSSemantics semantics, const auto p,
-                                     DxgiFormat format) {
-            semantices.push_back(semantics);
-            channels.push_back(
-                gsl::as_bytes(gsl::make_span(p, aiMesh_.mNumVertices)));
-            strides.push_back(sizeof(*p));
-            formats.push_back(format);
-            semanticsIndices.push_back(0);
-        };
-
-        pushChannel(VSSemantics::kPosition, aiMesh_.mVertices,
-                    DxgiFormat::R32G32B32Float);
+        // channels 只保存 span，带手性的切线要活到创建完 Mesh。
+        TangentStream tangents;
+        MeshChannels channels;
+        channels.Push(VSSemantics::kPosition, aiMesh_.mVertices, vertexCount,
+                      DxgiFormat::R32G32B32Float);
         if (aiMesh_.HasNormals())
         {
-            pushChannel(VSSemantics::kNormal, aiMesh_.mNormals,
-                        DxgiFormat::R32G32B32Float);
+            channels.Push(VSSemantics::kNormal, aiMesh_.mNormals, vertexCount,
+                          DxgiFormat::R32G32B32Float);
         }
         if (aiMesh_.HasTangentsAndBitangents())
         {
-            pushChannel(VSSemantics::kTangent, aiMesh_.mTangents,
-                        DxgiFormat::R32G32B32Float);
+            CopyAiTangents(aiMesh_, tangents);
+            channels.Push(VSSemantics::kTangent, tangents.data(),
+                          tangents.size(), DxgiFormat::R32G32B32A32Float);
         }
         if (aiMesh_.HasVertexColors(0))
         {
-            pushChannel(VSSemantics::kColor, aiMesh_.mColors[0],
-                        DxgiFormat::R32G32B32A32Float);
+            channels.Push(VSSemantics::kColor, aiMesh_.mColors[0],
+                          vertexCount, DxgiFormat::R32G32B32A32Float);
         }
         // TODO: multi-uv
         if (aiMesh_.HasTextureCoords(0))
         {
-            pushChannel(VSSemantics::kTexCoord, aiMesh_.mTextureCoords[0],
-                        DxgiFormat::R32G32Float);
+            channels.Push(VSSemantics::kTexCoord, aiMesh_.mTextureCoords[0],
+                          vertexCount, DxgiFormat::R32G32Float);
         }
 
         const D3D11_PRIMITIVE_TOPOLOGY topology = AsD3DPrimitiveTopology(
             static_cast<aiPrimitiveType>(aiMesh_.mPrimitiveTypes));
-        std::vector<D3D11_INPUT_ELEMENT_DESC> inputElementsDesces;
-        FillInputElementsDesc(inputElementsDesces, semantices, formats,
-                              semanticsIndices);
-        return std::make_shared<Mesh>(Mesh::CreateImmutable(
-            device3D, channels.size(), channels.data(), strides.data(),
-            semantices.data(), std::move(inputElementsDesces),
-            gsl::span<const ShortIndex>{indices}, topology));
+        return channels.CreateImmutable(device3D,
+                                        gsl::span<const ShortIndex>{indices},
+                                        topology, layout, usedSemantics);
+    }
+
+    std::shared_ptr<Mesh>
+    ConvertToImmutableMesh(ID3D11Device& device3D, const LoadedMesh& loadedMesh,
+                           D3D11_PRIMITIVE_TOPOLOGY topology,
+                           StreamLayout layout, VSSemantics usedSemantics)
+    {
+        auto& [positions, normals, tangents, colors, texCoords, indices] =
+            loadedMesh;
+        MeshChannels channels;
+        channels.Push(VSSemantics::kPosition, positions.data(),
+                      positions.size(), DxgiFormat::R32G32B32Float);
+        if (!normals.empty())
+        {
+            channels.Push(VSSemantics::kNormal, normals.data(), normals.size(),
+                          DxgiFormat::R32G32B32Float);
+        }
+        if (!tangents.empty())
+        {
+            channels.Push(VSSemantics::kTangent, tangents.data(),
+                          tangents.size(), DxgiFormat::R32G32B32A32Float);
+        }
+        if (!colors.empty())
+        {
+            channels.Push(VSSemantics::kColor, colors.data(), colors.size(),
+                          DxgiFormat::R32G32B32A32Float);
+        }
+        if (!texCoords.empty())
+        {
+            channels.Push(VSSemantics::kTexCoord, texCoords.data(),
+                          texCoords.size(), DxgiFormat::R32G32Float);
+        }
+        return channels.CreateImmutable(device3D,
+                                        gsl::span<const ShortIndex>{indices},
+                                        topology, layout, usedSemantics);
     }
 
     D3D11_PRIMITIVE_TOPOLOGY
@@ -286,16 +434,18 @@ namespace dx
                     MakePosition(radius * c, currentHeight, radius * s));
                 texCoords.push_back(MakeTexCoord(1.f - currentHeight / height,
                                                  angle / DirectX::XM_2PI));
-                // normalized already.
-                const auto tangentU = MakeDir(-s, 0, c);
-                tangents.push_back(tangentU);
-                const auto biTangent =
+                // u 沿母线，v 沿圆周。
+                const auto alongSlice = MakeDir(-s, 0, c);
+                const auto alongHeight =
                     MakeDir(radiusDelta * c, -height, radiusDelta * s);
-                const auto tangentUVec = Load(tangentU);
-                const auto biTangentVec = Load(biTangent);
-                const auto biTangentUVec = XMVector3Normalize(biTangentVec);
-                const auto normalUVec =
-                    XMVector3Cross(tangentUVec, biTangentVec);
+                const auto alongSliceVec = Load(alongSlice);
+                const auto tangentUVec =
+                    XMVector3Normalize(Load(alongHeight));
+                const auto normalUVec = XMVector3Normalize(
+                    XMVector3Cross(alongSliceVec, tangentUVec));
+                tangents.push_back(StoreTangent(
+                    tangentUVec, TangentHandedness(normalUVec, tangentUVec,
+                                                   alongSliceVec)));
                 normals.push_back(StoreVec(normalUVec));
                 angle += angleStep;
             }
@@ -331,9 +481,11 @@ namespace dx
         }
 
         {
+            // 顶盖的 v 沿 +Z，从上方看是镜像的。圆心的 UV 要与圆周的平面
+            // 映射一致，否则部分三角形在 UV 中翻转，手性不一致。
             positions.push_back(MakePosition(0.f, height, 0.f));
-            texCoords.push_back(MakeTexCoord(0.5f, 0.5f));
-            tangents.push_back(MakeDir(1.f, 0.f, 0.f));
+            texCoords.push_back(MakeTexCoord(0.f, 0.f));
+            tangents.push_back(MakeTangent(1.f, 0.f, 0.f, -1.f));
             normals.push_back(MakeDir(0.f, 1.f, 0.f));
 
             // vertices.push_back(SimpleVertex{ topPos, topNormal,
@@ -349,7 +501,7 @@ namespace dx
                 const auto z = topRadius * std::sin(angle);
                 positions.push_back(MakePosition(x, height, z));
                 normals.push_back(MakeDir(0.f, 1.f, 0.f));
-                tangents.push_back(MakeDir(1.f, 0.f, 0.f));
+                tangents.push_back(MakeTangent(1.f, 0.f, 0.f, -1.f));
                 // What the fuck?
                 texCoords.push_back({x / height, z / height});
             }
@@ -364,10 +516,9 @@ namespace dx
 
         {
             const auto bottomPos = MakePosition(0.f, 0.f, 0.f);
-            const auto bottomUV = MakeTexCoord(1.f, 1.f);
-            const auto bottomTangentU = MakeDir(1.f, 0.f, 0.f);
+            const auto bottomUV = MakeTexCoord(0.5f, 0.5f);
+            const auto bottomTangentU = MakeTangent(1.f, 0.f, 0.f);
             const auto bottomNormal = MakeDir(0.f, -1.f, 0.f);
-            const auto bottomBitangentU = MakeDir(0.0f, 0.0f, -1.0f);
             positions.push_back(bottomPos);
             texCoords.push_back(bottomUV);
             tangents.push_back(bottomTangentU);
@@ -384,7 +535,6 @@ namespace dx
                 const auto pos = MakePosition(x, 0.f, z);
                 const auto normal = bottomNormal;
                 const auto tangentU = bottomTangentU;
-                const auto bitangentU = bottomBitangentU;
                 // What the fuck?
                 const auto uv =
                     MakeTexCoord(x / height + 0.5f, z / height + 0.5f);
@@ -423,7 +573,7 @@ namespace dx
         {
             const auto topPos = MakePosition(0.f, radius, 0.f);
             const auto topNormal = MakeDir(0.f, 1.f, 0.f);
-            const auto topTangentU = MakeDir(1.f, 0.f, 0.f);
+            const auto topTangentU = MakeTangent(1.f, 0.f, 0.f);
             const auto topUV = MakeTexCoord(0.f, 0.f);
             positions.push_back(topPos);
             normals.push_back(topNormal);
@@ -452,11 +602,9 @@ namespace dx
                     MakeTexCoord(theta / DirectX::XM_2PI, phi / DirectX::XM_PI);
                 const auto normalU = XMVector3Normalize(Load(pos));
                 VectorType normal = StoreVec(normalU);
+                // cross(normal, tangent) 正好指向 v 增大的方向（向南）。
                 const auto tangentU =
-                    MakeDir(-std::sin(theta), 0.f, std::cos(theta));
-                const auto tangenUVec = Load(tangentU);
-                const auto biTangent =
-                    DirectX::XMVector3Cross(normalU, tangenUVec);
+                    MakeTangent(-std::sin(theta), 0.f, std::cos(theta));
 
                 positions.push_back(pos);
                 normals.push_back(normal);
@@ -468,8 +616,7 @@ namespace dx
             const auto bottomPos = MakePosition(0.f, -radius, 0.f);
             const auto bottomNormal = MakeDir(0.f, -1.f, 0.f);
             const auto bottomUV = MakeTexCoord(0.f, 1.f);
-            const auto bottomTangentU = MakeDir(1.f, 0.f, 0.f);
-            const auto bottombiTangentU = MakeDir(0.0f, 0.0f, -1.0f);
+            const auto bottomTangentU = MakeTangent(1.f, 0.f, 0.f);
             // SimpleVertex{ bottomPos, bottomNormal, bottomTangentU,
             // bottomUV }
             positions.push_back(bottomPos);
@@ -535,6 +682,16 @@ namespace dx
         TexCoords.reserve(size);
     }
 
+    void LoadedMesh::Resize(std::size_t vertexCount, std::size_t indexCount)
+    {
+        Positions.resize(vertexCount);
+        Normals.resize(vertexCount);
+        Tangents.resize(vertexCount);
+        Colors.clear();
+        TexCoords.resize(vertexCount);
+        Indices.resize(indexCount);
+    }
+
     void LoadedMesh::Clear()
     {
         Positions.clear();
@@ -18,22 +18,44 @@ namespace dx
     using VectorType = DirectX::XMFLOAT3A;
     using TexCoordType = DirectX::XMFLOAT2A;
     using ColorType = DirectX::XMFLOAT4;
+    // w 是切线空间的手性，副切线（v 增大的方向）为
+    // w * cross(normal, tangent)，与 MikkTSpace 相同。
+    using TangentType = DirectX::XMFLOAT4A;
 
     using PositionStream = std::vector<PositionType>;
     using VectorStream = std::vector<VectorType>;
     using TexCoordStream = std::vector<TexCoordType>;
     using ColorStream = std::vector<ColorType>;
+    using TangentStream = std::vector<TangentType>;
 
     PositionType MakePosition(float x, float y, float z);
     VectorType MakeDir(float x, float y, float z, float w = 0.0f);
     TexCoordType MakeTexCoord(float x, float y);
     ColorType MakeColor(float r, float g, float b, float a);
+    TangentType MakeTangent(float x, float y, float z, float w = 1.0f);
 
     inline VectorType StoreVec(DirectX::XMVECTOR vec)
     {
         return Store<VectorType>(vec);
     }
 
+    inline TangentType StoreTangent(DirectX::XMVECTOR tangent,
+                                    float handedness)
+    {
+        return Store<TangentType>(DirectX::XMVectorSetW(tangent, handedness));
+    }
+
+    // bitangent 与 cross(normal, tangent) 同侧时为 1，否则为 -1。
+    inline float TangentHandedness(DirectX::FXMVECTOR normal,
+                                   DirectX::FXMVECTOR tangent,
+                                   DirectX::FXMVECTOR bitangent)
+    {
+        using namespace DirectX;
+        const XMVECTOR side =
+            XMVector3Dot(XMVector3Cross(normal, tangent), bitangent);
+        return XMVectorGetX(side) < 0.0f ? -1.0f : 1.0f;
+    }
+
     enum class LoadFlags : std::uint32_t
     {
         kNone = 0,
@@ -53,13 +75,15 @@ namespace dx
     {
         PositionStream Positions;
         VectorStream Normals;
-        VectorStream Tangents;
+        TangentStream Tangents;
         // VectorStream Bitangents;
         ColorStream Colors;
         TexCoordStream TexCoords;
         std::vector<ShortIndex> Indices;
 
         void Reserve(std::size_t size);
+        // 调整顶点 stream 和 Indices 的大小，Colors 会被清空。
+        void Resize(std::size_t vertexCount, std::size_t indexCount);
         void Clear();
     };
 
@@ -73,9 +97,22 @@ namespace dx
     std::optional<Smoothness>
     SmoothnessFromMaterial(const aiMaterial& material);
 
-    // TODO: VSSemantics expectedSemantics
-    std::shared_ptr<Mesh> ConvertToImmutableMesh(ID3D11Device& device3D,
-                                                 const aiMesh& aiMesh_);
+    // 拷贝 flags 中请求且 aiMesh 中存在的 channel。请求了 kTangents 而文件
+    // 中没有时用 GenerateTangents 生成，导入时不必开启
+    // aiProcess_CalcTangentSpace。
+    void LoadedMeshFromAiMesh(const aiMesh& aiMesh_, LoadFlags flags,
+                              LoadedMesh& loadedMesh);
+
+    // usedSemantics 非 kNone 时只上传被用到的 channel。
+    std::shared_ptr<Mesh> ConvertToImmutableMesh(
+        ID3D11Device& device3D, const aiMesh& aiMesh_,
+        StreamLayout layout = StreamLayout::kPerChannel,
+        VSSemantics usedSemantics = VSSemantics::kNone);
+    std::shared_ptr<Mesh> ConvertToImmutableMesh(
+        ID3D11Device& device3D, const LoadedMesh& loadedMesh,
+        D3D11_PRIMITIVE_TOPOLOGY topology,
+        StreamLayout layout = StreamLayout::kPerChannel,
+        VSSemantics usedSemantics = VSSemantics::kNone);
     D3D11_PRIMITIVE_TOPOLOGY
     AsD3DPrimitiveTopology(aiPrimitiveType primitiveType);
 
@@ -102,7 +139,4 @@ namespace dx
 
     void MakeUVSphere(float radius, std::uint16_t sliceCount,
                       std::uint16_t stackCount, LoadedMesh& meshData);
-
-    /*void MakeIcoSphere(std::uint32_t recursionLevel,
-        CpuMesh<SimpleVertex>& meshData);*/
 } // namespace dx
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "pch.hpp"
 #include "Camera.hpp"
+#include "CascadeFitting.hpp"
 #include "CBStructs.hpp"
 #include "Events.hpp"
 #include "Game.hpp"
@@ -13,12 +14,23 @@
 #include "DependentGraphics.hpp"
 #include "Texture.hpp"
 #include "Transform.hpp"
+#include "TransformStore.hpp"
 #include "Predefined.hpp"
 #include "EventLoop.hpp"
 #include "Resources.hpp"
 #include "Bind.hpp"
+#include "BoundingVolumes.hpp"
 #include "Mesh.hpp"
+#include "MeshGenerators.hpp"
+#include "MeshProcessing.hpp"
 #include "MeshRenderer.hpp"
+#include "ShadowCache.hpp"
+#include "ClusteredLighting.hpp"
+#include "LightBvh.hpp"
+#include "LightRegistry.hpp"
+#include "FrameAllocator.hpp"
+#include "AssetWatcher.hpp"
+#include "AssetArchive.hpp"
 #include "GraphicsDevices.hpp"
 #include "DxMathWrappers.hpp"
 #include "Render.hpp"
@@ -69,6 +69,11 @@ namespace dx
         return g_predefineResources->wireFrameOnly_.Get();
     }
 
+    ID3D11RasterizerState* PredefinedResources::GetShadowCaster()
+    {
+        return g_predefineResources->shadowCaster_.Get();
+    }
+
     wrl::ComPtr<ID3D11SamplerState> PredefinedResources::GetDefaultSampler()
     {
         return g_predefineResources->defaultSampler_;
@@ -275,6 +280,19 @@ namespace dx
             TryHR(device.CreateRasterizerState(&wireframeDesc,
                                                wireFrameOnly_.GetAddressOf()));
         }
+
+        {
+            // 关掉深度裁剪（pancaking）：在光源一侧超出近平面的 caster
+            // 深度被钳到 0，仍然能遮挡后面的物体，而不是被裁掉。
+            D3D11_RASTERIZER_DESC shadowCasterDesc{};
+            shadowCasterDesc.FillMode = D3D11_FILL_SOLID;
+            shadowCasterDesc.CullMode = D3D11_CULL_BACK;
+            shadowCasterDesc.FrontCounterClockwise = false;
+            shadowCasterDesc.DepthClipEnable = false;
+
+            TryHR(device.CreateRasterizerState(&shadowCasterDesc,
+                                               shadowCaster_.GetAddressOf()));
+        }
     }
 
     std::unique_ptr<Object> obj(Object obj)
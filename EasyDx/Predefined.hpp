@@ -56,6 +56,7 @@ namespace dx
 
         static ID3D11RasterizerState* GetCullClockwise();
         static ID3D11RasterizerState* GetWireFrameOnly();
+        static ID3D11RasterizerState* GetShadowCaster();
 
         static wrl::ComPtr<ID3D11SamplerState> GetDefaultSampler();
         static wrl::ComPtr<ID3D11SamplerState> GetRepeatSampler();
@@ -79,7 +80,8 @@ namespace dx
         wrl::ComPtr<ID3D11DepthStencilState> stencilAlways_, drawnOnly_,
             noDoubleBlending_;
         wrl::ComPtr<ID3D11BlendState> noWriteToRt_, transparent_;
-        wrl::ComPtr<ID3D11RasterizerState> cullClockWise_, wireFrameOnly_;
+        wrl::ComPtr<ID3D11RasterizerState> cullClockWise_, wireFrameOnly_,
+            shadowCaster_;
     };
 
     void
@@ -5,6 +5,7 @@
 #include "Resources/Shaders.hpp"
 #include "Resources/InputLayout.hpp"
 #include "Vertex.hpp"
+#include <numeric>
 
 namespace dx
 {
@@ -13,6 +14,7 @@ namespace dx
     MaxStreamVector<std::uint32_t> g_Offsets;
     std::vector<D3D11_INPUT_ELEMENT_DESC> g_InputElementDescs;
     MaxStreamVector<VSSemantics> g_VSSemantics;
+    DrawStatistics g_drawStatistics;
 
     void UpdateGlobalMeshData(const dx::Mesh& mesh, VSSemantics& mask);
 
@@ -25,6 +27,37 @@ namespace dx
         g_InputElementDescs.clear();
     }
 
+    const DrawStatistics& GetDrawStatistics() { return g_drawStatistics; }
+
+    void ResetDrawStatistics() { g_drawStatistics = {}; }
+
+    void RecordMeshDraw(const Mesh& mesh)
+    {
+        const std::uint32_t stride =
+            std::accumulate(g_Strides.begin(), g_Strides.end(), 0u);
+        g_drawStatistics.DrawCalls += 1;
+        g_drawStatistics.VertexBuffersBound +=
+            static_cast<std::uint32_t>(g_Buffers.size());
+        g_drawStatistics.VertexBytesBound +=
+            static_cast<std::uint64_t>(stride) * mesh.GetVertexCount();
+    }
+
+    std::uint32_t BoundVertexStride(const Mesh& mesh, VSSemantics mask)
+    {
+        const gsl::span<const VSSemantics> semanticses = mesh.GetChannelMasks();
+        const gsl::span<const StreamInfo> streamsInfo = mesh.GetStreamsInfo();
+        std::uint32_t stride = 0;
+        for (std::ptrdiff_t i = 0; i < semanticses.size(); ++i)
+        {
+            if ((semanticses[i] & mask) != VSSemantics::kNone)
+            {
+                stride += streamsInfo[i].GetStride();
+                mask &= ~semanticses[i];
+            }
+        }
+        return stride;
+    }
+
     void CheckConsistency()
     {
         const auto size = g_Buffers.size();
@@ -44,6 +77,7 @@ namespace dx
         SetupIndexBuffer(context3D, mesh.GetGpuIndexBuffer());
         VSSemantics mask = pass.Shaders.GetMask();
         UpdateGlobalMeshData(mesh, mask);
+        RecordMeshDraw(mesh);
         // FIXME: .Get
         ID3D11InputLayout* existingLayout =
             InputLayoutAllocator::Query(gsl::make_span(g_InputElementDescs))
@@ -116,6 +150,7 @@ namespace dx
         ClearVbDataStructures();
         VSSemantics mask = pass.Shaders.GetMask();
         UpdateGlobalMeshData(mesh, mask);
+        RecordMeshDraw(mesh);
         // the instancing part
         Append(g_Buffers, buffers, ComPtrsCast(instancingBuffers));
         g_Strides.insert(g_Strides.end(), strides.begin(), strides.end());
@@ -14,6 +14,20 @@ namespace dx
                   const Material& material, ID3D11Device* deviceToCreateInputLayout = nullptr);
     void DrawMesh(ID3D11DeviceContext& context3D, const Mesh& mesh,
                   const Pass& pass, ID3D11Device* deviceToCreateInputLayout = nullptr);
+    struct DrawStatistics
+    {
+        std::uint32_t DrawCalls = 0;
+        std::uint32_t VertexBuffersBound = 0;
+        std::uint64_t VertexBytesBound = 0;
+    };
+
+    // 自上次 ResetDrawStatistics 以来 DrawMesh/DrawMeshInstancing 的统计。
+    const DrawStatistics& GetDrawStatistics();
+    void ResetDrawStatistics();
+
+    // 用 mask 绘制 mesh 时每个顶点从 vertex buffer 读取的字节数。
+    std::uint32_t BoundVertexStride(const Mesh& mesh, VSSemantics mask);
+
     void DrawMeshInstancing(ID3D11DeviceContext& context3D, const Mesh& mesh,
                             const Pass& pass, std::uint32_t instancingCount,
                             gsl::span<const GpuBuffer> instancingBuffers,
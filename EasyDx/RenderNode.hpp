@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <cstdint>
 
 namespace dx
 {
@@ -17,5 +18,10 @@ namespace dx
         Material& material;
         DirectX::XMMATRIX World;
         CallbackComponent* const renderCallbacks;
+        // 不会移动的 caster，阴影可以缓存。
+        bool IsStatic = false;
+        // 通常是 MeshRenderer::CbKey，用来缓存物体的 per-object cbuffer（见
+        // Shader::SetCbKey）；为 0 时不缓存。
+        std::uint64_t CbKey = 0;
     };
 } // namespace dx
\ No newline at end of file
@@ -2,4 +2,7 @@
 
 #include "Resources/Buffers.hpp"
 #include "Resources/InputLayout.hpp"
-#include "Resources/Shaders.hpp"
\ No newline at end of file
+#include "Resources/ShaderCache.hpp"
+#include "Resources/ShaderMetadata.hpp"
+#include "Resources/Shaders.hpp"
+#include "Resources/ShaderPermutation.hpp"
\ No newline at end of file
@@ -75,5 +75,40 @@ namespace dx
             offset);
     }
 
+    wrl::ComPtr<ID3D11Buffer>
+    MakeDynamicStructuredBuffer(ID3D11Device& device, std::uint32_t stride,
+                                std::uint32_t elementCount)
+    {
+        Expects(stride > 0 && elementCount > 0);
+        D3D11_BUFFER_DESC bufferDesc = {};
+        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+        bufferDesc.ByteWidth = stride * elementCount;
+        bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        bufferDesc.StructureByteStride = stride;
+        wrl::ComPtr<ID3D11Buffer> d3dBuffer;
+        TryHR(device.CreateBuffer(&bufferDesc, nullptr,
+                                  d3dBuffer.GetAddressOf()));
+        return d3dBuffer;
+    }
+
+    wrl::ComPtr<ID3D11ShaderResourceView>
+    MakeStructuredBufferView(ID3D11Device& device, ID3D11Buffer& buffer)
+    {
+        const auto bufferDesc = GetDesc(buffer);
+        Expects(bufferDesc.StructureByteStride != 0);
+        D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+        viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+        viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        viewDesc.Buffer.FirstElement = 0;
+        viewDesc.Buffer.NumElements =
+            bufferDesc.ByteWidth / bufferDesc.StructureByteStride;
+        wrl::ComPtr<ID3D11ShaderResourceView> view;
+        TryHR(device.CreateShaderResourceView(&buffer, &viewDesc,
+                                              view.GetAddressOf()));
+        return view;
+    }
+
     MappedGpuResource::~MappedGpuResource() { m_context->Unmap(m_resource, 0); }
 } // namespace dx
\ No newline at end of file
@@ -150,4 +150,12 @@ namespace dx
 
     void SetupIndexBuffer(ID3D11DeviceContext& context3D,
                           ID3D11Buffer& indexBuffer, std::uint32_t offset = 0);
+
+    // 可以每帧 Map 写入、在 shader 中作为 StructuredBuffer 读取的 buffer。
+    wrl::ComPtr<ID3D11Buffer>
+    MakeDynamicStructuredBuffer(ID3D11Device& device, std::uint32_t stride,
+                                std::uint32_t elementCount);
+
+    wrl::ComPtr<ID3D11ShaderResourceView>
+    MakeStructuredBufferView(ID3D11Device& device, ID3D11Buffer& buffer);
 } // namespace dx
\ No newline at end of file
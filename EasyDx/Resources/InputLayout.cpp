@@ -56,7 +56,7 @@ namespace dx
         const gsl::span<const D3D11_INPUT_ELEMENT_DESC>& desc,
         const fs::path& csoPath)
     {
-        const auto cso = MemoryMappedCso{csoPath};
+        const auto cso = MappedFile{csoPath, kShaderFileHints};
         return Register(device, desc, cso.Bytes());
     }
 
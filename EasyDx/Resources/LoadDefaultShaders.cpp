@@ -7,16 +7,22 @@ namespace dx
     {
         const auto currentPath = fs::current_path();
 
-        const auto addWithName = [&](const char* name,
-                                     const wchar_t* shaderFileName) {
-            Add(name, Shader::FromCompiledCso(device3D,
-                                              currentPath / shaderFileName));
-        };
-        addWithName(kBasicLighting, L"BasicPS.cso");
-        addWithName(kPosNormalTexTransform, L"BasicVS.cso");
-        addWithName(kQuadVS, L"UITextureVS.cso");
-        addWithName(kQuadVS, L"UITexturePS.cso");
-        addWithName(kDefaultShadowCasterVS, L"DefaultShadowCasterVS.cso");
-        addWithName(kDefaultShadowCasterPS, L"DefaultShadowCasterPS.cso");
+        const std::pair<const char*, const wchar_t*> shaderFiles[] = {
+            {kBasicLighting, L"BasicPS.cso"},
+            {kPosNormalTexTransform, L"BasicVS.cso"},
+            {kQuadVS, L"UITextureVS.cso"},
+            {kQuadVS, L"UITexturePS.cso"},
+            {kDefaultShadowCasterVS, L"DefaultShadowCasterVS.cso"},
+            {kDefaultShadowCasterPS, L"DefaultShadowCasterPS.cso"}};
+        std::vector<ShaderSource> sources;
+        for (const auto& [name, fileName] : shaderFiles)
+        {
+            sources.push_back(currentPath / fileName);
+        }
+        std::vector<Shader> shaders = LoadShaders(device3D, sources);
+        for (std::size_t i = 0; i < shaders.size(); ++i)
+        {
+            Add(shaderFiles[i].first, std::move(shaders[i]));
+        }
     }
 } // namespace dx
\ No newline at end of file
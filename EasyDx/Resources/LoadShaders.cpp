@@ -0,0 +1,166 @@
+#include "../pch.hpp"
+#include "Shaders.hpp"
+#include <future>
+
+namespace dx
+{
+    namespace
+    {
+        // .cso 和缓存命中时是映射的文件，否则是编译的结果。
+        using ShaderByteCode =
+            std::variant<std::monostate, MappedFile, wrl::ComPtr<ID3DBlob>>;
+
+        // 反射信息也在工作线程中准备好，主线程只负责创建 D3D 对象。
+        struct LoadedShader
+        {
+            ShaderByteCode ByteCode;
+            ShaderMetadata Metadata;
+        };
+
+        gsl::span<const std::byte> BytesOf(const ShaderByteCode& byteCode)
+        {
+            if (const auto mappedCso = std::get_if<MappedFile>(&byteCode))
+                return mappedCso->Bytes();
+            return AsSpan(Ref(std::get<wrl::ComPtr<ID3DBlob>>(byteCode)));
+        }
+
+        const fs::path& PathOf(const ShaderSource& source)
+        {
+            if (const auto csoPath = std::get_if<fs::path>(&source))
+                return *csoPath;
+            return std::get<ShaderCompileDesc>(source).SourcePath;
+        }
+
+        LoadedShader LoadMapped(const fs::path& csoPath)
+        {
+            LoadedShader loaded{MappedFile{csoPath, kShaderFileHints}, {}};
+            loaded.Metadata =
+                LoadShaderMetadata(csoPath, BytesOf(loaded.ByteCode));
+            return loaded;
+        }
+
+        LoadedShader LoadShader(const ShaderSource& source)
+        {
+            if (const auto csoPath = std::get_if<fs::path>(&source))
+                return LoadMapped(*csoPath);
+            const ShaderCompileDesc& desc = std::get<ShaderCompileDesc>(source);
+            if (ShaderCache* cache = Shaders::CompileCache())
+                return LoadMapped(cache->GetOrCompile(desc));
+            LoadedShader loaded{CompileShaderFromFile(desc), {}};
+            loaded.Metadata = MetadataFromByteCode(BytesOf(loaded.ByteCode));
+            return loaded;
+        }
+
+        std::string FormatErrors(const std::vector<ShaderLoadError>& errors)
+        {
+            std::string message =
+                fmt::format("Failed to load {} shader(s):", errors.size());
+            for (const ShaderLoadError& error : errors)
+            {
+                message += fmt::format("\n[{}] {}: {}", error.Index,
+                                       error.Path.string(), error.Message);
+            }
+            return message;
+        }
+    } // namespace
+
+    ShaderBatchError::ShaderBatchError(std::vector<ShaderLoadError> errors)
+        : std::runtime_error{FormatErrors(errors)}, m_errors{std::move(errors)}
+    {}
+
+    std::vector<Shader> LoadShaders(ID3D11Device& device3D,
+                                    gsl::span<const ShaderSource> sources)
+    {
+        const auto count = static_cast<std::size_t>(sources.size());
+        std::vector<LoadedShader> loadedShaders(count);
+        std::vector<std::optional<Shader>> shaders(count);
+
+        // 以下由 mutex 保护。
+        std::mutex mutex;
+        std::condition_variable readyCondition;
+        std::vector<std::size_t> ready;
+        std::vector<ShaderLoadError> errors;
+        std::size_t loaded = 0;
+
+        const auto addError = [&](std::size_t index, const char* message) {
+            errors.push_back(
+                ShaderLoadError{index, PathOf(sources[index]), message});
+        };
+
+        // 读取和编译在线程池中进行；D3D 对象在这个线程上创建，与还没有完成
+        // 的编译重叠。
+        auto loading = std::async(std::launch::async, [&] {
+            ParallelFor(count, 2, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    std::string message;
+                    try
+                    {
+                        loadedShaders[i] = LoadShader(sources[i]);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        message = e.what();
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock{mutex};
+                        if (message.empty())
+                            ready.push_back(i);
+                        else
+                            addError(i, message.c_str());
+                        ++loaded;
+                    }
+                    readyCondition.notify_one();
+                }
+            });
+        });
+
+        std::vector<std::size_t> creating;
+        for (bool done = false; !done;)
+        {
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                readyCondition.wait(
+                    lock, [&] { return !ready.empty() || loaded == count; });
+                creating.swap(ready);
+                done = loaded == count && creating.empty();
+            }
+            for (const std::size_t i : creating)
+            {
+                try
+                {
+                    LoadedShader& loadedShader = loadedShaders[i];
+                    shaders[i].emplace(device3D,
+                                       BytesOf(loadedShader.ByteCode),
+                                       std::move(loadedShader.Metadata));
+                }
+                catch (const std::exception& e)
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    addError(i, e.what());
+                }
+                // 不再需要的映射尽早释放。
+                loadedShaders[i].ByteCode = std::monostate{};
+            }
+            creating.clear();
+        }
+        loading.get();
+
+        if (!errors.empty())
+        {
+            std::sort(errors.begin(), errors.end(),
+                      [](const ShaderLoadError& lhs,
+                         const ShaderLoadError& rhs) {
+                          return lhs.Index < rhs.Index;
+                      });
+            throw ShaderBatchError{std::move(errors)};
+        }
+        std::vector<Shader> result;
+        result.reserve(count);
+        for (std::optional<Shader>& shader : shaders)
+        {
+            result.push_back(std::move(*shader));
+        }
+        return result;
+    }
+} // namespace dx
@@ -0,0 +1,196 @@
+#include "ShaderCache.hpp"
+#include "ShaderMetadata.hpp"
+#include "../EasyDx.Common/Hash.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <fmt/format.h>
+#include <gsl/gsl>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace dx
+{
+    ShaderCompiler::~ShaderCompiler() = default;
+
+    std::vector<std::byte>
+    ShaderCompiler::ExtractMetadata(gsl::span<const std::byte>)
+    {
+        return {};
+    }
+
+    ShaderCacheKey MakeShaderCacheKey(std::string_view compilerIdentity,
+                                      std::string_view preprocessedSource,
+                                      const ShaderCompileDesc& desc)
+    {
+        std::vector<const ShaderDefine*> defines;
+        defines.reserve(desc.Defines.size());
+        for (const ShaderDefine& define : desc.Defines)
+        {
+            defines.push_back(&define);
+        }
+        std::sort(defines.begin(), defines.end(),
+                  [](const ShaderDefine* lhs, const ShaderDefine* rhs) {
+                      return lhs->Name < rhs->Name;
+                  });
+
+        Fnv1aHasher hasher;
+        hasher.AppendField(compilerIdentity)
+            .AppendField(preprocessedSource)
+            .AppendField(desc.EntryPoint)
+            .AppendField(desc.Target)
+            .Append(desc.Flags)
+            .Append(static_cast<std::uint64_t>(defines.size()));
+        for (const ShaderDefine* define : defines)
+        {
+            hasher.AppendField(define->Name).AppendField(define->Value);
+        }
+        return hasher.Value();
+    }
+
+    namespace
+    {
+        unsigned long CurrentProcessId() noexcept
+        {
+#ifdef _WIN32
+            return static_cast<unsigned long>(::_getpid());
+#else
+            return static_cast<unsigned long>(::getpid());
+#endif
+        }
+
+        // 取出 #include "Foo.hlsli" 或者 #include <Foo.hlsli> 中的文件名。
+        std::optional<std::string_view> IncludedName(std::string_view line)
+        {
+            const auto skipSpaces = [&] {
+                while (!line.empty() && (line[0] == ' ' || line[0] == '\t'))
+                    line.remove_prefix(1);
+            };
+            skipSpaces();
+            if (line.empty() || line[0] != '#')
+                return std::nullopt;
+            line.remove_prefix(1);
+            skipSpaces();
+            constexpr std::string_view kInclude = "include";
+            if (line.substr(0, kInclude.size()) != kInclude)
+                return std::nullopt;
+            line.remove_prefix(kInclude.size());
+            skipSpaces();
+            if (line.empty() || (line[0] != '"' && line[0] != '<'))
+                return std::nullopt;
+            const char close = line[0] == '"' ? '"' : '>';
+            const auto end = line.find(close, 1);
+            if (end == std::string_view::npos)
+                return std::nullopt;
+            return line.substr(1, end - 1);
+        }
+    } // namespace
+
+    std::vector<fs::path> ShaderDependencies(const fs::path& sourcePath)
+    {
+        std::vector<fs::path> files{sourcePath.lexically_normal()};
+        for (std::size_t i = 0; i < files.size(); ++i)
+        {
+            std::ifstream file{files[i]};
+            std::string line;
+            while (std::getline(file, line))
+            {
+                const auto name = IncludedName(line);
+                if (!name)
+                    continue;
+                const fs::path included =
+                    (files[i].parent_path() / fs::path{std::string{*name}})
+                        .lexically_normal();
+                std::error_code ec;
+                if (fs::exists(included, ec) &&
+                    std::find(files.begin(), files.end(), included) ==
+                        files.end())
+                    files.push_back(included);
+            }
+        }
+        return files;
+    }
+
+    ShaderCache::ShaderCache(fs::path directory,
+                             std::unique_ptr<ShaderCompiler> compiler)
+        : m_directory{std::move(directory)}, m_compiler{std::move(compiler)}
+    {
+        Expects(m_compiler != nullptr);
+        m_compilerIdentity = m_compiler->Identity();
+        fs::create_directories(m_directory);
+    }
+
+    ShaderCache::~ShaderCache() = default;
+
+    fs::path ShaderCache::GetOrCompile(const ShaderCompileDesc& desc)
+    {
+        const std::string source = m_compiler->Preprocess(desc);
+        const fs::path path =
+            PathOf(MakeShaderCacheKey(m_compilerIdentity, source, desc));
+        std::error_code ec;
+        if (fs::file_size(path, ec) != 0 && !ec)
+        {
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return path;
+        }
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        const std::vector<std::byte> byteCode =
+            m_compiler->Compile(desc, source);
+        // .cso 最后写入，看到 .cso 时 .refl 一定已经存在。
+        const std::vector<std::byte> metadata =
+            m_compiler->ExtractMetadata(byteCode);
+        if (!metadata.empty())
+        {
+            Store(MetadataPathFor(path), metadata);
+        }
+        Store(path, byteCode);
+        return path;
+    }
+
+    fs::path ShaderCache::PathOf(ShaderCacheKey key) const
+    {
+        return m_directory / fmt::format("{:016x}.cso", key);
+    }
+
+    ShaderCacheStats ShaderCache::Stats() const noexcept
+    {
+        return ShaderCacheStats{m_hits.load(std::memory_order_relaxed),
+                                m_misses.load(std::memory_order_relaxed)};
+    }
+
+    void ShaderCache::Store(const fs::path& path,
+                            gsl::span<const std::byte> byteCode)
+    {
+        // 先写到临时文件再改名，其它线程或者进程不会读到写了一半的文件。
+        // 同一个 key 同时写入时内容相同，谁最后改名都可以。临时文件名带上
+        // 进程 id 与线程 id，不同进程中的线程 id 的 hash 可能相同。
+        fs::path temp = path;
+        temp += fmt::format(
+            ".{:x}.{:x}.tmp", CurrentProcessId(),
+            std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        {
+            std::ofstream file{temp, std::ios::binary | std::ios::trunc};
+            file.write(reinterpret_cast<const char*>(byteCode.data()),
+                       static_cast<std::streamsize>(byteCode.size()));
+            if (!file)
+                throw std::runtime_error{"Failed to write shader cache " +
+                                         temp.string()};
+        }
+        std::error_code ec;
+        fs::rename(temp, path, ec);
+        if (ec)
+        {
+            fs::remove(temp, ec);
+            // 另一个进程正在使用同名文件时改名会失败，它的内容与我们相同。
+            if (!fs::exists(path))
+                throw std::runtime_error{"Failed to write shader cache " +
+                                         path.string()};
+        }
+    }
+} // namespace dx
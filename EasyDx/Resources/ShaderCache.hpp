@@ -0,0 +1,105 @@
+#pragma once
+
+// 不依赖 pch 与 Windows 头文件，可以在其它平台上单独编译和测试。
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <gsl/span>
+
+namespace fs = std::filesystem;
+
+namespace dx
+{
+    struct ShaderDefine
+    {
+        std::string Name;
+        std::string Value;
+    };
+
+    struct ShaderCompileDesc
+    {
+        fs::path SourcePath;
+        std::string EntryPoint = "main";
+        // kShaderTargetStrings 中的一项，例如 "ps_5_0"。
+        std::string Target;
+        // D3DCOMPILE_* 标志。
+        std::uint32_t Flags = 0;
+        std::vector<ShaderDefine> Defines;
+    };
+
+    // 把 ShaderCache 与具体的编译器分开，测试中可以换成不依赖 D3D 的实现。
+    // 实现需要能在多个线程中同时调用。
+    class ShaderCompiler
+    {
+      public:
+        virtual ~ShaderCompiler();
+
+        // 编译器的名字与版本，会参与计算缓存的 key，升级编译器后旧的缓存
+        // 自然失效。
+        virtual std::string Identity() const = 0;
+        // 展开 #include 和宏之后的源码。
+        virtual std::string Preprocess(const ShaderCompileDesc& desc) = 0;
+        virtual std::vector<std::byte>
+        Compile(const ShaderCompileDesc& desc,
+                std::string_view preprocessedSource) = 0;
+        // 序列化的 ShaderMetadata，与字节码一起缓存；返回空表示没有。
+        virtual std::vector<std::byte>
+        ExtractMetadata(gsl::span<const std::byte> byteCode);
+    };
+
+    using ShaderCacheKey = std::uint64_t;
+
+    // 由编译器、预处理之后的源码、入口、target、编译标志以及宏计算。宏按
+    // 名字排序之后参与计算，与传入的顺序无关。
+    ShaderCacheKey MakeShaderCacheKey(std::string_view compilerIdentity,
+                                      std::string_view preprocessedSource,
+                                      const ShaderCompileDesc& desc);
+
+    // sourcePath 以及它直接或间接 #include 的文件，sourcePath 在第一个。
+    // 与 D3D_COMPILE_STANDARD_FILE_INCLUDE 一样，相对路径按包含它的文件所在
+    // 的目录解析；找不到的文件被忽略。只识别行首的 #include，不考虑条件
+    // 编译，结果可能多出几个文件，但不会漏掉。
+    std::vector<fs::path> ShaderDependencies(const fs::path& sourcePath);
+
+    struct ShaderCacheStats
+    {
+        std::uint32_t Hits = 0;
+        std::uint32_t Misses = 0;
+    };
+
+    // 以内容寻址的编译缓存：每个 key 对应目录下的一个 .cso 文件，以及
+    // 编译器提供的 .refl 文件（见 MetadataPathFor）。
+    //
+    // 每次查找仍然需要预处理，但省掉了编译，而编译才是启动时间的大头。
+    class ShaderCache
+    {
+      public:
+        ShaderCache(fs::path directory,
+                    std::unique_ptr<ShaderCompiler> compiler);
+        ShaderCache(const ShaderCache&) = delete;
+        ShaderCache& operator=(const ShaderCache&) = delete;
+        ~ShaderCache();
+
+        // 返回缓存文件的路径，缓存中没有时先编译并写入。可以在多个线程中
+        // 同时调用。
+        fs::path GetOrCompile(const ShaderCompileDesc& desc);
+
+        fs::path PathOf(ShaderCacheKey key) const;
+        const fs::path& Directory() const noexcept { return m_directory; }
+        ShaderCacheStats Stats() const noexcept;
+
+      private:
+        void Store(const fs::path& path, gsl::span<const std::byte> byteCode);
+
+        fs::path m_directory;
+        std::unique_ptr<ShaderCompiler> m_compiler;
+        std::string m_compilerIdentity;
+        std::atomic<std::uint32_t> m_hits{0};
+        std::atomic<std::uint32_t> m_misses{0};
+    };
+} // namespace dx
@@ -0,0 +1,244 @@
+#include "ShaderMetadata.hpp"
+#include "../EasyDx.Common/Hash.hpp"
+#include <array>
+#include <string_view>
+#include <type_traits>
+#include <gsl/gsl>
+
+namespace dx
+{
+    namespace
+    {
+        // 所有整数都按小端存储，字符串是 u16 长度加上内容。
+        constexpr std::array<char, 4> kMagic = {'D', 'X', 'R', 'F'};
+        constexpr std::uint32_t kVersion = 1;
+
+        // ShaderKind 的个数，以及 D3D11_COMMONSHADER_*_SLOT_COUNT。bind point
+        // 会直接用来确定 slot 数组的大小，超出范围的 blob 当作损坏处理。
+        constexpr std::uint32_t kKindCount = 6;
+        constexpr std::uint32_t kCbSlotCount = 14;
+        constexpr std::uint32_t kResourceSlotCount = 128;
+        constexpr std::uint32_t kSamplerSlotCount = 16;
+
+        void CheckBindPoint(std::uint32_t bindPoint, std::uint32_t slotCount,
+                            const std::string& name)
+        {
+            if (bindPoint >= slotCount)
+                throw ShaderMetadataError{"Bind point of " + name +
+                                          " is out of range"};
+        }
+
+        class BlobWriter
+        {
+          public:
+            template<typename T>
+            void Write(T value)
+            {
+                static_assert(std::is_integral_v<T>);
+                for (std::size_t i = 0; i < sizeof(T); ++i)
+                {
+                    m_bytes.push_back(static_cast<std::byte>(
+                        static_cast<std::make_unsigned_t<T>>(value) >>
+                        (i * 8)));
+                }
+            }
+
+            void WriteString(std::string_view str)
+            {
+                Write(gsl::narrow<std::uint16_t>(str.size()));
+                for (const char c : str)
+                {
+                    m_bytes.push_back(static_cast<std::byte>(c));
+                }
+            }
+
+            void WriteCount(std::size_t count)
+            {
+                Write(gsl::narrow<std::uint16_t>(count));
+            }
+
+            std::vector<std::byte> Take() { return std::move(m_bytes); }
+
+          private:
+            std::vector<std::byte> m_bytes;
+        };
+
+        class BlobReader
+        {
+          public:
+            explicit BlobReader(gsl::span<const std::byte> blob) : m_blob{blob}
+            {}
+
+            template<typename T>
+            T Read()
+            {
+                static_assert(std::is_integral_v<T>);
+                const auto bytes = Take(sizeof(T));
+                std::make_unsigned_t<T> value = 0;
+                for (std::size_t i = 0; i < sizeof(T); ++i)
+                {
+                    value |= static_cast<std::make_unsigned_t<T>>(
+                        static_cast<std::make_unsigned_t<T>>(bytes[i])
+                        << (i * 8));
+                }
+                return static_cast<T>(value);
+            }
+
+            std::string ReadString()
+            {
+                const auto size = Read<std::uint16_t>();
+                const auto bytes = Take(size);
+                return std::string(reinterpret_cast<const char*>(bytes.data()),
+                                   size);
+            }
+
+            std::size_t ReadCount() { return Read<std::uint16_t>(); }
+
+            bool AtEnd() const noexcept { return m_offset == BlobSize(); }
+
+          private:
+            std::size_t BlobSize() const noexcept
+            {
+                return static_cast<std::size_t>(m_blob.size());
+            }
+
+            gsl::span<const std::byte> Take(std::size_t size)
+            {
+                if (BlobSize() - m_offset < size)
+                    throw ShaderMetadataError{"Shader metadata is truncated"};
+                const auto bytes =
+                    m_blob.subspan(static_cast<std::ptrdiff_t>(m_offset),
+                                   static_cast<std::ptrdiff_t>(size));
+                m_offset += size;
+                return bytes;
+            }
+
+            gsl::span<const std::byte> m_blob;
+            std::size_t m_offset = 0;
+        };
+    } // namespace
+
+    bool ShaderMetadata::Matches(gsl::span<const std::byte> byteCode) const
+        noexcept
+    {
+        return ByteCodeSize == static_cast<std::size_t>(byteCode.size()) &&
+               ByteCodeHash == Fnv1a64(byteCode);
+    }
+
+    std::vector<std::byte>
+    SerializeShaderMetadata(const ShaderMetadata& metadata)
+    {
+        BlobWriter writer;
+        for (const char c : kMagic)
+        {
+            writer.Write(c);
+        }
+        writer.Write(kVersion);
+        writer.Write(metadata.Kind);
+        writer.Write(metadata.ByteCodeHash);
+        writer.Write(metadata.ByteCodeSize);
+
+        writer.WriteCount(metadata.ConstantBuffers.size());
+        for (const ShaderCbLayout& cb : metadata.ConstantBuffers)
+        {
+            writer.WriteString(cb.Name);
+            writer.Write(cb.BindPoint);
+            writer.Write(cb.Size);
+            writer.WriteCount(cb.Variables.size());
+            for (const ShaderCbVariable& variable : cb.Variables)
+            {
+                writer.WriteString(variable.Name);
+                writer.Write(variable.Offset);
+                writer.Write(variable.Size);
+            }
+        }
+
+        writer.WriteCount(metadata.Resources.size());
+        for (const ShaderResourceBinding& resource : metadata.Resources)
+        {
+            writer.WriteString(resource.Name);
+            writer.Write(static_cast<std::uint8_t>(resource.Type));
+            writer.Write(resource.BindPoint);
+        }
+
+        writer.WriteCount(metadata.Inputs.size());
+        for (const ShaderInputParameter& input : metadata.Inputs)
+        {
+            writer.WriteString(input.SemanticName);
+            writer.Write(input.SemanticIndex);
+        }
+        return writer.Take();
+    }
+
+    ShaderMetadata ParseShaderMetadata(gsl::span<const std::byte> blob)
+    {
+        BlobReader reader{blob};
+        for (const char c : kMagic)
+        {
+            if (reader.Read<char>() != c)
+                throw ShaderMetadataError{"Not a shader metadata blob"};
+        }
+        if (reader.Read<std::uint32_t>() != kVersion)
+            throw ShaderMetadataError{"Unsupported shader metadata version"};
+
+        ShaderMetadata metadata;
+        metadata.Kind = reader.Read<std::uint32_t>();
+        if (metadata.Kind >= kKindCount)
+            throw ShaderMetadataError{"Unknown shader kind"};
+        metadata.ByteCodeHash = reader.Read<std::uint64_t>();
+        metadata.ByteCodeSize = reader.Read<std::uint32_t>();
+
+        metadata.ConstantBuffers.resize(reader.ReadCount());
+        for (ShaderCbLayout& cb : metadata.ConstantBuffers)
+        {
+            cb.Name = reader.ReadString();
+            cb.BindPoint = reader.Read<std::uint32_t>();
+            CheckBindPoint(cb.BindPoint, kCbSlotCount, cb.Name);
+            cb.Size = reader.Read<std::uint32_t>();
+            cb.Variables.resize(reader.ReadCount());
+            for (ShaderCbVariable& variable : cb.Variables)
+            {
+                variable.Name = reader.ReadString();
+                variable.Offset = reader.Read<std::uint32_t>();
+                variable.Size = reader.Read<std::uint32_t>();
+                if (variable.Offset > cb.Size ||
+                    variable.Size > cb.Size - variable.Offset)
+                    throw ShaderMetadataError{"Variable " + variable.Name +
+                                              " is outside of its cbuffer"};
+            }
+        }
+
+        metadata.Resources.resize(reader.ReadCount());
+        for (ShaderResourceBinding& resource : metadata.Resources)
+        {
+            resource.Name = reader.ReadString();
+            const auto type = reader.Read<std::uint8_t>();
+            if (type > static_cast<std::uint8_t>(ShaderResourceType::kSampler))
+                throw ShaderMetadataError{"Unknown shader resource type"};
+            resource.Type = static_cast<ShaderResourceType>(type);
+            resource.BindPoint = reader.Read<std::uint32_t>();
+            CheckBindPoint(resource.BindPoint,
+                           resource.Type == ShaderResourceType::kSampler
+                               ? kSamplerSlotCount
+                               : kResourceSlotCount,
+                           resource.Name);
+        }
+
+        metadata.Inputs.resize(reader.ReadCount());
+        for (ShaderInputParameter& input : metadata.Inputs)
+        {
+            input.SemanticName = reader.ReadString();
+            input.SemanticIndex = reader.Read<std::uint32_t>();
+        }
+
+        if (!reader.AtEnd())
+            throw ShaderMetadataError{"Trailing bytes in shader metadata"};
+        return metadata;
+    }
+
+    fs::path MetadataPathFor(const fs::path& csoPath)
+    {
+        fs::path path = csoPath;
+        return path.replace_extension(".refl");
+    }
+} // namespace dx
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gsl/span>
+
+namespace fs = std::filesystem;
+
+namespace dx
+{
+    struct ShaderCbVariable
+    {
+        std::string Name;
+        std::uint32_t Offset;
+        std::uint32_t Size;
+    };
+
+    struct ShaderCbLayout
+    {
+        std::string Name;
+        std::uint32_t BindPoint;
+        std::uint32_t Size;
+        std::vector<ShaderCbVariable> Variables;
+    };
+
+    enum class ShaderResourceType : std::uint8_t
+    {
+        kShaderResourceView,
+        kSampler
+    };
+
+    struct ShaderResourceBinding
+    {
+        std::string Name;
+        ShaderResourceType Type;
+        std::uint32_t BindPoint;
+    };
+
+    struct ShaderInputParameter
+    {
+        std::string SemanticName;
+        std::uint32_t SemanticIndex;
+    };
+
+    // 运行时需要的反射信息：cbuffer 布局、绑定的资源以及输入的语义。可以
+    // 离线从 D3DReflect 中提取出来，序列化之后放在 .cso 旁边（见
+    // MetadataPathFor），启动时直接读取，不再调用 D3DReflect。
+    struct ShaderMetadata
+    {
+        // ShaderKind 的值。
+        std::uint32_t Kind = 0;
+        // 对应字节码的 Fnv1a64 与长度，用来发现过期的 .refl 文件。
+        std::uint64_t ByteCodeHash = 0;
+        std::uint32_t ByteCodeSize = 0;
+        std::vector<ShaderCbLayout> ConstantBuffers;
+        std::vector<ShaderResourceBinding> Resources;
+        std::vector<ShaderInputParameter> Inputs;
+
+        bool Matches(gsl::span<const std::byte> byteCode) const noexcept;
+    };
+
+    // 格式错误、版本不对、数据被截断，或者 Kind、bind point 超出范围。
+    class ShaderMetadataError : public std::runtime_error
+    {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+
+    std::vector<std::byte>
+    SerializeShaderMetadata(const ShaderMetadata& metadata);
+    ShaderMetadata ParseShaderMetadata(gsl::span<const std::byte> blob);
+
+    // Foo.cso 对应 Foo.refl。
+    fs::path MetadataPathFor(const fs::path& csoPath);
+} // namespace dx
@@ -0,0 +1,85 @@
+#include "../pch.hpp"
+#include "ShaderPermutation.hpp"
+
+namespace dx
+{
+    std::vector<ShaderDefine> DefinesFromFeatures(ShaderFeature features)
+    {
+        std::vector<ShaderDefine> defines;
+        for (std::size_t i = 0; i < kShaderFeatureCount; ++i)
+        {
+            const auto feature = static_cast<ShaderFeature>(1u << i);
+            if ((features & feature) != ShaderFeature::kNone)
+            {
+                defines.push_back(
+                    ShaderDefine{kShaderFeatureDefines[i], std::string{"1"}});
+            }
+        }
+        return defines;
+    }
+
+    ShaderPermutationSet::ShaderPermutationSet(ID3D11Device& device3D,
+                                               ShaderCompileDesc baseDesc,
+                                               ShaderFeature supportedFeatures)
+        : m_device3D{&device3D}, m_baseDesc{std::move(baseDesc)},
+          m_supported{supportedFeatures}
+    {
+        Expects(static_cast<std::size_t>(m_supported) < m_variants.size());
+    }
+
+    const Shader& ShaderPermutationSet::Get(ShaderFeature features)
+    {
+        std::optional<Shader>& variant = m_variants[IndexOf(features)];
+        if (!variant)
+        {
+            variant.emplace(Shader::FromSourceFile(*m_device3D,
+                                                   DescOf(features)));
+        }
+        return *variant;
+    }
+
+    void ShaderPermutationSet::Precompile(
+        gsl::span<const ShaderFeature> variants)
+    {
+        std::vector<std::size_t> indices;
+        std::vector<ShaderSource> sources;
+        for (const ShaderFeature features : variants)
+        {
+            const std::size_t index = IndexOf(features);
+            if (m_variants[index] ||
+                std::find(indices.begin(), indices.end(), index) !=
+                    indices.end())
+                continue;
+            indices.push_back(index);
+            sources.push_back(DescOf(features));
+        }
+        std::vector<Shader> shaders = LoadShaders(*m_device3D, sources);
+        for (std::size_t i = 0; i < indices.size(); ++i)
+        {
+            m_variants[indices[i]].emplace(std::move(shaders[i]));
+        }
+    }
+
+    bool ShaderPermutationSet::IsLoaded(ShaderFeature features) const
+    {
+        return m_variants[IndexOf(features)].has_value();
+    }
+
+    std::vector<ShaderFeature> ShaderPermutationSet::LoadedVariants() const
+    {
+        std::vector<ShaderFeature> variants;
+        for (std::size_t i = 0; i < m_variants.size(); ++i)
+        {
+            if (m_variants[i])
+                variants.push_back(static_cast<ShaderFeature>(i));
+        }
+        return variants;
+    }
+
+    ShaderCompileDesc ShaderPermutationSet::DescOf(ShaderFeature features) const
+    {
+        ShaderCompileDesc desc = m_baseDesc;
+        Append(desc.Defines, DefinesFromFeatures(features & m_supported));
+        return desc;
+    }
+} // namespace dx
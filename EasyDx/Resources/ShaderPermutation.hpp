@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Shaders.hpp"
+
+namespace dx
+{
+    // 同一份源码通过宏打开的功能。
+    enum class ShaderFeature : std::uint32_t
+    {
+        kNone = 0,
+        kShadows = 1,
+        kNormalMap = 1 << 1,
+        kInstancing = 1 << 2,
+        kAlphaTest = 1 << 3,
+        kSkinning = 1 << 4
+    };
+
+    ENABLE_FLAGS(ShaderFeature)
+
+    inline constexpr std::size_t kShaderFeatureCount = 5;
+
+    // 按位的顺序排列，每个 feature 打开时定义为 1。
+    inline constexpr auto kShaderFeatureDefines =
+        std::array{"DX_SHADOWS", "DX_NORMAL_MAP", "DX_INSTANCING",
+                   "DX_ALPHA_TEST", "DX_SKINNING"};
+
+    std::vector<ShaderDefine> DefinesFromFeatures(ShaderFeature features);
+
+    // 一份源码的所有变体，按 feature 组合直接索引。
+    //
+    // 变体在第一次 Get 时编译（有编译缓存时先查缓存），也可以用 Precompile
+    // 提前并行编译。源码不支持的 feature 在查找时被忽略，因此不会为它们
+    // 编译出重复的变体。不是线程安全的。
+    class ShaderPermutationSet
+    {
+      public:
+        ShaderPermutationSet(ID3D11Device& device3D, ShaderCompileDesc baseDesc,
+                             ShaderFeature supportedFeatures);
+
+        const Shader& Get(ShaderFeature features);
+        void Precompile(gsl::span<const ShaderFeature> variants);
+
+        bool IsLoaded(ShaderFeature features) const;
+        ShaderFeature SupportedFeatures() const noexcept { return m_supported; }
+        // 加载过的变体（已经去掉不支持的 feature），打包时只需要带上这些。
+        std::vector<ShaderFeature> LoadedVariants() const;
+        ShaderCompileDesc DescOf(ShaderFeature features) const;
+
+      private:
+        std::size_t IndexOf(ShaderFeature features) const noexcept
+        {
+            return static_cast<std::size_t>(features & m_supported);
+        }
+
+        ID3D11Device* m_device3D;
+        ShaderCompileDesc m_baseDesc;
+        ShaderFeature m_supported;
+        std::array<std::optional<Shader>, std::size_t{1} << kShaderFeatureCount>
+            m_variants;
+    };
+} // namespace dx
@@ -2,14 +2,127 @@
 #include <gsl/gsl_assert>
 #include <d3d11.h>
 #include <D3Dcompiler.h>
+#include <atomic>
+#include <fstream>
+#include <iterator>
 #include "Shaders.hpp"
 #include "Buffers.hpp"
 #include "../Material.hpp"
 #include "../GlobalShaderContext.hpp"
+#include "../LightBvh.hpp"
 #include "../ShaderCbKeyDef.hpp"
 
 namespace dx
 {
+    namespace
+    {
+        CbUploadStats g_cbUploadStats;
+        std::atomic<std::uint64_t> g_nextShaderId{1};
+        // 从 1 开始，0 表示 slot 不对应任何 ShaderInputs。
+        std::atomic<std::uint64_t> g_nextInputsLayoutVersion{1};
+        // 从 1 开始，0 表示不缓存。
+        std::atomic<std::uint64_t> g_nextCbKey{1};
+
+        template<typename T>
+        void CollectSlots(const BoundedResources<T>& inputs,
+                          const BoundedResources<T>& shader,
+                          std::vector<ShaderBindingTable::Slot<T>>& slots)
+        {
+            for (const BoundedResourcesInfo& info : inputs.Infos)
+            {
+                if (const BoundedResourcesInfo* shaderInfo =
+                        shader.FindInfo(info.Name))
+                {
+                    slots.push_back(ShaderBindingTable::Slot<T>{
+                        shaderInfo->Slot, inputs.Resources[info.Index].Get()});
+                }
+            }
+        }
+
+        std::vector<D3D_SHADER_MACRO>
+        MacrosFromDefines(const std::vector<ShaderDefine>& defines)
+        {
+            std::vector<D3D_SHADER_MACRO> macros;
+            macros.reserve(defines.size() + 1);
+            for (const ShaderDefine& define : defines)
+            {
+                macros.push_back(D3D_SHADER_MACRO{define.Name.c_str(),
+                                                  define.Value.c_str()});
+            }
+            macros.push_back(D3D_SHADER_MACRO{nullptr, nullptr});
+            return macros;
+        }
+
+        void TryCompile(long hr, const fs::path& path, ID3DBlob* errorBlob)
+        {
+            if (SUCCEEDED(hr))
+                return;
+            if (!errorBlob)
+                ThrowHRException(hr);
+            throw std::runtime_error{
+                "Compile error in shader " + path.string() + ", " +
+                static_cast<const char*>(errorBlob->GetBufferPointer())};
+        }
+
+        // .refl 损坏或者与字节码不符时返回 std::nullopt，调用者退回到
+        // D3DReflect。
+        std::optional<ShaderMetadata>
+        TryParseShaderMetadata(gsl::span<const std::byte> blob,
+                               gsl::span<const std::byte> byteCode)
+        {
+            try
+            {
+                ShaderMetadata metadata = ParseShaderMetadata(blob);
+                if (metadata.Matches(byteCode))
+                    return metadata;
+            }
+            catch (const ShaderMetadataError&)
+            {
+                // 当作没有 .refl。
+            }
+            return std::nullopt;
+        }
+
+        void WriteShaderMetadata(const fs::path& csoPath,
+                                 const ShaderMetadata& metadata)
+        {
+            const std::vector<std::byte> blob =
+                SerializeShaderMetadata(metadata);
+            std::ofstream file{MetadataPathFor(csoPath),
+                               std::ios::binary | std::ios::trunc};
+            file.write(reinterpret_cast<const char*>(blob.data()),
+                       static_cast<std::streamsize>(blob.size()));
+            if (!file)
+                throw std::runtime_error{
+                    "Failed to write shader metadata for " +
+                    csoPath.string()};
+        }
+
+        template<typename T>
+        void ResizeSlots(const BoundedResources<T>& resources,
+                         std::vector<T*>& slots)
+        {
+            for (const BoundedResourcesInfo& info : resources.Infos)
+            {
+                if (slots.size() <= info.Slot)
+                {
+                    slots.resize(info.Slot + 1);
+                }
+            }
+        }
+
+        void EvictIdleKeyedCbs(ShaderCb& cb, std::uint64_t frame)
+        {
+            for (auto it = cb.KeyedGpuCbs.begin(); it != cb.KeyedGpuCbs.end();)
+            {
+                if (it->second.LastUsedFrame + kKeyedCbIdleFrames < frame)
+                    it = cb.KeyedGpuCbs.erase(it);
+                else
+                    ++it;
+            }
+        }
+    } // namespace
+
 #define CREATE_SHADER_DEFINE(shaderName)                                  \
     wrl::ComPtr<ID3D11##shaderName> Create##shaderName(                   \
         ::ID3D11Device& device, gsl::span<const std::byte> byteCode)      \
@@ -52,30 +165,102 @@ namespace dx
         }
     }
 
-    wrl::ComPtr<ID3D10Blob> CompileShaderFromFile(const wchar_t* fileName,
-                                                  const char* entryPoint,
-                                                  const char* shaderModel)
+    std::uint32_t DefaultShaderCompileFlags()
     {
         std::uint32_t compileFlags = D3DCOMPILE_ENABLE_STRICTNESS;
 #ifdef _DEBUG
         compileFlags |= D3DCOMPILE_DEBUG;
         compileFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
+        return compileFlags;
+    }
+
+    wrl::ComPtr<ID3D10Blob> CompileShaderFromFile(const wchar_t* fileName,
+                                                  const char* entryPoint,
+                                                  const char* shaderModel)
+    {
+        return CompileShaderFromFile(ShaderCompileDesc{
+            fileName, entryPoint, shaderModel, DefaultShaderCompileFlags()});
+    }
+
+    wrl::ComPtr<ID3D10Blob>
+    CompileShaderFromFile(const ShaderCompileDesc& desc)
+    {
+        const std::vector<D3D_SHADER_MACRO> macros =
+            MacrosFromDefines(desc.Defines);
         wrl::ComPtr<ID3DBlob> shaderBlob;
         wrl::ComPtr<ID3DBlob> errorBlob;
         const auto hr = D3DCompileFromFile(
-            fileName, nullptr, nullptr, entryPoint, shaderModel, compileFlags,
-            {}, shaderBlob.GetAddressOf(), errorBlob.GetAddressOf());
-        if (FAILED(hr))
-        {
-            const auto errorMessage =
-                "Compile error in shader " + ws2s(fileName) + ", " +
-                static_cast<const char*>(errorBlob->GetBufferPointer());
-            throw std::runtime_error{errorMessage};
-        }
+            desc.SourcePath.c_str(), macros.data(),
+            D3D_COMPILE_STANDARD_FILE_INCLUDE, desc.EntryPoint.c_str(),
+            desc.Target.c_str(), desc.Flags, {}, shaderBlob.GetAddressOf(),
+            errorBlob.GetAddressOf());
+        TryCompile(hr, desc.SourcePath, errorBlob.Get());
         return shaderBlob;
     }
 
+    std::string D3DShaderCompiler::Identity() const
+    {
+        return fmt::format("d3dcompiler_{}", D3D_COMPILER_VERSION);
+    }
+
+    std::string D3DShaderCompiler::Preprocess(const ShaderCompileDesc& desc)
+    {
+        std::ifstream file{desc.SourcePath, std::ios::binary};
+        if (!file)
+            throw std::runtime_error{"Cannot open shader " +
+                                     desc.SourcePath.string()};
+        const std::string source{std::istreambuf_iterator<char>{file},
+                                 std::istreambuf_iterator<char>{}};
+        const std::vector<D3D_SHADER_MACRO> macros =
+            MacrosFromDefines(desc.Defines);
+        // 相对路径的 #include 以 sourceName 所在的目录为准。
+        const std::string sourceName = desc.SourcePath.string();
+        wrl::ComPtr<ID3DBlob> preprocessed;
+        wrl::ComPtr<ID3DBlob> errorBlob;
+        const auto hr = D3DPreprocess(
+            source.data(), source.size(), sourceName.c_str(), macros.data(),
+            D3D_COMPILE_STANDARD_FILE_INCLUDE, preprocessed.GetAddressOf(),
+            errorBlob.GetAddressOf());
+        TryCompile(hr, desc.SourcePath, errorBlob.Get());
+        return std::string{
+            static_cast<const char*>(preprocessed->GetBufferPointer()),
+            preprocessed->GetBufferSize()};
+    }
+
+    std::vector<std::byte>
+    D3DShaderCompiler::Compile(const ShaderCompileDesc& desc,
+                               std::string_view preprocessedSource)
+    {
+        const std::string sourceName = desc.SourcePath.string();
+        wrl::ComPtr<ID3DBlob> shaderBlob;
+        wrl::ComPtr<ID3DBlob> errorBlob;
+        const auto hr = D3DCompile(
+            preprocessedSource.data(), preprocessedSource.size(),
+            sourceName.c_str(), nullptr, nullptr, desc.EntryPoint.c_str(),
+            desc.Target.c_str(), desc.Flags, 0, shaderBlob.GetAddressOf(),
+            errorBlob.GetAddressOf());
+        TryCompile(hr, desc.SourcePath, errorBlob.Get());
+        const gsl::span<const std::byte> byteCode = AsSpan(Ref(shaderBlob));
+        return std::vector<std::byte>(byteCode.begin(), byteCode.end());
+    }
+
+    std::vector<std::byte>
+    D3DShaderCompiler::ExtractMetadata(gsl::span<const std::byte> byteCode)
+    {
+        return SerializeShaderMetadata(MetadataFromByteCode(byteCode));
+    }
+
+    UniqueCbKey::UniqueCbKey() noexcept
+        : m_value{g_nextCbKey.fetch_add(1, std::memory_order_relaxed)}
+    {}
+
+    std::uint64_t ShaderInputs::NextLayoutVersion() noexcept
+    {
+        return g_nextInputsLayoutVersion.fetch_add(1,
+                                                   std::memory_order_relaxed);
+    }
+
     void ShaderInputs::SetBytes(std::string_view fieldName,
                                 gsl::span<const std::byte> bytes)
     {
@@ -89,6 +274,7 @@ namespace dx
                        wrl::ComPtr<ID3D11ShaderResourceView> resourceView)
     {
         m_resourceViews.Bind(name, std::move(resourceView));
+        m_layoutVersion = NextLayoutVersion();
         return *this;
     }
 
@@ -96,6 +282,7 @@ namespace dx
                                      wrl::ComPtr<ID3D11SamplerState> sampler)
     {
         m_samplers.Bind(name, std::move(sampler));
+        m_layoutVersion = NextLayoutVersion();
         return *this;
     }
 
@@ -149,6 +336,7 @@ namespace dx
         {
             const std::size_t newStart = m_bytes.size();
             m_bytes.resize(newStart + size);
+            m_layoutVersion = NextLayoutVersion();
             return m_fields.emplace_back(
                 CbFieldInfo{std::string{name}, gsl::narrow<std::uint32_t>(size),
                             gsl::narrow<std::uint32_t>(newStart)});
@@ -177,6 +365,109 @@ namespace dx
         return result;
     }
 
+    ShaderMetadata ExtractShaderMetadata(ID3D11ShaderReflection& reflection,
+                                         gsl::span<const std::byte> byteCode)
+    {
+        ShaderMetadata metadata;
+        metadata.Kind =
+            static_cast<std::uint32_t>(KindFromReflection(reflection));
+        metadata.ByteCodeHash = Fnv1a64(byteCode);
+        metadata.ByteCodeSize = gsl::narrow<std::uint32_t>(byteCode.size());
+
+        D3D11_SHADER_DESC shaderDesc;
+        TryHR(reflection.GetDesc(&shaderDesc));
+        D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+        for (std::uint32_t i = 0; i < shaderDesc.BoundResources; ++i)
+        {
+            TryHR(reflection.GetResourceBindingDesc(i, &bindDesc));
+            switch (bindDesc.Type)
+            {
+                case D3D_SIT_SAMPLER:
+                    metadata.Resources.push_back(ShaderResourceBinding{
+                        bindDesc.Name, ShaderResourceType::kSampler,
+                        bindDesc.BindPoint});
+                    break;
+                case D3D_SIT_TEXTURE:
+                case D3D_SIT_TBUFFER:
+                case D3D_SIT_STRUCTURED:
+                case D3D_SIT_BYTEADDRESS:
+                    metadata.Resources.push_back(ShaderResourceBinding{
+                        bindDesc.Name, ShaderResourceType::kShaderResourceView,
+                        bindDesc.BindPoint});
+                    break;
+                case D3D_SIT_CBUFFER:
+                {
+                    ID3D11ShaderReflectionConstantBuffer* const cbReflection =
+                        reflection.GetConstantBufferByName(bindDesc.Name);
+                    D3D11_SHADER_BUFFER_DESC bufferDesc;
+                    TryHR(cbReflection->GetDesc(&bufferDesc));
+                    ShaderCbLayout& layout =
+                        metadata.ConstantBuffers.emplace_back(
+                            ShaderCbLayout{bindDesc.Name, bindDesc.BindPoint,
+                                           bufferDesc.Size});
+                    D3D11_SHADER_VARIABLE_DESC desc;
+                    for (std::uint32_t j = 0; j < bufferDesc.Variables; ++j)
+                    {
+                        TryHR(cbReflection->GetVariableByIndex(j)->GetDesc(
+                            &desc));
+                        layout.Variables.push_back(ShaderCbVariable{
+                            desc.Name, desc.StartOffset, desc.Size});
+                    }
+                    break;
+                }
+                default:
+                    assert(false);
+                    break;
+            }
+        }
+
+        D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+        for (std::uint32_t i = 0; i < shaderDesc.InputParameters; ++i)
+        {
+            TryHR(reflection.GetInputParameterDesc(i, &paramDesc));
+            metadata.Inputs.push_back(ShaderInputParameter{
+                paramDesc.SemanticName, paramDesc.SemanticIndex});
+        }
+        return metadata;
+    }
+
+    ShaderMetadata MetadataFromByteCode(gsl::span<const std::byte> byteCode)
+    {
+        return ExtractShaderMetadata(Ref(ReflectShader(byteCode)), byteCode);
+    }
+
+    ShaderMetadata LoadShaderMetadata(const fs::path& csoPath,
+                                      gsl::span<const std::byte> byteCode)
+    {
+        const fs::path metadataPath = MetadataPathFor(csoPath);
+        std::error_code ec;
+        if (fs::exists(metadataPath, ec))
+        {
+            if (auto metadata = TryParseShaderMetadata(
+                    MappedFile{metadataPath, kShaderFileHints}.Bytes(),
+                    byteCode))
+                return std::move(*metadata);
+        }
+        ShaderMetadata metadata = MetadataFromByteCode(byteCode);
+        // 第一次加载时顺便生成 .refl，之后启动时就不再调用 D3DReflect。
+        // 目录不可写时只是每次都反射。
+        try
+        {
+            WriteShaderMetadata(csoPath, metadata);
+        }
+        catch (const std::runtime_error&)
+        {
+            // 不影响这次加载。
+        }
+        return metadata;
+    }
+
+    void ExportShaderMetadata(const fs::path& csoPath)
+    {
+        const MappedFile cso{csoPath, kShaderFileHints};
+        WriteShaderMetadata(csoPath, MetadataFromByteCode(cso.Bytes()));
+    }
+
     void SetupShader(ID3D11DeviceContext& context3D, const Shader& shader)
     {
         shader.Setup(context3D);
@@ -191,63 +482,274 @@ namespace dx
             .Build();
     }
 
+    Shader Shader::FromSourceFile(ID3D11Device& device3D,
+                                  const ShaderCompileDesc& desc)
+    {
+        if (ShaderCache* cache = Shaders::CompileCache())
+        {
+            return FromCompiledCso(device3D, cache->GetOrCompile(desc));
+        }
+        return Shader{device3D, CompileShaderFromFile(desc)};
+    }
+
     Shader Shader::FromCompiledCso(ID3D11Device& device3D,
                                    const fs::path& csoPath)
     {
-        const auto mappedCso = MemoryMappedCso{csoPath};
-        return Shader{device3D, mappedCso.Bytes()};
+        const auto mappedCso = MappedFile{csoPath, kShaderFileHints};
+        return Shader{device3D, mappedCso.Bytes(),
+                      LoadShaderMetadata(csoPath, mappedCso.Bytes())};
+    }
+
+    Shader Shader::FromArchive(ID3D11Device& device3D,
+                               const AssetArchive& archive,
+                               std::string_view name)
+    {
+        const ArchiveBytes cso = archive.Read(name);
+        const std::string metadataName = ArchiveName(MetadataPathFor(name));
+        if (archive.Contains(metadataName))
+        {
+            if (auto metadata = TryParseShaderMetadata(
+                    archive.Read(metadataName).Bytes(), cso.Bytes()))
+                return Shader{device3D, cso.Bytes(), std::move(*metadata)};
+        }
+        return Shader{device3D, cso.Bytes()};
+    }
+
+    AssetWatcher::WatchId WatchShader(AssetWatcher& watcher,
+                                      ID3D11Device& device3D,
+                                      ShaderCompileDesc desc,
+                                      std::function<void(Shader)> replace)
+    {
+        std::vector<fs::path> dependencies =
+            ShaderDependencies(desc.SourcePath);
+        // ID3D11Device 是线程安全的，可以在 AssetWatcher 的线程中创建。
+        return watcher.Watch(
+            std::move(dependencies),
+            [&device3D, desc = std::move(desc), replace = std::move(replace)] {
+                std::vector<fs::path> newDependencies =
+                    ShaderDependencies(desc.SourcePath);
+                auto shader = std::make_shared<Shader>(
+                    Shader::FromSourceFile(device3D, desc));
+                return ReloadedAsset{
+                    [shader, replace] { replace(std::move(*shader)); },
+                    std::move(newDependencies)};
+            });
     }
 
     // ShaderKind Shader::Kind() const { return m_sharedData->Kind; }
 
     void Shader::Apply(const ShaderInputs& inputs) const
     {
-        for (const CbFieldInfo& fieldInfo : inputs.m_fields)
+        const ShaderBindingTable& table = FindOrBuildBindingTable(inputs);
+        WriteFields(table, inputs);
+        WriteSlots(table);
+        m_sharedData->SlotInputs = {};
+    }
+
+    void Shader::ApplyFields(const ShaderInputs& inputs) const
+    {
+        WriteFields(FindOrBuildBindingTable(inputs), inputs);
+    }
+
+    void Shader::ApplySlots(const ShaderInputs& inputs,
+                            const ShaderInputs* additional) const
+    {
+        SharedShaderData& data = *m_sharedData;
+        const std::array<std::uint64_t, 2> slotInputs = {
+            inputs.m_layoutVersion,
+            additional ? additional->m_layoutVersion : 0};
+        if (data.SlotInputs == slotInputs)
+            return;
+        ResetSlots();
+        WriteSlots(FindOrBuildBindingTable(inputs));
+        if (additional)
+        {
+            WriteSlots(FindOrBuildBindingTable(*additional));
+        }
+        data.SlotInputs = slotInputs;
+    }
+
+    void Shader::WriteFields(const ShaderBindingTable& table,
+                             const ShaderInputs& inputs) const
+    {
+        const gsl::span<const std::byte> bytes = inputs.Bytes();
+        for (const ShaderBindingTable::Field& field : table.Fields)
         {
-            SetBytes(fieldInfo.Name, inputs.BytesFromField(fieldInfo));
+            WriteField(*field.Target, bytes.subspan(field.Start, field.Size),
+                       false);
         }
+    }
 
-        // FIXME!!!
-        m_sharedData->ResourceViews = inputs.m_resourceViews;
-        m_sharedData->Samplers = inputs.m_samplers;
+    void Shader::WriteSlots(const ShaderBindingTable& table) const
+    {
+        SharedShaderData& data = *m_sharedData;
+        for (const auto& [slot, view] : table.Views)
+        {
+            data.SlotViews[slot] = view;
+        }
+        for (const auto& [slot, sampler] : table.Samplers)
+        {
+            data.SlotSamplers[slot] = sampler;
+        }
+    }
+
+    void Shader::ResetSlots() const
+    {
+        SharedShaderData& data = *m_sharedData;
+        std::fill(data.SlotViews.begin(), data.SlotViews.end(), nullptr);
+        std::fill(data.SlotSamplers.begin(), data.SlotSamplers.end(), nullptr);
+        for (const BoundedResourcesInfo& info : data.ResourceViews.Infos)
+        {
+            data.SlotViews[info.Slot] =
+                data.ResourceViews.Resources[info.Index].Get();
+        }
+        for (const BoundedResourcesInfo& info : data.Samplers.Infos)
+        {
+            data.SlotSamplers[info.Slot] =
+                data.Samplers.Resources[info.Index].Get();
+        }
+    }
+
+    const ShaderBindingTable&
+    Shader::FindOrBuildBindingTable(const ShaderInputs& inputs) const
+    {
+        const SharedShaderData& data = *m_sharedData;
+        std::vector<ShaderBindingTable>& tables = inputs.m_bindingTables;
+        const auto it = std::find_if(
+            tables.begin(), tables.end(), [&](const ShaderBindingTable& table) {
+                return table.ShaderId == data.Id;
+            });
+        ShaderBindingTable& table =
+            it != tables.end() ? *it : tables.emplace_back();
+        if (it != tables.end() &&
+            table.InputsLayoutVersion == inputs.m_layoutVersion)
+            return table;
+
+        table.ShaderId = data.Id;
+        table.InputsLayoutVersion = inputs.m_layoutVersion;
+        table.Fields.clear();
+        table.Views.clear();
+        table.Samplers.clear();
+        for (const CbFieldInfo& fieldInfo : inputs.m_fields)
+        {
+            // TODO: 异构查找
+            if (const auto field = data.BytesMap.find(fieldInfo.Name);
+                field != data.BytesMap.end())
+            {
+                table.Fields.push_back(ShaderBindingTable::Field{
+                    fieldInfo.Start, fieldInfo.Size, &field->second});
+            }
+        }
+        CollectSlots(inputs.m_resourceViews, data.ResourceViews, table.Views);
+        CollectSlots(inputs.m_samplers, data.Samplers, table.Samplers);
+        return table;
     }
 
     void Shader::Apply(const GlobalShaderContext& shaderContext) const
     {
-        shaderContext.Apply(m_sharedData->BytesMap);
+        SharedShaderData& data = *m_sharedData;
+        const auto write = [&](std::string_view name,
+                               gsl::span<const std::byte> bytes) {
+            WriteField(name, bytes, true);
+        };
+        if (shaderContext.FrameEpoch == 0 ||
+            shaderContext.FrameEpoch != data.AppliedFrameEpoch)
+        {
+            shaderContext.ForEachFrameField(write);
+            data.AppliedFrameEpoch = shaderContext.FrameEpoch;
+            if (shaderContext.FrameEpoch != 0)
+                ++data.AppliedFrames;
+        }
+        if (shaderContext.ViewEpoch == 0 ||
+            shaderContext.ViewEpoch != data.AppliedViewEpoch)
+        {
+            shaderContext.ForEachViewField(write);
+            data.AppliedViewEpoch = shaderContext.ViewEpoch;
+        }
+    }
+
+    void Shader::SetCbKey(CbFrequency frequency, std::uint64_t key) const
+    {
+        Expects(frequency == CbFrequency::kPerMaterial ||
+                frequency == CbFrequency::kPerObject);
+        m_sharedData->CbKeys[static_cast<std::size_t>(frequency)] = key;
     }
 
     void Shader::Flush(ID3D11DeviceContext& context3D) const
     {
-        if (m_sharedData->GpuCb)
+        SharedShaderData& data = *m_sharedData;
+        // 每帧检查一次，释放所有者可能已经销毁的 keyed buffer。
+        const bool evict = data.EvictedFrames != data.AppliedFrames;
+        data.EvictedFrames = data.AppliedFrames;
+        for (ShaderCb& cb : data.Cbs)
         {
-            UpdateWithDiscard(
-                context3D, dx::Ref(m_sharedData->GpuCb),
-                gsl::span<const std::byte>(m_sharedData->CpuBuffer));
+            if (evict)
+                EvictIdleKeyedCbs(cb, data.AppliedFrames);
+            const auto frequency = static_cast<std::size_t>(cb.Frequency);
+            wrl::ComPtr<ID3D11Buffer>& binding = data.CbBindings[cb.BindPoint];
+            if (const std::uint64_t key = data.CbKeys[frequency])
+            {
+                auto [it, inserted] = cb.KeyedGpuCbs.try_emplace(key);
+                ShaderCb::KeyedGpuCb& keyed = it->second;
+                keyed.LastUsedFrame = data.AppliedFrames;
+                if (inserted)
+                {
+                    wrl::ComPtr<ID3D11Device> device3D;
+                    context3D.GetDevice(device3D.GetAddressOf());
+                    keyed.GpuCb = MakeConstantBuffer(
+                        Ref(device3D),
+                        gsl::narrow<std::uint32_t>(cb.CpuBuffer.size()));
+                }
+                if (binding != keyed.GpuCb)
+                    binding = keyed.GpuCb;
+                if (keyed.Uploaded == cb.CpuBuffer)
+                {
+                    ++g_cbUploadStats.Skipped[frequency];
+                    continue;
+                }
+                UpdateWithDiscard(context3D, Ref(keyed.GpuCb),
+                                  gsl::span<const std::byte>(cb.CpuBuffer));
+                keyed.Uploaded = cb.CpuBuffer;
+                ++g_cbUploadStats.Uploads[frequency];
+                g_cbUploadStats.Bytes[frequency] += cb.CpuBuffer.size();
+                continue;
+            }
+            if (binding != cb.GpuCb)
+                binding = cb.GpuCb;
+            if (cb.Version == cb.UploadedVersion)
+            {
+                ++g_cbUploadStats.Skipped[frequency];
+                continue;
+            }
+            UpdateWithDiscard(context3D, dx::Ref(cb.GpuCb),
+                              gsl::span<const std::byte>(cb.CpuBuffer));
+            cb.UploadedVersion = cb.Version;
+            ++g_cbUploadStats.Uploads[frequency];
+            g_cbUploadStats.Bytes[frequency] += cb.CpuBuffer.size();
         }
     }
 
+// m_shaderObject 由 CreateShaderFromByteCode 从对应类型的 shader 转换而来，
+// 这里直接转换回去，不需要 QueryInterface。
 #define BIND_WITH_PREFIX(prefix, type)                                      \
     {                                                                       \
-        wrl::ComPtr<type> shader;                                           \
+        type* shader = nullptr;                                             \
         if (m_shaderObject)                                                 \
         {                                                                   \
-            const auto samplers = dx::ComPtrsCast(                          \
-                gsl::make_span(m_sharedData->Samplers.Resources));          \
+            const SharedShaderData& data = *m_sharedData;                   \
             context3D.CONCAT(prefix, SetSamplers)(                          \
-                0, gsl::narrow<std::uint32_t>(samplers.size()),             \
-                samplers.data());                                           \
-            const auto views = dx::ComPtrsCast(                             \
-                gsl::make_span(m_sharedData->ResourceViews.Resources));     \
+                0, gsl::narrow<std::uint32_t>(data.SlotSamplers.size()),    \
+                data.SlotSamplers.data());                                  \
             context3D.CONCAT(prefix, SetShaderResources)(                   \
-                0, gsl::narrow<std::uint32_t>(views.size()), views.data()); \
+                0, gsl::narrow<std::uint32_t>(data.SlotViews.size()),       \
+                data.SlotViews.data());                                     \
             const auto cbs =                                                \
-                dx::ComPtrsCast(dx::SingleAsSpan(m_sharedData->GpuCb));     \
+                dx::ComPtrsCast(gsl::make_span(data.CbBindings));           \
             context3D.CONCAT(prefix, SetConstantBuffers)(                   \
                 0, gsl::narrow<std::uint32_t>(cbs.size()), cbs.data());     \
-            TryHR(m_shaderObject.As(&shader));                              \
+            shader = static_cast<type*>(m_shaderObject.Get());              \
         }                                                                   \
-        context3D.CONCAT(prefix, SetShader)(shader.Get(), nullptr, 0);      \
+        context3D.CONCAT(prefix, SetShader)(shader, nullptr, 0);            \
     }
 
     void Shader::Setup(ID3D11DeviceContext& context3D) const
@@ -278,13 +780,39 @@ namespace dx
     void Shader::SetBytes(std::string_view fieldName,
                           gsl::span<const std::byte> bytes) const
     {
-        const auto& bytesMap = m_sharedData->BytesMap;
+        WriteField(fieldName, bytes, false);
+    }
+
+    void Shader::WriteField(std::string_view fieldName,
+                            gsl::span<const std::byte> bytes,
+                            bool fromContext) const
+    {
         // TODO: 异构查找
-        if (const auto it = bytesMap.find(std::string{fieldName});
-            it != bytesMap.end())
+        const auto it = m_sharedData->BytesMap.find(std::string{fieldName});
+        if (it == m_sharedData->BytesMap.end())
+            return;
+        WriteField(it->second, bytes, fromContext);
+    }
+
+    void Shader::WriteField(const ShaderCbField& field,
+                            gsl::span<const std::byte> bytes,
+                            bool fromContext) const
+    {
+        SharedShaderData& data = *m_sharedData;
+        Expects(bytes.size() <= field.Bytes.size());
+        // 内容相同时不算修改，静态的物体和材质因此不会每帧上传。
+        if (!std::equal(bytes.begin(), bytes.end(), field.Bytes.begin()))
+        {
+            gsl::copy(bytes, field.Bytes);
+            ++data.Cbs[field.Cb].Version;
+        }
+        // 被其它数据覆盖了（例如 ObjectLights），下次必须重新写入 context。
+        if (field.ContextFrequency && !fromContext)
         {
-            gsl::span<std::byte> destSpan = it->second;
-            gsl::copy(bytes, destSpan);
+            if (*field.ContextFrequency == CbFrequency::kPerFrame)
+                data.AppliedFrameEpoch = 0;
+            else
+                data.AppliedViewEpoch = 0;
         }
     }
 
@@ -297,13 +825,26 @@ namespace dx
     void Shader::Bind(std::string_view name,
                       wrl::ComPtr<ID3D11ShaderResourceView> resourceView) const
     {
-        m_sharedData->ResourceViews.Bind(name, std::move(resourceView));
+        SharedShaderData& data = *m_sharedData;
+        // shader 中没有用到的资源不需要绑定。
+        const BoundedResourcesInfo* info = data.ResourceViews.FindInfo(name);
+        if (!info)
+            return;
+        data.SlotViews[info->Slot] = resourceView.Get();
+        data.SlotInputs = {};
+        data.ResourceViews.Resources[info->Index] = std::move(resourceView);
     }
 
     void Shader::Bind(std::string_view name,
                       wrl::ComPtr<ID3D11SamplerState> sampler) const
     {
-        m_sharedData->Samplers.Bind(name, std::move(sampler));
+        SharedShaderData& data = *m_sharedData;
+        const BoundedResourcesInfo* info = data.Samplers.FindInfo(name);
+        if (!info)
+            return;
+        data.SlotSamplers[info->Slot] = sampler.Get();
+        data.SlotInputs = {};
+        data.Samplers.Resources[info->Index] = std::move(sampler);
     }
 
     ShaderKind KindFromReflection(ID3D11ShaderReflection& reflection)
@@ -314,70 +855,98 @@ namespace dx
     }
 
     Shader::Shader(ID3D11Device& device3D, gsl::span<const std::byte> byteCode,
-                   wrl::ComPtr<ID3D11ShaderReflection> reflection)
-        : m_kind { KindFromReflection(dx::Ref(reflection))},
-        m_sharedData{std::make_shared<SharedShaderData>(device3D,
-                                                          reflection, m_kind, byteCode)},
+                   ShaderMetadata metadata)
+        : m_kind{static_cast<ShaderKind>(metadata.Kind)},
+          m_sharedData{std::make_shared<SharedShaderData>(
+              device3D, std::move(metadata), byteCode)},
           m_shaderObject{
               CreateShaderFromByteCode(device3D, byteCode, GetKind())}
     {}
 
-    SharedShaderData::SharedShaderData(
-        ID3D11Device& device3D, wrl::ComPtr<ID3D11ShaderReflection> reflection_,
-        ShaderKind kind, gsl::span<const std::byte> byteCode_)
-        : reflection{std::move(reflection_)}
+    SharedShaderData::SharedShaderData(ID3D11Device& device3D,
+                                       ShaderMetadata metadata,
+                                       gsl::span<const std::byte> byteCode_)
+        : Metadata{std::move(metadata)}, Id{g_nextShaderId.fetch_add(1)}
     {
-        if (kind == ShaderKind::kVertexShader)
+        if (static_cast<ShaderKind>(Metadata.Kind) == ShaderKind::kVertexShader)
         {
             byteCode.insert(byteCode.end(), byteCode_.begin(), byteCode_.end());
         }
 
-        D3D11_SHADER_DESC shaderDesc;
-        TryHR(reflection->GetDesc(&shaderDesc));
-        const std::uint32_t cbCount = shaderDesc.ConstantBuffers;
-        if (cbCount == 0)
+        for (const ShaderResourceBinding& resource : Metadata.Resources)
         {
-            return;
+            if (resource.Type == ShaderResourceType::kSampler)
+                Samplers.AddInfo(resource.Name.c_str(), resource.BindPoint);
+            else
+                ResourceViews.AddInfo(resource.Name.c_str(),
+                                      resource.BindPoint);
         }
-        Ensures(cbCount == 1);
-        D3D11_SHADER_BUFFER_DESC bufferDesc;
-        ID3D11ShaderReflectionConstantBuffer* const cbReflection =
-            reflection->GetConstantBufferByIndex(0);
-        TryHR(cbReflection->GetDesc(&bufferDesc));
-        GpuCb = MakeConstantBuffer(device3D, bufferDesc.Size);
-        CpuBuffer.resize(static_cast<std::size_t>(bufferDesc.Size));
-        D3D11_SHADER_VARIABLE_DESC desc;
-        for (std::uint32_t i = 0; i < bufferDesc.Variables; ++i)
+        ResizeSlots(ResourceViews, SlotViews);
+        ResizeSlots(Samplers, SlotSamplers);
+
+        // BytesMap 中的 span 指向 CpuBuffer，Cbs 之后不能再扩容。
+        Cbs.reserve(Metadata.ConstantBuffers.size());
+        for (const ShaderCbLayout& layout : Metadata.ConstantBuffers)
+        {
+            AddCb(device3D, layout);
+        }
+    }
+
+    void SharedShaderData::AddCb(ID3D11Device& device3D,
+                                 const ShaderCbLayout& layout)
+    {
+        const auto cbIndex = gsl::narrow<std::uint32_t>(Cbs.size());
+        Ensures(cbIndex < Cbs.capacity());
+        ShaderCb& cb = Cbs.emplace_back();
+        cb.Frequency = CbFrequencyFromName(layout.Name);
+        cb.BindPoint = layout.BindPoint;
+        cb.GpuCb = MakeConstantBuffer(device3D, layout.Size);
+        cb.CpuBuffer.resize(static_cast<std::size_t>(layout.Size));
+        if (CbBindings.size() <= cb.BindPoint)
+        {
+            CbBindings.resize(cb.BindPoint + 1);
+        }
+        CbBindings[cb.BindPoint] = cb.GpuCb;
+        for (const ShaderCbVariable& variable : layout.Variables)
         {
-            const auto varReflection = cbReflection->GetVariableByIndex(i);
-            TryHR(varReflection->GetDesc(&desc));
             BytesMap.insert(std::make_pair(
-                desc.Name, gsl::span<std::byte>(CpuBuffer).subspan(
-                               desc.StartOffset, desc.Size)));
+                variable.Name,
+                ShaderCbField{
+                    gsl::span<std::byte>(cb.CpuBuffer)
+                        .subspan(variable.Offset, variable.Size),
+                    cbIndex,
+                    GlobalShaderContext::FieldFrequency(variable.Name)}));
         }
-        const std::uint32_t bindSlotCount = shaderDesc.BoundResources;
-        D3D11_SHADER_INPUT_BIND_DESC bindDesc;
-        for (std::uint32_t i = 0; i < bindSlotCount; ++i)
+    }
+
+    CbFrequency CbFrequencyFromName(std::string_view cbName)
+    {
+        for (std::size_t i = 0; i < kCbFrequencyCount; ++i)
         {
-            TryHR(reflection->GetResourceBindingDesc(i, &bindDesc));
-            switch (bindDesc.Type)
-            {
-                case D3D_SIT_SAMPLER:
-                    Samplers.AddInfo(bindDesc.Name);
-                    break;
-                case D3D_SIT_TEXTURE:
-                    ResourceViews.AddInfo(bindDesc.Name);
-                    break;
-                    // cbs has been handled
-                case D3D_SIT_CBUFFER:
-                    continue;
-                default:
-                    assert(false);
-                    break;
-            }
+            const std::string_view prefix = kCbFrequencyPrefixes[i];
+            if (cbName.substr(0, prefix.size()) == prefix)
+                return static_cast<CbFrequency>(i);
         }
+        return CbFrequency::kPerObject;
+    }
+
+    std::uint64_t CbUploadStats::TotalBytes() const noexcept
+    {
+        std::uint64_t total = 0;
+        for (const std::uint64_t bytes : Bytes)
+        {
+            total += bytes;
+        }
+        return total;
+    }
+
+    const CbUploadStats& GetCbUploadStats() noexcept
+    {
+        return g_cbUploadStats;
     }
 
+    void ResetCbUploadStats() noexcept { g_cbUploadStats = CbUploadStats{}; }
+
     void SetupShaders(ID3D11DeviceContext& context3D,
                       const ShaderCollection& shaders)
     {
@@ -390,60 +959,73 @@ namespace dx
         }
     }
 
-    void FillUpShaders(ID3D11DeviceContext& context3D,
-                       const PassWithShaderInputs& passWithInputs,
-                       const DirectX::XMMATRIX& world,
-                       const ShaderInputs* additionalInput,
-                       const GlobalShaderContext& shaderContext)
+    namespace
     {
-        using namespace DirectX;
-        const ShaderInputs& inputs = passWithInputs.inputs;
-        const Pass& pass = *passWithInputs.pass;
-        for (std::size_t i = 0; i < pass.Shaders.size(); ++i)
+        void FillUpShadersImpl(ID3D11DeviceContext& context3D,
+                               const PassWithShaderInputs& passWithInputs,
+                               const DirectX::XMMATRIX& world,
+                               const ShaderInputs* additionalInput,
+                               const GlobalShaderContext& shaderContext,
+                               const ObjectLights* objectLights,
+                               std::uint64_t objectKey)
         {
-            const Shader& shader = pass.Shaders[static_cast<ShaderKind>(i)];
-            if (!shader)
-                continue;
-            shader.Apply(inputs);
-            shader.Apply(shaderContext);
-            if (additionalInput)
+            using namespace DirectX;
+            const ShaderInputs& inputs = passWithInputs.inputs;
+            const Pass& pass = *passWithInputs.pass;
+            for (std::size_t i = 0; i < pass.Shaders.size(); ++i)
             {
-                shader.Apply(*additionalInput);
+                const Shader& shader =
+                    pass.Shaders[static_cast<ShaderKind>(i)];
+                if (!shader)
+                    continue;
+                shader.SetCbKey(CbFrequency::kPerMaterial, inputs.CbKey());
+                shader.SetCbKey(CbFrequency::kPerObject, objectKey);
+                shader.ApplySlots(inputs, additionalInput);
+                shader.ApplyFields(inputs);
+                shader.Apply(shaderContext);
+                if (objectLights)
+                {
+                    shader.SetBytes(LIGHTS,
+                                    gsl::as_bytes(objectLights->AsSpan()));
+                    shader.SetField(LIGHT_COUNT, static_cast<std::int32_t>(
+                                                     objectLights->Count));
+                }
+                if (additionalInput)
+                {
+                    shader.ApplyFields(*additionalInput);
+                }
+                shader.SetField(WORLD_MATRIX, world);
+                shader.SetField(
+                    INV_TRANS_WORLD,
+                    XMMatrixInverse(nullptr, XMMatrixTranspose(world)));
+                shader.SetField(WORLD_VIEW_PROJ_MATRIX,
+                                world * shaderContext.ViewProjMatrix);
+                shader.Flush(context3D);
             }
-            shader.SetField(WORLD_MATRIX, world);
-            shader.SetField(INV_TRANS_WORLD,
-                            XMMatrixInverse(nullptr, XMMatrixTranspose(world)));
-            shader.SetField(WORLD_VIEW_PROJ_MATRIX,
-                            world * shaderContext.ViewProjMatrix);
-            shader.Flush(context3D);
         }
-    }
+    } // namespace
 
-    MemoryMappedCso::MemoryMappedCso(const fs::path& path)
-        : m_fileHandle{OpenExistingFile(path, FileAccessMode::Read,
-                                        FileShareMode::Read)},
-          m_memoryMappedFile{
-              OpenWin32WithCheck<MemoryMappedFileHandle>(::CreateFileMappingW(
-                  m_fileHandle.Get(), nullptr, PAGE_READONLY, 0, 0, nullptr))},
-          m_mappedView{
-              OpenWin32WithCheck<FileMappingViewHandle>(::MapViewOfFile(
-                  m_memoryMappedFile.Get(), FILE_MAP_READ, 0, 0, 0))}
+    void FillUpShaders(ID3D11DeviceContext& context3D,
+                       const PassWithShaderInputs& passWithInputs,
+                       const DirectX::XMMATRIX& world,
+                       const ShaderInputs* additionalInput,
+                       const GlobalShaderContext& shaderContext,
+                       std::uint64_t objectKey)
     {
-        // FIXME: fileSize may be larger than 2GB, this code would not work
-        // with 32bit.
-        LARGE_INTEGER fileSize{};
-        if (::GetFileSizeEx(m_fileHandle.Get(), &fileSize) == FALSE)
-        {
-            ThrowWin32();
-        }
-        m_size = fileSize.QuadPart;
+        FillUpShadersImpl(context3D, passWithInputs, world, additionalInput,
+                          shaderContext, nullptr, objectKey);
     }
 
-    gsl::span<const std::byte> MemoryMappedCso::Bytes() const&
+    void FillUpShaders(ID3D11DeviceContext& context3D,
+                       const PassWithShaderInputs& passWithInputs,
+                       const DirectX::XMMATRIX& world,
+                       const ShaderInputs* additionalInput,
+                       const GlobalShaderContext& shaderContext,
+                       const ObjectLights& objectLights,
+                       std::uint64_t objectKey)
     {
-        return gsl::span<const std::byte>{
-            static_cast<const std::byte*>(m_mappedView.Get()),
-            gsl::narrow<std::ptrdiff_t>(m_size)};
+        FillUpShadersImpl(context3D, passWithInputs, world, additionalInput,
+                          shaderContext, &objectLights, objectKey);
     }
 
     std::unique_ptr<Shaders> g_shaders;
@@ -467,6 +1049,18 @@ namespace dx
 
     void Shaders::Setup() { g_shaders = std::make_unique<Shaders>(Shaders{}); }
 
+    void Shaders::EnableCompileCache(fs::path directory)
+    {
+        Expects(g_shaders != nullptr);
+        g_shaders->m_compileCache = std::make_unique<ShaderCache>(
+            std::move(directory), std::make_unique<D3DShaderCompiler>());
+    }
+
+    ShaderCache* Shaders::CompileCache()
+    {
+        return g_shaders ? g_shaders->m_compileCache.get() : nullptr;
+    }
+
     ShaderCollection ShadersBuilder::Build() const
     {
         return ShaderCollection{std::move(m_shaders)};
@@ -479,18 +1073,22 @@ namespace dx
         return *this;
     }
 
+    void ShaderCollection::Replace(Shader shader)
+    {
+        const ShaderKind kind = shader.GetKind();
+        static_cast<BaseType&>(*this)[static_cast<std::size_t>(kind)] =
+            std::move(shader);
+        if (kind == ShaderKind::kVertexShader)
+            m_mask = MaskFromVertexShader();
+    }
+
     VSSemantics ShaderCollection::MaskFromVertexShader()
     {
         const Shader& vs = GetVertexShader();
-        ID3D11ShaderReflection* const reflection = vs.GetReflection().Get();
-        D3D11_SHADER_DESC shaderDesc;
-        TryHR(reflection->GetDesc(&shaderDesc));
         VSSemantics mask = VSSemantics::kNone;
-        for (std::uint32_t i = 0; i < shaderDesc.InputParameters; ++i)
+        for (const ShaderInputParameter& input : vs.GetMetadata().Inputs)
         {
-            D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-            TryHR(reflection->GetInputParameterDesc(i, &paramDesc));
-            const std::string_view semantics = paramDesc.SemanticName;
+            const std::string_view semantics = input.SemanticName;
             // FIXME: semantics not found
             mask |= g_shaders->m_semanticsNameToMaskMap.find(semantics)->second;
         }
@@ -3,6 +3,10 @@
 #include <d3d11.h>
 #include <d3d11shader.h>
 #include "../Vertex.hpp"
+#include "../AssetWatcher.hpp"
+#include "../AssetArchive.hpp"
+#include "ShaderCache.hpp"
+#include "ShaderMetadata.hpp"
 
 namespace dx
 {
@@ -45,13 +49,43 @@ namespace dx
                              gsl::span<const std::byte> byteCode,
                              ShaderKind kind);
 
+    // D3DCOMPILE_ENABLE_STRICTNESS，debug 版本再加上 D3DCOMPILE_DEBUG 和
+    // D3DCOMPILE_SKIP_OPTIMIZATION。
+    std::uint32_t DefaultShaderCompileFlags();
+
     wrl::ComPtr<ID3D10Blob> CompileShaderFromFile(const wchar_t* fileName,
                                                   const char* entryPoint,
                                                   const char* shaderModel);
+    wrl::ComPtr<ID3D10Blob>
+    CompileShaderFromFile(const ShaderCompileDesc& desc);
+
+    class D3DShaderCompiler : public ShaderCompiler
+    {
+      public:
+        std::string Identity() const override;
+        std::string Preprocess(const ShaderCompileDesc& desc) override;
+        std::vector<std::byte>
+        Compile(const ShaderCompileDesc& desc,
+                std::string_view preprocessedSource) override;
+        std::vector<std::byte>
+        ExtractMetadata(gsl::span<const std::byte> byteCode) override;
+    };
 
     wrl::ComPtr<ID3D11ShaderReflection>
     ReflectShader(gsl::span<const std::byte> byteCode);
 
+    ShaderMetadata ExtractShaderMetadata(ID3D11ShaderReflection& reflection,
+                                         gsl::span<const std::byte> byteCode);
+    // 调用 D3DReflect。
+    ShaderMetadata MetadataFromByteCode(gsl::span<const std::byte> byteCode);
+    // 优先读取 csoPath 旁边的 .refl 文件；不存在或者与字节码不符时退回到
+    // D3DReflect，并把结果写成新的 .refl，所以 LoadDefaultShaders 等只有
+    // 第一次启动需要反射。
+    ShaderMetadata LoadShaderMetadata(const fs::path& csoPath,
+                                      gsl::span<const std::byte> byteCode);
+    // 为 csoPath 生成 .refl 文件，例如打包 AssetArchive 之前。
+    void ExportShaderMetadata(const fs::path& csoPath);
+
     struct CbFieldInfo
     {
         std::string Name;
@@ -63,6 +97,8 @@ namespace dx
     {
         std::string Name;
         std::uint32_t Index;
+        // shader 中的 bind point；ShaderInputs 中与 Index 相同。
+        std::uint32_t Slot;
     };
 
     template<typename T>
@@ -72,24 +108,35 @@ namespace dx
         std::vector<BoundedResourcesInfo> Infos;
 
         std::uint32_t AddInfo(const char* name)
+        {
+            return AddInfo(name, gsl::narrow<std::uint32_t>(Resources.size()));
+        }
+
+        std::uint32_t AddInfo(const char* name, std::uint32_t slot)
         {
             const std::uint32_t index =
                 gsl::narrow<std::uint32_t>(Resources.size());
             Resources.push_back(nullptr);
-            Infos.push_back(BoundedResourcesInfo{std::string{name}, index});
+            Infos.push_back(
+                BoundedResourcesInfo{std::string{name}, index, slot});
             return index;
         }
 
+        const BoundedResourcesInfo* FindInfo(std::string_view name) const
+        {
+            const auto pos = std::find_if(
+                Infos.begin(), Infos.end(),
+                [&](const BoundedResourcesInfo& info) {
+                    return name == info.Name;
+                });
+            return pos != Infos.end() ? &*pos : nullptr;
+        }
+
         void Bind(std::string_view name, wrl::ComPtr<T> resource)
         {
-            if (const auto pos =
-                    std::find_if(Infos.begin(), Infos.end(),
-                                 [&](const BoundedResourcesInfo& info) {
-                                     return name == info.Name;
-                                 });
-                pos != Infos.end())
+            if (const BoundedResourcesInfo* info = FindInfo(name))
             {
-                wrl::ComPtr<T>& oldResource = Resources[pos - Infos.begin()];
+                wrl::ComPtr<T>& oldResource = Resources[info->Index];
                 Ensures(oldResource == nullptr);
                 oldResource = std::move(resource);
             }
@@ -101,6 +148,51 @@ namespace dx
         }
     };
 
+    struct ShaderCbField;
+
+    // ShaderInputs 针对某个 shader 预先解析好的绑定：每个字段写到 shader
+    // 的哪个位置，每个 view/sampler 放到哪个 slot。ShaderInputs 增加字段或
+    // 绑定资源之前一直有效，Apply 因此不再按名字查找，也不会增减引用计数。
+    struct ShaderBindingTable
+    {
+        struct Field
+        {
+            // 在 ShaderInputs::Bytes 中的位置。
+            std::uint32_t Start;
+            std::uint32_t Size;
+            const ShaderCbField* Target;
+        };
+
+        template<typename T>
+        struct Slot
+        {
+            std::uint32_t Index;
+            T* Resource;
+        };
+
+        std::uint64_t ShaderId;
+        std::uint64_t InputsLayoutVersion;
+        std::vector<Field> Fields;
+        std::vector<Slot<ID3D11ShaderResourceView>> Views;
+        std::vector<Slot<ID3D11SamplerState>> Samplers;
+    };
+
+    // per-material 与 per-object cbuffer 缓存的 key，见 Shader::SetCbKey。
+    // 每次构造（包括复制）都从全局计数器取一个新值，对象销毁之后也不会
+    // 被别人取到；赋值不改变 key。0 表示不缓存。
+    class UniqueCbKey
+    {
+      public:
+        UniqueCbKey() noexcept;
+        UniqueCbKey(const UniqueCbKey&) noexcept : UniqueCbKey{} {}
+        UniqueCbKey& operator=(const UniqueCbKey&) noexcept { return *this; }
+
+        std::uint64_t Value() const noexcept { return m_value; }
+
+      private:
+        std::uint64_t m_value;
+    };
+
     class ShaderInputs
     {
       public:
@@ -130,6 +222,8 @@ namespace dx
         gsl::span<const Ptr<ID3D11ShaderResourceView>> ResourceViews() const;
         gsl::span<const std::byte> Bytes() const;
         gsl::span<std::byte> Bytes();
+        // FillUpShaders 用它作为 per-material cbuffer 的 key。
+        std::uint64_t CbKey() const noexcept { return m_cbKey.Value(); }
 
       private:
         friend class Shader;
@@ -147,24 +241,23 @@ namespace dx
         std::vector<std::byte> m_bytes;
         BoundedResources<ID3D11ShaderResourceView> m_resourceViews;
         BoundedResources<ID3D11SamplerState> m_samplers;
+        static std::uint64_t NextLayoutVersion() noexcept;
+
+        // 增加字段或者绑定新的资源时从全局计数器取一个新值，使
+        // m_bindingTables 失效。不同的 ShaderInputs 不会取到相同的值（复制
+        // 出来的除外，内容也相同），Shader::ApplySlots 用它判断 slot 是否
+        // 需要重新填写。
+        std::uint64_t m_layoutVersion = NextLayoutVersion();
+        UniqueCbKey m_cbKey;
+        // 一个 ShaderInputs 通常只用于一个 pass 中的几个 shader。
+        mutable std::vector<ShaderBindingTable> m_bindingTables;
     };
 
     inline constexpr auto kDefaultEntryName = u8"main";
 
-    class MemoryMappedCso : Noncopyable
-    {
-      public:
-        MemoryMappedCso(const fs::path& path);
-        DEFAULT_MOVE(MemoryMappedCso)
-
-        gsl::span<const std::byte> Bytes() const&;
-
-      private:
-        FileHandle m_fileHandle;
-        MemoryMappedFileHandle m_memoryMappedFile;
-        FileMappingViewHandle m_mappedView;
-        std::uint64_t m_size;
-    };
+    // .cso 和 .refl 很小，映射之后马上就会整个读一遍。
+    inline constexpr MappedFileHints kShaderFileHints =
+        MappedFileHints::kSequential | MappedFileHints::kPrefetch;
 
     struct GpuCbFieldInfo
     {
@@ -172,21 +265,111 @@ namespace dx
         std::uint32_t Size;
     };
 
-    struct SharedShaderData
+    // cbuffer 的更新频率，由 cbuffer 名字的前缀决定（见 kCbFrequencyPrefixes），
+    // 其它名字的 cbuffer 按 kPerObject 处理。
+    enum class CbFrequency : std::uint8_t
+    {
+        kPerFrame,
+        kPerView,
+        kPerMaterial,
+        kPerObject
+    };
+
+    inline constexpr std::size_t kCbFrequencyCount = 4;
+
+    inline constexpr auto kCbFrequencyPrefixes = std::array{
+        "dx_PerFrame", "dx_PerView", "dx_PerMaterial", "dx_PerObject"};
+
+    CbFrequency CbFrequencyFromName(std::string_view cbName);
+
+    // 上传到 constant buffer 的次数和字节数，按 CbFrequency 分开统计。
+    struct CbUploadStats
     {
-        SharedShaderData(ID3D11Device& device3D,
-                         wrl::ComPtr<ID3D11ShaderReflection> reflection_,
-            ShaderKind kind,
-            gsl::span<const std::byte> byteCode_);
+        std::array<std::uint32_t, kCbFrequencyCount> Uploads{};
+        std::array<std::uint64_t, kCbFrequencyCount> Bytes{};
+        // 内容没有变化、跳过了 map 的 cbuffer 数。
+        std::array<std::uint32_t, kCbFrequencyCount> Skipped{};
 
+        std::uint64_t TotalBytes() const noexcept;
+    };
+
+    // 上次 ResetCbUploadStats 之后的统计，只在渲染线程上更新。
+    const CbUploadStats& GetCbUploadStats() noexcept;
+    void ResetCbUploadStats() noexcept;
+
+    // 大约一秒，足够跨过物体偶尔被剔除的几帧。
+    inline constexpr std::uint64_t kKeyedCbIdleFrames = 60;
+
+    struct ShaderCb
+    {
+        CbFrequency Frequency;
+        std::uint32_t BindPoint;
         wrl::ComPtr<ID3D11Buffer> GpuCb;
-        wrl::ComPtr<ID3D11ShaderReflection> reflection;
         std::vector<std::byte> CpuBuffer;
-        std::unordered_map<std::string, gsl::span<std::byte>> BytesMap;
+        // CpuBuffer 的内容每改变一次加一；与 UploadedVersion 相同时 Flush
+        // 不需要 map。
+        std::uint64_t Version = 1;
+        std::uint64_t UploadedVersion = 0;
+
+        // 设置了 key 时（见 Shader::SetCbKey）使用的 GPU buffer，按 key
+        // 缓存。Uploaded 是上次上传的内容，与 CpuBuffer 相同时不需要 map，
+        // 因此共用同一个 shader 的静态物体和材质不会每次绘制都上传。
+        // 连续 kKeyedCbIdleFrames 帧没有用到的会被释放。
+        struct KeyedGpuCb
+        {
+            wrl::ComPtr<ID3D11Buffer> GpuCb;
+            std::vector<std::byte> Uploaded;
+            // 最后一次使用时的 SharedShaderData::AppliedFrames。
+            std::uint64_t LastUsedFrame = 0;
+        };
+        std::unordered_map<std::uint64_t, KeyedGpuCb> KeyedGpuCbs;
+    };
+
+    struct ShaderCbField
+    {
+        gsl::span<std::byte> Bytes;
+        // 在 SharedShaderData::Cbs 中的下标。
+        std::uint32_t Cb;
+        // 由 GlobalShaderContext 写入的字段属于 kPerFrame 还是 kPerView。
+        std::optional<CbFrequency> ContextFrequency;
+    };
+
+    struct SharedShaderData
+    {
+        SharedShaderData(ID3D11Device& device3D, ShaderMetadata metadata,
+                         gsl::span<const std::byte> byteCode_);
+
+        ShaderMetadata Metadata;
+        // 区分 ShaderInputs 中的 ShaderBindingTable 属于哪个 shader。
+        std::uint64_t Id;
+        std::vector<ShaderCb> Cbs;
+        // 按 bind point 排列，没有 cbuffer 的 slot 为 nullptr。
+        std::vector<wrl::ComPtr<ID3D11Buffer>> CbBindings;
+        std::unordered_map<std::string, ShaderCbField> BytesMap;
+        // 每种频率的 cbuffer 当前使用的 key，见 Shader::SetCbKey。
+        std::array<std::uint64_t, kCbFrequencyCount> CbKeys{};
+        // 最近一次写入的 GlobalShaderContext 的 epoch，相同时跳过写入。
+        std::uint64_t AppliedFrameEpoch = 0;
+        std::uint64_t AppliedViewEpoch = 0;
+        // Apply 见过的帧数（FrameEpoch 为 0 的不算），以及 Flush 上次淘汰
+        // keyed buffer 时的帧数。
+        std::uint64_t AppliedFrames = 0;
+        std::uint64_t EvictedFrames = 0;
         BoundedResources<ID3D11ShaderResourceView> ResourceViews;
         BoundedResources<ID3D11SamplerState> Samplers;
+        // 当前绑定的 view/sampler，按 slot 排列，Setup 直接交给 D3D。
+        // 通过 ShaderInputs 放进来的资源不在这里持有引用，ShaderInputs 要
+        // 活到 Setup 之后。
+        std::vector<ID3D11ShaderResourceView*> SlotViews;
+        std::vector<ID3D11SamplerState*> SlotSamplers;
+        // 由 ApplySlots 填进 slot 的 ShaderInputs 的 m_layoutVersion；Apply
+        // 或者 Bind 改过 slot 之后为 0。
+        std::array<std::uint64_t, 2> SlotInputs{};
         //for vertex shaders only.
         std::vector<std::byte> byteCode;
+
+      private:
+        void AddCb(ID3D11Device& device3D, const ShaderCbLayout& layout);
     };
 
     class Shader
@@ -195,9 +378,13 @@ namespace dx
         Shader(ShaderKind kind) : m_kind{kind} {}
 
         Shader(ID3D11Device& device3D, gsl::span<const std::byte> byteCode)
-            : Shader{device3D, byteCode, ReflectShader(byteCode)}
+            : Shader{device3D, byteCode, MetadataFromByteCode(byteCode)}
         {}
 
+        // metadata 必须与 byteCode 对应，见 LoadShaderMetadata。
+        Shader(ID3D11Device& device3D, gsl::span<const std::byte> byteCode,
+               ShaderMetadata metadata);
+
         Shader(Shader&& rhs) noexcept = default;
         Shader& operator=(Shader&&) noexcept = default;
         Shader(const Shader&) = default;
@@ -207,9 +394,11 @@ namespace dx
                                      const wchar_t* path, ShaderKind shaderKind,
                                      const char* entryName = kDefaultEntryName)
         {
-            return Shader{device3D, CompileShaderFromFile(
-                                        path, entryName,
-                                        ShaderModelFromKind(shaderKind))};
+            return FromSourceFile(
+                device3D,
+                ShaderCompileDesc{path, entryName,
+                                  ShaderModelFromKind(shaderKind),
+                                  DefaultShaderCompileFlags()});
         }
 
         static Shader FromSourceFile(ID3D11Device& device3D,
@@ -221,22 +410,51 @@ namespace dx
                                   entryName);
         }
 
+        // 调用过 Shaders::EnableCompileCache 时先查找编译缓存。缓存中带有
+        // .refl 文件，命中时不需要 D3DReflect。
+        static Shader FromSourceFile(ID3D11Device& device3D,
+                                     const ShaderCompileDesc& desc);
+
+        // 有 .refl 文件时（见 ExportShaderMetadata）不调用 D3DReflect。
         static Shader FromCompiledCso(ID3D11Device& device3D,
                                       const fs::path& path);
 
+        // name 是包中 .cso 条目的名字。包中有对应的 .refl 条目并且与字节码
+        // 相符时不调用 D3DReflect。
+        static Shader FromArchive(ID3D11Device& device3D,
+                                  const AssetArchive& archive,
+                                  std::string_view name);
+
         // ShaderKind Kind() const;
 
+        // 写入 inputs 中的字段，并把资源放进对应的 slot，没有提供的 slot
+        // 不变，因此可以 Apply 多个 ShaderInputs。
         void Apply(const ShaderInputs& inputs) const;
+        // 只写入 inputs 中的字段。
+        void ApplyFields(const ShaderInputs& inputs) const;
+        // 绘制前调用：slot 中只留下 Bind 绑定的资源以及 inputs、additional
+        // 提供的资源，不会沿用上一次绘制的贴图。与上一次的 ShaderInputs
+        // 相同时什么也不做，只有换了材质才重新填写。
+        void ApplySlots(const ShaderInputs& inputs,
+                        const ShaderInputs* additional = nullptr) const;
+        // 只写入 epoch 与上次不同的部分，见 GlobalShaderContext::BeginFrame。
         void Apply(const GlobalShaderContext& shaderContext) const;
+        // 之后 Flush 把 frequency（kPerMaterial 或 kPerObject）的 cbuffer
+        // 上传到 key 自己的 GPU buffer 并绑定它。key 来自 UniqueCbKey，
+        // 通常是材质的 ShaderInputs::CbKey 或者 RenderNode::CbKey；为 0 时
+        // 所有绘制共用一个 buffer。key 只决定缓存的位置，是否上传仍然比较
+        // 内容。
+        void SetCbKey(CbFrequency frequency, std::uint64_t key) const;
+        // 只上传内容改变过的 cbuffer。
         void Flush(ID3D11DeviceContext& context3D) const;
         void Setup(ID3D11DeviceContext& context3D) const;
         void SetBytes(std::string_view fieldName,
                       gsl::span<const std::byte> bytes) const;
         ShaderKind GetKind() const { return m_kind; }
         gsl::span<const std::byte> GetByteCode() const;
-        const wrl::ComPtr<ID3D11ShaderReflection>& GetReflection() const
+        const ShaderMetadata& GetMetadata() const
         {
-            return m_sharedData->reflection;
+            return m_sharedData->Metadata;
         }
 
         template<typename T>
@@ -257,8 +475,18 @@ namespace dx
             : Shader{device3D, AsSpan(Ref(byteCode))}
         {}
 
-        Shader(ID3D11Device& device3D, gsl::span<const std::byte> byteCode,
-               wrl::ComPtr<ID3D11ShaderReflection> reflection);
+        void WriteField(std::string_view fieldName,
+                        gsl::span<const std::byte> bytes,
+                        bool fromContext) const;
+        void WriteField(const ShaderCbField& field,
+                        gsl::span<const std::byte> bytes,
+                        bool fromContext) const;
+        const ShaderBindingTable&
+        FindOrBuildBindingTable(const ShaderInputs& inputs) const;
+        void WriteFields(const ShaderBindingTable& table,
+                         const ShaderInputs& inputs) const;
+        void WriteSlots(const ShaderBindingTable& table) const;
+        void ResetSlots() const;
 
         ShaderKind m_kind;
         std::shared_ptr<SharedShaderData> m_sharedData;
@@ -286,6 +514,9 @@ namespace dx
 
         VSSemantics GetMask() const { return m_mask; }
 
+        // 换掉同类的 shader，换 VS 时重新计算 mask。用于热重载。
+        void Replace(Shader shader);
+
         const Shader& operator[](ShaderKind kind) const noexcept
         {
             return static_cast<const BaseType&>(
@@ -334,16 +565,29 @@ namespace dx
 
     struct Pass;
     struct PassWithShaderInputs;
+    struct ObjectLights;
 
     ShaderCollection MakeShaderCollection(Shader vertexShader,
                                           Shader pixelShader);
     void SetupShaders(ID3D11DeviceContext& context3D,
                       const ShaderCollection& shaders);
+    // per-material 的 cbuffer 以 passWithInputs.inputs.CbKey() 为 key，
+    // per-object 的以 objectKey 为 key（见 Shader::SetCbKey 与
+    // RenderNode::CbKey）。
+    void FillUpShaders(ID3D11DeviceContext& context3D,
+                       const PassWithShaderInputs& passWithInputs,
+                       const DirectX::XMMATRIX& world,
+                       const ShaderInputs* additionalInput,
+                       const GlobalShaderContext& shaderContext,
+                       std::uint64_t objectKey = 0);
+    // 同上，但用 objectLights（见 LightBvh）代替 shaderContext 中的光源。
     void FillUpShaders(ID3D11DeviceContext& context3D,
                        const PassWithShaderInputs& passWithInputs,
                        const DirectX::XMMATRIX& world,
                        const ShaderInputs* additionalInput,
-                       const GlobalShaderContext& shaderContext);
+                       const GlobalShaderContext& shaderContext,
+                       const ObjectLights& objectLights,
+                       std::uint64_t objectKey = 0);
 
     struct Shaders
     {
@@ -353,6 +597,10 @@ namespace dx
 
         static void Setup();
         static void LoadDefaultShaders(ID3D11Device& device3D);
+        // 之后 Shader::FromSourceFile 编译的结果保存在 directory 中，下次
+        // 启动时源码没有变化就不再编译。
+        static void EnableCompileCache(fs::path directory);
+        static ShaderCache* CompileCache();
 
 #define DEF_SHADER_NAME(name) \
     inline static constexpr auto CONCAT(k, name) = CONCAT(u8, #name)
@@ -374,5 +622,48 @@ namespace dx
         std::unordered_map<std::string, Shader> m_shaders;
         std::unordered_map<std::string_view, VSSemantics>
             m_semanticsNameToMaskMap;
+        std::unique_ptr<ShaderCache> m_compileCache;
+    };
+
+    // .cso 文件，或者需要编译的源码（调用过 Shaders::EnableCompileCache 时
+    // 先查找编译缓存）。
+    using ShaderSource = std::variant<fs::path, ShaderCompileDesc>;
+
+    struct ShaderLoadError
+    {
+        // 在传给 LoadShaders 的 sources 中的下标。
+        std::size_t Index;
+        fs::path Path;
+        std::string Message;
     };
+
+    // LoadShaders 中所有失败的 shader，按下标排序。
+    class ShaderBatchError : public std::runtime_error
+    {
+      public:
+        explicit ShaderBatchError(std::vector<ShaderLoadError> errors);
+
+        const std::vector<ShaderLoadError>& Errors() const noexcept
+        {
+            return m_errors;
+        }
+
+      private:
+        std::vector<ShaderLoadError> m_errors;
+    };
+
+    // 在多个线程中同时读取或编译 sources，字节码准备好之后由调用线程依次
+    // 创建 D3D 对象。返回的 shader 与 sources 一一对应；有任何一个失败时
+    // 等其它的都结束之后抛出 ShaderBatchError。
+    std::vector<Shader> LoadShaders(ID3D11Device& device3D,
+                                    gsl::span<const ShaderSource> sources);
+
+    // desc.SourcePath 或者它 #include 的文件变化时在后台重新编译，然后在
+    // 帧之间把新的 shader 交给 replace，例如
+    // [pass](Shader shader) { pass->Shaders.Replace(std::move(shader)); }。
+    // 编译失败时旧的 shader 保持不变，错误见 AssetWatcher::TakeErrors。
+    AssetWatcher::WatchId WatchShader(AssetWatcher& watcher,
+                                      ID3D11Device& device3D,
+                                      ShaderCompileDesc desc,
+                                      std::function<void(Shader)> replace);
 } // namespace dx
@@ -2,7 +2,8 @@
 
 #include "Events.hpp"
 #include "Camera.hpp"
-#include "Light.hpp"
+#include "LightRegistry.hpp"
+#include "TransformStore.hpp"
 
 namespace dx
 {
@@ -10,15 +11,16 @@ namespace dx
     class PredefinedResources;
     class GlobalGraphicsContext;
 
-    // TODO: camera/light 都要加上 dirty 标记。
     class SceneBase
     {
       public:
         SceneBase(Game& game);
         Camera& MainCamera() { return mainCamera_; }
         const Camera& MainCamera() const { return mainCamera_; }
-        std::vector<Light>& Lights() { return m_lights; }
-        const std::vector<Light>& Lights() const { return m_lights; }
+        LightRegistry& Lights() { return m_lights; }
+        const LightRegistry& Lights() const { return m_lights; }
+        TransformStore& Transforms() { return m_transforms; }
+        const TransformStore& Transforms() const { return m_transforms; }
 
         virtual ~SceneBase();
 
@@ -33,6 +35,7 @@ namespace dx
                             const Game& game);
 
         Camera mainCamera_;
-        std::vector<Light> m_lights;
+        LightRegistry m_lights;
+        TransformStore m_transforms;
     };
 } // namespace dx
\ No newline at end of file
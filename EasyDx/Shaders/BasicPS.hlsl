@@ -1,18 +1,22 @@
 #include "Basic3D.hlsli"
-#include "BasicLighting.hlsli"
+#include "ClusteredLighting.hlsli"
 
-cbuffer GlobalLightingInfo : register(b0)
+// 按更新频率拆分，见 dx::CbFrequency。
+cbuffer dx_PerFrame : register(b0)
 {
-    float3 dx_EyePos;
     int dx_LightCount;
     Light dx_Lights[10];
-	Material ObjectMaterial;
+}
 
+cbuffer dx_PerView : register(b1)
+{
+    float3 dx_EyePos;
 }
 
-//cbuffer PerObjectLightingInfo : register(b1)
-//{
-//}
+cbuffer dx_PerMaterial : register(b2)
+{
+	Material ObjectMaterial;
+}
 
 Texture2D Texture;
 SamplerState Sampler;
@@ -20,13 +24,27 @@ SamplerState Sampler;
 float4 main(dx::Outputs::PosNormalTex input) : SV_TARGET
 {
     float4 totalDiffuse = float4(0.0f, 0.0f, 0.0f, 0.0f), totalSpec = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    // 绑定了 cluster 数据时 point/spot light 由 ComputeClusteredLighting
+    // 计算，dx_Lights 中只取方向光。
+    bool clustered = dx_ClusterDims.x != 0;
     for (int i = 0; i < dx_LightCount; ++i)
     {
+        if (clustered && dx_Lights[i].LightType != DIRECTIONAL_LIGHT)
+            continue;
         float4 diffuse = 0.0f, spec = 0.0f;
         ComputeLighting(dx_EyePos, input.PositionWS.xyz, input.NormalWS, dx_Lights[i], ObjectMaterial, diffuse, spec);
         totalDiffuse += diffuse;
         totalSpec += spec;
     }
+    if (clustered)
+    {
+        // 透视投影下 SV_Position.w 就是 view space 的深度。
+        float4 diffuse, spec;
+        ComputeClusteredLighting(input.Position.xy, input.Position.w, dx_EyePos,
+            input.PositionWS.xyz, input.NormalWS, ObjectMaterial, diffuse, spec);
+        totalDiffuse += diffuse;
+        totalSpec += spec;
+    }
     totalDiffuse = saturate(totalDiffuse);
     totalSpec = saturate(totalSpec);
     float4 total = totalDiffuse + totalSpec;
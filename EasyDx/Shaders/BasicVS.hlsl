@@ -1,6 +1,6 @@
 #include "Basic3D.hlsli"
 
-cbuffer TransformMatrices : register(b0)
+cbuffer dx_PerObject : register(b0)
 {
     matrix dx_WorldViewProjMatrix;
 	matrix dx_WorldMatrix;
@@ -0,0 +1,67 @@
+#include "BasicLighting.hlsli"
+
+// 与 dx::ClusteredLightBinner / dx::ClusteredLightBuffers 对应。
+// 方向光仍然通过 dx_Lights 传入，这里只处理 point/spot light。
+
+struct ClusterRange
+{
+    uint Offset;
+    uint Count;
+};
+
+// 固定的 slot，不随包含它的 shader 中其它资源的声明而变化。BasicPS 的
+// cbuffer 用到 b2，贴图从 t0 开始。
+StructuredBuffer<Light> dx_ClusterLights : register(t8);
+StructuredBuffer<uint> dx_ClusterLightIndices : register(t9);
+StructuredBuffer<ClusterRange> dx_Clusters : register(t10);
+
+cbuffer dx_PerViewClusterGrid : register(b3)
+{
+    uint3 dx_ClusterDims;
+    uint dx_ClusterPadding;
+    // slice = log(viewZ) * SliceScale + SliceBias
+    float dx_SliceScale;
+    float dx_SliceBias;
+    // tile = SV_Position.xy * TileScale
+    float2 dx_TileScale;
+}
+
+uint ComputeClusterIndex(float2 svPosition, float viewZ)
+{
+    uint2 tile = min(uint2(svPosition * dx_TileScale), dx_ClusterDims.xy - 1);
+    int slice = int(floor(log(viewZ) * dx_SliceScale + dx_SliceBias));
+    uint z = (uint) clamp(slice, 0, int(dx_ClusterDims.z) - 1);
+    return tile.x + (tile.y + z * dx_ClusterDims.y) * dx_ClusterDims.x;
+}
+
+// SpotAngle 为圆锥半角。
+float ComputeSpotFactor(Light light, float3 lightToPos)
+{
+    float cosAngle = dot(lightToPos, normalize(light.Direction));
+    return cosAngle >= cos(light.SpotAngle) ? cosAngle : 0.f;
+}
+
+void ComputeClusteredLighting(float2 svPosition, float viewZ, float3 eyePos,
+    float3 position, float3 normal, Material material,
+    out float4 totalDiffuse, out float4 totalSpec)
+{
+    totalDiffuse = 0.f;
+    totalSpec = 0.f;
+    ClusterRange range = dx_Clusters[ComputeClusterIndex(svPosition, viewZ)];
+    float3 viewDir = eyePos - position;
+    for (uint i = 0; i < range.Count; ++i)
+    {
+        Light light = dx_ClusterLights[dx_ClusterLightIndices[range.Offset + i]];
+        float4 diffuse = 0.f, spec = 0.f;
+        ComputePointLight(material, light, position, normal, viewDir, diffuse, spec);
+        if (light.LightType == SPOT_LIGHT)
+        {
+            float3 lightToPos = normalize(position - light.Position);
+            float spotFactor = ComputeSpotFactor(light, lightToPos);
+            diffuse *= spotFactor;
+            spec *= spotFactor;
+        }
+        totalDiffuse += diffuse;
+        totalSpec += spec;
+    }
+}
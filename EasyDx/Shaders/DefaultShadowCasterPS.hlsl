@@ -1,5 +1,6 @@
 float4 main(float4 position: SV_POSITION) : SV_TARGET
 {
-	float d = position.z / position.w;
+	// 关掉深度裁剪后 z 可能超出 [0, 1]，和深度缓冲一样钳住。
+	float d = saturate(position.z / position.w);
 	return float4(d, d, d, d);
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
 #include "Basic3D.hlsli"
 
-cbuffer Cb : register(b0)
+cbuffer dx_PerObject : register(b0)
 {
 	matrix dx_WorldViewProjMatrix;
 };
@@ -0,0 +1,53 @@
+#include "pch.hpp"
+#include "ShadowCache.hpp"
+#include <cstring>
+
+namespace dx
+{
+    StaticShadowCache::StaticShadowCache(std::uint32_t cascadeCount)
+        : m_entries(cascadeCount), m_redrawCount{}
+    {
+        Invalidate();
+    }
+
+    void StaticShadowCache::Invalidate()
+    {
+        for (Entry& entry : m_entries)
+            entry.Valid = false;
+    }
+
+    bool StaticShadowCache::NeedsStaticRedraw(
+        std::uint32_t cascade, DirectX::FXMMATRIX lightViewProjection,
+        std::size_t staticCasterSignature)
+    {
+        Expects(cascade < m_entries.size());
+        DirectX::XMFLOAT4X4 matrix;
+        DirectX::XMStoreFloat4x4(&matrix, lightViewProjection);
+        Entry& entry = m_entries[cascade];
+        // 逐位比较：稳定拟合下矩阵没有变化时是完全相同的。
+        if (entry.Valid && entry.Signature == staticCasterSignature &&
+            std::memcmp(&entry.LightViewProjection, &matrix,
+                        sizeof(matrix)) == 0)
+        {
+            return false;
+        }
+        entry = Entry{matrix, staticCasterSignature, true};
+        ++m_redrawCount;
+        return true;
+    }
+
+    std::size_t HashStaticCasters(gsl::span<const RenderNode> nodes)
+    {
+        std::size_t seed = 0;
+        for (const RenderNode& node : nodes)
+        {
+            if (!node.IsStatic)
+                continue;
+            boost::hash_combine(seed, &node.mesh);
+            DirectX::XMFLOAT4X4 world;
+            DirectX::XMStoreFloat4x4(&world, node.World);
+            boost::hash_range(seed, &world.m[0][0], &world.m[0][0] + 16);
+        }
+        return seed;
+    }
+} // namespace dx
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "RenderNode.hpp"
+
+namespace dx
+{
+    // 记录每个 cascade 中静态 caster 的深度是在什么状态下生成的，判断缓存
+    // 是否还能继续使用。只负责判断，深度本身由调用者保存。
+    class StaticShadowCache
+    {
+      public:
+        explicit StaticShadowCache(std::uint32_t cascadeCount);
+
+        // 让所有 cascade 在下一次查询时重画，例如 shadow map 被重建后。
+        void Invalidate();
+
+        // light view-projection（包括光源方向和 cascade 范围）或静态 caster
+        // 的签名与缓存时不同则返回 true，并把当前状态记为已缓存：调用者
+        // 应当随后重画并保存这个 cascade 的静态深度。
+        bool NeedsStaticRedraw(std::uint32_t cascade,
+                               DirectX::FXMMATRIX lightViewProjection,
+                               std::size_t staticCasterSignature);
+
+        std::uint32_t CascadeCount() const
+        {
+            return static_cast<std::uint32_t>(m_entries.size());
+        }
+        // 累计重画的次数。
+        std::uint32_t RedrawCount() const { return m_redrawCount; }
+
+      private:
+        struct Entry
+        {
+            DirectX::XMFLOAT4X4 LightViewProjection;
+            std::size_t Signature;
+            bool Valid;
+        };
+
+        std::vector<Entry> m_entries;
+        std::uint32_t m_redrawCount;
+    };
+
+    // 由所有 IsStatic 的 node 的 mesh 与 world 矩阵求出的签名，静态几何
+    // 增删或移动后会改变。
+    std::size_t HashStaticCasters(gsl::span<const RenderNode> nodes);
+} // namespace dx
@@ -27,18 +27,29 @@ namespace dx::systems
     }
 
     void PreparePsCb(ID3D11DeviceContext& context3D, ShaderInputs& inputs,
-                     gsl::span<const dx::Light> lights,
+                     gsl::span<const cb::Light> lights,
                      const dx::Camera& camera)
     {
         // auto& globalLights = *inputs.GetCbInfo("GlobalLightingInfo");
-        inputs.SetField("EyePos", camera.GetEyePos());
-        inputs.SetField("LightCount", static_cast<std::int32_t>(lights.size()));
         auto& lightCbs = inputs.BorrowMut<dx::cb::Light[10]>("Lights");
-        std::copy(lights.begin(), lights.end(), lightCbs);
+        const auto lightCount =
+            std::min<std::ptrdiff_t>(lights.size(), std::size(lightCbs));
+        // 没有 cluster 时多出的光源只能丢掉。每帧都会调用，只报告一次。
+        static bool reported = false;
+        if (lightCount < lights.size() && !std::exchange(reported, true))
+        {
+            ::OutputDebugStringA(
+                fmt::format("PreparePsCb: {} of {} lights dropped\n",
+                            lights.size() - lightCount, lights.size())
+                    .c_str());
+        }
+        inputs.SetField("EyePos", camera.GetEyePos());
+        inputs.SetField("LightCount", static_cast<std::int32_t>(lightCount));
+        std::copy_n(lights.begin(), lightCount, lightCbs);
     }
 
     void PrepareForRendering(ID3D11DeviceContext& context3D,
-                             gsl::span<const Light> lights,
+                             gsl::span<const cb::Light> lights,
                              const Camera& camera, Material& material,
                              const DirectX::XMMATRIX& world)
     {
@@ -54,12 +65,16 @@ namespace dx::systems
         const auto meshRenderer = object.GetComponent<MeshRenderer>();
         if (meshRenderer == nullptr)
             return;
-        const auto transform = object.GetComponent<TransformComponent>();
-        PrepareForRendering(context3D, gsl::make_span(scene.Lights()),
+        // 优先使用 scene 的 TransformStore 中已经算好的矩阵。
+        const auto handle = object.GetComponent<TransformHandleComponent>();
+        const DirectX::XMMATRIX world =
+            handle != nullptr
+                ? MatrixFromTransform(scene.Transforms(), handle)
+                : MatrixFromTransform(
+                      object.GetComponent<TransformComponent>());
+        PrepareForRendering(context3D, scene.Lights().GpuLights(),
                             scene.MainCamera(), meshRenderer->GetMaterial(),
-                            transform == nullptr
-                                ? DirectX::XMMatrixIdentity()
-                                : transform->GetTransform().Matrix());
+                            world);
         DrawMesh(context3D, meshRenderer->GetMesh(),
                  meshRenderer->GetMaterial());
     }
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../Light.hpp"
+#include "../CBStructs.hpp"
 #include <DirectXMath.h>
 
 namespace dx
@@ -18,7 +18,7 @@ namespace dx
                          const DirectX::XMMATRIX& projection);
 
         void PreparePsCb(ID3D11DeviceContext& context3D, ShaderInputs& inputs,
-                         gsl::span<const dx::Light> lights,
+                         gsl::span<const cb::Light> lights,
                          const dx::Camera& camera);
 
         void SimpleRenderSystem(ID3D11DeviceContext& context3D,
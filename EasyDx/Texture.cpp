@@ -23,14 +23,23 @@ namespace dx
         return texture;
     }
 
+    // 图片文件只会从头到尾读一遍，映射之后直接交给 DirectXTex 解码。
+    MappedFile MapImageFile(const fs::path& filePath)
+    {
+        return MappedFile{filePath, MappedFileHints::kSequential |
+                                        MappedFileHints::kPrefetch};
+    }
+
     wrl::ComPtr<ID3D11Texture2D> Load2DTexFromWicFile(ID3D11Device& device,
                                                       const fs::path& filePath,
                                                       ResourceUsage usage)
     {
         DirectX::ScratchImage image;
         DirectX::TexMetadata metaData;
-        TryHR(DirectX::LoadFromWICFile(
-            filePath.c_str(), DirectX::WIC_FLAGS_NONE, &metaData, image));
+        const MappedFile file = MapImageFile(filePath);
+        TryHR(DirectX::LoadFromWICMemory(file.Bytes().data(), file.Size(),
+                                         DirectX::WIC_FLAGS_NONE, &metaData,
+                                         image));
         return MakeTexture2D(device, image, metaData, usage);
     }
 
@@ -40,7 +49,9 @@ namespace dx
     {
         DirectX::ScratchImage image;
         DirectX::TexMetadata metaData;
-        TryHR(DirectX::LoadFromTGAFile(filePath.c_str(), &metaData, image));
+        const MappedFile file = MapImageFile(filePath);
+        TryHR(DirectX::LoadFromTGAMemory(file.Bytes().data(), file.Size(),
+                                         &metaData, image));
         return MakeTexture2D(device, image, metaData, usage);
     }
 
@@ -51,8 +62,9 @@ namespace dx
     {
         DirectX::ScratchImage image;
         DirectX::TexMetadata metaData;
-        TryHR(DirectX::LoadFromDDSFile(filePath.c_str(), ddsFlags, &metaData,
-                                       image));
+        const MappedFile file = MapImageFile(filePath);
+        TryHR(DirectX::LoadFromDDSMemory(file.Bytes().data(), file.Size(),
+                                         ddsFlags, &metaData, image));
         return MakeTexture2D(device, image, metaData, usage);
     }
 
@@ -105,6 +117,36 @@ namespace dx
         }
     }
 
+    wrl::ComPtr<ID3D11Texture2D>
+    Load2DTexFromArchive(ID3D11Device& device, const AssetArchive& archive,
+                         std::string_view name, ResourceUsage usage)
+    {
+        DirectX::ScratchImage image;
+        DirectX::TexMetadata metaData;
+        const ArchiveBytes file = archive.Read(name);
+        const auto bytes = file.Bytes();
+        const auto size = static_cast<std::size_t>(bytes.size());
+        const auto format = fs::path{name}.extension();
+        if (format == L".tga")
+        {
+            TryHR(DirectX::LoadFromTGAMemory(bytes.data(), size, &metaData,
+                                             image));
+        }
+        else if (format == L".dds")
+        {
+            TryHR(DirectX::LoadFromDDSMemory(bytes.data(), size,
+                                             DirectX::DDS_FLAGS_NONE,
+                                             &metaData, image));
+        }
+        else
+        {
+            TryHR(DirectX::LoadFromWICMemory(bytes.data(), size,
+                                             DirectX::WIC_FLAGS_NONE,
+                                             &metaData, image));
+        }
+        return MakeTexture2D(device, image, metaData, usage);
+    }
+
     wrl::ComPtr<ID3D11ShaderResourceView> Get2DTexView(ID3D11Device& device,
                                                        ID3D11Texture2D& texture)
     {
@@ -119,4 +161,18 @@ namespace dx
                                               view.ReleaseAndGetAddressOf()));
         return view;
     }
+
+    AssetWatcher::WatchId WatchTexture(
+        AssetWatcher& watcher, ID3D11Device& device, fs::path filePath,
+        std::function<void(wrl::ComPtr<ID3D11ShaderResourceView>)> replace,
+        ResourceUsage usage)
+    {
+        return watcher.Watch(
+            {filePath}, [&device, filePath, replace = std::move(replace),
+                         usage]() -> ReloadedAsset {
+                const auto texture = Load2DTexFromFile(device, filePath, usage);
+                auto view = Get2DTexView(device, Ref(texture));
+                return {[view, replace] { replace(view); }, {}};
+            });
+    }
 } // namespace dx
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "AssetWatcher.hpp"
+#include "AssetArchive.hpp"
+
 namespace dx
 {
     wrl::ComPtr<ID3D11Texture2D>
@@ -19,7 +22,20 @@ namespace dx
     wrl::ComPtr<ID3D11Texture2D>
     Load2DTexFromFile(ID3D11Device& device, const fs::path& filePath,
                       ResourceUsage usage = ResourceUsage::Default);
+    // 与 Load2DTexFromFile 一样按 name 的扩展名选择格式。未压缩的条目直接
+    // 从映射的包中解码，不需要额外的拷贝。
+    wrl::ComPtr<ID3D11Texture2D>
+    Load2DTexFromArchive(ID3D11Device& device, const AssetArchive& archive,
+                         std::string_view name,
+                         ResourceUsage usage = ResourceUsage::Default);
     wrl::ComPtr<ID3D11ShaderResourceView>
     Get2DTexView(ID3D11Device& device, ID3D11Texture2D& texture);
 
+    // filePath 变化时在后台用 Load2DTexFromFile 重新加载，然后在帧之间把
+    // 新的 view 交给 replace。
+    AssetWatcher::WatchId WatchTexture(
+        AssetWatcher& watcher, ID3D11Device& device, fs::path filePath,
+        std::function<void(wrl::ComPtr<ID3D11ShaderResourceView>)> replace,
+        ResourceUsage usage = ResourceUsage::Default);
+
 } // namespace dx
\ No newline at end of file
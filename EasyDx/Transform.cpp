@@ -52,6 +52,7 @@ namespace dx
             const auto scale = XMLoadFloat3(&m_scale);
             m_data->Matrix = XMMatrixAffineTransformation(
                 scale, XMVectorZero(), m_data->Rotation, position);
+            m_dirty = false;
         }
         return m_data->Matrix;
     }
@@ -61,4 +62,12 @@ namespace dx
         return transform == nullptr ? DirectX::XMMatrixIdentity()
                                     : transform->GetTransform().Matrix();
     }
+
+    DirectX::XMMATRIX
+    MatrixFromTransform(const TransformStore& store,
+                        const dx::TransformHandleComponent* handle)
+    {
+        return handle == nullptr ? DirectX::XMMatrixIdentity()
+                                 : store.WorldMatrix(handle->GetHandle());
+    }
 } // namespace dx
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "ComponentBase.hpp"
 #include "AlignedAllocator.hpp"
+#include "TransformStore.hpp"
 #include <DirectXMath.h>
 
 namespace dx
@@ -42,5 +43,8 @@ namespace dx
     DEF_COMPONENT_WRAPPER_DEFAULT(Transform, GetTransform)
 
     DirectX::XMMATRIX MatrixFromTransform(dx::TransformComponent* transform);
+    DirectX::XMMATRIX
+    MatrixFromTransform(const TransformStore& store,
+                        const dx::TransformHandleComponent* handle);
 
 } // namespace dx
\ No newline at end of file
@@ -0,0 +1,428 @@
+#include "pch.hpp"
+#include "TransformStore.hpp"
+
+namespace dx
+{
+    constexpr std::uint32_t kGroupSize = 4;
+    constexpr std::uint32_t kBitsPerWord = 64;
+    constexpr std::uint32_t kGroupsPerWord = kBitsPerWord / kGroupSize;
+    constexpr std::size_t kParallelWordThreshold = 32;
+    constexpr std::size_t kParallelLevelThreshold = 1024;
+    constexpr std::uint32_t kNoParent = UINT32_MAX;
+    constexpr std::uint32_t kNoSlot = UINT32_MAX;
+
+    TransformHandle TransformStore::Create()
+    {
+        using namespace DirectX;
+        return Create(XMVectorSplatOne(), XMQuaternionIdentity(),
+                      XMVectorZero());
+    }
+
+    TransformHandle TransformStore::Create(DirectX::FXMVECTOR scale,
+                                           DirectX::FXMVECTOR rotation,
+                                           DirectX::FXMVECTOR translation)
+    {
+        const std::uint32_t slot = AllocateSlot();
+        SetLanes(slot, kPositionX, translation, 3);
+        SetLanes(slot, kRotationX, rotation, 4);
+        SetLanes(slot, kScaleX, scale, 3);
+        MarkDirty(slot);
+        return TransformHandle{slot, m_generations[slot]};
+    }
+
+    std::uint32_t TransformStore::AllocateSlot()
+    {
+        using namespace DirectX;
+        if (!m_freeSlots.empty())
+        {
+            const std::uint32_t slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+            return slot;
+        }
+        const auto slot = static_cast<std::uint32_t>(m_generations.size());
+        m_generations.push_back(0);
+        m_parents.push_back(kNoParent);
+        m_firstChildren.push_back(kNoSlot);
+        m_nextSiblings.push_back(kNoSlot);
+        m_prevSiblings.push_back(kNoSlot);
+        m_depths.push_back(0);
+        m_queued.push_back(0);
+        if (slot % kGroupSize == 0)
+        {
+            // 新的 4 元组，未使用的 lane 保持为单位变换。
+            for (std::uint32_t lane = 0; lane < kLaneCount; ++lane)
+            {
+                const bool isOne = lane == kRotationW || lane >= kScaleX;
+                m_lanes[lane].push_back(isOne ? XMVectorSplatOne()
+                                              : XMVectorZero());
+            }
+            m_locals.insert(m_locals.end(), kGroupSize, XMMatrixIdentity());
+            m_worlds.insert(m_worlds.end(), kGroupSize, XMMatrixIdentity());
+        }
+        if (slot % kBitsPerWord == 0)
+        {
+            m_dirtyWords.push_back(0);
+        }
+        return slot;
+    }
+
+    void TransformStore::Destroy(TransformHandle handle)
+    {
+        const std::uint32_t slot = Slot(handle);
+        ++m_generations[slot];
+        m_freeSlots.push_back(slot);
+        if (m_parents[slot] != kNoParent)
+            Unlink(slot);
+        m_dirtyWords[slot / kBitsPerWord] &=
+            ~(std::uint64_t{1} << (slot % kBitsPerWord));
+        // 子节点成为根节点。
+        for (std::uint32_t child = m_firstChildren[slot]; child != kNoSlot;)
+        {
+            const std::uint32_t next = m_nextSiblings[child];
+            m_parents[child] = kNoParent;
+            m_nextSiblings[child] = kNoSlot;
+            m_prevSiblings[child] = kNoSlot;
+            SetSubtreeDepth(child, 0);
+            MarkDirty(child);
+            child = next;
+        }
+        m_firstChildren[slot] = kNoSlot;
+        m_depths[slot] = 0;
+    }
+
+    void TransformStore::Link(std::uint32_t child, std::uint32_t parent)
+    {
+        const std::uint32_t next = m_firstChildren[parent];
+        m_parents[child] = parent;
+        m_nextSiblings[child] = next;
+        m_prevSiblings[child] = kNoSlot;
+        if (next != kNoSlot)
+            m_prevSiblings[next] = child;
+        m_firstChildren[parent] = child;
+    }
+
+    void TransformStore::Unlink(std::uint32_t child)
+    {
+        const std::uint32_t prev = m_prevSiblings[child];
+        const std::uint32_t next = m_nextSiblings[child];
+        if (prev != kNoSlot)
+            m_nextSiblings[prev] = next;
+        else
+            m_firstChildren[m_parents[child]] = next;
+        if (next != kNoSlot)
+            m_prevSiblings[next] = prev;
+        m_parents[child] = kNoParent;
+        m_nextSiblings[child] = kNoSlot;
+        m_prevSiblings[child] = kNoSlot;
+    }
+
+    // 顺着子节点和兄弟链表做先序遍历，回溯时沿 parent 向上，不需要栈。
+    void TransformStore::SetSubtreeDepth(std::uint32_t root,
+                                         std::uint32_t depth)
+    {
+        m_depths[root] = depth;
+        std::uint32_t slot = root;
+        for (;;)
+        {
+            const std::uint32_t child = m_firstChildren[slot];
+            if (child != kNoSlot)
+            {
+                m_depths[child] = m_depths[slot] + 1;
+                slot = child;
+                continue;
+            }
+            while (slot != root && m_nextSiblings[slot] == kNoSlot)
+                slot = m_parents[slot];
+            if (slot == root)
+                return;
+            slot = m_nextSiblings[slot];
+            m_depths[slot] = m_depths[m_parents[slot]] + 1;
+        }
+    }
+
+    void TransformStore::SetParent(TransformHandle child,
+                                   TransformHandle parent)
+    {
+        const std::uint32_t childSlot = Slot(child);
+        std::uint32_t parentSlot = kNoParent;
+        if (parent != TransformHandle{})
+        {
+            parentSlot = Slot(parent);
+            for (std::uint32_t i = parentSlot; i != kNoParent;
+                 i = m_parents[i])
+            {
+                Expects(i != childSlot);
+            }
+        }
+        if (m_parents[childSlot] == parentSlot)
+            return;
+        if (m_parents[childSlot] != kNoParent)
+            Unlink(childSlot);
+        if (parentSlot != kNoParent)
+            Link(childSlot, parentSlot);
+        SetSubtreeDepth(childSlot,
+                        parentSlot == kNoParent ? 0 : m_depths[parentSlot] + 1);
+        MarkDirty(childSlot);
+    }
+
+    TransformHandle TransformStore::Parent(TransformHandle handle) const
+    {
+        const std::uint32_t parent = m_parents[Slot(handle)];
+        return parent == kNoParent
+                   ? TransformHandle{}
+                   : TransformHandle{parent, m_generations[parent]};
+    }
+
+    bool TransformStore::IsAlive(TransformHandle handle) const
+    {
+        return handle.Index < m_generations.size() &&
+               m_generations[handle.Index] == handle.Generation;
+    }
+
+    std::uint32_t TransformStore::AliveCount() const
+    {
+        return static_cast<std::uint32_t>(m_generations.size() -
+                                          m_freeSlots.size());
+    }
+
+    std::uint32_t TransformStore::Slot(TransformHandle handle) const
+    {
+        Expects(IsAlive(handle));
+        return handle.Index;
+    }
+
+    void TransformStore::SetLanes(std::uint32_t slot, Lane first,
+                                  DirectX::FXMVECTOR value,
+                                  std::uint32_t count)
+    {
+        const std::uint32_t group = slot / kGroupSize;
+        const std::uint32_t lane = slot % kGroupSize;
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            DirectX::XMVECTOR& lanes = m_lanes[first + i][group];
+            lanes = DirectX::XMVectorSetByIndex(
+                lanes, DirectX::XMVectorGetByIndex(value, i), lane);
+        }
+    }
+
+    DirectX::XMVECTOR TransformStore::GetLanes(std::uint32_t slot,
+                                               Lane first) const
+    {
+        const std::uint32_t group = slot / kGroupSize;
+        const std::uint32_t lane = slot % kGroupSize;
+        const std::uint32_t count = first == kRotationX ? 4 : 3;
+        DirectX::XMVECTOR result = DirectX::XMVectorZero();
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            result = DirectX::XMVectorSetByIndex(
+                result,
+                DirectX::XMVectorGetByIndex(m_lanes[first + i][group], lane),
+                i);
+        }
+        return result;
+    }
+
+    void TransformStore::MarkDirty(std::uint32_t slot)
+    {
+        m_dirtyWords[slot / kBitsPerWord] |= std::uint64_t{1}
+                                             << (slot % kBitsPerWord);
+    }
+
+    bool TransformStore::IsDirty(std::uint32_t slot) const
+    {
+        return (m_dirtyWords[slot / kBitsPerWord] >> (slot % kBitsPerWord)) &
+               1;
+    }
+
+    DirectX::XMVECTOR TransformStore::Position(TransformHandle handle) const
+    {
+        return GetLanes(Slot(handle), kPositionX);
+    }
+
+    DirectX::XMVECTOR TransformStore::Rotation(TransformHandle handle) const
+    {
+        return GetLanes(Slot(handle), kRotationX);
+    }
+
+    DirectX::XMVECTOR TransformStore::Scale(TransformHandle handle) const
+    {
+        return GetLanes(Slot(handle), kScaleX);
+    }
+
+    void TransformStore::SetPosition(TransformHandle handle,
+                                     DirectX::FXMVECTOR position)
+    {
+        const std::uint32_t slot = Slot(handle);
+        SetLanes(slot, kPositionX, position, 3);
+        MarkDirty(slot);
+    }
+
+    void TransformStore::SetRotation(TransformHandle handle,
+                                     DirectX::FXMVECTOR rotation)
+    {
+        const std::uint32_t slot = Slot(handle);
+        SetLanes(slot, kRotationX, rotation, 4);
+        MarkDirty(slot);
+    }
+
+    void TransformStore::SetScale(TransformHandle handle,
+                                  DirectX::FXMVECTOR scale)
+    {
+        const std::uint32_t slot = Slot(handle);
+        SetLanes(slot, kScaleX, scale, 3);
+        MarkDirty(slot);
+    }
+
+    const DirectX::XMMATRIX&
+    TransformStore::LocalMatrix(TransformHandle handle) const
+    {
+        return m_locals[Slot(handle)];
+    }
+
+    const DirectX::XMMATRIX&
+    TransformStore::WorldMatrix(TransformHandle handle) const
+    {
+        return m_worlds[Slot(handle)];
+    }
+
+    // 与 XMMatrixAffineTransformation(scale, 0, rotation, translation)
+    // 相同，只是 4 个 transform 同时计算：每个 XMVECTOR 的 4 个 lane 分别
+    // 属于 4 个不同的矩阵，最后转置得到各自的行。
+    void TransformStore::ComposeGroup(std::size_t group)
+    {
+        using namespace DirectX;
+        const auto lanes = [&](Lane lane) { return m_lanes[lane][group]; };
+        const XMVECTOR x = lanes(kRotationX);
+        const XMVECTOR y = lanes(kRotationY);
+        const XMVECTOR z = lanes(kRotationZ);
+        const XMVECTOR w = lanes(kRotationW);
+        const XMVECTOR one = XMVectorSplatOne();
+        const XMVECTOR two = XMVectorReplicate(2.0f);
+        const XMVECTOR x2 = XMVectorMultiply(x, two);
+        const XMVECTOR y2 = XMVectorMultiply(y, two);
+        const XMVECTOR z2 = XMVectorMultiply(z, two);
+        const XMVECTOR xx = XMVectorMultiply(x, x2);
+        const XMVECTOR yy = XMVectorMultiply(y, y2);
+        const XMVECTOR zz = XMVectorMultiply(z, z2);
+        const XMVECTOR xy = XMVectorMultiply(x, y2);
+        const XMVECTOR xz = XMVectorMultiply(x, z2);
+        const XMVECTOR yz = XMVectorMultiply(y, z2);
+        const XMVECTOR wx = XMVectorMultiply(w, x2);
+        const XMVECTOR wy = XMVectorMultiply(w, y2);
+        const XMVECTOR wz = XMVectorMultiply(w, z2);
+
+        const XMVECTOR sx = lanes(kScaleX);
+        const XMVECTOR sy = lanes(kScaleY);
+        const XMVECTOR sz = lanes(kScaleZ);
+        const XMVECTOR zero = XMVectorZero();
+        const XMMATRIX row0 = XMMatrixTranspose(XMMATRIX{
+            XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(yy, zz)), sx),
+            XMVectorMultiply(XMVectorAdd(xy, wz), sx),
+            XMVectorMultiply(XMVectorSubtract(xz, wy), sx), zero});
+        const XMMATRIX row1 = XMMatrixTranspose(XMMATRIX{
+            XMVectorMultiply(XMVectorSubtract(xy, wz), sy),
+            XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(xx, zz)), sy),
+            XMVectorMultiply(XMVectorAdd(yz, wx), sy), zero});
+        const XMMATRIX row2 = XMMatrixTranspose(XMMATRIX{
+            XMVectorMultiply(XMVectorAdd(xz, wy), sz),
+            XMVectorMultiply(XMVectorSubtract(yz, wx), sz),
+            XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(xx, yy)), sz),
+            zero});
+        const XMMATRIX row3 = XMMatrixTranspose(
+            XMMATRIX{lanes(kPositionX), lanes(kPositionY), lanes(kPositionZ),
+                     one});
+        XMMATRIX* locals = &m_locals[group * kGroupSize];
+        for (std::uint32_t i = 0; i < kGroupSize; ++i)
+        {
+            locals[i] = XMMATRIX{row0.r[i], row1.r[i], row2.r[i], row3.r[i]};
+        }
+    }
+
+    void TransformStore::Enqueue(std::uint32_t slot)
+    {
+        if (m_queued[slot])
+            return;
+        m_queued[slot] = 1;
+        const std::uint32_t depth = m_depths[slot];
+        if (m_levelQueues.size() <= depth)
+            m_levelQueues.resize(depth + 1);
+        m_levelQueues[depth].push_back(slot);
+    }
+
+    void TransformStore::UpdateWorld(std::uint32_t slot)
+    {
+        const std::uint32_t parent = m_parents[slot];
+        m_worlds[slot] = parent == kNoParent
+                             ? m_locals[slot]
+                             : DirectX::XMMatrixMultiply(m_locals[slot],
+                                                         m_worlds[parent]);
+    }
+
+    std::uint32_t TransformStore::UpdateWorldMatrices()
+    {
+        const std::size_t groupCount = m_locals.size() / kGroupSize;
+        ParallelFor(
+            m_dirtyWords.size(), kParallelWordThreshold,
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t word = begin; word < end; ++word)
+                {
+                    const std::uint64_t bits = m_dirtyWords[word];
+                    if (bits == 0)
+                        continue;
+                    for (std::size_t i = 0; i < kGroupsPerWord; ++i)
+                    {
+                        const std::size_t group = word * kGroupsPerWord + i;
+                        if (((bits >> (i * kGroupSize)) & 0xF) != 0 &&
+                            group < groupCount)
+                        {
+                            ComposeGroup(group);
+                        }
+                    }
+                }
+            });
+
+        // dirty 项按深度入队，每层算完后把子节点放进下一层。
+        for (std::size_t word = 0; word < m_dirtyWords.size(); ++word)
+        {
+            const std::uint64_t bits = m_dirtyWords[word];
+            if (bits == 0)
+                continue;
+            for (std::uint32_t i = 0; i < kBitsPerWord; ++i)
+            {
+                if ((bits >> i) & 1)
+                    Enqueue(static_cast<std::uint32_t>(word * kBitsPerWord +
+                                                       i));
+            }
+        }
+        std::uint32_t updatedCount = 0;
+        // 每层只依赖上一层的结果，层内各项互不相关。Enqueue 可能让
+        // m_levelQueues 扩容，所以每次都按下标访问。
+        for (std::size_t level = 0; level < m_levelQueues.size(); ++level)
+        {
+            const std::size_t count = m_levelQueues[level].size();
+            ParallelFor(count, kParallelLevelThreshold,
+                        [&](std::size_t begin, std::size_t end) {
+                            for (std::size_t i = begin; i < end; ++i)
+                                UpdateWorld(m_levelQueues[level][i]);
+                        });
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const std::uint32_t slot = m_levelQueues[level][i];
+                for (std::uint32_t child = m_firstChildren[slot];
+                     child != kNoSlot; child = m_nextSiblings[child])
+                {
+                    Enqueue(child);
+                }
+            }
+            updatedCount += static_cast<std::uint32_t>(count);
+        }
+        for (std::vector<std::uint32_t>& queue : m_levelQueues)
+        {
+            for (const std::uint32_t slot : queue)
+                m_queued[slot] = 0;
+            queue.clear();
+        }
+        std::fill(m_dirtyWords.begin(), m_dirtyWords.end(), 0);
+        return updatedCount;
+    }
+} // namespace dx
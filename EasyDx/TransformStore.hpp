@@ -0,0 +1,121 @@
+#pragma once
+
+#include "ComponentBase.hpp"
+#include "AlignedAllocator.hpp"
+#include <DirectXMath.h>
+
+namespace dx
+{
+    // TransformStore 中一项的句柄。对应的项被 Destroy 后 Generation 不再匹配，
+    // 因此旧句柄不会误指向复用了同一槽位的新项。
+    struct TransformHandle
+    {
+        std::uint32_t Index = UINT32_MAX;
+        std::uint32_t Generation = 0;
+    };
+
+    inline bool operator==(TransformHandle lhs, TransformHandle rhs)
+    {
+        return lhs.Index == rhs.Index && lhs.Generation == rhs.Generation;
+    }
+
+    inline bool operator!=(TransformHandle lhs, TransformHandle rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    DEF_COMPONENT_WRAPPER_DEFAULT(TransformHandle, GetHandle)
+
+    // 以 SoA 保存 position/rotation/scale：每个分量一个数组，数组中的每个
+    // XMVECTOR 存 4 个 transform 的同一分量，这样 UpdateWorldMatrices 可以
+    // 一次组合 4 个矩阵。只有 dirty 的 4 元组会被重新计算。
+    //
+    // 每项可以有一个 parent，position/rotation/scale 都是相对 parent 的。
+    // world 矩阵按深度逐层计算，同一层内并行。每次更新只访问 dirty 的项
+    // 以及它们的子树（顺着子节点链表找到），干净的层级不会被遍历。
+    class TransformStore : Noncopyable
+    {
+      public:
+        TransformStore() = default;
+        DEFAULT_MOVE(TransformStore)
+
+        TransformHandle Create();
+        TransformHandle Create(DirectX::FXMVECTOR scale,
+                               DirectX::FXMVECTOR rotation,
+                               DirectX::FXMVECTOR translation);
+        void Destroy(TransformHandle handle);
+        bool IsAlive(TransformHandle handle) const;
+        std::uint32_t AliveCount() const;
+
+        DirectX::XMVECTOR Position(TransformHandle handle) const;
+        DirectX::XMVECTOR Rotation(TransformHandle handle) const;
+        DirectX::XMVECTOR Scale(TransformHandle handle) const;
+        void SetPosition(TransformHandle handle, DirectX::FXMVECTOR position);
+        // rotation 必须是单位四元数。
+        void SetRotation(TransformHandle handle, DirectX::FXMVECTOR rotation);
+        void SetScale(TransformHandle handle, DirectX::FXMVECTOR scale);
+
+        // parent 为默认构造的句柄时 child 成为根节点。不能形成环。
+        void SetParent(TransformHandle child, TransformHandle parent);
+        // 根节点返回默认构造的句柄。
+        TransformHandle Parent(TransformHandle handle) const;
+
+        // 重新计算所有 dirty 项及其子树的矩阵，项多时并行。返回重新计算
+        // 了 world 矩阵的项数。
+        std::uint32_t UpdateWorldMatrices();
+        // 以下两个返回上一次 UpdateWorldMatrices 的结果。
+        const DirectX::XMMATRIX& LocalMatrix(TransformHandle handle) const;
+        const DirectX::XMMATRIX& WorldMatrix(TransformHandle handle) const;
+
+      private:
+        enum Lane
+        {
+            kPositionX,
+            kPositionY,
+            kPositionZ,
+            kRotationX,
+            kRotationY,
+            kRotationZ,
+            kRotationW,
+            kScaleX,
+            kScaleY,
+            kScaleZ,
+            kLaneCount
+        };
+
+        std::uint32_t Slot(TransformHandle handle) const;
+        std::uint32_t AllocateSlot();
+        void SetLanes(std::uint32_t slot, Lane first, DirectX::FXMVECTOR value,
+                      std::uint32_t count);
+        DirectX::XMVECTOR GetLanes(std::uint32_t slot, Lane first) const;
+        void MarkDirty(std::uint32_t slot);
+        bool IsDirty(std::uint32_t slot) const;
+        void ComposeGroup(std::size_t group);
+        void Link(std::uint32_t child, std::uint32_t parent);
+        void Unlink(std::uint32_t child);
+        void SetSubtreeDepth(std::uint32_t root, std::uint32_t depth);
+        void Enqueue(std::uint32_t slot);
+        void UpdateWorld(std::uint32_t slot);
+
+        std::array<AlignedVec<DirectX::XMVECTOR>, kLaneCount> m_lanes;
+        AlignedVec<DirectX::XMMATRIX> m_locals;
+        AlignedVec<DirectX::XMMATRIX> m_worlds;
+        // 每个 bit 对应一项，表示 local 需要重新计算。
+        std::vector<std::uint64_t> m_dirtyWords;
+        std::vector<std::uint32_t> m_generations;
+        std::vector<std::uint32_t> m_freeSlots;
+
+        std::vector<std::uint32_t> m_parents;
+        // 同一 parent 的子节点串成双向链表，改 parent 和 Destroy 只需要
+        // 访问相关的子节点。
+        std::vector<std::uint32_t> m_firstChildren;
+        std::vector<std::uint32_t> m_nextSiblings;
+        std::vector<std::uint32_t> m_prevSiblings;
+        // 根节点为 0，改 parent 时整个子树一起更新。
+        std::vector<std::uint32_t> m_depths;
+        // 本次更新中已经放进 m_levelQueues 的项。
+        std::vector<std::uint8_t> m_queued;
+        // 第 i 层需要重新计算 world 的项，跨帧复用以免重复分配。
+        std::vector<std::vector<std::uint32_t>> m_levelQueues;
+    };
+} // namespace dx
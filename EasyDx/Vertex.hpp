@@ -28,6 +28,18 @@ namespace dx
         kPerinstance = 1
     };
 
+    // How the channels of a mesh are laid out in GPU vertex buffers.
+    enum class StreamLayout
+    {
+        // one vertex buffer per channel.
+        kPerChannel,
+        // all channels packed into a single vertex buffer.
+        kInterleaved,
+        // positions in their own buffer (for depth/shadow passes), the rest
+        // interleaved in a second one.
+        kInterleavedWithPositionStream
+    };
+
     constexpr const char* NameFromSemantic(VSSemantics semantic)
     {
         switch (semantic)
@@ -63,8 +75,9 @@ namespace dx
             case VSSemantics::kNormal:
             case VSSemantics::kPosition:
             case VSSemantics::kTransformedPosition:
-            case VSSemantics::kTangent:
                 return DxgiFormat::R32G32B32Float;
+            case VSSemantics::kTangent:
+                return DxgiFormat::R32G32B32A32Float;
             case VSSemantics::kTexCoord:
                 return DxgiFormat::R32G32Float;
             default:
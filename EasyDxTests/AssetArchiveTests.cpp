@@ -0,0 +1,204 @@
+#include "Pch.hpp"
+#include <EasyDx/AssetArchive.hpp>
+#include <catch.hpp>
+#include <cstring>
+#include <fstream>
+
+using namespace dx;
+
+namespace
+{
+    gsl::span<const std::byte> AsBytes(const std::string& str)
+    {
+        return {reinterpret_cast<const std::byte*>(str.data()),
+                static_cast<std::ptrdiff_t>(str.size())};
+    }
+
+    std::string AsString(gsl::span<const std::byte> bytes)
+    {
+        return std::string(reinterpret_cast<const char*>(bytes.data()),
+                           static_cast<std::size_t>(bytes.size()));
+    }
+
+    fs::path TestDirectory()
+    {
+        const fs::path directory =
+            fs::temp_directory_path() / "EasyDxAssetArchiveTests";
+        fs::remove_all(directory);
+        fs::create_directories(directory);
+        return directory;
+    }
+} // namespace
+
+TEST_CASE("Archive entries can be found by name", "[AssetArchive]")
+{
+    const fs::path directory = TestDirectory();
+    const fs::path path = directory / "Assets.dxar";
+    const std::string big(200000, 'b');
+    {
+        AssetArchiveWriter writer{path};
+        writer.Add("Shaders/Basic.cso", AsBytes("cso"));
+        writer.Add("Textures/Big.dds", AsBytes(big));
+        writer.Add("Empty", AsBytes(""));
+        CHECK_THROWS_AS(writer.Add("Empty", AsBytes("again")),
+                        AssetArchiveError);
+        writer.Finish();
+    }
+
+    const AssetArchive archive{path};
+    REQUIRE(archive.EntryCount() == 3);
+    CHECK(archive.Contains("Shaders/Basic.cso"));
+    CHECK_FALSE(archive.Contains("Shaders/Missing.cso"));
+    CHECK_FALSE(archive.Find("Shaders/Missing.cso").has_value());
+    CHECK(AsString(archive.View("Shaders/Basic.cso")) == "cso");
+    CHECK(archive.View("Empty").size() == 0);
+
+    const ArchiveBytes bigBytes = archive.Read("Textures/Big.dds");
+    CHECK(bigBytes.IsZeroCopy());
+    CHECK(AsString(bigBytes.Bytes()) == big);
+
+    const auto info = archive.Find("Textures/Big.dds");
+    REQUIRE(info.has_value());
+    CHECK(info->Name == "Textures/Big.dds");
+    CHECK(info->Size == big.size());
+    CHECK(info->StoredSize == big.size());
+    CHECK(info->Compression == ArchiveCompression::kNone);
+
+    // 每个条目都从 64 KiB 边界开始，第一个条目之前只有文件头。
+    const std::byte* const first = archive.View("Shaders/Basic.cso").data();
+    const auto distance = bigBytes.Bytes().data() - first;
+    CHECK(distance == static_cast<std::ptrdiff_t>(kArchiveAlignment));
+    const MappedFile raw{path};
+    CHECK(raw.Size() > 2 * kArchiveAlignment + big.size());
+
+    CHECK_THROWS_AS(archive.Read("Missing"), AssetArchiveError);
+    CHECK_THROWS_AS(archive.View("Missing"), AssetArchiveError);
+    fs::remove_all(directory);
+}
+
+TEST_CASE("Archives are built from directories", "[AssetArchive]")
+{
+    const fs::path directory = TestDirectory();
+    const fs::path root = directory / "Assets";
+    fs::create_directories(root / "Textures" / "Sky");
+    std::ofstream{root / "Basic.cso", std::ios::binary} << "shader";
+    std::ofstream{root / "Textures" / "Sky" / "Day.png",
+                  std::ios::binary} << "png";
+
+    const fs::path path = directory / "Assets.dxar";
+    {
+        AssetArchiveWriter writer{path};
+        writer.AddDirectory(root);
+        writer.Finish();
+    }
+    const AssetArchive archive{path};
+    REQUIRE(archive.EntryCount() == 2);
+    CHECK(archive.EntryAt(0).Name == "Basic.cso");
+    CHECK(archive.EntryAt(1).Name == "Textures/Sky/Day.png");
+    CHECK(ArchiveName(fs::path{"Textures"} / "Sky" / "Day.png") ==
+          "Textures/Sky/Day.png");
+    CHECK(AsString(archive.View(ArchiveName(fs::path{"Textures"} / "Sky" /
+                                            "Day.png"))) == "png");
+    fs::remove_all(directory);
+}
+
+TEST_CASE("Archives reject unsupported or corrupted data", "[AssetArchive]")
+{
+    const fs::path directory = TestDirectory();
+    const fs::path path = directory / "Assets.dxar";
+    {
+        AssetArchiveWriter writer{path};
+        const std::string repeated(100000, 'r');
+        for (const auto compression :
+             {ArchiveCompression::kLz4, ArchiveCompression::kZstd})
+        {
+            if (IsCompressionSupported(compression))
+                writer.Add(compression == ArchiveCompression::kLz4 ? "Lz4"
+                                                                   : "Zstd",
+                           AsBytes(repeated), compression);
+            else
+                CHECK_THROWS_AS(
+                    writer.Add("Unsupported", AsBytes(repeated), compression),
+                    AssetArchiveError);
+        }
+        writer.Finish();
+    }
+    {
+        const AssetArchive archive{path};
+        for (std::size_t i = 0; i < archive.EntryCount(); ++i)
+        {
+            const ArchiveEntryInfo info = archive.EntryAt(i);
+            CHECK(info.StoredSize < info.Size);
+            const ArchiveBytes bytes = archive.Read(info.Name);
+            CHECK_FALSE(bytes.IsZeroCopy());
+            CHECK(AsString(bytes.Bytes()) == std::string(100000, 'r'));
+            CHECK_THROWS_AS(archive.View(info.Name), AssetArchiveError);
+        }
+    }
+
+    // 没有 Finish 的文件头是空的。
+    const fs::path unfinished = directory / "Unfinished.dxar";
+    {
+        AssetArchiveWriter writer{unfinished};
+        writer.Add("Data", AsBytes("data"));
+    }
+    CHECK_THROWS_AS(AssetArchive{unfinished}, AssetArchiveError);
+
+    std::ofstream{directory / "Short.dxar", std::ios::binary} << "DXAR";
+    CHECK_THROWS_AS(AssetArchive{directory / "Short.dxar"}, AssetArchiveError);
+
+    // 目录指向文件之外。
+    {
+        std::fstream file{path,
+                          std::ios::binary | std::ios::in | std::ios::out};
+        file.seekp(32);
+        const char huge[8] = {0, 0, 0, 0, 0, 0, 0, 0x7f};
+        file.write(huge, sizeof(huge));
+    }
+    CHECK_THROWS_AS(AssetArchive{path}, AssetArchiveError);
+    fs::remove_all(directory);
+}
+
+TEST_CASE("Archives reject corrupted hash tables", "[AssetArchive]")
+{
+    const fs::path directory = TestDirectory();
+    const fs::path path = directory / "Assets.dxar";
+    {
+        AssetArchiveWriter writer{path};
+        writer.Add("A", AsBytes("a"));
+        writer.Add("B", AsBytes("b"));
+        writer.Finish();
+    }
+    std::uint32_t bucketCount = 0;
+    std::uint64_t bucketsOffset = 0;
+    {
+        // 文件头中的桶数和桶的位置，小端。
+        const MappedFile raw{path};
+        const std::byte* const header = raw.Bytes().data();
+        std::memcpy(&bucketCount, header + 12, sizeof(bucketCount));
+        std::memcpy(&bucketsOffset, header + 16, sizeof(bucketsOffset));
+    }
+    const auto fillBuckets = [&](auto&& slotAt) {
+        std::fstream file{path,
+                          std::ios::binary | std::ios::in | std::ios::out};
+        file.seekp(static_cast<std::streamoff>(bucketsOffset));
+        for (std::uint32_t i = 0; i < bucketCount; ++i)
+        {
+            const std::uint32_t slot = slotAt(i);
+            file.write(reinterpret_cast<const char*>(&slot), sizeof(slot));
+        }
+    };
+
+    // 所有桶都不为空时查找不会停下来，打开时就要报错。
+    fillBuckets([](std::uint32_t i) { return i % 2 + 1; });
+    CHECK_THROWS_AS(AssetArchive{path}, AssetArchiveError);
+
+    // 条目数对上了，但同一个条目出现了两次。
+    fillBuckets([](std::uint32_t i) { return i < 2 ? 1u : 0u; });
+    CHECK_THROWS_AS(AssetArchive{path}, AssetArchiveError);
+
+    // 有条目不在任何桶中。
+    fillBuckets([](std::uint32_t i) { return i == 0 ? 1u : 0u; });
+    CHECK_THROWS_AS(AssetArchive{path}, AssetArchiveError);
+    fs::remove_all(directory);
+}
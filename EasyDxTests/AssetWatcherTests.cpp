@@ -0,0 +1,162 @@
+#include <EasyDx/AssetWatcher.hpp>
+#include <EasyDx/Resources/ShaderCache.hpp>
+#include <catch.hpp>
+#include <fstream>
+#include <stdexcept>
+
+using namespace dx;
+
+namespace
+{
+    // 修改时间的精度可能很粗，直接把时间往后推，保证能被发现。
+    void Touch(const fs::path& path, const std::string& content)
+    {
+        const bool existed = fs::exists(path);
+        const auto before =
+            existed ? fs::last_write_time(path) : fs::file_time_type{};
+        std::ofstream{path, std::ios::trunc} << content;
+        if (existed)
+            fs::last_write_time(path, before + std::chrono::seconds{1});
+    }
+
+    fs::path MakeTestDirectory(const char* name)
+    {
+        const fs::path directory = fs::temp_directory_path() / name;
+        fs::remove_all(directory);
+        fs::create_directories(directory);
+        return directory;
+    }
+} // namespace
+
+TEST_CASE("Shader dependencies follow nested includes", "[AssetWatcher]")
+{
+    const fs::path directory = MakeTestDirectory("EasyDxShaderDependencies");
+    fs::create_directories(directory / "Common");
+    Touch(directory / "Lit.hlsl",
+          "#include \"Common/Lighting.hlsli\"\n"
+          "  #  include <Missing.hlsli>\n"
+          "float4 main() : SV_Target { return Shade(); }\n");
+    Touch(directory / "Common" / "Lighting.hlsli",
+          "#include \"../Basic3D.hlsli\"\n#include \"Math.hlsli\"\n");
+    Touch(directory / "Common" / "Math.hlsli",
+          "#include \"Lighting.hlsli\"\n");
+    Touch(directory / "Basic3D.hlsli", "// #include \"Ignored.hlsli\"\n");
+
+    const std::vector<fs::path> dependencies =
+        ShaderDependencies(directory / "Lit.hlsl");
+    REQUIRE(dependencies.size() == 4);
+    CHECK(dependencies[0] == (directory / "Lit.hlsl").lexically_normal());
+    CHECK(dependencies[1] ==
+          (directory / "Common" / "Lighting.hlsli").lexically_normal());
+    CHECK(dependencies[2] == (directory / "Basic3D.hlsli").lexically_normal());
+    CHECK(dependencies[3] ==
+          (directory / "Common" / "Math.hlsli").lexically_normal());
+    fs::remove_all(directory);
+}
+
+TEST_CASE("Changed assets are reloaded and applied between frames",
+          "[AssetWatcher]")
+{
+    const fs::path directory = MakeTestDirectory("EasyDxAssetWatcher");
+    const fs::path source = directory / "Source.txt";
+    const fs::path include = directory / "Include.txt";
+    const fs::path added = directory / "Added.txt";
+    Touch(source, "1");
+    Touch(include, "1");
+
+    AssetWatcher watcher;
+    int loads = 0;
+    int applied = 0;
+    const auto id = watcher.Watch({source, include}, [&] {
+        ++loads;
+        return ReloadedAsset{[&] { ++applied; }, {source, added}};
+    });
+    CHECK(watcher.Poll() == 0);
+
+    // 依赖的文件变化也会触发重新加载，但要等到 ApplyPendingReloads 才换入。
+    Touch(include, "2");
+    CHECK(watcher.Poll() == 1);
+    CHECK(loads == 1);
+    CHECK(applied == 0);
+    CHECK(watcher.Poll() == 0);
+    CHECK(watcher.ApplyPendingReloads() == 1);
+    CHECK(applied == 1);
+    CHECK(watcher.ApplyPendingReloads() == 0);
+
+    // loader 返回的依赖替换了原来的列表。
+    Touch(include, "3");
+    CHECK(watcher.Poll() == 0);
+    Touch(added, "1");
+    Touch(source, "2");
+    CHECK(watcher.Poll() == 1);
+    CHECK(watcher.Poll() == 0);
+
+    // 两次换入之间加载多次，只换入一次。
+    Touch(source, "3");
+    CHECK(watcher.Poll() == 1);
+    CHECK(watcher.ApplyPendingReloads() == 1);
+    CHECK(loads == 3);
+    CHECK(applied == 2);
+
+    Touch(source, "4");
+    CHECK(watcher.Poll() == 1);
+    watcher.Unwatch(id);
+    CHECK(watcher.ApplyPendingReloads() == 0);
+    CHECK(watcher.WatchCount() == 0);
+    fs::remove_all(directory);
+}
+
+TEST_CASE("Failed reloads keep the old asset", "[AssetWatcher]")
+{
+    const fs::path directory = MakeTestDirectory("EasyDxAssetWatcherErrors");
+    const fs::path source = directory / "Broken.txt";
+    Touch(source, "1");
+
+    AssetWatcher watcher;
+    bool fail = true;
+    watcher.Watch({source}, [&]() -> ReloadedAsset {
+        if (fail)
+            throw std::runtime_error{"syntax error"};
+        return ReloadedAsset{[] {}, {}};
+    });
+
+    Touch(source, "2");
+    CHECK(watcher.Poll() == 0);
+    CHECK(watcher.ApplyPendingReloads() == 0);
+    const std::vector<AssetReloadError> errors = watcher.TakeErrors();
+    REQUIRE(errors.size() == 1);
+    CHECK(errors[0].Path == source);
+    CHECK(errors[0].Message == "syntax error");
+    CHECK(watcher.TakeErrors().empty());
+
+    // 修好之后再次保存才会重试。
+    fail = false;
+    CHECK(watcher.Poll() == 0);
+    Touch(source, "3");
+    CHECK(watcher.Poll() == 1);
+    fs::remove_all(directory);
+}
+
+TEST_CASE("The polling thread picks up changes", "[AssetWatcher]")
+{
+    const fs::path directory = MakeTestDirectory("EasyDxAssetWatcherThread");
+    const fs::path source = directory / "Source.txt";
+    Touch(source, "1");
+
+    AssetWatcher watcher{std::chrono::milliseconds{5}};
+    std::atomic<int> loads{0};
+    watcher.Watch({source}, [&] {
+        ++loads;
+        return ReloadedAsset{[] {}, {}};
+    });
+    watcher.Start();
+    Touch(source, "2");
+    for (int i = 0; i < 400 && loads == 0; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    }
+    watcher.Stop();
+    CHECK(loads == 1);
+    CHECK(watcher.ApplyPendingReloads() == 1);
+    fs::remove_all(directory);
+}
@@ -0,0 +1,94 @@
+#include "Pch.hpp"
+#include <EasyDx/BoundingVolumes.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+using namespace DirectX;
+
+namespace
+{
+    const std::byte* AsBytePointer(const PositionStream& positions)
+    {
+        return reinterpret_cast<const std::byte*>(positions.data());
+    }
+} // namespace
+
+TEST_CASE("Bounding spheres are tight and conservative", "[BoundingVolumes]")
+{
+    LoadedMesh sphere;
+    MakeUVSphere(2.0f, 24, 24, sphere);
+    const MeshBounds bounds =
+        ComputeMeshBounds(AsBytePointer(sphere.Positions),
+                          sizeof(PositionType), sphere.Positions.size());
+    CHECK(bounds.Sphere.Radius == Approx(2.0f).epsilon(0.05));
+    for (const PositionType& position : sphere.Positions)
+    {
+        CHECK(bounds.Sphere.Contains(Load(position)) != DISJOINT);
+    }
+    CHECK(bounds.Box.Extents.y == Approx(2.0f));
+}
+
+TEST_CASE("Index ranges get their own bounds", "[BoundingVolumes]")
+{
+    const PositionStream positions = {
+        MakePosition(0.0f, 0.0f, 0.0f), MakePosition(1.0f, 0.0f, 0.0f),
+        MakePosition(0.0f, 1.0f, 0.0f), MakePosition(10.0f, 10.0f, 10.0f)};
+    const ShortIndex firstTriangle[] = {0, 1, 2};
+    const MeshBounds bounds = ComputeMeshBounds(
+        AsBytePointer(positions), sizeof(PositionType), positions.size(),
+        gsl::make_span(firstTriangle));
+    CHECK(bounds.Box.Center.x == Approx(0.5f));
+    CHECK(bounds.Box.Extents.z == Approx(0.0f).margin(1e-5f));
+    CHECK(bounds.Sphere.Radius < 1.0f);
+}
+
+TEST_CASE("Culling uses the transformed bounds", "[BoundingVolumes]")
+{
+    const PositionStream positions = {MakePosition(-1.0f, -1.0f, -1.0f),
+                                      MakePosition(1.0f, 1.0f, 1.0f)};
+    const MeshBounds bounds = ComputeMeshBounds(
+        AsBytePointer(positions), sizeof(PositionType), positions.size());
+    const BoundingFrustum frustum{
+        XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 100.0f)};
+    CHECK(IsVisible(bounds, XMMatrixTranslation(0.0f, 0.0f, 10.0f), frustum));
+    CHECK_FALSE(
+        IsVisible(bounds, XMMatrixTranslation(0.0f, 0.0f, -10.0f), frustum));
+    CHECK_FALSE(
+        IsVisible(bounds, XMMatrixTranslation(0.0f, 0.0f, 200.0f), frustum));
+    // straddles the left plane.
+    CHECK(IsVisible(bounds, XMMatrixTranslation(-4.5f, 0.0f, 10.0f), frustum));
+}
+
+TEST_CASE("Frustum planes agree with BoundingFrustum", "[BoundingVolumes]")
+{
+    const PositionStream positions = {MakePosition(-1.0f, -1.0f, -1.0f),
+                                      MakePosition(1.0f, 1.0f, 1.0f)};
+    const MeshBounds bounds = ComputeMeshBounds(
+        AsBytePointer(positions), sizeof(PositionType), positions.size());
+    const XMMATRIX view =
+        XMMatrixLookAtLH(XMVectorSet(3.0f, 2.0f, -5.0f, 1.0f), XMVectorZero(),
+                         XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const XMMATRIX projection =
+        XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.5f, 0.1f, 100.0f);
+    const FrustumPlanes planes = ExtractFrustumPlanes(view * projection);
+    BoundingFrustum frustum{projection};
+    frustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+
+    for (int x = -60; x <= 60; x += 6)
+    {
+        for (int z = -60; z <= 120; z += 6)
+        {
+            const XMMATRIX world = XMMatrixTranslation(
+                static_cast<float>(x), 1.0f, static_cast<float>(z));
+            // 平面测试是保守的：BoundingFrustum 可见的一定可见。
+            if (IsVisible(bounds, world, frustum))
+                CHECK(IsVisible(bounds, world, planes));
+        }
+    }
+    CHECK(IsVisible(bounds, XMMatrixIdentity(), planes));
+    // 在相机背后。
+    CHECK_FALSE(
+        IsVisible(bounds, XMMatrixTranslation(10.0f, 6.0f, -20.0f), planes));
+    CHECK_FALSE(IsVisible(bounds, XMMatrixTranslation(60.0f, 40.0f, 200.0f),
+                          planes));
+}
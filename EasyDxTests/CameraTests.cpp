@@ -0,0 +1,26 @@
+#include "Pch.hpp"
+#include <EasyDx/Camera.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+using namespace DirectX;
+
+TEST_CASE("Camera caches inverse matrices", "[Camera]")
+{
+    Camera camera;
+    camera.SetProjection(XM_PIDIV4, 1.5f, 0.1f, 100.0f);
+    camera.SetLookAt(XMFLOAT3{3.0f, 2.0f, -5.0f}, XMFLOAT3{},
+                     XMFLOAT3{0.0f, 1.0f, 0.0f});
+    const XMMATRIX product =
+        camera.GetViewProjection() * camera.GetInverseViewProjection();
+    const XMMATRIX identity = XMMatrixIdentity();
+    for (int i = 0; i < 4; ++i)
+    {
+        CHECK(XMVector4NearEqual(product.r[i], identity.r[i],
+                                 XMVectorReplicate(1e-4f)));
+    }
+    CHECK(Intersects(camera.WorldFrustumPlanes(), XMVectorZero(), 0.5f));
+    camera.Translate(0.0f, 0.0f, -200.0f, Space::WorldSpace);
+    CHECK_FALSE(
+        Intersects(camera.WorldFrustumPlanes(), XMVectorZero(), 0.5f));
+}
@@ -0,0 +1,106 @@
+#include "Pch.hpp"
+#include <EasyDx/CascadeFitting.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+using namespace DirectX;
+
+TEST_CASE("Practical splits blend uniform and logarithmic", "[CascadeFitting]")
+{
+    std::array<float, 5> splits;
+    ComputePracticalSplits(1.0f, 81.0f, 0.0f, gsl::make_span(splits));
+    CHECK(splits[2] == Approx(41.0f));
+    ComputePracticalSplits(1.0f, 81.0f, 1.0f, gsl::make_span(splits));
+    CHECK(splits[1] == Approx(3.0f));
+    CHECK(splits[3] == Approx(27.0f));
+    ComputePracticalSplits(1.0f, 81.0f, 0.5f, gsl::make_span(splits));
+    CHECK(splits.front() == 1.0f);
+    CHECK(splits.back() == 81.0f);
+    CHECK(splits[2] == Approx(0.5f * (9.0f + 41.0f)));
+    CHECK(std::is_sorted(splits.begin(), splits.end()));
+}
+
+TEST_CASE("Slice spheres enclose the slice", "[CascadeFitting]")
+{
+    const BoundingFrustum frustum{
+        XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.5f, 200.0f)};
+    const std::pair<float, float> slices[] = {
+        {0.5f, 5.0f}, {5.0f, 30.0f}, {30.0f, 200.0f}};
+    for (const auto [sliceNear, sliceFar] : slices)
+    {
+        BoundingFrustum slice = frustum;
+        slice.Near = sliceNear;
+        slice.Far = sliceFar;
+        XMFLOAT3 corners[BoundingFrustum::CORNER_COUNT];
+        slice.GetCorners(corners);
+        const BoundingSphere sphere =
+            SliceBoundingSphere(frustum, sliceNear, sliceFar);
+        float maxDistance = 0.0f;
+        for (const XMFLOAT3& corner : corners)
+        {
+            maxDistance = std::max(
+                maxDistance,
+                XMVectorGetX(XMVector3Length(XMVectorSubtract(
+                    XMLoadFloat3(&corner), XMLoadFloat3(&sphere.Center)))));
+        }
+        CHECK(maxDistance <= sphere.Radius * 1.0001f);
+        // 外接球是最小的：至少有一个角点在球面上。
+        CHECK(maxDistance == Approx(sphere.Radius));
+    }
+}
+
+TEST_CASE("Stable cascades move in whole texels", "[CascadeFitting]")
+{
+    constexpr std::uint32_t kShadowMapSize = 1024;
+    const XMVECTOR lightDirection =
+        XMVector3Normalize(XMVectorSet(1.0f, -2.0f, 1.0f, 0.0f));
+    const XMMATRIX lightView = XMMatrixLookToLH(
+        XMVectorZero(), lightDirection, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const XMVECTOR worldPoint = XMVectorSet(3.0f, 0.0f, 4.0f, 1.0f);
+    const auto texelCoords = [&](float offset) {
+        const BoundingSphere sphere{XMFLOAT3{offset, 1.0f, 2.0f * offset},
+                                    10.3f};
+        const XMMATRIX projection =
+            FitStableCascade(sphere, lightView, kShadowMapSize, std::nullopt);
+        const XMVECTOR clip =
+            XMVector3Transform(worldPoint, lightView * projection);
+        return XMVectorScale(clip, 0.5f * kShadowMapSize);
+    };
+    const XMVECTOR first = texelCoords(0.0f);
+    for (float offset : {0.013f, 0.37f, 1.9f})
+    {
+        const XMVECTOR delta = XMVectorSubtract(texelCoords(offset), first);
+        const XMVECTOR fraction =
+            XMVectorSubtract(delta, XMVectorRound(delta));
+        CHECK(XMVectorGetX(fraction) == Approx(0.0f).margin(1e-2f));
+        CHECK(XMVectorGetY(fraction) == Approx(0.0f).margin(1e-2f));
+    }
+}
+
+TEST_CASE("Cascade near plane extends to the casters", "[CascadeFitting]")
+{
+    const XMMATRIX lightView = XMMatrixIdentity();
+    const BoundingSphere sphere{XMFLOAT3{0.0f, 0.0f, 50.0f}, 10.0f};
+    // caster 在球与光源之间。
+    const BoundingBox casters{XMFLOAT3{0.0f, 0.0f, 20.0f},
+                              XMFLOAT3{5.0f, 5.0f, 15.0f}};
+    const XMMATRIX projection =
+        FitStableCascade(sphere, lightView, 512, casters);
+    const auto depth = [&](float z) {
+        return XMVectorGetZ(
+            XMVector3Transform(XMVectorSet(0.0f, 0.0f, z, 1.0f), projection));
+    };
+    CHECK(depth(5.0f) == Approx(0.0f).margin(1e-5f));
+    // far 不随 caster 收紧，最后一个 caster 之后的 receiver 仍在范围内。
+    CHECK(depth(55.0f) < 1.0f);
+    CHECK(depth(60.0f) == Approx(1.0f));
+
+    // caster 全在球内时深度范围就是球。
+    const BoundingBox inside{XMFLOAT3{0.0f, 0.0f, 50.0f},
+                             XMFLOAT3{1.0f, 1.0f, 1.0f}};
+    const XMMATRIX sphereOnly =
+        FitStableCascade(sphere, lightView, 512, inside);
+    CHECK(XMVectorGetZ(XMVector3Transform(XMVectorSet(0.0f, 0.0f, 40.0f, 1.0f),
+                                          sphereOnly)) ==
+          Approx(0.0f).margin(1e-5f));
+}
@@ -0,0 +1,150 @@
+#include "Pch.hpp"
+#include <EasyDx/ClusteredLighting.hpp>
+#include <EasyDx/Camera.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+using namespace DirectX;
+
+namespace
+{
+    // 90° fov、aspect 为 1：深度 d 处 x/y 的范围是 [-d, d]，4x4 tile 的
+    // 边界在 -d/2、0、d/2。slice 边界为 100^(k/8)：1, 1.78, 3.16, 5.62,
+    // 10, 17.8, 31.6, 56.2, 100。
+    constexpr ClusterGridSize kGrid{4, 4, 8};
+
+    void SetupCamera(Camera& camera)
+    {
+        camera.SetProjection(XM_PIDIV2, 1.0f, 1.0f, 100.0f);
+    }
+
+    PointLight MakePointLight(float x, float y, float z, float range)
+    {
+        return PointLight{XMFLOAT3{x, y, z}, XMFLOAT4{1.0f, 1.0f, 1.0f, 1.0f},
+                          XMFLOAT3{1.0f, 0.0f, 0.0f}, range, true};
+    }
+
+    bool ContainsLight(const ClusteredLightBinner& binner, std::uint32_t x,
+                       std::uint32_t y, std::uint32_t z, std::uint32_t light)
+    {
+        const auto range = binner.Clusters()[binner.ClusterIndex(x, y, z)];
+        const auto indices = binner.LightIndices();
+        for (std::uint32_t i = 0; i < range.Count; ++i)
+        {
+            if (indices[range.Offset + i] == light)
+                return true;
+        }
+        return false;
+    }
+} // namespace
+
+TEST_CASE("Point lights are binned into the clusters they touch",
+          "[ClusteredLighting]")
+{
+    Camera camera;
+    SetupCamera(camera);
+    const std::vector<Light> lights = {MakePointLight(0.0f, 0.0f, 4.0f, 0.5f),
+                                       MakePointLight(0.0f, 0.0f, 50.0f, 1.0f)};
+    ClusteredLightBinner binner{kGrid};
+    binner.Build(lights, camera);
+    REQUIRE(binner.Lights().size() == 2);
+
+    for (std::uint32_t y = 1; y <= 2; ++y)
+    {
+        for (std::uint32_t x = 1; x <= 2; ++x)
+        {
+            CHECK(ContainsLight(binner, x, y, 2, 0));
+            CHECK_FALSE(ContainsLight(binner, x, y, 1, 0));
+            CHECK_FALSE(ContainsLight(binner, x, y, 3, 0));
+        }
+    }
+    CHECK_FALSE(ContainsLight(binner, 0, 0, 2, 0));
+    CHECK_FALSE(ContainsLight(binner, 3, 3, 2, 0));
+
+    // 远处的光源不会出现在近处的 slice 中。
+    for (std::uint32_t z = 0; z < 6; ++z)
+    {
+        CHECK_FALSE(ContainsLight(binner, 1, 1, z, 1));
+    }
+    CHECK(ContainsLight(binner, 1, 1, 6, 1));
+}
+
+TEST_CASE("Spot light cones reject clusters outside the cone",
+          "[ClusteredLighting]")
+{
+    Camera camera;
+    SetupCamera(camera);
+    // 指向 +x，半角约 17°。
+    const SpotLight spot{XMFLOAT3{0.0f, 0.0f, 4.0f},
+                         0.3f,
+                         XMFLOAT3{1.0f, 0.0f, 0.0f},
+                         8.0f,
+                         XMFLOAT4{1.0f, 1.0f, 1.0f, 1.0f},
+                         XMFLOAT3{1.0f, 0.0f, 0.0f},
+                         true};
+    const std::vector<Light> lights = {spot};
+    ClusteredLightBinner binner{kGrid};
+    binner.Build(lights, camera);
+
+    // 球与光源左侧的 cluster 相交，但圆锥不会。
+    for (std::uint32_t z = 0; z < kGrid.SlicesZ; ++z)
+    {
+        for (std::uint32_t y = 0; y < kGrid.TilesY; ++y)
+        {
+            CHECK_FALSE(ContainsLight(binner, 0, y, z, 0));
+        }
+    }
+    CHECK(ContainsLight(binner, 3, 1, 2, 0));
+}
+
+TEST_CASE("Cluster ranges index a compact light list",
+          "[ClusteredLighting]")
+{
+    Camera camera;
+    SetupCamera(camera);
+    std::vector<Light> lights;
+    for (int i = 0; i < 40; ++i)
+    {
+        const float angle = i * 0.7f;
+        lights.push_back(MakePointLight(std::cos(angle) * i * 0.5f,
+                                        std::sin(angle) * i * 0.3f,
+                                        2.0f + i * 1.5f, 1.0f + i % 5));
+    }
+    // 方向光和被禁用的光源不参与分配。
+    lights.push_back(DirectionalLight{XMFLOAT4{1.0f, 1.0f, 1.0f, 1.0f},
+                                      XMFLOAT3{0.0f, -1.0f, 0.0f}, true});
+    auto disabled = MakePointLight(0.0f, 0.0f, 4.0f, 10.0f);
+    disabled.Enabled = false;
+    lights.push_back(disabled);
+
+    ClusteredLightBinner binner{kGrid};
+    binner.Build(lights, camera);
+    REQUIRE(binner.Lights().size() == 40);
+    REQUIRE(binner.Clusters().size() == binner.ClusterCount());
+
+    std::uint32_t expectedOffset = 0;
+    for (const auto& range : binner.Clusters())
+    {
+        CHECK(range.Offset == expectedOffset);
+        expectedOffset += range.Count;
+        for (std::uint32_t i = 0; i < range.Count; ++i)
+        {
+            const auto index = binner.LightIndices()[range.Offset + i];
+            CHECK(index < 40);
+            if (i > 0)
+            {
+                CHECK(binner.LightIndices()[range.Offset + i - 1] < index);
+            }
+        }
+    }
+    CHECK(expectedOffset == binner.LightIndices().size());
+    CHECK(expectedOffset > 40);
+
+    SECTION("the grid constants match the CPU slices")
+    {
+        const auto grid = binner.GridConstants(Size{800, 800});
+        CHECK(grid.TileScale.x == Approx(4.0f / 800.0f));
+        CHECK(std::log(4.0f) * grid.SliceScale + grid.SliceBias ==
+              Approx(2.41f).epsilon(0.01f));
+    }
+}
@@ -0,0 +1,111 @@
+#include "Pch.hpp"
+#include <EasyDx/FrameAllocator.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+
+TEST_CASE("Linear arena allocates aligned memory and reuses it after Reset",
+          "[FrameAllocator]")
+{
+    LinearArena arena{1024};
+    const auto first = arena.Allocate(3, 1);
+    const auto aligned = arena.Allocate(16, 64);
+    CHECK(reinterpret_cast<std::uintptr_t>(aligned) % 64 == 0);
+    CHECK(first != aligned);
+
+    // 超过块大小时申请新块，Reset 后合并成一个块。
+    arena.AllocateArray<float>(1000);
+    arena.Allocate(2000, 16);
+    CHECK(arena.BlockCount() == 3);
+    const std::size_t capacity = arena.Capacity();
+    arena.Reset();
+    CHECK(arena.BytesUsed() == 0);
+    CHECK(arena.BlockCount() == 1);
+    CHECK(arena.Capacity() == capacity);
+    arena.AllocateArray<float>(1000);
+    arena.Allocate(2000, 16);
+    CHECK(arena.BlockCount() == 1);
+
+    SECTION("pmr containers")
+    {
+        std::pmr::vector<int> values{&arena};
+        for (int i = 0; i < 100; ++i)
+        {
+            values.push_back(i);
+        }
+        CHECK(values[99] == 99);
+        CHECK(arena.BlockCount() == 1);
+    }
+}
+
+TEST_CASE("Steady frames do not allocate from the heap", "[FrameAllocator]")
+{
+    struct Node
+    {
+        const void* Mesh;
+        float World[16];
+    };
+    FrameAllocator frames;
+    // 和 ShadowMapping 的 render node 一样，每帧从 arena 中分配列表。
+    // 返回 arena 在这一帧里新申请的容量。
+    const auto renderFrame = [&] {
+        frames.BeginFrame();
+        const std::size_t capacity = frames.Arena().Capacity();
+        auto nodes = frames.MakeVector<Node>();
+        for (int i = 0; i < 500; ++i)
+        {
+            nodes.push_back(Node{&nodes, {}});
+        }
+        return frames.Arena().Capacity() - capacity;
+    };
+    // 每个 arena 第一次使用时会申请块。
+    for (std::uint32_t i = 0; i < 2 * FrameAllocator::kFramesInFlight; ++i)
+    {
+        renderFrame();
+    }
+    // 用量稳定之后 arena 不再申请新块。
+    CHECK(renderFrame() == 0);
+    frames.BeginFrame();
+    CHECK(frames.LastFrameStats().ArenaBytes >= 500 * sizeof(Node));
+
+    // 只有 Debug 配置统计堆分配。
+    if (!CountsHeapAllocations())
+    {
+        WARN("DX_COUNT_HEAP_ALLOCATIONS is off, heap allocations not checked");
+        return;
+    }
+    CHECK(frames.LastFrameStats().HeapAllocations == 0);
+    const std::uint64_t before = HeapAllocationCount();
+    std::vector<Node> heapNodes(500);
+    CHECK(HeapAllocationCount() > before);
+}
+
+TEST_CASE("Frame allocator keeps memory alive for the frames in flight",
+          "[FrameAllocator]")
+{
+    FrameAllocator frames{256};
+    int* const first = frames.Arena().AllocateArray<int>(4);
+    first[0] = 42;
+    LinearArena* const firstArena = &frames.Arena();
+    for (std::uint32_t i = 1; i < FrameAllocator::kFramesInFlight; ++i)
+    {
+        frames.BeginFrame();
+        CHECK(&frames.Arena() != firstArena);
+        frames.Arena().AllocateArray<int>(4)[0] = -1;
+        CHECK(first[0] == 42);
+    }
+    frames.BeginFrame();
+    CHECK(frames.FrameIndex() == FrameAllocator::kFramesInFlight);
+    CHECK(&frames.Arena() == firstArena);
+    CHECK(frames.Arena().BytesUsed() == 0);
+    CHECK(frames.LastFrameStats().ArenaBytes == 4 * sizeof(int));
+
+    SECTION("each thread has its own arena")
+    {
+        LinearArena* workerArena = nullptr;
+        std::thread worker{[&] { workerArena = &frames.Arena(); }};
+        worker.join();
+        CHECK(workerArena != nullptr);
+        CHECK(workerArena != &frames.Arena());
+    }
+}
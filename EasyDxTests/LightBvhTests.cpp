@@ -0,0 +1,106 @@
+#include "Pch.hpp"
+#include <EasyDx/LightBvh.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+using namespace DirectX;
+
+namespace
+{
+    PointLight MakePointLight(float x, float y, float z, float range,
+                              float brightness = 1.0f)
+    {
+        return PointLight{XMFLOAT3{x, y, z},
+                          XMFLOAT4{brightness, brightness, brightness, 1.0f},
+                          XMFLOAT3{1.0f, 0.0f, 1.0f}, range, true};
+    }
+
+    float DistanceSq(const XMFLOAT4& lhs, const XMFLOAT3& rhs)
+    {
+        const float x = lhs.x - rhs.x, y = lhs.y - rhs.y, z = lhs.z - rhs.z;
+        return x * x + y * y + z * z;
+    }
+
+    // 20x20 的光源阵列，间隔 2，作用半径 8。
+    std::vector<Light> MakeLightGrid()
+    {
+        std::vector<Light> lights;
+        for (int i = 0; i < 20; ++i)
+        {
+            for (int j = 0; j < 20; ++j)
+            {
+                lights.push_back(
+                    MakePointLight(i * 2.0f, 0.5f, j * 2.0f, 8.0f));
+            }
+        }
+        return lights;
+    }
+} // namespace
+
+TEST_CASE("Light BVH selects the nearest lights of equal brightness",
+          "[LightBvh]")
+{
+    const auto lights = MakeLightGrid();
+    LightBvh bvh;
+    bvh.Build(lights);
+    REQUIRE(bvh.LocalLightCount() == 400);
+    CHECK(bvh.NodeCount() < 400);
+
+    for (const XMFLOAT3 center : {XMFLOAT3{7.3f, 0.0f, 11.1f},
+                                  XMFLOAT3{0.0f, 0.0f, 0.0f},
+                                  XMFLOAT3{38.9f, 1.0f, 20.2f}})
+    {
+        const BoundingSphere bounds{center, 0.1f};
+        ObjectLights selected;
+        bvh.SelectLights(bounds, selected);
+        REQUIRE(selected.Count == kMaxLightsPerObject);
+
+        std::vector<float> distances;
+        for (const auto& light : lights)
+        {
+            distances.push_back(
+                DistanceSq(cb::Light{light}.Position, center));
+        }
+        std::sort(distances.begin(), distances.end());
+        for (std::uint32_t i = 0; i < selected.Count; ++i)
+        {
+            CHECK(DistanceSq(selected.Lights[i].Position, center) ==
+                  Approx(distances[i]));
+        }
+    }
+
+    SECTION("no lights outside their range")
+    {
+        ObjectLights selected;
+        bvh.SelectLights(BoundingSphere{XMFLOAT3{20.0f, 30.0f, 20.0f}, 1.0f},
+                         selected);
+        CHECK(selected.Count == 0);
+    }
+}
+
+TEST_CASE("Light BVH prefers brighter lights and keeps directional lights",
+          "[LightBvh]")
+{
+    std::vector<Light> lights = {
+        MakePointLight(1.0f, 0.0f, 0.0f, 10.0f, 0.1f),
+        MakePointLight(3.0f, 0.0f, 0.0f, 10.0f, 1.0f),
+        MakePointLight(-2.0f, 0.0f, 0.0f, 10.0f, 0.5f),
+        DirectionalLight{XMFLOAT4{1.0f, 1.0f, 1.0f, 1.0f},
+                         XMFLOAT3{0.0f, -1.0f, 0.0f}, true}};
+    auto disabled = MakePointLight(0.0f, 0.0f, 0.0f, 10.0f, 100.0f);
+    disabled.Enabled = false;
+    lights.push_back(disabled);
+
+    LightBvh bvh;
+    bvh.Build(lights);
+    CHECK(bvh.LocalLightCount() == 3);
+
+    ObjectLights selected;
+    bvh.SelectLights(BoundingSphere{XMFLOAT3{}, 0.5f}, selected, 3);
+    REQUIRE(selected.Count == 3);
+    CHECK(selected.Lights[0].Type == LightType::DirectionalLight);
+    // 0.5 / (1 + 1.5^2) > 1 / (1 + 2.5^2) > 0.1 / (1 + 0.5^2)，最近的
+    // 光源被挤掉了。
+    CHECK(selected.Lights[1].Position.x == -2.0f);
+    CHECK(selected.Lights[2].Position.x == 3.0f);
+}
@@ -0,0 +1,108 @@
+#include "Pch.hpp"
+#include <EasyDx/LightRegistry.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+using namespace DirectX;
+
+namespace
+{
+    bool SameGpuLight(const cb::Light& lhs, const cb::Light& rhs)
+    {
+        const auto same4 = [](const XMFLOAT4& a, const XMFLOAT4& b) {
+            return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+        };
+        if (lhs.Type != rhs.Type || lhs.Enabled != rhs.Enabled ||
+            !same4(lhs.Color, rhs.Color))
+            return false;
+        if (lhs.Type != LightType::DirectionalLight &&
+            (!same4(lhs.Position, rhs.Position) || lhs.Range != rhs.Range ||
+             lhs.ConstantAttenuation != rhs.ConstantAttenuation ||
+             lhs.LinearAttenuation != rhs.LinearAttenuation ||
+             lhs.QuadraticAttenuation != rhs.QuadraticAttenuation))
+            return false;
+        if (lhs.Type != LightType::PointLight &&
+            !same4(lhs.Direction, rhs.Direction))
+            return false;
+        return lhs.Type != LightType::SpotLight ||
+               lhs.SpotAngle == rhs.SpotAngle;
+    }
+
+    PointLight MakePointLight(float x)
+    {
+        return PointLight{XMFLOAT3{x, 1.0f, 2.0f},
+                          XMFLOAT4{0.5f, 0.25f, 1.0f, 1.0f},
+                          XMFLOAT3{1.0f, 0.1f, 0.01f}, 7.0f, true};
+    }
+} // namespace
+
+TEST_CASE("Registered lights are converted to the GPU layout",
+          "[LightRegistry]")
+{
+    const SpotLight spot{XMFLOAT3{3.0f, 4.0f, 5.0f},
+                         0.5f,
+                         XMFLOAT3{0.0f, -1.0f, 0.0f},
+                         12.0f,
+                         XMFLOAT4{1.0f, 0.0f, 0.0f, 1.0f},
+                         XMFLOAT3{1.0f, 0.0f, 0.5f},
+                         true};
+    const DirectionalLight directional{XMFLOAT4{1.0f, 1.0f, 1.0f, 1.0f},
+                                       XMFLOAT3{0.0f, -0.6f, 0.8f}, true};
+
+    LightRegistry registry;
+    std::vector<LightHandle> points;
+    for (int i = 0; i < 6; ++i)
+    {
+        points.push_back(registry.Add(MakePointLight(i * 1.0f)));
+    }
+    const LightHandle spotHandle = registry.Add(spot);
+    registry.Add(Light{directional});
+    CHECK(registry.Count(LightType::PointLight) == 6);
+
+    CHECK(registry.Flush() == 8);
+    auto lights = registry.GpuLights();
+    REQUIRE(lights.size() == 8);
+    // 方向光在前，spot light 在最后。
+    CHECK(SameGpuLight(lights[0], cb::Light{directional}));
+    for (int i = 0; i < 6; ++i)
+    {
+        CHECK(SameGpuLight(lights[i + 1],
+                           cb::Light{MakePointLight(i * 1.0f)}));
+    }
+    CHECK(SameGpuLight(lights[7], cb::Light{spot}));
+    CHECK(SameGpuLight(cb::Light{registry.Get(spotHandle)}, cb::Light{spot}));
+
+    SECTION("only changed lights are converted again")
+    {
+        CHECK(registry.Flush() == 0);
+        registry.SetRange(points[4], 3.0f);
+        registry.SetColor(spotHandle, XMFLOAT4{0.0f, 1.0f, 0.0f, 1.0f});
+        CHECK(registry.Flush() == 2);
+        CHECK(registry.GpuLights()[5].Range == 3.0f);
+        CHECK(registry.GpuLights()[7].Color.y == 1.0f);
+    }
+
+    SECTION("disabled and removed lights are left out")
+    {
+        registry.SetEnabled(points[1], false);
+        registry.Remove(points[2]);
+        registry.Flush();
+        lights = registry.GpuLights();
+        REQUIRE(lights.size() == 6);
+        CHECK(lights[1].Position.x == 0.0f);
+        CHECK(lights[2].Position.x == 3.0f);
+        CHECK_FALSE(registry.IsEnabled(points[1]));
+        CHECK_FALSE(registry.IsAlive(points[2]));
+
+        // 复用的槽位得到新的 generation。
+        const LightHandle reused = registry.Add(MakePointLight(10.0f));
+        CHECK(reused.Index == points[2].Index);
+        CHECK(reused != points[2]);
+        registry.SetEnabled(points[1], true);
+        registry.Flush();
+        lights = registry.GpuLights();
+        REQUIRE(lights.size() == 8);
+        CHECK(lights[2].Position.x == 1.0f);
+        CHECK(lights[3].Position.x == 10.0f);
+    }
+}
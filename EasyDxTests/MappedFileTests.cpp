@@ -0,0 +1,56 @@
+#include <EasyDx/EasyDx.Common/MappedFile.hpp>
+#include <catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+using namespace dx;
+namespace fs = std::filesystem;
+
+namespace
+{
+    std::string AsString(gsl::span<const std::byte> bytes)
+    {
+        return std::string(reinterpret_cast<const char*>(bytes.data()),
+                           static_cast<std::size_t>(bytes.size()));
+    }
+} // namespace
+
+TEST_CASE("Mapped files expose the file contents", "[MappedFile]")
+{
+    const fs::path directory =
+        fs::temp_directory_path() / "EasyDxMappedFileTests";
+    fs::create_directories(directory);
+    const fs::path path = directory / "Data.bin";
+    std::string content(100000, 'x');
+    content[0] = 'a';
+    content.back() = 'z';
+    std::ofstream{path, std::ios::binary} << content;
+
+    MappedFile file{path, MappedFileHints::kSequential |
+                              MappedFileHints::kPrefetch |
+                              MappedFileHints::kLargePages};
+    CHECK(file.Size() == content.size());
+    CHECK(AsString(file.Bytes()) == content);
+    // 超出范围的部分被截掉。
+    file.Prefetch(content.size() - 10, 100);
+    file.Prefetch(content.size() + 10, 100);
+
+    // 映射期间其它人仍然可以读。
+    std::ifstream reader{path, std::ios::binary};
+    CHECK(reader.get() == 'a');
+    reader.close();
+
+    MappedFile moved = std::move(file);
+    CHECK(file.Empty());
+    CHECK(moved.Bytes()[0] == std::byte{'a'});
+    moved = MappedFile{};
+    CHECK(moved.Empty());
+
+    const fs::path emptyPath = directory / "Empty.bin";
+    std::ofstream{emptyPath};
+    CHECK(MappedFile{emptyPath}.Empty());
+    CHECK_THROWS_AS(MappedFile{directory / "Missing.bin"}, std::system_error);
+    fs::remove_all(directory);
+}
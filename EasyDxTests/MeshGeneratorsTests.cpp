@@ -0,0 +1,165 @@
+#include "Pch.hpp"
+#include <EasyDx/MeshGenerators.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+using namespace DirectX;
+
+namespace
+{
+    // 顶点切线的 w 应与三角形 UV 算出的手性一致。跨越 u 接缝的三角形
+    // 没有意义，跳过。
+    std::size_t CountWrongHandedness(const LoadedMesh& mesh, ShortIndex a,
+                                     ShortIndex b, ShortIndex c)
+    {
+        const XMVECTOR uv0 = Load(mesh.TexCoords[a]);
+        const XMVECTOR d1 = XMVectorSubtract(Load(mesh.TexCoords[b]), uv0);
+        const XMVECTOR d2 = XMVectorSubtract(Load(mesh.TexCoords[c]), uv0);
+        const float det = XMVectorGetX(d1) * XMVectorGetY(d2) -
+                          XMVectorGetX(d2) * XMVectorGetY(d1);
+        const auto [minU, maxU] =
+            std::minmax({0.0f, XMVectorGetX(d1), XMVectorGetX(d2)});
+        if (std::abs(det) < 1e-8f || maxU - minU > 0.5f)
+            return 0;
+        const XMVECTOR p0 = Load(mesh.Positions[a]);
+        const XMVECTOR e1 = XMVectorSubtract(Load(mesh.Positions[b]), p0);
+        const XMVECTOR e2 = XMVectorSubtract(Load(mesh.Positions[c]), p0);
+        const XMVECTOR tangent =
+            XMVectorScale(XMVectorSubtract(XMVectorScale(e1, XMVectorGetY(d2)),
+                                           XMVectorScale(e2, XMVectorGetY(d1))),
+                          1.0f / det);
+        const XMVECTOR bitangent =
+            XMVectorScale(XMVectorSubtract(XMVectorScale(e2, XMVectorGetX(d1)),
+                                           XMVectorScale(e1, XMVectorGetX(d2))),
+                          1.0f / det);
+        std::size_t wrong = 0;
+        for (const ShortIndex vertex : {a, b, c})
+        {
+            const float expected = TangentHandedness(
+                Load(mesh.Normals[vertex]), tangent, bitangent);
+            if (mesh.Tangents[vertex].w != expected)
+                ++wrong;
+        }
+        return wrong;
+    }
+
+    // 所有三角形的几何法线都应与顶点法线同向（与 MakeUVSphere 的绕序一致）。
+    void CheckWindingAndStreams(const LoadedMesh& mesh)
+    {
+        const std::size_t vertexCount = mesh.Positions.size();
+        REQUIRE(mesh.Normals.size() == vertexCount);
+        REQUIRE(mesh.Tangents.size() == vertexCount);
+        REQUIRE(mesh.TexCoords.size() == vertexCount);
+        REQUIRE(mesh.Indices.size() % 3 == 0);
+        std::size_t wrongWinding = 0;
+        std::size_t wrongHandedness = 0;
+        for (std::size_t i = 0; i < mesh.Indices.size(); i += 3)
+        {
+            const ShortIndex a = mesh.Indices[i];
+            const ShortIndex b = mesh.Indices[i + 1];
+            const ShortIndex c = mesh.Indices[i + 2];
+            REQUIRE(std::max({a, b, c}) < vertexCount);
+            const XMVECTOR pa = Load(mesh.Positions[a]);
+            const XMVECTOR faceNormal =
+                XMVector3Cross(XMVectorSubtract(Load(mesh.Positions[b]), pa),
+                               XMVectorSubtract(Load(mesh.Positions[c]), pa));
+            // 极点处的退化三角形。
+            if (XMVectorGetX(XMVector3LengthSq(faceNormal)) < 1e-12f)
+                continue;
+            const XMVECTOR normalSum =
+                XMVectorAdd(XMVectorAdd(Load(mesh.Normals[a]),
+                                        Load(mesh.Normals[b])),
+                            Load(mesh.Normals[c]));
+            if (XMVectorGetX(XMVector3Dot(faceNormal, normalSum)) <= 0.0f)
+                ++wrongWinding;
+            wrongHandedness += CountWrongHandedness(mesh, a, b, c);
+        }
+        CHECK(wrongWinding == 0);
+        CHECK(wrongHandedness == 0);
+    }
+} // namespace
+
+TEST_CASE("Icospheres are subdivided from a cached icosahedron",
+          "[MeshGenerators]")
+{
+    LoadedMesh mesh;
+    for (std::uint32_t level = 0; level <= 3; ++level)
+    {
+        MakeIcoSphere(2.0f, level, mesh);
+        const std::size_t faces = std::size_t{20} << (2 * level);
+        CHECK(mesh.Positions.size() >= faces / 2 + 2);
+        CHECK(mesh.Indices.size() == faces * 3);
+        CheckWindingAndStreams(mesh);
+        for (const PositionType& position : mesh.Positions)
+        {
+            CHECK(XMVectorGetX(XMVector3Length(Load(position))) ==
+                  Approx(2.0f));
+        }
+    }
+}
+
+TEST_CASE("Icosphere UVs are split along the seam", "[MeshGenerators]")
+{
+    LoadedMesh mesh;
+    // 不细分时有两条边正好经过极点，横跨半个经度，从 1 级开始检查。
+    for (std::uint32_t level = 1; level <= 6; ++level)
+    {
+        MakeIcoSphere(1.0f, level, mesh);
+        std::size_t wrapped = 0;
+        for (std::size_t i = 0; i < mesh.Indices.size(); i += 3)
+        {
+            const auto [minU, maxU] =
+                std::minmax({mesh.TexCoords[mesh.Indices[i]].x,
+                             mesh.TexCoords[mesh.Indices[i + 1]].x,
+                             mesh.TexCoords[mesh.Indices[i + 2]].x});
+            if (maxU - minU > 0.5f)
+                ++wrapped;
+        }
+        CHECK(wrapped == 0);
+        // 副本的 u 加了 1，对应的经度不变。
+        for (std::size_t i = 0; i < mesh.Positions.size(); ++i)
+        {
+            const XMFLOAT3A& normal = mesh.Normals[i];
+            if (normal.x == 0.0f && normal.z == 0.0f)
+                continue;
+            const float u = std::atan2(normal.z, normal.x) / XM_2PI + 0.5f;
+            const float shift = mesh.TexCoords[i].x - u;
+            CHECK(shift - std::round(shift) == Approx(0.0f).margin(1e-5f));
+        }
+    }
+}
+
+TEST_CASE("Boxes, grids, tori and capsules", "[MeshGenerators]")
+{
+    LoadedMesh mesh;
+    MakeBox(1.0f, 2.0f, 3.0f, mesh);
+    CHECK(mesh.Positions.size() == 24);
+    CHECK(mesh.Indices.size() == 36);
+    CheckWindingAndStreams(mesh);
+
+    // 足够大以走并行路径。
+    MakePlaneGrid(10.0f, 20.0f, 200, 150, mesh);
+    CHECK(mesh.Positions.size() == 201 * 151);
+    CHECK(mesh.Indices.size() == 200 * 150 * 6);
+    CHECK(mesh.Positions.front().x == Approx(-5.0f));
+    CHECK(mesh.Positions.front().z == Approx(10.0f));
+    CHECK(mesh.Positions.back().x == Approx(5.0f));
+    CHECK(mesh.Positions.back().z == Approx(-10.0f));
+    CheckWindingAndStreams(mesh);
+
+    MakeTorus(2.0f, 0.5f, 32, 16, mesh);
+    CHECK(mesh.Positions.size() == 33 * 17);
+    CHECK(mesh.Indices.size() == 32 * 16 * 6);
+    CheckWindingAndStreams(mesh);
+
+    MakeCapsule(1.0f, 2.0f, 16, 8, mesh);
+    CHECK(mesh.Positions.size() == 18 * 17);
+    CheckWindingAndStreams(mesh);
+    const auto [minY, maxY] = std::minmax_element(
+        mesh.Positions.begin(), mesh.Positions.end(),
+        [](const PositionType& lhs, const PositionType& rhs) {
+            return lhs.y < rhs.y;
+        });
+    CHECK(minY->y == Approx(-2.0f));
+    CHECK(maxY->y == Approx(2.0f));
+}
@@ -0,0 +1,177 @@
+#include "Pch.hpp"
+#include <EasyDx/MeshProcessing.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+
+TEST_CASE("Welding removes duplicated vertices", "[MeshProcessing]")
+{
+    LoadedMesh quad;
+    quad.Positions = {MakePosition(0.0f, 0.0f, 0.0f),
+                      MakePosition(0.0f, 1.0f, 0.0f),
+                      MakePosition(1.0f, 1.0f, 0.0f),
+                      MakePosition(0.0f, 0.0f, 0.0f),
+                      MakePosition(1.0f, 1.0f, 0.0f),
+                      MakePosition(1.0f, 0.0f, 0.0f)};
+    quad.TexCoords = {MakeTexCoord(0.0f, 0.0f), MakeTexCoord(0.0f, 1.0f),
+                      MakeTexCoord(1.0f, 1.0f), MakeTexCoord(0.0f, 0.0f),
+                      MakeTexCoord(1.0f, 1.0f), MakeTexCoord(1.0f, 0.0f)};
+    quad.Indices = {0, 1, 2, 3, 4, 5};
+
+    CHECK(WeldVertices(quad) == 4);
+    CHECK(quad.Positions.size() == 4);
+    CHECK(quad.TexCoords.size() == 4);
+    CHECK(quad.Indices == std::vector<ShortIndex>{0, 1, 2, 0, 2, 3});
+    CHECK(quad.Positions[3].x == 1.0f);
+    CHECK(quad.Positions[3].y == 0.0f);
+}
+
+TEST_CASE("Welding keeps vertices that differ in any stream",
+          "[MeshProcessing]")
+{
+    LoadedMesh mesh;
+    mesh.Positions = {MakePosition(1.0f, 2.0f, 3.0f),
+                      MakePosition(1.0f, 2.0f, 3.0f)};
+    mesh.Normals = {MakeDir(0.0f, 1.0f, 0.0f), MakeDir(0.0f, -1.0f, 0.0f)};
+    mesh.Indices = {0, 1, 0};
+    CHECK(WeldVertices(mesh) == 2);
+    CHECK(mesh.Indices == std::vector<ShortIndex>{0, 1, 0});
+}
+
+TEST_CASE("Welding with an epsilon merges close vertices", "[MeshProcessing]")
+{
+    LoadedMesh mesh;
+    mesh.Positions = {MakePosition(0.5f, 0.5f, 0.5f),
+                      MakePosition(0.5f + 1e-6f, 0.5f, 0.5f),
+                      MakePosition(0.0f, 0.0f, 0.0f),
+                      MakePosition(-0.0f, 0.0f, 0.0f)};
+    mesh.Indices = {0, 1, 2, 3};
+    LoadedMesh exact = mesh;
+    CHECK(WeldVertices(exact) == 3);
+    CHECK(exact.Indices == std::vector<ShortIndex>{0, 1, 2, 2});
+    CHECK(WeldVertices(mesh, 1e-4f) == 2);
+    CHECK(mesh.Indices == std::vector<ShortIndex>{0, 0, 1, 1});
+}
+
+TEST_CASE("Welding with an epsilon looks across grid cells",
+          "[MeshProcessing]")
+{
+    // 0.0999 与 0.1001 分别落在 [0, 0.1) 和 [0.1, 0.2) 两个格子里。
+    LoadedMesh mesh;
+    mesh.Positions = {MakePosition(0.0999f, 0.0f, -0.0999f),
+                      MakePosition(0.1001f, 0.0f, -0.1001f),
+                      MakePosition(0.25f, 0.0f, 0.0f)};
+    mesh.TexCoords = {MakeTexCoord(0.5f, 0.5f), MakeTexCoord(0.5f, 0.5f),
+                      MakeTexCoord(0.5f, 0.5f)};
+    mesh.Indices = {0, 1, 2};
+    CHECK(WeldVertices(mesh, 0.1f) == 2);
+    CHECK(mesh.Indices == std::vector<ShortIndex>{0, 0, 1});
+    CHECK(mesh.Positions[0].x == 0.0999f);
+
+    // 位置相近，但 UV 相差超过 epsilon。
+    LoadedMesh seam;
+    seam.Positions = {MakePosition(1.0f, 0.0f, 0.0f),
+                      MakePosition(1.0f, 0.0f, 0.0f)};
+    seam.TexCoords = {MakeTexCoord(0.0f, 0.5f), MakeTexCoord(1.0f, 0.5f)};
+    seam.Indices = {0, 1, 0};
+    CHECK(WeldVertices(seam, 0.1f) == 2);
+}
+
+TEST_CASE("Welding preserves the triangles of generated shapes",
+          "[MeshProcessing]")
+{
+    LoadedMesh sphere;
+    MakeUVSphere(1.0f, 16, 16, sphere);
+    // 只保留 position 时，经线接缝处的顶点是重复的（相差浮点误差）。
+    sphere.Normals.clear();
+    sphere.Tangents.clear();
+    sphere.TexCoords.clear();
+    const LoadedMesh original = sphere;
+    const std::size_t welded = WeldVertices(sphere, 1e-4f);
+    CHECK(welded < original.Positions.size());
+    REQUIRE(sphere.Indices.size() == original.Indices.size());
+    for (std::size_t i = 0; i < sphere.Indices.size(); ++i)
+    {
+        const PositionType& lhs = sphere.Positions[sphere.Indices[i]];
+        const PositionType& rhs = original.Positions[original.Indices[i]];
+        CHECK(lhs.x == Approx(rhs.x).margin(1e-4f));
+        CHECK(lhs.y == Approx(rhs.y).margin(1e-4f));
+        CHECK(lhs.z == Approx(rhs.z).margin(1e-4f));
+    }
+}
+
+TEST_CASE("Generated tangents follow the U direction", "[MeshProcessing]")
+{
+    LoadedMesh quad;
+    quad.Positions = {
+        MakePosition(0.0f, 0.0f, 0.0f), MakePosition(0.0f, 1.0f, 0.0f),
+        MakePosition(1.0f, 1.0f, 0.0f), MakePosition(1.0f, 0.0f, 0.0f)};
+    quad.Normals.assign(4, MakeDir(0.0f, 0.0f, -1.0f));
+    quad.TexCoords = {MakeTexCoord(0.0f, 1.0f), MakeTexCoord(0.0f, 0.0f),
+                      MakeTexCoord(1.0f, 0.0f), MakeTexCoord(1.0f, 1.0f)};
+    quad.Indices = {0, 1, 2, 0, 2, 3};
+    GenerateTangents(quad);
+    REQUIRE(quad.Tangents.size() == 4);
+    for (const TangentType& tangent : quad.Tangents)
+    {
+        CHECK(tangent.x == Approx(1.0f));
+        CHECK(tangent.y == Approx(0.0f).margin(1e-5f));
+        CHECK(tangent.z == Approx(0.0f).margin(1e-5f));
+        // v 向下增大，正好是 cross(normal, tangent) 的方向。
+        CHECK(tangent.w == 1.0f);
+    }
+}
+
+TEST_CASE("Vertices shared by mirrored UVs are split", "[MeshProcessing]")
+{
+    // 两个三角形共享中间一列顶点，右边的 u 是镜像的。
+    LoadedMesh quad;
+    quad.Positions = {
+        MakePosition(0.0f, 0.0f, 0.0f), MakePosition(0.0f, 1.0f, 0.0f),
+        MakePosition(1.0f, 1.0f, 0.0f), MakePosition(1.0f, 0.0f, 0.0f),
+        MakePosition(2.0f, 1.0f, 0.0f), MakePosition(2.0f, 0.0f, 0.0f)};
+    quad.Normals.assign(6, MakeDir(0.0f, 0.0f, -1.0f));
+    quad.TexCoords = {MakeTexCoord(0.0f, 1.0f), MakeTexCoord(0.0f, 0.0f),
+                      MakeTexCoord(1.0f, 0.0f), MakeTexCoord(1.0f, 1.0f),
+                      MakeTexCoord(0.0f, 0.0f), MakeTexCoord(0.0f, 1.0f)};
+    quad.Indices = {0, 1, 2, 0, 2, 3, 3, 2, 4, 3, 4, 5};
+    GenerateTangents(quad);
+    // 顶点 2、3 各拆出一个镜像的副本。
+    REQUIRE(quad.Positions.size() == 8);
+    REQUIRE(quad.Tangents.size() == 8);
+    REQUIRE(quad.Normals.size() == 8);
+    REQUIRE(quad.TexCoords.size() == 8);
+    for (std::size_t corner = 0; corner < quad.Indices.size(); ++corner)
+    {
+        const TangentType& tangent = quad.Tangents[quad.Indices[corner]];
+        const bool mirrored = corner >= 6;
+        CHECK(tangent.x == Approx(mirrored ? -1.0f : 1.0f));
+        CHECK(tangent.w == (mirrored ? -1.0f : 1.0f));
+    }
+    CHECK(quad.Indices[6] != 3);
+    CHECK(quad.Positions[quad.Indices[6]].x == 1.0f);
+    CHECK(quad.TexCoords[quad.Indices[7]].x == 1.0f);
+}
+
+TEST_CASE("Generated tangents match the analytic ones of a sphere",
+          "[MeshProcessing]")
+{
+    using namespace DirectX;
+    LoadedMesh sphere;
+    const std::uint16_t sliceCount = 32;
+    MakeUVSphere(1.0f, sliceCount, 32, sphere);
+    const TangentStream analytic = sphere.Tangents;
+    GenerateTangents(sphere);
+    REQUIRE(sphere.Tangents.size() == analytic.size());
+    // 跳过两极及其相邻的一圈：极点只有一个 UV，那里的切线没有意义。
+    const std::size_t ring = sliceCount + 1;
+    for (std::size_t i = 1 + ring; i < analytic.size() - 1 - ring; ++i)
+    {
+        const XMVECTOR generated = Load(sphere.Tangents[i]);
+        CHECK(XMVectorGetX(XMVector3Dot(generated, Load(sphere.Normals[i]))) ==
+              Approx(0.0f).margin(1e-4f));
+        CHECK(XMVectorGetX(XMVector3Dot(generated, Load(analytic[i]))) >
+              0.99f);
+        CHECK(sphere.Tangents[i].w == analytic[i].w);
+    }
+}
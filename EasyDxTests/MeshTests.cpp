@@ -34,4 +34,61 @@ TEST_CASE("Mesh's single stream construction", "[Mesh]")
     == std::size(positions)); CHECK(mem.size_bytes() ==
     std::size(positions) * sizeof(DirectX::XMFLOAT3A));
     }*/
-}
\ No newline at end of file
+}
+
+TEST_CASE("Mesh's interleaved stream layouts", "[Mesh]")
+{
+    ID3D11Device& device = std::get<0>(GetDevice());
+    dx::LoadedMesh sphere;
+    dx::MakeUVSphere(1.0f, 16, 16, sphere);
+    const auto vertexCount =
+        static_cast<std::uint32_t>(sphere.Positions.size());
+    const auto makeMesh = [&](dx::StreamLayout layout,
+                              dx::VSSemantics usedSemantics =
+                                  dx::VSSemantics::kNone) {
+        return dx::ConvertToImmutableMesh(device, sphere,
+                                          D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST,
+                                          layout, usedSemantics);
+    };
+    const auto perChannel = makeMesh(dx::StreamLayout::kPerChannel);
+    const auto interleaved = makeMesh(dx::StreamLayout::kInterleaved);
+    const auto separatePosition =
+        makeMesh(dx::StreamLayout::kInterleavedWithPositionStream);
+
+    // positions, normals, tangents, texcoords; colors are empty.
+    CHECK(perChannel->GetStreamsInfo().size() == 4);
+    CHECK(interleaved->GetStreamsInfo().size() == 1);
+    CHECK(separatePosition->GetStreamsInfo().size() == 2);
+    for (const auto& mesh : {perChannel, interleaved, separatePosition})
+    {
+        CHECK(mesh->GetVertexCount() == vertexCount);
+        CHECK(mesh->GetFullInputElementDesces().size() == 4);
+        CHECK(mesh->GetBoundingBox().Extents.x ==
+              Approx(perChannel->GetBoundingBox().Extents.x));
+    }
+
+    const std::uint32_t fullStride = sizeof(dx::PositionType) +
+                                     sizeof(dx::VectorType) * 2 +
+                                     sizeof(dx::TexCoordType);
+    CHECK(interleaved->GetStreamsInfo()[0].GetStride() == fullStride);
+    CHECK(interleaved->GetGpuVbsWithoutFlush().size() == 1);
+    const auto descs = interleaved->GetFullInputElementDesces();
+    CHECK(descs[1].AlignedByteOffset == sizeof(dx::PositionType));
+    CHECK(descs[1].InputSlot == 0);
+
+    // a depth-only pass reads far less with a separate position stream.
+    const auto depthOnly = dx::VSSemantics::kPosition;
+    CHECK(dx::BoundVertexStride(*perChannel, depthOnly) ==
+          sizeof(dx::PositionType));
+    CHECK(dx::BoundVertexStride(*interleaved, depthOnly) == fullStride);
+    CHECK(dx::BoundVertexStride(*separatePosition, depthOnly) ==
+          sizeof(dx::PositionType));
+    CHECK(separatePosition->GetChannelMasks()[0] == dx::VSSemantics::kPosition);
+
+    const auto positionNormal =
+        makeMesh(dx::StreamLayout::kInterleaved,
+                 dx::VSSemantics::kPosition | dx::VSSemantics::kNormal);
+    CHECK(positionNormal->GetStreamsInfo()[0].GetStride() ==
+          sizeof(dx::PositionType) + sizeof(dx::VectorType));
+    CHECK(positionNormal->GetFullInputElementDesces().size() == 2);
+}
@@ -0,0 +1,3 @@
+// 不依赖 D3D 的测试入口，见根目录的 CMakeLists.txt。
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
@@ -0,0 +1,118 @@
+#include <EasyDx/Resources/ShaderCache.hpp>
+#include <EasyDx/Resources/ShaderMetadata.hpp>
+#include <catch.hpp>
+#include <fstream>
+#include <iterator>
+
+using namespace dx;
+
+namespace
+{
+    // 把 target 与源码拼起来作为字节码，并记录编译次数。
+    class StubCompiler : public ShaderCompiler
+    {
+      public:
+        explicit StubCompiler(std::string source) : Source{std::move(source)}
+        {}
+
+        std::string Identity() const override { return "stub"; }
+
+        std::string Preprocess(const ShaderCompileDesc&) override
+        {
+            return Source;
+        }
+
+        std::vector<std::byte> Compile(const ShaderCompileDesc& desc,
+                                       std::string_view source) override
+        {
+            ++CompileCount;
+            std::vector<std::byte> byteCode;
+            for (const char c : desc.Target)
+                byteCode.push_back(static_cast<std::byte>(c));
+            for (const char c : source)
+                byteCode.push_back(static_cast<std::byte>(c));
+            return byteCode;
+        }
+
+        std::vector<std::byte>
+        ExtractMetadata(gsl::span<const std::byte>) override
+        {
+            return {std::byte{'r'}, std::byte{'e'}, std::byte{'f'},
+                    std::byte{'l'}};
+        }
+
+        std::string Source;
+        int CompileCount = 0;
+    };
+
+    std::string ReadAll(const fs::path& path)
+    {
+        std::ifstream file{path, std::ios::binary};
+        return std::string{std::istreambuf_iterator<char>{file},
+                           std::istreambuf_iterator<char>{}};
+    }
+} // namespace
+
+TEST_CASE("Shader cache keys cover source, entry, target, flags and defines",
+          "[ShaderCache]")
+{
+    ShaderCompileDesc desc;
+    desc.Target = "ps_5_0";
+    desc.Defines = {ShaderDefine{"A", "1"}, ShaderDefine{"B", "2"}};
+    const ShaderCacheKey key = MakeShaderCacheKey("stub", "source", desc);
+    CHECK(key == MakeShaderCacheKey("stub", "source", desc));
+    CHECK(key != MakeShaderCacheKey("stub2", "source", desc));
+    CHECK(key != MakeShaderCacheKey("stub", "source2", desc));
+
+    ShaderCompileDesc other = desc;
+    std::swap(other.Defines[0], other.Defines[1]);
+    CHECK(key == MakeShaderCacheKey("stub", "source", other));
+    other.Defines[0].Value = "3";
+    CHECK(key != MakeShaderCacheKey("stub", "source", other));
+    other = desc;
+    other.EntryPoint = "PS";
+    CHECK(key != MakeShaderCacheKey("stub", "source", other));
+    other = desc;
+    other.Target = "vs_5_0";
+    CHECK(key != MakeShaderCacheKey("stub", "source", other));
+    other = desc;
+    other.Flags = 1;
+    CHECK(key != MakeShaderCacheKey("stub", "source", other));
+}
+
+TEST_CASE("Shader cache compiles once and persists across instances",
+          "[ShaderCache]")
+{
+    const fs::path directory =
+        fs::temp_directory_path() / "EasyDxShaderCacheTests";
+    fs::remove_all(directory);
+
+    ShaderCompileDesc desc;
+    desc.SourcePath = "Test.hlsl";
+    desc.Target = "ps_5_0";
+    auto compiler = std::make_unique<StubCompiler>("float4 main()");
+    StubCompiler& stub = *compiler;
+    fs::path path;
+    {
+        ShaderCache cache{directory, std::move(compiler)};
+        path = cache.GetOrCompile(desc);
+        CHECK(ReadAll(path) == "ps_5_0float4 main()");
+        CHECK(ReadAll(MetadataPathFor(path)) == "refl");
+        CHECK(cache.GetOrCompile(desc) == path);
+        CHECK(cache.Stats().Hits == 1);
+        CHECK(cache.Stats().Misses == 1);
+        CHECK(stub.CompileCount == 1);
+
+        // 源码变化之后是另一个 key。
+        stub.Source = "float4 main() : SV_Target";
+        CHECK(cache.GetOrCompile(desc) != path);
+        CHECK(stub.CompileCount == 2);
+    }
+
+    auto reopened = std::make_unique<StubCompiler>("float4 main()");
+    StubCompiler& reopenedStub = *reopened;
+    ShaderCache cache{directory, std::move(reopened)};
+    CHECK(cache.GetOrCompile(desc) == path);
+    CHECK(reopenedStub.CompileCount == 0);
+    fs::remove_all(directory);
+}
@@ -0,0 +1,118 @@
+#include <EasyDx/EasyDx.Common/Hash.hpp>
+#include <EasyDx/Resources/ShaderMetadata.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+
+namespace
+{
+    ShaderMetadata MakeMetadata()
+    {
+        ShaderMetadata metadata;
+        metadata.Kind = 1;
+        metadata.ByteCodeHash = 0x0123456789abcdefull;
+        metadata.ByteCodeSize = 1024;
+        metadata.ConstantBuffers.push_back(ShaderCbLayout{
+            "dx_PerObject",
+            0,
+            144,
+            {ShaderCbVariable{"dx_World", 0, 64},
+             ShaderCbVariable{"dx_WorldViewProj", 64, 64},
+             ShaderCbVariable{"dx_Index", 128, 4}}});
+        metadata.Resources.push_back(ShaderResourceBinding{
+            "Texture", ShaderResourceType::kShaderResourceView, 3});
+        metadata.Resources.push_back(
+            ShaderResourceBinding{"Sampler", ShaderResourceType::kSampler, 1});
+        metadata.Inputs.push_back(ShaderInputParameter{"POSITION", 0});
+        metadata.Inputs.push_back(ShaderInputParameter{"TEXCOORD", 1});
+        return metadata;
+    }
+} // namespace
+
+TEST_CASE("Shader metadata round-trips through its binary form",
+          "[ShaderMetadata]")
+{
+    const ShaderMetadata metadata = MakeMetadata();
+    const std::vector<std::byte> blob = SerializeShaderMetadata(metadata);
+    const ShaderMetadata parsed = ParseShaderMetadata(blob);
+
+    CHECK(parsed.Kind == metadata.Kind);
+    CHECK(parsed.ByteCodeHash == metadata.ByteCodeHash);
+    CHECK(parsed.ByteCodeSize == metadata.ByteCodeSize);
+    REQUIRE(parsed.ConstantBuffers.size() == 1);
+    const ShaderCbLayout& cb = parsed.ConstantBuffers[0];
+    CHECK(cb.Name == "dx_PerObject");
+    CHECK(cb.Size == 144);
+    REQUIRE(cb.Variables.size() == 3);
+    CHECK(cb.Variables[1].Name == "dx_WorldViewProj");
+    CHECK(cb.Variables[1].Offset == 64);
+    CHECK(cb.Variables[2].Size == 4);
+    REQUIRE(parsed.Resources.size() == 2);
+    CHECK(parsed.Resources[0].Name == "Texture");
+    CHECK(parsed.Resources[0].BindPoint == 3);
+    CHECK(parsed.Resources[1].Type == ShaderResourceType::kSampler);
+    REQUIRE(parsed.Inputs.size() == 2);
+    CHECK(parsed.Inputs[1].SemanticName == "TEXCOORD");
+    CHECK(parsed.Inputs[1].SemanticIndex == 1);
+    CHECK(SerializeShaderMetadata(parsed) == blob);
+}
+
+TEST_CASE("Malformed shader metadata is rejected", "[ShaderMetadata]")
+{
+    std::vector<std::byte> blob = SerializeShaderMetadata(MakeMetadata());
+
+    // 任何位置被截断都要报错，不能读出界。
+    for (std::size_t size = 0; size < blob.size(); ++size)
+    {
+        const gsl::span<const std::byte> truncated{
+            blob.data(), static_cast<std::ptrdiff_t>(size)};
+        CHECK_THROWS_AS(ParseShaderMetadata(truncated), ShaderMetadataError);
+    }
+
+    std::vector<std::byte> trailing = blob;
+    trailing.push_back(std::byte{0});
+    CHECK_THROWS_AS(ParseShaderMetadata(trailing), ShaderMetadataError);
+
+    std::vector<std::byte> badMagic = blob;
+    badMagic[0] = std::byte{'X'};
+    CHECK_THROWS_AS(ParseShaderMetadata(badMagic), ShaderMetadataError);
+
+    ShaderMetadata outOfRange = MakeMetadata();
+    outOfRange.ConstantBuffers[0].Variables[2].Offset = 144;
+    blob = SerializeShaderMetadata(outOfRange);
+    CHECK_THROWS_AS(ParseShaderMetadata(blob), ShaderMetadataError);
+
+    // Kind 和 bind point 超出 D3D11 的范围。
+    ShaderMetadata badKind = MakeMetadata();
+    badKind.Kind = 6;
+    blob = SerializeShaderMetadata(badKind);
+    CHECK_THROWS_AS(ParseShaderMetadata(blob), ShaderMetadataError);
+    ShaderMetadata badCbSlot = MakeMetadata();
+    badCbSlot.ConstantBuffers[0].BindPoint = 14;
+    blob = SerializeShaderMetadata(badCbSlot);
+    CHECK_THROWS_AS(ParseShaderMetadata(blob), ShaderMetadataError);
+    ShaderMetadata badSampler = MakeMetadata();
+    badSampler.Resources[1].BindPoint = 16;
+    blob = SerializeShaderMetadata(badSampler);
+    CHECK_THROWS_AS(ParseShaderMetadata(blob), ShaderMetadataError);
+    ShaderMetadata lastSlots = MakeMetadata();
+    lastSlots.ConstantBuffers[0].BindPoint = 13;
+    lastSlots.Resources[0].BindPoint = 127;
+    lastSlots.Resources[1].BindPoint = 15;
+    blob = SerializeShaderMetadata(lastSlots);
+    CHECK_NOTHROW(ParseShaderMetadata(blob));
+}
+
+TEST_CASE("Shader metadata detects stale byte code", "[ShaderMetadata]")
+{
+    const std::vector<std::byte> byteCode(64, std::byte{7});
+    ShaderMetadata metadata;
+    metadata.ByteCodeHash = Fnv1a64(byteCode);
+    metadata.ByteCodeSize = static_cast<std::uint32_t>(byteCode.size());
+    CHECK(metadata.Matches(byteCode));
+
+    std::vector<std::byte> changed = byteCode;
+    changed[10] = std::byte{8};
+    CHECK_FALSE(metadata.Matches(changed));
+    CHECK(MetadataPathFor("Shaders/BasicPS.cso") == "Shaders/BasicPS.refl");
+}
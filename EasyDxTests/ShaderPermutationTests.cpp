@@ -0,0 +1,78 @@
+#include "Pch.hpp"
+#include "CommonDevices.hpp"
+#include <EasyDx/Resources/ShaderPermutation.hpp>
+#include <catch.hpp>
+#include <fstream>
+
+using namespace dx;
+
+namespace
+{
+    constexpr const char* kAlphaTestSource = R"(
+cbuffer dx_PerMaterial
+{
+    float4 Color;
+#ifdef DX_ALPHA_TEST
+    float AlphaCutoff;
+#endif
+};
+
+float4 main() : SV_Target
+{
+#ifdef DX_ALPHA_TEST
+    clip(Color.a - AlphaCutoff);
+#endif
+    return Color;
+}
+)";
+
+    std::size_t CbVariableCount(const Shader& shader)
+    {
+        return shader.GetMetadata().ConstantBuffers[0].Variables.size();
+    }
+} // namespace
+
+TEST_CASE("Shader features map to defines", "[ShaderPermutation]")
+{
+    CHECK(DefinesFromFeatures(ShaderFeature::kNone).empty());
+    const auto defines =
+        DefinesFromFeatures(ShaderFeature::kShadows | ShaderFeature::kSkinning);
+    REQUIRE(defines.size() == 2);
+    CHECK(defines[0].Name == "DX_SHADOWS");
+    CHECK(defines[1].Name == "DX_SKINNING");
+    CHECK(defines[1].Value == "1");
+}
+
+TEST_CASE("Shader permutations compile once per supported feature set",
+          "[ShaderPermutation]")
+{
+    auto [device, context] = GetDevice();
+    const fs::path directory =
+        fs::temp_directory_path() / "EasyDxShaderPermutationTests";
+    fs::create_directories(directory);
+    const fs::path sourcePath = directory / "AlphaTest.hlsl";
+    std::ofstream{sourcePath} << kAlphaTestSource;
+
+    ShaderCompileDesc desc;
+    desc.SourcePath = sourcePath;
+    desc.Target = ShaderModelFromKind(ShaderKind::kPixelShader);
+    ShaderPermutationSet permutations{device, desc, ShaderFeature::kAlphaTest};
+
+    const Shader& opaque = permutations.Get(ShaderFeature::kNone);
+    const Shader& alphaTest = permutations.Get(ShaderFeature::kAlphaTest);
+    CHECK(CbVariableCount(opaque) == 1);
+    CHECK(CbVariableCount(alphaTest) == 2);
+    // 不支持的 feature 被忽略。
+    CHECK(&permutations.Get(ShaderFeature::kAlphaTest |
+                            ShaderFeature::kSkinning) == &alphaTest);
+    CHECK(permutations.LoadedVariants().size() == 2);
+
+    ShaderPermutationSet precompiled{device, desc, ShaderFeature::kAlphaTest};
+    const ShaderFeature variants[] = {ShaderFeature::kNone,
+                                      ShaderFeature::kAlphaTest,
+                                      ShaderFeature::kShadows};
+    precompiled.Precompile(variants);
+    CHECK(precompiled.IsLoaded(ShaderFeature::kAlphaTest));
+    CHECK(precompiled.LoadedVariants().size() == 2);
+    fs::remove_all(directory);
+}
@@ -0,0 +1,324 @@
+#include "Pch.hpp"
+#include "CommonDevices.hpp"
+#include <EasyDx/BasicPS.hpp>
+#include <EasyDx/BasicVS.hpp>
+#include <EasyDx/GlobalShaderContext.hpp>
+#include <catch.hpp>
+#include <fstream>
+
+using namespace dx;
+
+TEST_CASE("Constant buffers are classified by name", "[Shader]")
+{
+    CHECK(CbFrequencyFromName("dx_PerFrame") == CbFrequency::kPerFrame);
+    CHECK(CbFrequencyFromName("dx_PerViewClusterGrid") ==
+          CbFrequency::kPerView);
+    CHECK(CbFrequencyFromName("dx_PerMaterial") == CbFrequency::kPerMaterial);
+    CHECK(CbFrequencyFromName("Cb") == CbFrequency::kPerObject);
+    CHECK(GlobalShaderContext::FieldFrequency("dx_Lights") ==
+          CbFrequency::kPerFrame);
+    CHECK(GlobalShaderContext::FieldFrequency("dx_EyePos") ==
+          CbFrequency::kPerView);
+    CHECK_FALSE(GlobalShaderContext::FieldFrequency("ObjectMaterial"));
+}
+
+TEST_CASE("Only written constant buffers are uploaded", "[Shader]")
+{
+    auto [device, context] = GetDevice();
+    const Shader ps{device, AsBytes(BasicPixelShader)};
+    GlobalShaderContext shaderContext{};
+    shaderContext.BeginFrame();
+    const auto uploadedBytes = [&] {
+        ResetCbUploadStats();
+        ps.Apply(shaderContext);
+        ps.Flush(context);
+        return GetCbUploadStats().Bytes;
+    };
+    const auto perFrame = static_cast<std::size_t>(CbFrequency::kPerFrame);
+    const auto perView = static_cast<std::size_t>(CbFrequency::kPerView);
+    const auto perMaterial =
+        static_cast<std::size_t>(CbFrequency::kPerMaterial);
+
+    auto bytes = uploadedBytes();
+    CHECK(bytes[perFrame] != 0);
+    CHECK(bytes[perView] != 0);
+    CHECK(bytes[perMaterial] != 0);
+    // 同一 epoch 的 context 不再上传。
+    CHECK(uploadedBytes() == decltype(bytes){});
+
+    shaderContext.EyePos = DirectX::XMFLOAT3{1.0f, 2.0f, 3.0f};
+    shaderContext.BeginView();
+    bytes = uploadedBytes();
+    CHECK(bytes[perFrame] == 0);
+    CHECK(bytes[perView] != 0);
+
+    ps.SetField("ObjectMaterial", cb::Material{Smoothness{}, true});
+    bytes = uploadedBytes();
+    CHECK(bytes[perMaterial] != 0);
+    CHECK(bytes[perView] == 0);
+
+    // 直接写入 context 的字段之后，下一次 Apply 重新写入 context。
+    ps.SetField("dx_LightCount", 1);
+    CHECK(uploadedBytes()[perFrame] != 0);
+    CHECK(uploadedBytes()[perFrame] == 0);
+}
+
+TEST_CASE("Unchanged constant buffers skip the upload", "[Shader]")
+{
+    auto [device, context] = GetDevice();
+    const Shader ps{device, AsBytes(BasicPixelShader)};
+    const auto perMaterial =
+        static_cast<std::size_t>(CbFrequency::kPerMaterial);
+    const cb::Material material{Smoothness{}, true};
+    ps.SetField("ObjectMaterial", material);
+    ps.Flush(context);
+
+    ResetCbUploadStats();
+    ps.SetField("ObjectMaterial", material);
+    ps.Flush(context);
+    CHECK(GetCbUploadStats().TotalBytes() == 0);
+    CHECK(GetCbUploadStats().Skipped[perMaterial] == 1);
+
+    ps.SetField("ObjectMaterial", cb::Material{Smoothness{}, false});
+    ps.Flush(context);
+    CHECK(GetCbUploadStats().Uploads[perMaterial] == 1);
+}
+
+TEST_CASE("Static objects sharing a shader are uploaded once", "[Shader]")
+{
+    using namespace DirectX;
+    auto [device, context] = GetDevice();
+    const Shader vs{device, AsBytes(BasicVertexShader)};
+    const Shader ps{device, AsBytes(BasicPixelShader)};
+    const auto perMaterial =
+        static_cast<std::size_t>(CbFrequency::kPerMaterial);
+    const auto perObject = static_cast<std::size_t>(CbFrequency::kPerObject);
+    const std::array materials = {cb::Material{Smoothness{}, true},
+                                  cb::Material{Smoothness{}, false}};
+    const std::array worlds = {XMMatrixIdentity(),
+                               XMMatrixTranslation(1.0f, 2.0f, 3.0f)};
+    const std::array<UniqueCbKey, 2> objectKeys{};
+    const std::array<UniqueCbKey, 2> materialKeys{};
+    // 两个物体、两个材质共用 vs 和 ps，和 FillUpShaders 一样设置 key。
+    const auto drawFrame = [&](bool keyed) {
+        ResetCbUploadStats();
+        for (std::size_t i = 0; i < worlds.size(); ++i)
+        {
+            vs.SetCbKey(CbFrequency::kPerObject,
+                        keyed ? objectKeys[i].Value() : 0);
+            vs.SetField("dx_WorldMatrix", worlds[i]);
+            vs.Flush(context);
+            ps.SetCbKey(CbFrequency::kPerMaterial,
+                        keyed ? materialKeys[i].Value() : 0);
+            ps.SetField("ObjectMaterial", materials[i]);
+            ps.Flush(context);
+        }
+        return GetCbUploadStats();
+    };
+
+    CbUploadStats stats = drawFrame(true);
+    CHECK(stats.Uploads[perObject] == 2);
+    CHECK(stats.Uploads[perMaterial] == 2);
+    // 第二帧什么都没有改变，一次也不上传。
+    stats = drawFrame(true);
+    CHECK(stats.TotalBytes() == 0);
+    CHECK(stats.Skipped[perObject] == 2);
+    CHECK(stats.Skipped[perMaterial] == 2);
+
+    // 没有 key 时两个物体交替覆盖同一个 buffer，每次绘制都要上传。
+    stats = drawFrame(false);
+    stats = drawFrame(false);
+    CHECK(stats.Uploads[perObject] == 2);
+    CHECK(stats.Uploads[perMaterial] == 2);
+
+    // 每个 key 的 buffer 不受共用 buffer 的影响，仍然不需要上传。
+    stats = drawFrame(true);
+    CHECK(stats.TotalBytes() == 0);
+}
+
+TEST_CASE("Keyed constant buffers are released when unused", "[Shader]")
+{
+    auto [device, context] = GetDevice();
+    const Shader vs{device, AsBytes(BasicVertexShader)};
+    const auto perObject = static_cast<std::size_t>(CbFrequency::kPerObject);
+    GlobalShaderContext shaderContext{};
+    const UniqueCbKey key;
+    const auto drawFrame = [&](std::uint64_t objectKey) {
+        shaderContext.BeginFrame();
+        ResetCbUploadStats();
+        vs.Apply(shaderContext);
+        vs.SetCbKey(CbFrequency::kPerObject, objectKey);
+        vs.SetField("dx_WorldMatrix", DirectX::XMMatrixIdentity());
+        vs.Flush(context);
+        return GetCbUploadStats().Uploads[perObject];
+    };
+
+    // 复制出来的 key 与原来的不同，销毁的 key 不会再被取到。
+    CHECK(UniqueCbKey{key}.Value() != key.Value());
+    const ShaderInputs inputs;
+    CHECK(ShaderInputs{inputs}.CbKey() != inputs.CbKey());
+
+    CHECK(drawFrame(key.Value()) == 1);
+    CHECK(drawFrame(key.Value()) == 0);
+    for (std::uint64_t i = 1; i < kKeyedCbIdleFrames; ++i)
+        drawFrame(0);
+    // 隔了 kKeyedCbIdleFrames 帧再用到，buffer 仍然保留着。
+    CHECK(drawFrame(key.Value()) == 0);
+    for (std::uint64_t i = 0; i < kKeyedCbIdleFrames; ++i)
+        drawFrame(0);
+    // 释放之后重新创建，需要再上传一次。
+    CHECK(drawFrame(key.Value()) == 1);
+}
+
+TEST_CASE("Shader inputs are bound through a cached binding table", "[Shader]")
+{
+    auto [device, context] = GetDevice();
+    const Shader ps{device, AsBytes(BasicPixelShader)};
+    const auto perMaterial =
+        static_cast<std::size_t>(CbFrequency::kPerMaterial);
+    wrl::ComPtr<ID3D11SamplerState> sampler;
+    const CD3D11_SAMPLER_DESC samplerDesc{CD3D11_DEFAULT{}};
+    TryHR(device.CreateSamplerState(&samplerDesc, sampler.GetAddressOf()));
+
+    ShaderInputs inputs;
+    inputs.SetField("ObjectMaterial", cb::Material{Smoothness{}, true});
+    inputs.SetField("NotInShader", 1);
+    inputs.Bind("Sampler", sampler);
+    ps.Apply(inputs);
+    ps.Setup(context);
+    ps.Flush(context);
+
+    wrl::ComPtr<ID3D11SamplerState> bound;
+    context.PSGetSamplers(0, 1, bound.GetAddressOf());
+    CHECK(bound == sampler);
+
+    // 修改已有字段不会使绑定表失效，内容不变时也不会上传。
+    ResetCbUploadStats();
+    ps.Apply(inputs);
+    ps.Flush(context);
+    CHECK(GetCbUploadStats().Uploads[perMaterial] == 0);
+    inputs.SetField("ObjectMaterial", cb::Material{Smoothness{}, false});
+    ps.Apply(inputs);
+    ps.Flush(context);
+    CHECK(GetCbUploadStats().Uploads[perMaterial] == 1);
+}
+
+TEST_CASE("Shader slots are refilled only when the inputs change", "[Shader]")
+{
+    auto [device, context] = GetDevice();
+    const Shader ps{device, AsBytes(BasicPixelShader)};
+    wrl::ComPtr<ID3D11SamplerState> sampler;
+    const CD3D11_SAMPLER_DESC samplerDesc{CD3D11_DEFAULT{}};
+    TryHR(device.CreateSamplerState(&samplerDesc, sampler.GetAddressOf()));
+    const auto boundSampler = [&context = context] {
+        wrl::ComPtr<ID3D11SamplerState> bound;
+        context.PSGetSamplers(0, 1, bound.GetAddressOf());
+        return bound;
+    };
+
+    ShaderInputs material;
+    material.Bind("Sampler", sampler);
+    const ShaderInputs empty;
+    ps.ApplySlots(material);
+    ps.Setup(context);
+    CHECK(boundSampler() == sampler);
+    ps.ApplySlots(material);
+    ps.Setup(context);
+    CHECK(boundSampler() == sampler);
+
+    // 下一次绘制的材质没有提供 sampler，不会沿用上一次的。
+    ps.ApplySlots(empty);
+    ps.Setup(context);
+    CHECK(boundSampler() == nullptr);
+
+    // 复制出来的材质与原来的相同。
+    const ShaderInputs copy = material;
+    ps.ApplySlots(copy);
+    ps.Setup(context);
+    CHECK(boundSampler() == sampler);
+
+    // Apply 改过的 slot 在下一次 ApplySlots 时重新填写。
+    ps.ApplySlots(empty);
+    ps.Apply(material);
+    ps.ApplySlots(empty);
+    ps.Setup(context);
+    CHECK(boundSampler() == nullptr);
+
+    // Shader::Bind 绑定的资源在换材质之后仍然有效。
+    ps.Bind("Sampler", sampler);
+    ps.ApplySlots(empty);
+    ps.Setup(context);
+    CHECK(boundSampler() == sampler);
+}
+
+TEST_CASE("Shaders are loaded in batches", "[Shader]")
+{
+    auto [device, context] = GetDevice();
+    const fs::path directory =
+        fs::temp_directory_path() / "EasyDxLoadShadersTests";
+    fs::create_directories(directory);
+    const fs::path csoPath = directory / "BasicPS.cso";
+    {
+        std::ofstream file{csoPath, std::ios::binary};
+        file.write(reinterpret_cast<const char*>(BasicPixelShader),
+                   sizeof(BasicPixelShader));
+    }
+
+    std::vector<ShaderSource> sources(3, csoPath);
+    std::vector<Shader> shaders = LoadShaders(device, sources);
+    REQUIRE(shaders.size() == 3);
+    for (const Shader& shader : shaders)
+    {
+        CHECK(shader);
+        CHECK(shader.GetKind() == ShaderKind::kPixelShader);
+    }
+
+    // 所有的错误一起报告。
+    sources[0] = directory / "Missing0.cso";
+    sources[2] = directory / "Missing2.cso";
+    try
+    {
+        LoadShaders(device, sources);
+        FAIL("LoadShaders should throw");
+    }
+    catch (const ShaderBatchError& error)
+    {
+        REQUIRE(error.Errors().size() == 2);
+        CHECK(error.Errors()[0].Index == 0);
+        CHECK(error.Errors()[1].Index == 2);
+        CHECK(error.Errors()[1].Path == sources[2]);
+    }
+    fs::remove_all(directory);
+}
+
+TEST_CASE("Shaders are recompiled when an included file changes", "[Shader]")
+{
+    auto [device, context] = GetDevice();
+    const fs::path directory =
+        fs::temp_directory_path() / "EasyDxWatchShaderTests";
+    fs::create_directories(directory);
+    const fs::path includePath = directory / "Color.hlsli";
+    std::ofstream{includePath} << "cbuffer dx_PerMaterial { float4 Color; };";
+    std::ofstream{directory / "Watched.hlsl"}
+        << "#include \"Color.hlsli\"\n"
+           "float4 main() : SV_Target { return Color; }\n";
+
+    ShaderCompileDesc desc;
+    desc.SourcePath = directory / "Watched.hlsl";
+    desc.Target = ShaderModelFromKind(ShaderKind::kPixelShader);
+    AssetWatcher watcher;
+    std::optional<Shader> replaced;
+    WatchShader(watcher, device, desc,
+                [&](Shader shader) { replaced.emplace(std::move(shader)); });
+
+    const auto lastWrite = fs::last_write_time(includePath);
+    std::ofstream{includePath, std::ios::trunc}
+        << "cbuffer dx_PerMaterial { float4 Color; float Scale; };";
+    fs::last_write_time(includePath, lastWrite + std::chrono::seconds{1});
+    CHECK(watcher.Poll() == 1);
+    CHECK(!replaced);
+    CHECK(watcher.ApplyPendingReloads() == 1);
+    REQUIRE(replaced);
+    CHECK(replaced->GetMetadata().ConstantBuffers[0].Variables.size() == 2);
+    fs::remove_all(directory);
+}
@@ -0,0 +1,133 @@
+#include "Pch.hpp"
+#include "CommonDevices.hpp"
+#include <EasyDx/ShadowCache.hpp>
+#include <catch.hpp>
+
+using namespace dx;
+using namespace DirectX;
+
+TEST_CASE("Static shadows are drawn once until something changes",
+          "[ShadowCache]")
+{
+    StaticShadowCache cache{2};
+    const XMMATRIX lightViewProj =
+        XMMatrixOrthographicLH(20.0f, 20.0f, 0.0f, 50.0f);
+    constexpr std::size_t kSignature = 42;
+
+    CHECK(cache.NeedsStaticRedraw(0, lightViewProj, kSignature));
+    CHECK(cache.NeedsStaticRedraw(1, lightViewProj, kSignature));
+    CHECK_FALSE(cache.NeedsStaticRedraw(0, lightViewProj, kSignature));
+    CHECK_FALSE(cache.NeedsStaticRedraw(1, lightViewProj, kSignature));
+    CHECK(cache.RedrawCount() == 2);
+
+    SECTION("cascade bounds or light changed")
+    {
+        const XMMATRIX moved =
+            XMMatrixTranslation(0.5f, 0.0f, 0.0f) * lightViewProj;
+        CHECK(cache.NeedsStaticRedraw(0, moved, kSignature));
+        CHECK_FALSE(cache.NeedsStaticRedraw(1, lightViewProj, kSignature));
+        CHECK_FALSE(cache.NeedsStaticRedraw(0, moved, kSignature));
+    }
+
+    SECTION("static geometry changed")
+    {
+        CHECK(cache.NeedsStaticRedraw(0, lightViewProj, kSignature + 1));
+        CHECK(cache.NeedsStaticRedraw(1, lightViewProj, kSignature + 1));
+    }
+
+    SECTION("explicit invalidation")
+    {
+        cache.Invalidate();
+        CHECK(cache.NeedsStaticRedraw(0, lightViewProj, kSignature));
+        CHECK(cache.NeedsStaticRedraw(1, lightViewProj, kSignature));
+        CHECK(cache.RedrawCount() == 4);
+    }
+}
+
+TEST_CASE("Dynamic casters outside the static depth range are clamped",
+          "[ShadowCache]")
+{
+    auto [device, context] = GetDevice();
+    PredefinedResources::Setup(device);
+
+    // cascade 的深度只拟合了 [0, 50] 里的静态 caster，动态 caster 在
+    // z = -10，朝光源一侧超出了近平面。
+    const XMMATRIX lightViewProj =
+        XMMatrixOrthographicLH(20.0f, 20.0f, 0.0f, 50.0f);
+    const auto toClip = [&](float x, float y) {
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector4Transform(XMVectorSet(x, y, -10.0f, 1.0f),
+                                                lightViewProj));
+        return clip;
+    };
+    // 盖住整个 cascade 的三角形。
+    const std::array<XMFLOAT4, 3> vertices = {
+        toClip(-10.0f, -10.0f), toClip(-10.0f, 30.0f), toClip(30.0f, -10.0f)};
+    REQUIRE(vertices[0].z < 0.0f);
+
+    D3DShaderCompiler compiler;
+    const std::vector<std::byte> vsByteCode = compiler.Compile(
+        ShaderCompileDesc{"CasterVS.hlsl", "main", "vs_5_0"},
+        "float4 main(float4 position : POSITION) : SV_Position "
+        "{ return position; }");
+    wrl::ComPtr<ID3D11VertexShader> vs;
+    TryHR(device.CreateVertexShader(vsByteCode.data(), vsByteCode.size(),
+                                    nullptr, vs.GetAddressOf()));
+    const D3D11_INPUT_ELEMENT_DESC inputDesc{
+        "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0,
+        D3D11_INPUT_PER_VERTEX_DATA, 0};
+    wrl::ComPtr<ID3D11InputLayout> inputLayout;
+    TryHR(device.CreateInputLayout(&inputDesc, 1, vsByteCode.data(),
+                                   vsByteCode.size(),
+                                   inputLayout.GetAddressOf()));
+    const CD3D11_BUFFER_DESC vbDesc{sizeof(vertices),
+                                    D3D11_BIND_VERTEX_BUFFER,
+                                    D3D11_USAGE_IMMUTABLE};
+    const D3D11_SUBRESOURCE_DATA vbData{vertices.data()};
+    wrl::ComPtr<ID3D11Buffer> vb;
+    TryHR(device.CreateBuffer(&vbDesc, &vbData, vb.GetAddressOf()));
+
+    constexpr std::uint32_t kSize = 4;
+    const CD3D11_TEXTURE2D_DESC depthDesc{DXGI_FORMAT_D32_FLOAT, kSize, kSize,
+                                          1, 1, D3D11_BIND_DEPTH_STENCIL};
+    wrl::ComPtr<ID3D11Texture2D> depth;
+    TryHR(device.CreateTexture2D(&depthDesc, nullptr, depth.GetAddressOf()));
+    wrl::ComPtr<ID3D11DepthStencilView> depthView;
+    TryHR(device.CreateDepthStencilView(depth.Get(), nullptr,
+                                        depthView.GetAddressOf()));
+    CD3D11_TEXTURE2D_DESC stagingDesc{
+        DXGI_FORMAT_D32_FLOAT, kSize, kSize, 1, 1, 0, D3D11_USAGE_STAGING,
+        D3D11_CPU_ACCESS_READ};
+    wrl::ComPtr<ID3D11Texture2D> staging;
+    TryHR(
+        device.CreateTexture2D(&stagingDesc, nullptr, staging.GetAddressOf()));
+
+    const auto drawCaster = [&](ID3D11RasterizerState* rasterizerState) {
+        context.ClearDepthStencilView(depthView.Get(), D3D11_CLEAR_DEPTH, 1.0f,
+                                      0);
+        context.OMSetRenderTargets(0, nullptr, depthView.Get());
+        context.OMSetDepthStencilState(nullptr, 0);
+        const CD3D11_VIEWPORT viewport{0.0f, 0.0f, float(kSize), float(kSize)};
+        context.RSSetViewports(1, &viewport);
+        context.RSSetState(rasterizerState);
+        const UINT stride = sizeof(XMFLOAT4);
+        const UINT offset = 0;
+        context.IASetVertexBuffers(0, 1, vb.GetAddressOf(), &stride, &offset);
+        context.IASetInputLayout(inputLayout.Get());
+        context.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        context.VSSetShader(vs.Get(), nullptr, 0);
+        context.PSSetShader(nullptr, nullptr, 0);
+        context.Draw(3, 0);
+        context.CopyResource(staging.Get(), depth.Get());
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        TryHR(context.Map(staging.Get(), 0, D3D11_MAP_READ, 0, &mapped));
+        const float result = *static_cast<const float*>(mapped.pData);
+        context.Unmap(staging.Get(), 0);
+        return result;
+    };
+
+    // 默认的光栅化状态会把它裁掉，深度缓冲保持清除时的值。
+    CHECK(drawCaster(nullptr) == 1.0f);
+    // shadow caster pass 的状态把它压到近平面上，照样能遮挡。
+    CHECK(drawCaster(PredefinedResources::GetShadowCaster()) == 0.0f);
+}
@@ -7,4 +7,250 @@ TEST_CASE("Transforms' default construction", "[Transform]")
 {
     Transform defaultTransform;
     CHECK(DirectX::XMMatrixIsIdentity(defaultTransform.Matrix()));
-}
\ No newline at end of file
+}
+
+namespace
+{
+    bool MatricesNearEqual(const DirectX::XMMATRIX& lhs,
+                           const DirectX::XMMATRIX& rhs)
+    {
+        const DirectX::XMVECTOR epsilon = DirectX::XMVectorReplicate(1e-5f);
+        for (int i = 0; i < 4; ++i)
+        {
+            if (!DirectX::XMVector4NearEqual(lhs.r[i], rhs.r[i], epsilon))
+                return false;
+        }
+        return true;
+    }
+
+    DirectX::XMVECTOR RotationFor(std::uint32_t i)
+    {
+        return DirectX::XMQuaternionRotationRollPitchYaw(
+            0.1f * static_cast<float>(i), 0.2f * static_cast<float>(i % 7),
+            0.3f * static_cast<float>(i % 11));
+    }
+} // namespace
+
+TEST_CASE("TransformStore matches XMMatrixAffineTransformation",
+          "[Transform]")
+{
+    using namespace DirectX;
+    TransformStore store;
+    std::vector<TransformHandle> handles;
+    // 不是 4 的倍数，覆盖最后一个不满的 4 元组。
+    for (std::uint32_t i = 0; i < 103; ++i)
+    {
+        const float f = static_cast<float>(i);
+        handles.push_back(store.Create(
+            XMVectorSet(1.0f + 0.01f * f, 2.0f, 0.5f, 0.0f), RotationFor(i),
+            XMVectorSet(f, -f, 2.0f * f, 0.0f)));
+    }
+    store.UpdateWorldMatrices();
+    for (std::uint32_t i = 0; i < handles.size(); ++i)
+    {
+        const TransformHandle handle = handles[i];
+        CHECK(MatricesNearEqual(
+            store.WorldMatrix(handle),
+            XMMatrixAffineTransformation(store.Scale(handle), XMVectorZero(),
+                                         store.Rotation(handle),
+                                         store.Position(handle))));
+    }
+
+    store.SetPosition(handles[5], XMVectorSet(3.0f, 4.0f, 5.0f, 0.0f));
+    store.UpdateWorldMatrices();
+    CHECK(XMVector3Equal(store.WorldMatrix(handles[5]).r[3],
+                         XMVectorSet(3.0f, 4.0f, 5.0f, 1.0f)));
+}
+
+TEST_CASE("TransformStore handles are invalidated by Destroy", "[Transform]")
+{
+    TransformStore store;
+    const TransformHandle first = store.Create();
+    store.Destroy(first);
+    CHECK(!store.IsAlive(first));
+    const TransformHandle second = store.Create();
+    CHECK(second.Index == first.Index);
+    CHECK(second != first);
+    CHECK(store.IsAlive(second));
+    CHECK(store.AliveCount() == 1);
+    store.UpdateWorldMatrices();
+    CHECK(DirectX::XMMatrixIsIdentity(store.WorldMatrix(second)));
+}
+
+// 默认不运行：EasyDxTests.exe "[benchmark]"
+TEST_CASE("TransformStore vs per-object Transform", "[.][benchmark]")
+{
+    using namespace DirectX;
+    using Clock = std::chrono::steady_clock;
+    constexpr std::uint32_t kCount = 100000;
+
+    TransformStore store;
+    std::vector<TransformHandle> handles;
+    std::vector<Transform> transforms;
+    handles.reserve(kCount);
+    transforms.reserve(kCount);
+    for (std::uint32_t i = 0; i < kCount; ++i)
+    {
+        const XMVECTOR position = XMVectorSet(static_cast<float>(i), 0, 0, 0);
+        handles.push_back(
+            store.Create(XMVectorSplatOne(), RotationFor(i), position));
+        transforms.emplace_back(XMVectorSplatOne(), RotationFor(i), position);
+    }
+
+    XMVECTOR sink = XMVectorZero();
+    const auto soaStart = Clock::now();
+    for (const TransformHandle handle : handles)
+        store.SetPosition(handle, XMVectorSet(1.0f, 2.0f, 3.0f, 0.0f));
+    store.UpdateWorldMatrices();
+    for (const TransformHandle handle : handles)
+        sink = XMVectorAdd(sink, store.WorldMatrix(handle).r[3]);
+    const auto soaTime = Clock::now() - soaStart;
+
+    const auto aosStart = Clock::now();
+    for (Transform& transform : transforms)
+    {
+        transform.SetPosition(XMFLOAT3{1.0f, 2.0f, 3.0f});
+        sink = XMVectorAdd(sink, transform.Matrix().r[3]);
+    }
+    const auto aosTime = Clock::now() - aosStart;
+
+    using std::chrono::microseconds;
+    WARN("TransformStore: "
+         << std::chrono::duration_cast<microseconds>(soaTime).count()
+         << "us, Transform: "
+         << std::chrono::duration_cast<microseconds>(aosTime).count()
+         << "us");
+    CHECK(XMVectorGetX(sink) > 0.0f);
+}
+
+TEST_CASE("TransformStore propagates parent matrices", "[Transform]")
+{
+    using namespace DirectX;
+    TransformStore store;
+    // 先创建子节点，slot 顺序与层级顺序不同。
+    const TransformHandle grandChild =
+        store.Create(XMVectorSplatOne(), XMQuaternionIdentity(),
+                     XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f));
+    const TransformHandle child =
+        store.Create(XMVectorReplicate(2.0f), XMQuaternionIdentity(),
+                     XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const TransformHandle root =
+        store.Create(XMVectorSplatOne(), RotationFor(3),
+                     XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+    const TransformHandle sibling = store.Create();
+    store.SetParent(child, root);
+    store.SetParent(grandChild, child);
+    CHECK(store.Parent(grandChild) == child);
+    CHECK(store.Parent(root) == TransformHandle{});
+    store.UpdateWorldMatrices();
+
+    const auto expected = [&](TransformHandle handle) {
+        XMMATRIX world = store.LocalMatrix(handle);
+        for (TransformHandle parent = store.Parent(handle);
+             parent != TransformHandle{}; parent = store.Parent(parent))
+        {
+            world = XMMatrixMultiply(world, store.LocalMatrix(parent));
+        }
+        return world;
+    };
+    CHECK(MatricesNearEqual(store.WorldMatrix(grandChild),
+                            expected(grandChild)));
+
+    // 只改根节点，整个子树都要跟着更新。
+    store.SetPosition(root, XMVectorSet(-4.0f, 2.0f, 0.0f, 0.0f));
+    store.UpdateWorldMatrices();
+    CHECK(MatricesNearEqual(store.WorldMatrix(child), expected(child)));
+    CHECK(MatricesNearEqual(store.WorldMatrix(grandChild),
+                            expected(grandChild)));
+    CHECK(XMMatrixIsIdentity(store.WorldMatrix(sibling)));
+
+    store.SetParent(grandChild, sibling);
+    store.Destroy(root);
+    store.UpdateWorldMatrices();
+    CHECK(store.Parent(child) == TransformHandle{});
+    CHECK(
+        MatricesNearEqual(store.WorldMatrix(child), store.LocalMatrix(child)));
+    CHECK(MatricesNearEqual(store.WorldMatrix(grandChild),
+                            store.LocalMatrix(grandChild)));
+}
+
+TEST_CASE("TransformStore handles deep hierarchies", "[Transform]")
+{
+    using namespace DirectX;
+    constexpr std::uint32_t kDepth = 500;
+    TransformStore store;
+    TransformHandle parent;
+    std::vector<TransformHandle> chain;
+    for (std::uint32_t i = 0; i < kDepth; ++i)
+    {
+        const TransformHandle node =
+            store.Create(XMVectorSplatOne(), XMQuaternionIdentity(),
+                         XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+        store.SetParent(node, parent);
+        chain.push_back(node);
+        parent = node;
+    }
+    store.UpdateWorldMatrices();
+    CHECK(XMVectorGetX(store.WorldMatrix(chain.back()).r[3]) ==
+          Approx(static_cast<float>(kDepth)));
+
+    store.SetPosition(chain.front(), XMVectorSet(11.0f, 0.0f, 0.0f, 0.0f));
+    store.UpdateWorldMatrices();
+    CHECK(XMVectorGetX(store.WorldMatrix(chain.back()).r[3]) ==
+          Approx(static_cast<float>(kDepth + 10)));
+}
+
+TEST_CASE("TransformStore only updates dirty hierarchies", "[Transform]")
+{
+    using namespace DirectX;
+    constexpr std::uint32_t kTreeCount = 100;
+    TransformStore store;
+    std::vector<TransformHandle> roots;
+    std::vector<TransformHandle> children;
+    for (std::uint32_t i = 0; i < kTreeCount; ++i)
+    {
+        roots.push_back(store.Create());
+        children.push_back(store.Create());
+        store.SetParent(children.back(), roots.back());
+    }
+    CHECK(store.UpdateWorldMatrices() == kTreeCount * 2);
+    CHECK(store.UpdateWorldMatrices() == 0);
+
+    // 只有被修改的那棵树会被访问。
+    store.SetPosition(roots[42], XMVectorSet(0.0f, 3.0f, 0.0f, 0.0f));
+    CHECK(store.UpdateWorldMatrices() == 2);
+    CHECK(XMVectorGetY(store.WorldMatrix(children[42]).r[3]) ==
+          Approx(3.0f));
+    CHECK(XMVectorGetY(store.WorldMatrix(children[41]).r[3]) ==
+          Approx(0.0f));
+
+    // 父子都 dirty 时子节点只算一次。
+    store.SetPosition(children[7], XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+    store.SetPosition(roots[7], XMVectorSet(0.0f, 0.0f, 2.0f, 0.0f));
+    CHECK(store.UpdateWorldMatrices() == 2);
+    CHECK(MatricesNearEqual(
+        store.WorldMatrix(children[7]),
+        XMMatrixTranslation(1.0f, 0.0f, 2.0f)));
+
+    // 换 parent 后跟着新 parent 走，旧 parent 的子树里不再有它。
+    store.SetParent(children[7], roots[42]);
+    CHECK(store.UpdateWorldMatrices() == 1);
+    store.SetPosition(roots[7], XMVectorZero());
+    CHECK(store.UpdateWorldMatrices() == 1);
+    store.SetPosition(roots[42], XMVectorZero());
+    CHECK(store.UpdateWorldMatrices() == 3);
+    CHECK(MatricesNearEqual(store.WorldMatrix(children[7]),
+                            XMMatrixTranslation(1.0f, 0.0f, 0.0f)));
+
+    store.Destroy(roots[42]);
+    CHECK(store.Parent(children[42]) == TransformHandle{});
+    CHECK(store.Parent(children[7]) == TransformHandle{});
+    CHECK(store.UpdateWorldMatrices() == 2);
+    const TransformHandle reused = store.Create();
+    store.SetParent(reused, roots[0]);
+    store.SetParent(children[0], reused);
+    CHECK(store.UpdateWorldMatrices() == 2);
+    store.SetPosition(roots[0], XMVectorSet(5.0f, 0.0f, 0.0f, 0.0f));
+    CHECK(store.UpdateWorldMatrices() == 3);
+    CHECK(XMVectorGetX(store.WorldMatrix(children[0]).r[3]) == Approx(5.0f));
+}
@@ -44,25 +44,18 @@ void GenerateInstancingData(dx::AlignedVec<InstancingVertex>& instancingData,
 
 using namespace DirectX;
 
-void Culling(const DirectX::BoundingFrustum& frustum,
-             gsl::span<const dx::PositionType> mesh, const XMMATRIX& view,
+// planes 是 world space 的，实例的包围体不需要变换到 view space。
+void Culling(const dx::FrustumPlanes& planes, const dx::MeshBounds& bounds,
              gsl::span<const InstancingVertex> transforms,
-             std::vector<InstancingVertex>& visibleParts,
+             std::pmr::vector<InstancingVertex>& visibleParts,
              ID3D11DeviceContext& context3D, dx::GpuBuffer& instancingBuffer)
 {
     visibleParts.clear();
-    const auto invView = XMMatrixInverse({}, view);
-    BoundingBox aabb;
-    DirectX::BoundingFrustum localFrustum;
-    std::copy_if(
-        transforms.begin(), transforms.end(), std::back_inserter(visibleParts),
-        [&](const InstancingVertex& v) {
-            BoundingBox::CreateFromPoints(aabb, mesh.size(), mesh.data(),
-                                          sizeof(dx::PositionType));
-            const auto inv = invView * XMMatrixInverse({}, v.World);
-            frustum.Transform(localFrustum, inv);
-            return localFrustum.Contains(aabb) == ContainmentType::CONTAINS;
-        });
+    std::copy_if(transforms.begin(), transforms.end(),
+                 std::back_inserter(visibleParts),
+                 [&](const InstancingVertex& v) {
+                     return dx::IsVisible(bounds, v.World, planes);
+                 });
     dx::UpdateWithDiscard(context3D, dx::Ref(instancingBuffer),
                           gsl::make_span(visibleParts));
 }
@@ -86,7 +79,7 @@ void MainScene::BuildCamera()
     {
         light.Color = {1.0f, 1.0f, 1.0f, 1.0f};
         light.Enabled = true;
-        lights.emplace_back(light);
+        lights.Add(light);
     }
     camera.UseDefaultMoveEvents(true);
     camera.Viewport() = dx::Rect{0.0f, 0.0f, 1.0f, 1.0f};
@@ -139,15 +132,17 @@ void MainScene::Render(const dx::Game& game)
     using namespace dx::systems;
     auto& shaders = m_ballMaterial->Passes[0].Shaders;
     shaders.VertexShader_.Inputs.Set("TfMatrices", "ViewProj",
-                                     camera.GetView() * camera.GetProjection());
+                                     camera.GetViewProjection());
     PreparePsCb(context3D, shaders.PixelShader_.Inputs,
-                gsl::make_span(Lights()), camera);
+                Lights().GpuLights(), camera);
     const std::uint32_t instancingVertexSize =
         static_cast<std::uint32_t>(sizeof(InstancingVertex));
-    Culling(camera.Frustum(), m_ballMesh->Positions(), camera.GetView(),
-            m_instancingData, m_visibleBuffer, context3D, m_instancingBuffer);
+    auto visibleParts = game.FrameMemory().MakeVector<InstancingVertex>();
+    visibleParts.reserve(m_instancingData.size());
+    Culling(camera.WorldFrustumPlanes(), m_ballMesh->GetBounds(),
+            m_instancingData, visibleParts, context3D, m_instancingBuffer);
     dx::DrawMeshInstancing(context3D, *m_ballMesh, *m_ballMaterial,
-                           m_visibleBuffer.size(),
+                           visibleParts.size(),
                            dx::SingleAsSpan(m_instancingBuffer),
                            dx::SingleAsSpan(instancingVertexSize));
 }
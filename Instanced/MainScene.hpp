@@ -20,5 +20,4 @@ class MainScene : public dx::SceneBase
     std::shared_ptr<dx::Material> m_ballMaterial;
     dx::AlignedVec<InstancingVertex> m_instancingData;
     dx::TypedGpuBuffer<InstancingVertex> m_instancingBuffer;
-    std::vector<InstancingVertex> m_visibleBuffer;
 };
\ No newline at end of file
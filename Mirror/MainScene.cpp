@@ -192,7 +192,7 @@ void MainScene::BuildLights()
     auto& lights = Lights();
     for (auto& dirLight : dirLights)
     {
-        lights.emplace_back(std::move(dirLight));
+        lights.Add(dirLight);
     }
 }
 
@@ -250,16 +250,16 @@ void MainScene::Render(ID3D11DeviceContext& context3D,
         const auto meshRenderer = m_ball->GetComponent<dx::MeshRenderer>();
         auto sharedMesh = meshRenderer->SharedMesh();
         auto& material = meshRenderer->GetMaterial();
-        auto lights = Lights();
+        const auto sceneLights = Lights().GpuLights();
+        std::vector<dx::cb::Light> lights(sceneLights.begin(),
+                                          sceneLights.end());
         auto reflectionMatrix = DirectX::XMMatrixReflect(
             DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f));
         for (auto& light : lights)
         {
-            auto& direction = std::get<dx::DirectionalLight>(light).Direction;
-            auto dirF4 = dx::MakeDirection4(direction);
             auto reflected = DirectX::XMVector4Transform(
-                DirectX::XMLoadFloat4(&dirF4), reflectionMatrix);
-            DirectX::XMStoreFloat3(&direction, reflected);
+                DirectX::XMLoadFloat4(&light.Direction), reflectionMatrix);
+            DirectX::XMStoreFloat4(&light.Direction, reflected);
         }
         auto& transform =
             m_ball->GetComponent<dx::TransformComponent>()->GetTransform();
@@ -34,9 +34,26 @@ DirectX::BoundingBox BoxFromFrutum(const BoundingFrustum& frustum)
     return box;
 }
 
+// cascade 的投影是正交的（仿射变换），caster 的包围盒变换到 clip space
+// 后仍然可以用 AABB 判断。z 方向不设下限：在 cascade 与光源之间的物体
+// 也会把阴影投进这个 cascade。
+bool CasterAffectsCascade(const BoundingBox& localBox, const XMMATRIX& world,
+                          const XMMATRIX& worldToCascadeClip)
+{
+    BoundingBox clipBox;
+    localBox.Transform(clipBox, world * worldToCascadeClip);
+    const XMVECTOR center = XMLoadFloat3(&clipBox.Center);
+    const XMVECTOR extents = XMLoadFloat3(&clipBox.Extents);
+    const XMVECTOR minPoint = XMVectorSubtract(center, extents);
+    const XMVECTOR maxPoint = XMVectorAdd(center, extents);
+    return XMVector3LessOrEqual(minPoint, g_XMOne) &&
+           XMVector2GreaterOrEqual(maxPoint, g_XMNegativeOne);
+}
+
 void CascadedShadowMappingRenderer::GenerateShadowMap(
     const dx::GlobalGraphicsContext& gfxContext, const dx::Camera& camera,
-    gsl::span<const dx::Light> lights, gsl::span<const RenderNode> renderNodes,
+    gsl::span<const dx::cb::Light> lights,
+    gsl::span<const RenderNode> renderNodes,
     const dx::GlobalShaderContext& shaderContext)
 {
     ID3D11DeviceContext& context3D = gfxContext.Context3D();
@@ -47,12 +64,24 @@ void CascadedShadowMappingRenderer::GenerateShadowMap(
     context3D.OMSetRenderTargets(1, nullView.data(), m_worldDepthView.Get());
    // context3D.ClearRenderTargetView(rt, color.data());
     context3D.ClearDepthStencilView(m_worldDepthView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-    RunShadowCaster(renderNodes, shaderContext, context3D);
+    m_casterStats = ShadowCasterStats{};
+    m_casterStats.TotalCasters = static_cast<std::uint32_t>(renderNodes.size());
+    RunShadowCaster(renderNodes, shaderContext, camera.WorldFrustumPlanes(),
+                    context3D);
+    // 缓存静态阴影时，cascade 只按静态 caster 拟合：动态 caster 一动，
+    // split 和 ViewProj 就会跟着变，静态缓存每帧都要重画。动态 caster
+    // 超出静态 caster 深度范围的部分靠 shadow caster pass 关掉深度裁剪
+    // （PredefinedResources::GetShadowCaster）钳到近平面上。
+    const auto fitsCascades = [&](const RenderNode& node) {
+        return !m_config.CacheStaticCasters || node.IsStatic;
+    };
     BoundingBox viewSpaceSceneAabb;
     BoundingBox::CreateFromPoints(viewSpaceSceneAabb, g_XMNegInfinity,
                                   g_XMInfinity);
     for (const RenderNode& renderNode : renderNodes)
     {
+        if (!fitsCascades(renderNode))
+            continue;
         const BoundingBox& localBoundingBox = renderNode.mesh.GetBoundingBox();
         BoundingBox worldBoundingBox;
         localBoundingBox.Transform(worldBoundingBox,
@@ -64,21 +93,19 @@ void CascadedShadowMappingRenderer::GenerateShadowMap(
     // m_viewSpaceDepthMap contains what we want
     // second pass: CSM
     BoundingFrustum frustum = camera.Frustum();
-    const dx::Light& mainLight = lights[0];
+    const dx::cb::Light& mainLight = lights[0];
     BoundingFrustum lightSpaceFrustum;
     XMMATRIX lightSpaceViewMatrix;
     XMMATRIX lightSpaceProjMatrix;
     XMMATRIX viewToLight;
-    switch (mainLight.index())
+    switch (mainLight.Type)
     {
-        case dx::kDirectionalLight:
+        case dx::LightType::DirectionalLight:
         {
-            auto& directionalLight = std::get<DirectionalLight>(mainLight);
             lightSpaceViewMatrix = XMMatrixLookToLH(
-                XMVectorZero(), Load(directionalLight.Direction),
+                XMVectorZero(), XMLoadFloat4(&mainLight.Direction),
                 XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
-            viewToLight =
-                XMMatrixInverse({}, camera.GetView()) * lightSpaceViewMatrix;
+            viewToLight = camera.GetInverseView() * lightSpaceViewMatrix;
             BoundingBox lightSpaceAabb;
             viewSpaceSceneAabb.Transform(lightSpaceAabb, viewToLight);
             lightSpaceProjMatrix = OrthographicFromBoundingBox(lightSpaceAabb);
@@ -108,16 +135,64 @@ void CascadedShadowMappingRenderer::GenerateShadowMap(
         0.0f, 0.0f, m_config.ShadowMapSize.Width, m_config.ShadowMapSize.Height, 0, 1
     };;
     context3D.RSSetViewports(1, &viewport);
+    const bool stableFitting =
+        m_config.Fitting == CascadeFitting::kStableSphere &&
+        mainLight.Type == dx::LightType::DirectionalLight;
+    std::optional<BoundingBox> lightSpaceCasterBounds;
+    if (stableFitting)
+    {
+        // split 只取决于相机的 near/far。按 view space 中 caster 的范围
+        // 计算时，相机一转动 split 和外接球就跟着变，texel 对齐失去意义，
+        // 静态缓存也会失效。
+        if (frustum.Near != m_stableSplitsNear ||
+            frustum.Far != m_stableSplitsFar)
+        {
+            ComputePracticalSplits(frustum.Near, frustum.Far,
+                                   m_config.SplitLambda,
+                                   gsl::make_span(m_stableSplits));
+            m_stableSplitsNear = frustum.Near;
+            m_stableSplitsFar = frustum.Far;
+        }
+        // light space 与相机无关，caster 的范围只用来延伸 near。
+        for (const RenderNode& renderNode : renderNodes)
+        {
+            if (!fitsCascades(renderNode))
+                continue;
+            BoundingBox box;
+            renderNode.mesh.GetBoundingBox().Transform(
+                box, renderNode.World * lightSpaceViewMatrix);
+            if (lightSpaceCasterBounds)
+                BoundingBox::CreateMerged(*lightSpaceCasterBounds,
+                                          *lightSpaceCasterBounds, box);
+            else
+                lightSpaceCasterBounds = box;
+        }
+    }
+    const std::size_t staticSignature =
+        m_config.CacheStaticCasters ? HashStaticCasters(renderNodes) : 0;
     for (std::uint32_t i = 0; i < partitionCount; ++i)
     {
-        const float low = nearZ + m_partitions[i] * nearFarDistance;
-        const float high = nearZ + m_partitions[i + 1] * nearFarDistance;
-        m_intervals[i] = low;
-        XMMATRIX projMatrix = CalcLightProjMatrix(
-            mainLight, frustum, low, high, lightSpaceProjMatrix,
-            viewSpaceSceneAabb, viewToLight);
-        shaderContextForShadowMapping.ProjMatrix =
-            lightSpaceProjMatrix * projMatrix;
+        if (stableFitting)
+        {
+            m_intervals[i] = m_stableSplits[i];
+            BoundingSphere sphere = SliceBoundingSphere(
+                frustum, m_stableSplits[i], m_stableSplits[i + 1]);
+            sphere.Transform(sphere, camera.GetInverseView());
+            shaderContextForShadowMapping.ProjMatrix = FitStableCascade(
+                sphere, lightSpaceViewMatrix, m_config.ShadowMapSize.Width,
+                lightSpaceCasterBounds);
+        }
+        else
+        {
+            const float low = nearZ + m_partitions[i] * nearFarDistance;
+            const float high = nearZ + m_partitions[i + 1] * nearFarDistance;
+            m_intervals[i] = low;
+            XMMATRIX projMatrix = CalcLightProjMatrix(
+                mainLight, frustum, low, high, lightSpaceProjMatrix,
+                viewSpaceSceneAabb, viewToLight);
+            shaderContextForShadowMapping.ProjMatrix =
+                lightSpaceProjMatrix * projMatrix;
+        }
         if (!m_lightSpaceFrustum[i])
         {
             m_lightSpaceFrustum[i] = MeshFromFrustum(
@@ -126,27 +201,67 @@ void CascadedShadowMappingRenderer::GenerateShadowMap(
         shaderContextForShadowMapping.ViewProjMatrix =
             shaderContextForShadowMapping.ViewMatrix *
             shaderContextForShadowMapping.ProjMatrix;
+        shaderContextForShadowMapping.BeginView();
         m_lightViewProjs[i] = viewToLight * shaderContextForShadowMapping.ProjMatrix;
         ID3D11RenderTargetView* rt = m_shadowMapRtViews[i].Get();
         context3D.OMSetRenderTargets(1, &rt, m_shadowMapRtDepthStencil.View());
-        std::array<float, 4> color = {};
-        context3D.ClearRenderTargetView(rt, color.data());
-        m_shadowMapRtDepthStencil.ClearBoth(context3D);
-        ShaderInputs inputs;
-        for (const RenderNode& renderNode : renderNodes)
+        const auto drawCasters = [&](auto&& predicate) {
+            for (const RenderNode& renderNode : renderNodes)
+            {
+                if (!predicate(renderNode) ||
+                    !CasterAffectsCascade(
+                        renderNode.mesh.GetBoundingBox(), renderNode.World,
+                        shaderContextForShadowMapping.ViewProjMatrix))
+                    continue;
+                ++m_casterStats.CascadeCasters[i];
+                // FIXME：如何避免上一个对象设置的 buffer 遗留的问题？
+                FillUpShaders(context3D, renderNode.material.shadowCasterPass,
+                              renderNode.World, nullptr,
+                              shaderContextForShadowMapping);
+                DrawMesh(context3D, renderNode.mesh,
+                         *renderNode.material.shadowCasterPass.pass);
+            }
+        };
+        const auto clear = [&] {
+            std::array<float, 4> color = {};
+            context3D.ClearRenderTargetView(rt, color.data());
+            m_shadowMapRtDepthStencil.ClearBoth(context3D);
+        };
+        if (!m_config.CacheStaticCasters)
         {
-            // FIXME：如何避免上一个对象设置的 buffer 遗留的问题？
-            FillUpShaders(context3D, renderNode.material.shadowCasterPass,
-                          renderNode.World, nullptr,
-                          shaderContextForShadowMapping);
-            DrawMesh(context3D, renderNode.mesh,
-                     *renderNode.material.shadowCasterPass.pass);
+            clear();
+            drawCasters([](const RenderNode&) { return true; });
+            continue;
         }
+        const UINT subresource = D3D11CalcSubresource(0, i, 1);
+        if (m_staticShadowCache.NeedsStaticRedraw(
+                i, shaderContextForShadowMapping.ViewProjMatrix,
+                staticSignature))
+        {
+            clear();
+            drawCasters([](const RenderNode& node) { return node.IsStatic; });
+            context3D.CopySubresourceRegion(
+                m_staticDepthTexArray.Get(), subresource, 0, 0, 0,
+                m_depthTexArray.Get(), subresource, nullptr);
+            context3D.CopyResource(&m_staticDepthStencils[i].Tex(),
+                                   &m_shadowMapRtDepthStencil.Tex());
+        }
+        else
+        {
+            ++m_casterStats.CachedCascades;
+            context3D.CopySubresourceRegion(
+                m_depthTexArray.Get(), subresource, 0, 0, 0,
+                m_staticDepthTexArray.Get(), subresource, nullptr);
+            context3D.CopyResource(&m_shadowMapRtDepthStencil.Tex(),
+                                   &m_staticDepthStencils[i].Tex());
+        }
+        // 动态 caster 叠加在静态深度之上。
+        drawCasters([](const RenderNode& node) { return !node.IsStatic; });
     }
     /*if (!m_cubePass)
     {
         const auto mappedCso =
-            MemoryMappedCso{fs::current_path() / L"CubeVS.cso"};
+            MappedFile{fs::current_path() / L"CubeVS.cso"};
         m_cubePass = std::make_shared<Pass>(Pass{MakeShaderCollection(
             Shader{gfxContext.Device3D(), mappedCso.Bytes()},
             dx::Shader::FromCompiledCso(gfxContext.Device3D(),
@@ -174,8 +289,7 @@ void CascadedShadowMappingRenderer::GenerateShadowMap(
     float color[4] = {};
     context3D.ClearRenderTargetView(m_sssmRt.Get(), color);
     ShaderInputs& inputs = m_collectPass.inputs;
-    const XMMATRIX invProj = XMMatrixInverse({}, camera.GetProjection());
-    inputs.SetField("InvProj", invProj);
+    inputs.SetField("InvProj", camera.GetInverseProjection());
     inputs.SetField("lightSpaceProjs", m_lightViewProjs);
     inputs.SetField("Intervals", m_intervals);
     inputs.Bind("DepthMap", m_depthSrv);
@@ -214,13 +328,17 @@ CascadedShadowMappingRenderer::GetCsmTexArray() const
 void CascadedShadowMappingRenderer::RunShadowCaster(
     gsl::span<const dx::RenderNode>& renderNodes,
     const dx::GlobalShaderContext& shaderContextForShadowMapping,
-    ID3D11DeviceContext& context3D)
+    const dx::FrustumPlanes& cameraPlanes, ID3D11DeviceContext& context3D)
 {
     for (const RenderNode& renderNode : renderNodes)
     {
         const Material& material = renderNode.material;
-        if (material.shadowCasterPass.pass)
+        // 这个 pass 只为主相机收集深度，看不见的物体不用画。
+        if (material.shadowCasterPass.pass &&
+            IsVisible(renderNode.mesh.GetBounds(), renderNode.World,
+                      cameraPlanes))
         {
+            ++m_casterStats.DepthPrePassCasters;
             FillUpShaders(context3D, material.shadowCasterPass,
                           renderNode.World, nullptr,
                           shaderContextForShadowMapping);
@@ -265,13 +383,13 @@ std::shared_ptr<dx::Mesh> CascadedShadowMappingRenderer::MeshFromFrustum(
 }
 
 DirectX::XMMATRIX CascadedShadowMappingRenderer::CalcLightProjMatrix(
-    const dx::Light& light, DirectX::BoundingFrustum& existingFrustum,
+    const dx::cb::Light& light, DirectX::BoundingFrustum& existingFrustum,
     float low, float high, const XMMATRIX& lightProjMatrix,
     const DirectX::BoundingBox& viewSpaceAabb, const XMMATRIX& viewToLight)
 {
-    switch (light.index())
+    switch (light.Type)
     {
-        case kDirectionalLight:
+        case LightType::DirectionalLight:
         {
             // BUG:
             //上面的 viewSpaceSceneAabb 是物体求出的
@@ -398,6 +516,14 @@ void CascadedShadowMappingRenderer::CreateCsmGenerationResources(
             m_shadowMapRtViews[i].GetAddressOf()));
     }
     m_shadowMapRtDepthStencil = DepthStencil{device3D, size};
+
+    // 只作为复制的来源和目标。
+    depthTexArrayDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    TryHR(device3D.CreateTexture2D(&depthTexArrayDesc, nullptr,
+                                   m_staticDepthTexArray.GetAddressOf()));
+    for (DepthStencil& depthStencil : m_staticDepthStencils)
+        depthStencil = DepthStencil{device3D, size};
+    m_staticShadowCache.Invalidate();
 }
 
 void CascadedShadowMappingRenderer::CreateSssmRt(ID3D11Device& device3D,
@@ -445,13 +571,15 @@ void CascadedShadowMappingRenderer::CreateSssmRt(ID3D11Device& device3D,
          semantics, 4, std::move(inputElementsDesces),
      quadPositions, quadTexCoords);
 
+     const dx::ShaderSource collectSources[] = {
+         fs::current_path() / "ShadowCollectVS.cso",
+         fs::current_path() / "ShadowCollectPS.cso"};
+     std::vector<dx::Shader> collectShaders =
+         dx::LoadShaders(device3D, collectSources);
      m_collectPass.pass = std::make_shared<dx::Pass>(dx::Pass
      {
-         MakeShaderCollection(
-             dx::Shader::FromCompiledCso(device3D, fs::current_path() /
-                                                       "ShadowCollectVS.cso"),
-             dx::Shader::FromCompiledCso(device3D, fs::current_path() /
-                                                       L"ShadowCollectPS.cso"))
+         MakeShaderCollection(std::move(collectShaders[0]),
+                              std::move(collectShaders[1]))
      });
      CD3D11_SAMPLER_DESC samplerDesc{ CD3D11_DEFAULT{} };
      samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
@@ -5,11 +5,35 @@ inline static constexpr std::uint32_t kCascadedCount = 4;
 template<typename T>
 using CascadedArray = std::array<T, kCascadedCount>;
 
+enum class CascadeFitting
+{
+    // 每帧用 caster 与视锥的包围盒重新拟合，分辨率利用率高但会闪烁。
+    kTightBounds,
+    // 每段视锥用外接球拟合，并按 texel 对齐。
+    kStableSphere
+};
+
 struct CascadedShadowMapConfig
 {
     dx::Size ShadowMapSize;
     dx::Size ScreenSpaceTexSize;
+    // 只用于 kTightBounds。
     std::array<float, kCascadedCount + 1> Intervals;
+    CascadeFitting Fitting = CascadeFitting::kStableSphere;
+    // 只用于 kStableSphere，见 dx::ComputePracticalSplits。
+    float SplitLambda = 0.75f;
+    // 缓存每个 cascade 中静态 caster 的深度，之后只叠加动态 caster。
+    bool CacheStaticCasters = true;
+};
+
+// 上一帧各个 pass 实际绘制的 caster 数。
+struct ShadowCasterStats
+{
+    std::uint32_t DepthPrePassCasters = 0;
+    CascadedArray<std::uint32_t> CascadeCasters = {};
+    std::uint32_t TotalCasters = 0;
+    // 直接使用了缓存的静态深度的 cascade 数。
+    std::uint32_t CachedCascades = 0;
 };
 
 class CascadedShadowMappingRenderer
@@ -20,15 +44,16 @@ class CascadedShadowMappingRenderer
 
     void GenerateShadowMap(const dx::GlobalGraphicsContext& gfxContext,
                            const dx::Camera& camera,
-                           gsl::span<const dx::Light> lights,
+                           gsl::span<const dx::cb::Light> lights,
                            gsl::span<const dx::RenderNode> renderNodes,
                            const dx::GlobalShaderContext& shaderContext);
 
     wrl::ComPtr<ID3D11ShaderResourceView> GetCsmTexArray() const;
+    const ShadowCasterStats& GetCasterStats() const { return m_casterStats; }
 
   private:
     DirectX::XMMATRIX
-    CalcLightProjMatrix(const dx::Light& light,
+    CalcLightProjMatrix(const dx::cb::Light& light,
                         DirectX::BoundingFrustum& existingFrustum, float low,
                         float high, const DirectX::XMMATRIX& lightProjMatrix,
                         const DirectX::BoundingBox& lightSpaceViewAabb,
@@ -41,6 +66,7 @@ class CascadedShadowMappingRenderer
     void RunShadowCaster(
         gsl::span<const dx::RenderNode>& renderNodes,
         const dx::GlobalShaderContext& shaderContextForShadowMapping,
+        const dx::FrustumPlanes& cameraPlanes,
         ID3D11DeviceContext& context3D);
     void DrawCube(gsl::span<const DirectX::XMFLOAT3> points);
     std::shared_ptr<dx::Mesh>
@@ -58,6 +84,10 @@ class CascadedShadowMappingRenderer
     wrl::ComPtr<ID3D11Texture2D> m_depthTexArray;
     wrl::ComPtr<ID3D11ShaderResourceView> m_shadowMapTexArraySrv;
     dx::DepthStencil m_shadowMapRtDepthStencil;
+    // 与 m_depthTexArray 和 m_shadowMapRtDepthStencil 对应，只含静态 caster。
+    wrl::ComPtr<ID3D11Texture2D> m_staticDepthTexArray;
+    CascadedArray<dx::DepthStencil> m_staticDepthStencils;
+    dx::StaticShadowCache m_staticShadowCache{kCascadedCount};
     CascadedArray<wrl::ComPtr<ID3D11RenderTargetView>> m_shadowMapRtViews;
     wrl::ComPtr<ID3D11SamplerState> m_nearestPointSampler;
     std::array<std::shared_ptr<dx::Mesh>, kCascadedCount> m_lightSpaceFrustum;
@@ -72,6 +102,11 @@ class CascadedShadowMappingRenderer
     CascadedShadowMapConfig m_config;
     std::shared_ptr<dx::Mesh> m_screenSpaceQuad;
     std::array<float, kCascadedCount> m_intervals;
+    // kStableSphere 的 split，相机的 near/far 不变时保持不变。
+    std::array<float, kCascadedCount + 1> m_stableSplits{};
+    float m_stableSplitsNear = 0.0f;
+    float m_stableSplitsFar = 0.0f;
+    ShadowCasterStats m_casterStats;
 };
 
 DirectX::XMMATRIX MatrixFromTransform(dx::TransformComponent* transform);
@@ -1,6 +1,7 @@
 #include "Pch.hpp"
 #include <DirectXColors.h>
 #include "MainScene.hpp"
+#include <EasyDx/InputSystem.hpp>
 #include <EasyDx/Systems/SimpleRender.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -13,6 +14,9 @@ MainScene::MainScene(dx::Game& game) : dx::SceneBase{game}
     BuildCamera();
     BuildLights();
     LoadScene(dx::PredefinedResources::GetInstance());
+    AddOrbiter();
+    m_noClusterInputs.SetField("dx_ClusterDims",
+                               std::array<std::uint32_t, 3>{});
     m_shadowMapRenderer = std::make_unique<CascadedShadowMappingRenderer>(
         Device3D,
         CascadedShadowMapConfig{dx::Size{1024, 1024}, dx::Size{1008, 985},
@@ -52,21 +56,28 @@ void MainScene::LoadScene(const dx::PredefinedResources& predefinedRes)
             throw std::runtime_error{importer.GetErrorString()};
         return ptr;
     };
-    const aiScene* const scene =
-        TryAssimp(importer.ReadFile(modelPath.u8string().c_str(),
-                                    aiProcessPreset_TargetRealtime_MaxQuality));
+    // tangents are generated by dx::LoadedMeshFromAiMesh, which is much
+    // cheaper than aiProcess_CalcTangentSpace.
+    constexpr unsigned int kImportFlags =
+        aiProcessPreset_TargetRealtime_MaxQuality & ~aiProcess_CalcTangentSpace;
+    const aiScene* const scene = TryAssimp(
+        importer.ReadFile(modelPath.u8string().c_str(), kImportFlags));
     CollectMaterials(*scene, modelPath.parent_path(), predefinedRes,
                      m_materials);
     using namespace DirectX;
+    dx::LoadedMesh loadedMesh;
     for (const aiMesh* aiMesh_ : dx::GetMeshesInScene(*scene))
     {
-        std::shared_ptr<dx::Mesh> mesh =
-            dx::ConvertToImmutableMesh(Device3D, *aiMesh_);
+        dx::LoadedMeshFromAiMesh(*aiMesh_, dx::LoadFlags::kAll, loadedMesh);
+        std::shared_ptr<dx::Mesh> mesh = dx::ConvertToImmutableMesh(
+            Device3D, loadedMesh,
+            dx::AsD3DPrimitiveTopology(
+                static_cast<aiPrimitiveType>(aiMesh_->mPrimitiveTypes)));
         m_objects.push_back(std::make_shared<dx::Object>(
             dx::MeshRenderer{mesh, m_materials[aiMesh_->mMaterialIndex]}));
         m_objects.push_back(std::make_shared<dx::Object>(
             dx::MeshRenderer{mesh, m_materials[aiMesh_->mMaterialIndex]},
-            dx::TransformComponent{dx::Transform(
+            dx::TransformHandleComponent{Transforms().Create(
                 XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f), XMQuaternionIdentity(),
                 XMVectorSet(0.0f, 0.0f, 15.0f, 0.0f))}));
        /* m_objects.push_back(std::make_shared<dx::Object>(
@@ -77,6 +88,35 @@ void MainScene::LoadScene(const dx::PredefinedResources& predefinedRes)
     }
 }
 
+void MainScene::AddOrbiter()
+{
+    using namespace DirectX;
+    dx::LoadedMesh sphereMesh;
+    dx::MakeUVSphere(1.0f, 24, 24, sphereMesh);
+    const std::shared_ptr<dx::Mesh> mesh = dx::ConvertToImmutableMesh(
+        Device3D, sphereMesh, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    m_orbiterTransform = Transforms().Create();
+    m_orbiter = std::make_shared<dx::Object>(
+        dx::MeshRenderer{mesh, m_materials.front()},
+        dx::TransformHandleComponent{m_orbiterTransform});
+    m_objects.push_back(m_orbiter);
+}
+
+void MainScene::Update(const dx::UpdateArgs& args, const dx::Game& game)
+{
+    using namespace DirectX;
+    m_clusteredLighting =
+        !game.GetInputSystem().IsPressing(dx::VirtualKey::kL);
+    constexpr float kOrbitSpeed = 0.5f;
+    constexpr float kOrbitRadius = 6.0f;
+    m_orbitAngle += kOrbitSpeed *
+                    std::chrono::duration<float>{args.Delta}.count();
+    Transforms().SetPosition(
+        m_orbiterTransform,
+        XMVectorSet(kOrbitRadius * std::cos(m_orbitAngle), 3.0f,
+                    kOrbitRadius * std::sin(m_orbitAngle) + 7.5f, 0.0f));
+}
+
 // void MainScene::DrawQuad(ID3D11DeviceContext& context3D, const dx::Mesh&
 // mesh,
 //                         ID3D11ShaderResourceView& tex,
@@ -94,7 +134,7 @@ void MainScene::LoadScene(const dx::PredefinedResources& predefinedRes)
 //    DrawMesh(context3D, mesh, *m_quadMat);
 //}
 
-void MainScene::PrepareRenderParams(std::vector<dx::RenderNode>& nodes,
+void MainScene::PrepareRenderParams(std::pmr::vector<dx::RenderNode>& nodes,
                                     dx::GlobalShaderContext& context)
 {
     nodes.clear();
@@ -106,15 +146,62 @@ void MainScene::PrepareRenderParams(std::vector<dx::RenderNode>& nodes,
         nodes.push_back(dx::RenderNode{
             renderer->GetMesh(), renderer->GetMaterial(),
             dx::MatrixFromTransform(
-                object->GetComponent<dx::TransformComponent>())});
+                Transforms(),
+                object->GetComponent<dx::TransformHandleComponent>()),
+            // 除了 m_orbiter，场景中的物体都不会移动。
+            nullptr, object != m_orbiter, renderer->CbKey()});
     }
     auto& camera = MainCamera();
     context.ProjMatrix = camera.GetProjection();
     context.ViewMatrix = camera.GetView();
-    context.ViewProjMatrix = context.ViewMatrix * context.ProjMatrix;
+    context.ViewProjMatrix = camera.GetViewProjection();
     context.EyePos = camera.GetEyePos();
-    context.lightCount = Lights().size();
-    std::copy(Lights().begin(), Lights().end(), context.lights);
+    // 使用 cluster 时其它光源在 PrepareClusters 中分配到 cluster，否则
+    // 超出的光源由每个物体通过 m_lightBvh 单独选择。
+    int lightCount = 0;
+    for (const dx::cb::Light& light : Lights().GpuLights())
+    {
+        if (m_clusteredLighting &&
+            light.Type != dx::LightType::DirectionalLight)
+            continue;
+        if (lightCount == static_cast<int>(std::size(context.lights)))
+            break;
+        context.lights[lightCount++] = light;
+    }
+    context.lightCount = lightCount;
+    context.BeginFrame();
+}
+
+void MainScene::PrepareClusters(ID3D11DeviceContext& context3D,
+                                dx::GlobalGraphicsContext& gfxContext)
+{
+    m_lightBinner.Build(Lights().GpuLights(), MainCamera());
+    m_clusterBuffers.Upload(Device3D, context3D, m_lightBinner);
+    // 容量不够时 buffer 会重新创建。ShaderInputs 中的资源不能重新绑定，
+    // view 变化时整个换掉。
+    const std::array views = {m_clusterBuffers.LightsView(),
+                              m_clusterBuffers.IndicesView(),
+                              m_clusterBuffers.ClustersView()};
+    if (views != m_boundClusterViews)
+    {
+        m_clusterInputs = dx::ShaderInputs{};
+        m_clusterInputs
+            .Bind("dx_ClusterLights",
+                  wrl::ComPtr<ID3D11ShaderResourceView>{views[0]})
+            .Bind("dx_ClusterLightIndices",
+                  wrl::ComPtr<ID3D11ShaderResourceView>{views[1]})
+            .Bind("dx_Clusters",
+                  wrl::ComPtr<ID3D11ShaderResourceView>{views[2]});
+        m_boundClusterViews = views;
+    }
+    const dx::cb::ClusterGrid grid =
+        m_lightBinner.GridConstants(gfxContext.GetSwapChain().BufferSize());
+    m_clusterInputs.SetField(
+        "dx_ClusterDims",
+        std::array{grid.TilesX, grid.TilesY, grid.SlicesZ});
+    m_clusterInputs.SetField("dx_SliceScale", grid.SliceScale);
+    m_clusterInputs.SetField("dx_SliceBias", grid.SliceBias);
+    m_clusterInputs.SetField("dx_TileScale", grid.TileScale);
 }
 
 // void MainScene::AppendShadowMappingPass(dx::Material& material, const
@@ -177,8 +264,19 @@ const DirectX::XMFLOAT3 LightDir = {0.57735f, -0.57735f, 0.57735f};
 void MainScene::BuildLights()
 {
     auto& lights = Lights();
-    lights.emplace_back(
+    lights.Add(
         dx::DirectionalLight{{1.0f, 1.0f, 1.0f, 0.0f}, LightDir, true});
+    // 两个房间里各有一盏灯，走 clustered lighting。
+    lights.Add(dx::PointLight{{0.0f, 3.0f, 0.0f},
+                              {1.0f, 0.8f, 0.6f, 1.0f},
+                              {1.0f, 0.1f, 0.0f},
+                              8.0f,
+                              true});
+    lights.Add(dx::PointLight{{0.0f, 3.0f, 15.0f},
+                              {0.6f, 0.8f, 1.0f, 1.0f},
+                              {1.0f, 0.1f, 0.0f},
+                              8.0f,
+                              true});
 }
 
 /*
@@ -250,25 +348,44 @@ void MainScene::Render(ID3D11DeviceContext& context3D,
                        dx::GlobalGraphicsContext& gfxContext,
                        const dx::Game& game)
 {
-    std::vector<dx::RenderNode> renderNodes;
+    // 只在这一帧内使用，从 frame arena 中分配。
+    auto renderNodes = game.FrameMemory().MakeVector<dx::RenderNode>();
     dx::GlobalShaderContext context;
     PrepareRenderParams(renderNodes, context);
     ID3D11RenderTargetView* const mainRt = gfxContext.MainRt();
     gfxContext.ClearBoth();
     gfxContext.ClearMainRt(DirectX::Colors::White);
-    m_shadowMapRenderer->GenerateShadowMap(gfxContext, MainCamera(), Lights(),
+    m_shadowMapRenderer->GenerateShadowMap(gfxContext, MainCamera(),
+                                           Lights().GpuLights(),
                                            gsl::make_span(renderNodes),
                                            context);
      context3D.OMSetRenderTargets(1, &mainRt,
      gfxContext.GetDepthStencil().View());
+    if (m_clusteredLighting)
+    {
+        PrepareClusters(context3D, gfxContext);
+    }
+    else
+    {
+        m_lightBvh.Build(Lights().GpuLights());
+        dx::SelectLightsForNodes(m_lightBvh, gsl::make_span(renderNodes),
+                                 m_objectLights);
+    }
     ////TODO: sort by material
-     for (const dx::RenderNode& node : renderNodes)
+    for (std::size_t i = 0; i < renderNodes.size(); ++i)
     {
+        const dx::RenderNode& node = renderNodes[i];
         const dx::Material& material = node.material;
         const dx::Mesh& mesh = node.mesh;
         const dx::PassWithShaderInputs& mainPassWithInputs =
-        material.mainPass; dx::FillUpShaders(context3D,
-        mainPassWithInputs, node.World, nullptr, context);
+            material.mainPass;
+        if (m_clusteredLighting)
+            dx::FillUpShaders(context3D, mainPassWithInputs, node.World,
+                              &m_clusterInputs, context, node.CbKey);
+        else
+            dx::FillUpShaders(context3D, mainPassWithInputs, node.World,
+                              &m_noClusterInputs, context, m_objectLights[i],
+                              node.CbKey);
         dx::DrawMesh(context3D, mesh, mainPassWithInputs.pass);
     }
 
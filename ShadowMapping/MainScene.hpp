@@ -2,6 +2,8 @@
 
 #include <DirectXMath.h>
 #include <EasyDx/Fwd.hpp>
+#include <EasyDx/ClusteredLighting.hpp>
+#include <EasyDx/LightBvh.hpp>
 #include "CascadedShadowMappingRenderer.hpp"
 
 class MainScene : public dx::SceneBase
@@ -20,12 +22,32 @@ class MainScene : public dx::SceneBase
                      std::vector<std::shared_ptr<dx::Material>>& materials);
     void Render(ID3D11DeviceContext& context3D,
                 dx::GlobalGraphicsContext& gfxContext, const dx::Game& game);
+    void Update(const dx::UpdateArgs& args, const dx::Game& game) override;
+    void AddOrbiter();
     // void InitShadowMapping(dx::Game& game);
 
-    void PrepareRenderParams(std::vector<dx::RenderNode>& nodes,
+    void PrepareRenderParams(std::pmr::vector<dx::RenderNode>& nodes,
                              dx::GlobalShaderContext& context);
+    void PrepareClusters(ID3D11DeviceContext& context3D,
+                         dx::GlobalGraphicsContext& gfxContext);
     std::vector<std::shared_ptr<dx::Object>> m_objects;
     std::vector<std::shared_ptr<dx::Material>> m_materials;
     std::shared_ptr<dx::Mesh> m_quad;
+    // 绕场景转动的球，是唯一的动态 caster，阴影每帧重画。
+    std::shared_ptr<dx::Object> m_orbiter;
+    dx::TransformHandle m_orbiterTransform;
+    float m_orbitAngle = 0.0f;
     std::unique_ptr<CascadedShadowMappingRenderer> m_shadowMapRenderer;
+    // point/spot light 按 cluster 分配，BasicPS 中逐像素查找；方向光仍然
+    // 通过 GlobalShaderContext 传入。按住 L 时关闭，用来对照结果。
+    bool m_clusteredLighting = true;
+    dx::ClusteredLightBinner m_lightBinner;
+    dx::ClusteredLightBuffers m_clusterBuffers;
+    dx::ShaderInputs m_clusterInputs;
+    std::array<ID3D11ShaderResourceView*, 3> m_boundClusterViews{};
+    // dx_ClusterDims 为 0，BasicPS 因此使用 dx_Lights 中的全部光源。
+    dx::ShaderInputs m_noClusterInputs;
+    // 不使用 cluster 时由 m_lightBvh 为每个物体挑选光源。
+    dx::LightBvh m_lightBvh;
+    std::vector<dx::ObjectLights> m_objectLights;
 };